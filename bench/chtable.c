@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "unic.h"
+
+/* Contention benchmark: every thread runs a mix of 90% lookups and 10%
+ * insert/remove pairs on a shared map, the sharded #chtable_t is compared
+ * against a single #htable_t guarded by one mutex.
+ *
+ * Usage: chtable_bench [max_threads] */
+
+#define BENCH_KEYS 65536
+#define BENCH_OPS 2000000
+#define BENCH_WRITE_PERCENT 10
+
+typedef struct bench_map bench_map_t;
+
+struct bench_map {
+  const char *name;
+  ptr_t map;
+  mutex_t *mutex;
+  void (*insert)(bench_map_t *map, ptr_t key, ptr_t value);
+  ptr_t (*lookup)(bench_map_t *map, ptr_t key);
+  void (*remove)(bench_map_t *map, ptr_t key);
+};
+
+typedef struct bench_worker {
+  bench_map_t *map;
+  size_t nops;
+  u32_t seed;
+} bench_worker_t;
+
+static void
+bench_mutex_insert(bench_map_t *map, ptr_t key, ptr_t value) {
+  u_mutex_lock(map->mutex);
+  u_htable_insert((htable_t *) map->map, key, value);
+  u_mutex_unlock(map->mutex);
+}
+
+static ptr_t
+bench_mutex_lookup(bench_map_t *map, ptr_t key) {
+  ptr_t ret;
+
+  u_mutex_lock(map->mutex);
+  ret = u_htable_lookup((htable_t *) map->map, key);
+  u_mutex_unlock(map->mutex);
+  return ret;
+}
+
+static void
+bench_mutex_remove(bench_map_t *map, ptr_t key) {
+  u_mutex_lock(map->mutex);
+  u_htable_remove((htable_t *) map->map, key);
+  u_mutex_unlock(map->mutex);
+}
+
+static void
+bench_sharded_insert(bench_map_t *map, ptr_t key, ptr_t value) {
+  u_chtable_insert((chtable_t *) map->map, key, value);
+}
+
+static ptr_t
+bench_sharded_lookup(bench_map_t *map, ptr_t key) {
+  return u_chtable_lookup((chtable_t *) map->map, key);
+}
+
+static void
+bench_sharded_remove(bench_map_t *map, ptr_t key) {
+  u_chtable_remove((chtable_t *) map->map, key);
+}
+
+static u32_t
+bench_xorshift(u32_t *state) {
+  u32_t x;
+
+  x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return *state = x;
+}
+
+static ptr_t
+bench_worker_func(ptr_t data) {
+  bench_worker_t *worker;
+  size_t i;
+  u32_t r;
+  ptr_t key;
+
+  worker = (bench_worker_t *) data;
+  for (i = 0; i < worker->nops; ++i) {
+    r = bench_xorshift(&worker->seed);
+    key = PUINT_TO_POINTER ((r >> 8) % BENCH_KEYS + 1);
+    if ((r & 0xFF) % 100 < BENCH_WRITE_PERCENT) {
+      worker->map->remove(worker->map, key);
+      worker->map->insert(worker->map, key, key);
+    } else {
+      worker->map->lookup(worker->map, key);
+    }
+  }
+  return NULL;
+}
+
+static double
+bench_run(bench_map_t *map, int nthreads) {
+  thread_t **threads;
+  bench_worker_t *workers;
+  profiler_t *profiler;
+  u64_t usecs;
+  int i;
+
+  threads = u_malloc0(sizeof(thread_t *) * nthreads);
+  workers = u_malloc0(sizeof(bench_worker_t) * nthreads);
+  profiler = u_profiler_new();
+  if (threads == NULL || workers == NULL || profiler == NULL) {
+    fprintf(stderr, "Failed to allocate memory\n");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < nthreads; ++i) {
+    workers[i].map = map;
+    workers[i].nops = BENCH_OPS / nthreads;
+    workers[i].seed = 2463534242U + (u32_t) i * 0x9E3779B9U;
+  }
+  u_profiler_reset(profiler);
+  for (i = 0; i < nthreads; ++i) {
+    threads[i] = u_thread_create(bench_worker_func, &workers[i], true);
+  }
+  for (i = 0; i < nthreads; ++i) {
+    u_thread_join(threads[i]);
+    u_thread_unref(threads[i]);
+  }
+  usecs = u_profiler_elapsed_usecs(profiler);
+  u_profiler_free(profiler);
+  u_free(workers);
+  u_free(threads);
+  return usecs > 0 ? (double) BENCH_OPS / (double) usecs : 0.0;
+}
+
+int
+main(int ac, char **av) {
+  bench_map_t maps[2];
+  int max_threads;
+  int nthreads;
+  int i, j;
+
+  u_libsys_init();
+  maps[0].name = "mutex htable_t";
+  maps[0].map = u_htable_new();
+  maps[0].mutex = u_mutex_new();
+  maps[0].insert = bench_mutex_insert;
+  maps[0].lookup = bench_mutex_lookup;
+  maps[0].remove = bench_mutex_remove;
+  maps[1].name = "sharded chtable_t";
+  maps[1].map = u_chtable_new();
+  maps[1].mutex = NULL;
+  maps[1].insert = bench_sharded_insert;
+  maps[1].lookup = bench_sharded_lookup;
+  maps[1].remove = bench_sharded_remove;
+  for (i = 0; i < 2; ++i) {
+    for (j = 1; j <= BENCH_KEYS; ++j) {
+      maps[i].insert(&maps[i], PINT_TO_POINTER (j), PINT_TO_POINTER (j));
+    }
+  }
+  max_threads = ac > 1 ? atoi(av[1]) : u_thread_ideal_count();
+  if (max_threads < 1) {
+    max_threads = 1;
+  }
+  printf("%d keys, %d ops, %d%% writes\n", BENCH_KEYS, BENCH_OPS,
+    BENCH_WRITE_PERCENT);
+  printf("%-8s %20s %20s\n", "threads", maps[0].name, maps[1].name);
+  for (nthreads = 1; nthreads <= max_threads; nthreads <<= 1) {
+    printf("%-8d", nthreads);
+    for (i = 0; i < 2; ++i) {
+      printf(" %14.2f Mop/s", bench_run(&maps[i], nthreads));
+    }
+    printf("\n");
+    if (nthreads < max_threads && nthreads << 1 > max_threads) {
+      nthreads = max_threads >> 1;
+    }
+  }
+  u_mutex_free(maps[0].mutex);
+  u_htable_free((htable_t *) maps[0].map);
+  u_chtable_free((chtable_t *) maps[1].map);
+  u_libsys_shutdown();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "unic.h"
+
+/* Integer key benchmark: a tree created with u_tree_new() and a callback
+ * comparison is compared against u_tree_new_int() with inline comparisons,
+ * for every tree type. Keys are inserted and then looked up in random order.
+ *
+ * Usage: tree_bench [nkeys] */
+
+#define BENCH_DEFAULT_KEYS 1000000
+#define BENCH_LOOKUP_ROUNDS 4
+
+static const char *bench_type_names[] = {"binary", "rb", "avl", "btree"};
+
+static int
+bench_compare(const_ptr_t a, const_ptr_t b) {
+  int x, y;
+
+  x = PPOINTER_TO_INT (a);
+  y = PPOINTER_TO_INT (b);
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static u32_t
+bench_xorshift(u32_t *state) {
+  u32_t x;
+
+  x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return *state = x;
+}
+
+/* Returns the insertion and the lookup rates in Mop/s */
+static void
+bench_run(tree_t *tree, const int *keys, int nkeys, double *insert_rate,
+  double *lookup_rate) {
+  profiler_t *profiler;
+  u64_t usecs;
+  int i, j;
+
+  if ((profiler = u_profiler_new()) == NULL) {
+    fprintf(stderr, "Failed to allocate memory\n");
+    exit(EXIT_FAILURE);
+  }
+  u_profiler_reset(profiler);
+  for (i = 0; i < nkeys; ++i) {
+    u_tree_insert(tree, PINT_TO_POINTER (keys[i]), PINT_TO_POINTER (keys[i]));
+  }
+  usecs = u_profiler_elapsed_usecs(profiler);
+  *insert_rate = usecs > 0 ? (double) nkeys / (double) usecs : 0.0;
+  u_profiler_reset(profiler);
+  for (j = 0; j < BENCH_LOOKUP_ROUNDS; ++j) {
+    for (i = nkeys - 1; i >= 0; --i) {
+      if (u_tree_lookup(tree, PINT_TO_POINTER (keys[i])) == NULL) {
+        fprintf(stderr, "Key %d is lost\n", keys[i]);
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+  usecs = u_profiler_elapsed_usecs(profiler);
+  *lookup_rate = usecs > 0
+    ? (double) nkeys * BENCH_LOOKUP_ROUNDS / (double) usecs : 0.0;
+  u_profiler_free(profiler);
+}
+
+int
+main(int ac, char **av) {
+  tree_t *tree;
+  double rates[4];
+  int *keys;
+  int nkeys, i, j, tmp;
+  u32_t seed;
+
+  u_libsys_init();
+  nkeys = ac > 1 ? atoi(av[1]) : BENCH_DEFAULT_KEYS;
+  if (nkeys < 1) {
+    nkeys = 1;
+  }
+  if ((keys = u_malloc(sizeof(int) * (size_t) nkeys)) == NULL) {
+    fprintf(stderr, "Failed to allocate memory\n");
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < nkeys; ++i) {
+    keys[i] = i + 1;
+  }
+  seed = 2463534242U;
+  for (i = nkeys - 1; i > 0; --i) {
+    j = (int) (bench_xorshift(&seed) % (u32_t) (i + 1));
+    tmp = keys[i];
+    keys[i] = keys[j];
+    keys[j] = tmp;
+  }
+  printf("%d random integer keys, Mop/s\n", nkeys);
+  printf("%-8s %12s %12s %12s %12s\n", "type", "insert cb", "insert int",
+    "lookup cb", "lookup int");
+  for (i = (int) U_TREE_TYPE_BINARY; i <= (int) U_TREE_TYPE_BTREE; ++i) {
+    tree = u_tree_new((tree_kind_t) i, bench_compare);
+    bench_run(tree, keys, nkeys, &rates[0], &rates[2]);
+    u_tree_free(tree);
+    tree = u_tree_new_int((tree_kind_t) i);
+    bench_run(tree, keys, nkeys, &rates[1], &rates[3]);
+    u_tree_free(tree);
+    printf("%-8s %12.2f %12.2f %12.2f %12.2f\n", bench_type_names[i],
+      rates[0], rates[1], rates[2], rates[3]);
+  }
+  u_free(keys);
+  u_libsys_shutdown();
+  return EXIT_SUCCESS;
+}
@@ -20,13 +20,17 @@
 
 #include "unic/config.h"
 #include "unic/atomic.h"
+#include "unic/chtable.h"
 #include "unic/condvar.h"
 #include "unic/hash.h"
 #include "unic/dir.h"
+#include "unic/dlist.h"
 #include "unic/err.h"
 #include "unic/file.h"
+#include "unic/hindex.h"
 #include "unic/htable.h"
 #include "unic/inifile.h"
+#include "unic/lfhtable.h"
 #include "unic/dl.h"
 #include "unic/list.h"
 #include "unic/macros.h"
@@ -35,12 +39,15 @@
 #include "unic/os.h"
 #include "unic/main.h"
 #include "unic/mem.h"
+#include "unic/mphf.h"
 #include "unic/mutex.h"
+#include "unic/pool.h"
 #include "unic/process.h"
 #include "unic/rwlock.h"
 #include "unic/sema.h"
 #include "unic/shm.h"
 #include "unic/shmbuf.h"
+#include "unic/skiplist.h"
 #include "unic/socket.h"
 #include "unic/socketaddr.h"
 #include "unic/spinlock.h"
@@ -49,5 +56,6 @@
 #include "unic/tree.h"
 #include "unic/types.h"
 #include "unic/thread.h"
+#include "unic/vec.h"
 
 #endif /* !U_H__ */
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!@file unic/chtable.h
+ * @brief Concurrent hash table
+ * @author Alexander Saprykin
+ *
+ * #chtable_t is a thread-safe hash table built on top of #htable_t. The table
+ * is split into several shards, every shard is an independent #htable_t
+ * protected with its own #rwlock_t. A key is always stored in the same shard
+ * which is selected using the key hash value, so threads working with
+ * different keys rarely compete for the same lock, and any number of readers
+ * can look up keys in the same shard simultaneously.
+ *
+ * The number of shards is fixed upon creation. By default it is four times
+ * the u_thread_ideal_count() value rounded up to a power of two, which keeps
+ * the lock contention low even when all the cores hammer the table.
+ *
+ * The insert, lookup and remove operations follow the #htable_t semantics,
+ * u_chtable_lookup() returns (#ptr_t) -1 if the key was not found.
+ *
+ * Note that the value returned by u_chtable_lookup() is not protected by the
+ * shard lock anymore, so another thread may remove and destroy it at the same
+ * time. Use a value destroy function only when it is safe for your data.
+ */
+#ifndef U_CHTABLE_H__
+# define U_CHTABLE_H__
+
+#include "unic/macros.h"
+#include "unic/types.h"
+
+/*!@brief Opaque data structure for a concurrent hash table. */
+typedef struct chtable chtable_t;
+
+/*!@brief Initializes a new concurrent hash table with pointer keys.
+ * @return Pointer to a newly initialized #chtable_t structure in case of
+ * success, NULL otherwise.
+ * @since 0.1.0
+ * @note Free with u_chtable_free() after usage.
+ */
+U_API chtable_t *
+u_chtable_new(void);
+
+/*!@brief Initializes a new concurrent hash table with custom key handling.
+ * @param nshards Number of shards, rounded up to a power of two, 0 to pick
+ * it from u_thread_ideal_count().
+ * @param hash_func Function to calculate key hash values, NULL to hash keys
+ * as pointers.
+ * @param equal_func Function to check keys for equality, NULL to compare keys
+ * as pointers.
+ * @param key_destroy Function to call on every key before the pair
+ * destruction, maybe NULL.
+ * @param value_destroy Function to call on every value before the pair
+ * destruction, maybe NULL.
+ * @return Pointer to a newly initialized #chtable_t structure in case of
+ * success, NULL otherwise.
+ * @since 0.1.0
+ * @note Free with u_chtable_free() after usage.
+ *
+ * See u_htable_new_full() for the meaning of the functions.
+ */
+U_API chtable_t *
+u_chtable_new_full(size_t nshards, hash_fn_t hash_func, equal_fn_t equal_func,
+  destroy_fn_t key_destroy, destroy_fn_t value_destroy);
+
+/*!@brief Inserts a new key-value pair into a concurrent hash table.
+ * @param table Initialized concurrent hash table.
+ * @param key Key to insert.
+ * @param value Value to insert.
+ * @since 0.1.0
+ *
+ * If the @a key already exists its key-value pair is replaced. Only the shard
+ * holding the @a key is locked for writing.
+ */
+U_API void
+u_chtable_insert(chtable_t *table, ptr_t key, ptr_t value);
+
+/*!@brief Searches for a specifed key in a concurrent hash table.
+ * @param table Concurrent hash table to lookup in.
+ * @param key Key to lookup for.
+ * @return Value related to its key pair (can be NULL), (#ptr_t) -1 if no
+ * value was found.
+ * @since 0.1.0
+ *
+ * Only the shard holding the @a key is locked for reading.
+ */
+U_API ptr_t
+u_chtable_lookup(chtable_t *table, const_ptr_t key);
+
+/*!@brief Removes @a key from a concurrent hash table.
+ * @param table Concurrent hash table to remove the key from.
+ * @param key Key to remove (if exists).
+ * @since 0.1.0
+ */
+U_API void
+u_chtable_remove(chtable_t *table, const_ptr_t key);
+
+/*!@brief Calls a specified function for each key-value pair.
+ * @param table Concurrent hash table to go through.
+ * @param func Function to call, return true from it to stop the iteration.
+ * @param user_data User defined data, may be NULL.
+ * @since 0.1.0
+ *
+ * The shards are visited one by one, every shard is locked for reading while
+ * its pairs are being passed to @a func. The result is not a snapshot of the
+ * whole table if other threads modify it concurrently. Do not modify the
+ * table from within @a func.
+ */
+U_API void
+u_chtable_foreach(chtable_t *table, traverse_fn_t func, ptr_t user_data);
+
+/*!@brief Gets the number of shards in a concurrent hash table.
+ * @param table Concurrent hash table to get the shard count for.
+ * @return Number of shards, 0 if @a table is NULL.
+ * @since 0.1.0
+ */
+U_API size_t
+u_chtable_get_nshards(const chtable_t *table);
+
+/*!@brief Frees a previously initialized #chtable_t.
+ * @param table Concurrent hash table to free.
+ * @since 0.1.0
+ *
+ * The table must not be used by other threads anymore.
+ */
+U_API void
+u_chtable_free(chtable_t *table);
+
+#endif /* !U_CHTABLE_H__ */
@@ -0,0 +1,150 @@
+#ifndef UNIC_HEADER_UNICCONFIG_H
+#define UNIC_HEADER_UNICCONFIG_H
+
+#define UNIC_VERSION_MAJOR 0
+#define UNIC_VERSION_MINOR 1
+#define UNIC_VERSION_PATCH 0
+#define UNIC_VERSION_STR "0.1.0"
+#define UNIC_VERSION 0x000100
+
+/* #undef UNIC_NEED_WINDOWS_H */
+#define UNIC_NEED_FLOAT_H
+#define UNIC_NEED_LIMITS_H
+/* #undef UNIC_NEED_VALUES_H */
+/* #undef UNIC_IS_BIGENDIAN */
+/* #undef UNIC_SIZEOF_SAFAMILY_T */
+
+#define UNIC_NTDDI_VERSION_FROM_WIN32_WINNT2(ver)    ver##0000
+#define UNIC_NTDDI_VERSION_FROM_WIN32_WINNT(ver)     UNIC_NTDDI_VERSION_FROM_WIN32_WINNT2(ver)
+
+#ifdef UNIC_NEED_WINDOWS_H
+#  ifndef _WIN32_WINNT
+#    define _WIN32_WINNT 0x501
+#  endif
+#  ifndef NTDDI_VERSION
+#    define NTDDI_VERSION UNIC_NTDDI_VERSION_FROM_WIN32_WINNT(_WIN32_WINNT)
+#  endif
+#  include <winsock2.h>
+#  include <ws2tcpip.h>
+#  include <windows.h>
+#endif
+
+#include "unic/macros.h"
+
+#ifdef UNIC_NEED_FLOAT_H
+#  include <float.h>
+#endif
+
+#ifdef UNIC_NEED_LIMITS_H
+#  include <limits.h>
+#endif
+
+#ifdef UNIC_NEED_VALUES_H
+#  include <values.h>
+#endif
+
+#define U_MINFLOAT    FLT_MIN
+#define U_MAXFLOAT    FLT_MAX
+#define U_MINDOUBLE   DBL_MIN
+#define U_MAXDOUBLE   DBL_MAX
+#define U_MINSHORT    SHRT_MIN
+#define U_MAXSHORT    SHRT_MAX
+#define U_MAXUSHORT   USHRT_MAX
+#define U_MININT      INT_MIN
+#define U_MAXINT      INT_MAX
+#define U_MAXUINT     UINT_MAX
+#define U_MINLONG     LONG_MIN
+#define U_MAXLONG     LONG_MAX
+#define U_MAXULONG    ULONG_MAX
+
+#define UNIC_SIZEOF_VOID_P 8
+#define UNIC_SIZEOF_SIZE_T 8
+#define UNIC_SIZEOF_LONG 8
+
+#ifdef UNIC_IS_BIGENDIAN
+#  define U_BYTE_ORDER U_BIG_ENDIAN
+#else
+#  define U_BYTE_ORDER U_LITTLE_ENDIAN
+#endif
+
+#define UNIC_HAVE_ARPA_INET_H
+#define UNIC_HAVE_ASSERT_H
+/* #undef UNIC_HAVE_ATHEOS_SEMAPHORE_H */
+/* #undef UNIC_HAVE_ATHEOS_SYSINFO_H */
+/* #undef UNIC_HAVE_ATHEOS_THREADS_H */
+/* #undef UNIC_HAVE_ATHEOS_TLD_H */
+/* #undef UNIC_HAVE_BE_KERNEL_IMAGE_H */
+/* #undef UNIC_HAVE_BE_KERNEL_OS_H */
+/* #undef UNIC_HAVE_BUILTINS_H */
+#define UNIC_HAVE_CTYPE_H
+#define UNIC_HAVE_DIRENT_H
+#define UNIC_HAVE_DLFCN_H
+/* #undef UNIC_HAVE_DL_H */
+/* #undef UNIC_HAVE_EFNDEF_H */
+#define UNIC_HAVE_ERRNO_H
+#define UNIC_HAVE_FCNTL_H
+#define UNIC_HAVE_FLOAT_H
+/* #undef UNIC_HAVE_ILEDEF_H */
+/* #undef UNIC_HAVE_INTRIN_H */
+#define UNIC_HAVE_INTTYPES_H
+/* #undef UNIC_HAVE_IOSBDEF_H */
+/* #undef UNIC_HAVE_KERNEL_OS_H */
+/* #undef UNIC_HAVE_KERNEL_SCHEDULER_H */
+/* #undef UNIC_HAVE_LIB */
+#define UNIC_HAVE_LIMITS_H
+/* #undef UNIC_HAVE_MACHINE_BUILTINS_H */
+/* #undef UNIC_HAVE_MACH_MACH_TIME_H */
+#define UNIC_HAVE_MATH_H
+#define UNIC_HAVE_MEMORY_H
+#define UNIC_HAVE_NETDB_H
+#define UNIC_HAVE_NETINET_IN_H
+/* #undef UNIC_HAVE_OS2_H */
+/* #undef UNIC_HAVE_PMACROS_H */
+/* #undef UNIC_HAVE_PROCESS_H */
+#define UNIC_HAVE_PTHREAD_H
+#define UNIC_HAVE_SCHED_H
+#define UNIC_HAVE_SEMAPHORE_H
+#define UNIC_HAVE_SIGNAL_H
+/* #undef UNIC_HAVE_SSDEF_H */
+/* #undef UNIC_HAVE_STARLET_H */
+#define UNIC_HAVE_STDARG_H
+#define UNIC_HAVE_STDATOMIC_H
+#define UNIC_HAVE_STDBOOL_H
+#define UNIC_HAVE_STDDEF_H
+#define UNIC_HAVE_STDINT_H
+#define UNIC_HAVE_STDIO_H
+#define UNIC_HAVE_STDLIB_H
+#define UNIC_HAVE_STRING_H
+/* #undef UNIC_HAVE_STROPTS_H */
+/* #undef UNIC_HAVE_STSDEF_H */
+/* #undef UNIC_HAVE_SUPPORT_TLS_H */
+/* #undef UNIC_HAVE_SYIDEF_H */
+/* #undef UNIC_HAVE_SYNCH_H */
+#define UNIC_HAVE_SYS_IPC_H
+#define UNIC_HAVE_SYS_MMAN_H
+#define UNIC_HAVE_SYS_PARAM_H
+#define UNIC_HAVE_SYS_POLL_H
+/* #undef UNIC_HAVE_SYS_PSTAT_H */
+#define UNIC_HAVE_SYS_SELECT_H
+#define UNIC_HAVE_SYS_SEM_H
+#define UNIC_HAVE_SYS_SHM_H
+#define UNIC_HAVE_SYS_SOCKET_H
+#define UNIC_HAVE_SYS_STAT_H
+/* #undef UNIC_HAVE_SYS_SYSCTL_H */
+/* #undef UNIC_HAVE_SYS_SYSPAGE_H */
+#define UNIC_HAVE_SYS_TIME_H
+#define UNIC_HAVE_SYS_TYPES_H
+#define UNIC_HAVE_SYS_UTSNAME_H
+/* #undef UNIC_HAVE_THREAD_H */
+#define UNIC_HAVE_TIME_H
+/* #undef UNIC_HAVE_TIS_H */
+#define UNIC_HAVE_UNISTD_H
+#define UNIC_HAVE_VALUES_H
+/* #undef UNIC_HAVE_WINDOWS_H */
+/* #undef UNIC_HAVE_WINSOCK2_H */
+/* #undef UNIC_HAVE_WS2TCPIP_H */
+
+#define UNIC_HAVE_ATOMIC_INTRIN
+#define UNIC_HAVE_SYNC_INTRIN
+
+#endif /* UNIC_HEADER_UNICCONFIG_H */
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!@file unic/dlist.h
+ * @brief Intrusive doubly linked list
+ * @author Alexander Saprykin
+ *
+ * Unlike #list_t, an intrusive list does not allocate its nodes: a
+ * #dlist_node_t is embedded into the user structure, and the list only links
+ * the embedded nodes together. The list head keeps both ends and the node
+ * count, so appending, prepending, removing a known node and moving it to
+ * either end take O(1) time without any memory allocation. That makes it fit
+ * for LRU queues, timer lists and other structures which constantly relink
+ * their elements.
+ *
+ * Use #U_DLIST_ENTRY to get the user structure back from its node:
+ * @code
+ * typedef struct {
+ *   int         id;
+ *   dlist_node_t node;
+ * } item_t;
+ *
+ * dlist_t      lru;
+ * dlist_node_t *node;
+ *
+ * u_dlist_init (&lru);
+ * u_dlist_append (&lru, &item->node);
+ * ...
+ * u_dlist_move_to_back (&lru, &item->node);
+ * ...
+ * for (node = lru.head; node != NULL; node = node->next)
+ *   printf ("%d\n", U_DLIST_ENTRY (node, item_t, node)->id);
+ * @endcode
+ * A node can be linked into a single list at a time, the list never checks
+ * which list a node belongs to. The memory of the user structures is never
+ * touched beyond the embedded nodes.
+ */
+#ifndef U_DLIST_H__
+# define U_DLIST_H__
+
+#include "unic/macros.h"
+#include "unic/types.h"
+
+/*!@brief Gets a pointer to the structure embedding a list node.
+ * @param node Pointer to the #dlist_node_t.
+ * @param type Type of the embedding structure.
+ * @param member Name of the #dlist_node_t member in @a type.
+ * @since 0.1.0
+ */
+#define U_DLIST_ENTRY(node, type, member) \
+  ((type *) ((byte_t *) (node) - offsetof (type, member)))
+
+/*!@brief Typedef for an intrusive list node. */
+typedef struct dlist_node dlist_node_t;
+
+/*!@brief Typedef for an intrusive list head. */
+typedef struct dlist dlist_t;
+
+/*!@brief Node for an intrusive doubly linked list. */
+struct dlist_node {
+
+  /*!@brief Next list node. */
+  dlist_node_t *next;
+
+  /*!@brief Previous list node. */
+  dlist_node_t *prev;
+};
+
+/*!@brief Head of an intrusive doubly linked list. */
+struct dlist {
+
+  /*!@brief First list node. */
+  dlist_node_t *head;
+
+  /*!@brief Last list node. */
+  dlist_node_t *tail;
+
+  /*!@brief Number of nodes in the list. */
+  size_t count;
+};
+
+/*!@brief Initializes an empty intrusive list.
+ * @param list List to initialize.
+ * @since 0.1.0
+ */
+U_API void
+u_dlist_init(dlist_t *list);
+
+/*!@brief Appends a node to an intrusive list.
+ * @param list List to append the node to.
+ * @param node Node to append, must not be linked into any list.
+ * @since 0.1.0
+ */
+U_API void
+u_dlist_append(dlist_t *list, dlist_node_t *node);
+
+/*!@brief Prepends a node to an intrusive list.
+ * @param list List to prepend the node to.
+ * @param node Node to prepend, must not be linked into any list.
+ * @since 0.1.0
+ */
+U_API void
+u_dlist_prepend(dlist_t *list, dlist_node_t *node);
+
+/*!@brief Inserts a node before another one.
+ * @param list List to insert the node to.
+ * @param pos Node of the @a list to insert before, NULL to append.
+ * @param node Node to insert, must not be linked into any list.
+ * @since 0.1.0
+ */
+U_API void
+u_dlist_insert_before(dlist_t *list, dlist_node_t *pos, dlist_node_t *node);
+
+/*!@brief Inserts a node after another one.
+ * @param list List to insert the node to.
+ * @param pos Node of the @a list to insert after, NULL to prepend.
+ * @param node Node to insert, must not be linked into any list.
+ * @since 0.1.0
+ */
+U_API void
+u_dlist_insert_after(dlist_t *list, dlist_node_t *pos, dlist_node_t *node);
+
+/*!@brief Unlinks a node from an intrusive list.
+ * @param list List to remove the node from.
+ * @param node Node of the @a list to remove.
+ * @since 0.1.0
+ *
+ * The node memory is not touched except for its links, which are reset.
+ */
+U_API void
+u_dlist_remove(dlist_t *list, dlist_node_t *node);
+
+/*!@brief Unlinks the first node of an intrusive list.
+ * @param list List to remove the node from.
+ * @return Removed node, NULL if the @a list is empty.
+ * @since 0.1.0
+ */
+U_API dlist_node_t *
+u_dlist_pop_front(dlist_t *list);
+
+/*!@brief Unlinks the last node of an intrusive list.
+ * @param list List to remove the node from.
+ * @return Removed node, NULL if the @a list is empty.
+ * @since 0.1.0
+ */
+U_API dlist_node_t *
+u_dlist_pop_back(dlist_t *list);
+
+/*!@brief Moves a node to the beginning of its list.
+ * @param list List the node belongs to.
+ * @param node Node of the @a list to move.
+ * @since 0.1.0
+ */
+U_API void
+u_dlist_move_to_front(dlist_t *list, dlist_node_t *node);
+
+/*!@brief Moves a node to the end of its list.
+ * @param list List the node belongs to.
+ * @param node Node of the @a list to move.
+ * @since 0.1.0
+ */
+U_API void
+u_dlist_move_to_back(dlist_t *list, dlist_node_t *node);
+
+/*!@brief Calls a specified function for each list node.
+ * @param list List to go through.
+ * @param func Pointer for the callback function.
+ * @param user_data User defined data, may be NULL.
+ * @since 0.1.0
+ *
+ * The @a func receives the node pointer and @a user_data. The next node is
+ * fetched before calling @a func, so it may free the memory holding the node,
+ * after which the @a list must be initialized again:
+ * @code
+ * u_dlist_foreach (&list, (fn_t) my_item_free, NULL);
+ * u_dlist_init (&list);
+ * @endcode
+ */
+U_API void
+u_dlist_foreach(dlist_t *list, fn_t func, ptr_t user_data);
+
+#endif /* !U_DLIST_H__ */
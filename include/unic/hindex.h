@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!@file unic/hindex.h
+ * @brief Persistent read-only hash index
+ * @author Alexander Saprykin
+ *
+ * #hindex_t is a read-only hash table stored in a file. It is created once
+ * from a #htable_t with string keys and values using u_hindex_write(), and
+ * then opened with u_hindex_open() as many times as needed. Opening maps the
+ * file into memory and does not parse it, so a large index is ready at once
+ * and its pages are loaded lazily by the first lookups touching them.
+ *
+ * The file layout is flat and position independent: a header is followed by
+ * an open addressing slot array holding hash values and entry offsets, and
+ * by the entries with NUL-terminated key and value bytes. All the numbers are
+ * stored in little-endian byte order with fixed widths, so the file can be
+ * shared between platforms. Keys are hashed with u_htable_bytes_hash().
+ *
+ * Values returned by u_hindex_lookup() point directly into the mapped file
+ * and stay valid until u_hindex_close() is called.
+ */
+#ifndef U_HINDEX_H__
+# define U_HINDEX_H__
+
+#include "unic/macros.h"
+#include "unic/types.h"
+#include "unic/err.h"
+#include "unic/htable.h"
+
+/*!@brief Opaque data structure for a persistent hash index. */
+typedef struct hindex hindex_t;
+
+/*!@brief Writes a hash table into an index file.
+ * @param table Hash table with NUL-terminated string keys and values, values
+ * may be NULL.
+ * @param path Path of the index file to create or overwrite.
+ * @param[out] error Error report object, NULL to ignore.
+ * @return true in case of success, false otherwise.
+ * @since 0.1.0
+ */
+U_API bool
+u_hindex_write(const htable_t *table, const byte_t *path, err_t **error);
+
+/*!@brief Opens an index file for lookups.
+ * @param path Path of the index file.
+ * @param[out] error Error report object, NULL to ignore.
+ * @return Pointer to a newly opened #hindex_t structure in case of success,
+ * NULL otherwise.
+ * @since 0.1.0
+ * @note Close with u_hindex_close() after usage.
+ *
+ * Only the header is checked here, the rest of the file is validated while
+ * being accessed.
+ */
+U_API hindex_t *
+u_hindex_open(const byte_t *path, err_t **error);
+
+/*!@brief Searches for a key in an index.
+ * @param index Index to lookup in.
+ * @param key NUL-terminated key to lookup for.
+ * @param[out] value Location to store the found value (can be NULL), maybe
+ * NULL.
+ * @return true if the @a key was found, false otherwise.
+ * @since 0.1.0
+ */
+U_API bool
+u_hindex_lookup(const hindex_t *index, const byte_t *key,
+  const byte_t **value);
+
+/*!@brief Gets the number of keys in an index.
+ * @param index Index to get the size for.
+ * @return Number of keys, 0 if @a index is NULL.
+ * @since 0.1.0
+ */
+U_API size_t
+u_hindex_get_size(const hindex_t *index);
+
+/*!@brief Closes an index and unmaps its file.
+ * @param index Index to close.
+ * @since 0.1.0
+ */
+U_API void
+u_hindex_close(hindex_t *index);
+
+#endif /* !U_HINDEX_H__ */
@@ -19,27 +19,48 @@
  * @brief Hash table
  * @author Alexander Saprykin
  *
- * A hash table is a data structure used to map keys to values. The hash table
- * consists of several internal slots which hold a list of values. A hash
- * function is used to compute an index in the array of the slots from a given
- * key. The hash function itself is fast and it takes a constant time to compute
- * the internal slot index.
- *
- * When the number of pairs in the hash table is small the lookup and insert
- * (remove) operations are very fast and have average complexity O(1), because
- * every slot holds almost the only one pair. As the number of internal slots is
- * fixed, the increasing number of pairs will lead to degraded performance and
- * the average complexity of the operations can drop to O(N) in the worst case.
- * This is because the more pairs are inserted the more longer the list of
- * values is placed in every slot.
- *
- * This is a simple hash table implementation which is not intended for heavy
- * usage (several thousands), see #tree_t if you need the best performance on
- * large data sets. This implementation doesn't support multi-inserts when
- * several values belong to the same key.
- *
- * Note that #htable_t stores keys and values only as pointers, so you need
- * to free used memory manually, u_htable_free() will not do it in any way.
+ * A hash table is a data structure used to map keys to values. A hash
+ * function is used to compute an index in the array of the internal buckets
+ * from a given key. The hash function itself is fast and it takes a constant
+ * time to compute the bucket index.
+ *
+ * #htable_t uses open addressing: every key-value pair is stored directly in
+ * the bucket array and collisions are resolved with Robin Hood linear probing,
+ * which keeps probe sequences short and lookups within a few adjacent cache
+ * lines. The lookup, insert and remove operations have average complexity
+ * O(1).
+ *
+ * The bucket array grows twice once the load factor exceeds 7/8. Entries are
+ * moved to the new array incrementally: every following insert or remove
+ * migrates a small portion of the old buckets, so the rehashing cost is spread
+ * over many operations instead of stalling a single insert. This
+ * implementation doesn't support multi-inserts when several values belong to
+ * the same key.
+ *
+ * By default keys are compared and hashed as pointers. Use u_htable_new_full()
+ * to provide custom hash and equality functions, i.e. u_htable_str_hash() and
+ * u_htable_str_equal() to look up by string contents instead of interning the
+ * strings first. Build your own hash function on top of u_htable_bytes_hash()
+ * for keys which are arbitrary byte buffers.
+ *
+ * Note that #htable_t stores keys and values only as pointers. Unless destroy
+ * notification functions were passed to u_htable_new_full() you need to free
+ * used memory manually, u_htable_free() will not do it in any way.
+ *
+ * Use u_htable_foreach() or the #htable_iter_t iterator to walk through all
+ * the stored pairs in place without allocating memory:
+ * @code
+ * htable_iter_t iter;
+ * ptr_t         key, value;
+ *
+ * u_htable_iter_init (&iter, table);
+ * while (u_htable_iter_next (&iter, &key, &value)) {
+ *   if (is_expired (value))
+ *     u_htable_iter_remove (&iter);
+ * }
+ * @endcode
+ * The pairs are visited in an unspecified order. The table must not be
+ * modified during the iteration other than with u_htable_iter_remove().
  *
  * Integers (up to 32 bits) can be stored in pointers using #U_POINTER_TO_INT
  * and #U_INT_TO_POINTER macros.
@@ -50,10 +71,23 @@
 #include "unic/macros.h"
 #include "unic/types.h"
 #include "unic/list.h"
+#include "unic/vec.h"
 
 /*!@brief Opaque data structure for a hash table. */
 typedef struct htable htable_t;
 
+/*!@brief Hash table iterator. */
+typedef struct htable_iter htable_iter_t;
+
+/*!@brief Hash table iterator, allocate it on the stack and initialize with
+ * u_htable_iter_init(). All the fields are private. */
+struct htable_iter {
+  htable_t *table;
+  ptr_t node;
+  size_t pos;
+  size_t start;
+};
+
 /*!@brief Initializes a new hash table.
  * @return Pointer to a  newly initialized #htable_t structure in case of
  * success, NULL otherwise.
@@ -63,6 +97,79 @@ typedef struct htable htable_t;
 U_API htable_t *
 u_htable_new(void);
 
+/*!@brief Initializes a new hash table with custom key handling.
+ * @param hash_func Function to calculate key hash values, NULL to hash keys
+ * as pointers with u_htable_ptr_hash().
+ * @param equal_func Function to check keys for equality, NULL to compare keys
+ * as pointers.
+ * @param key_destroy Function to call on every key before the pair
+ * destruction, maybe NULL.
+ * @param value_destroy Function to call on every value before the pair
+ * destruction, maybe NULL.
+ * @return Pointer to a newly initialized #htable_t structure in case of
+ * success, NULL otherwise.
+ * @since 0.1.0
+ * @note Free with u_htable_free() after usage.
+ *
+ * Keys which are equal according to @a equal_func must have equal hash
+ * values. The destroy functions are called when a pair is removed, when a
+ * pair is replaced by u_htable_insert() and for every pair left upon
+ * u_htable_free().
+ */
+U_API htable_t *
+u_htable_new_full(hash_fn_t hash_func, equal_fn_t equal_func,
+  destroy_fn_t key_destroy, destroy_fn_t value_destroy);
+
+/*!@brief Calculates a hash value for a pointer key.
+ * @param key Pointer to hash.
+ * @return Hash value of the pointer itself (not the pointed data).
+ * @since 0.1.0
+ *
+ * All bits of the pointer are mixed, so aligned pointers and small integers
+ * stored with #PINT_TO_POINTER spread evenly over the buckets.
+ */
+U_API size_t
+u_htable_ptr_hash(const_ptr_t key);
+
+/*!@brief Compares two pointer keys.
+ * @param a First pointer.
+ * @param b Second pointer.
+ * @return true if the pointers are equal, false otherwise.
+ * @since 0.1.0
+ */
+U_API bool
+u_htable_ptr_equal(const_ptr_t a, const_ptr_t b);
+
+/*!@brief Calculates a hash value for a byte buffer.
+ * @param data Buffer to hash.
+ * @param len Length of @a data in bytes.
+ * @return Hash value of the buffer contents.
+ * @since 0.1.0
+ *
+ * This is a fast non-cryptographic hash (wyhash), do not use it where
+ * resistance to malicious input is required. The result does not depend on
+ * the byte order of the platform.
+ */
+U_API size_t
+u_htable_bytes_hash(const_ptr_t data, size_t len);
+
+/*!@brief Calculates a hash value for a NULL-terminated string key.
+ * @param key String to hash.
+ * @return Hash value of the string contents.
+ * @since 0.1.0
+ */
+U_API size_t
+u_htable_str_hash(const_ptr_t key);
+
+/*!@brief Compares two NULL-terminated string keys.
+ * @param a First string.
+ * @param b Second string.
+ * @return true if the strings are equal, false otherwise.
+ * @since 0.1.0
+ */
+U_API bool
+u_htable_str_equal(const_ptr_t a, const_ptr_t b);
+
 /*!@brief Inserts a new key-value pair into a hash table.
  * @param table Initialized hash table.
  * @param key Key to insert.
@@ -70,11 +177,52 @@ u_htable_new(void);
  * @since 0.0.1
  *
  * This function only stores pointers, so you need to manually free pointed
- * data after using the hash table.
+ * data after using the hash table unless destroy notification functions were
+ * provided.
+ *
+ * If the @a key already exists its key-value pair is replaced, the destroy
+ * notification functions (if any) are called on the old key and value.
  */
 U_API void
 u_htable_insert(htable_t *table, ptr_t key, ptr_t value);
 
+/*!@brief Inserts several key-value pairs into a hash table at once.
+ * @param table Initialized hash table.
+ * @param keys Array of keys to insert.
+ * @param values Array of values to insert, NULL to insert NULL values.
+ * @param n Number of pairs in the arrays.
+ * @since 0.1.0
+ *
+ * Works as calling u_htable_insert() for every pair, but the table is sized
+ * only once for all the new pairs, so no rehashing happens in between. Use
+ * it to load large tables.
+ */
+U_API void
+u_htable_insert_many(htable_t *table, ptr_t const *keys, ptr_t const *values,
+  size_t n);
+
+/*!@brief Reserves space for a number of pairs in a hash table.
+ * @param table Initialized hash table.
+ * @param n Total number of pairs the table should hold without growing.
+ * @return true in case of success, false otherwise.
+ * @since 0.1.0
+ *
+ * The table never gets smaller here, use u_htable_shrink() for that. A
+ * pending incremental rehash is completed in any case.
+ */
+U_API bool
+u_htable_reserve(htable_t *table, size_t n);
+
+/*!@brief Shrinks a hash table to fit its current number of pairs.
+ * @param table Initialized hash table.
+ * @return true in case of success, false otherwise.
+ * @since 0.1.0
+ *
+ * An empty table releases all of its buckets.
+ */
+U_API bool
+u_htable_shrink(htable_t *table);
+
 /*!@brief Searches for a specifed key in the hash table.
  * @param table Hash table to lookup in.
  * @param key Key to lookup for.
@@ -85,6 +233,85 @@ u_htable_insert(htable_t *table, ptr_t key, ptr_t value);
 U_API ptr_t
 u_htable_lookup(const htable_t *table, const_ptr_t key);
 
+/*!@brief Searches for a specifed key in a hash table, telling apart missing
+ * keys from any stored value.
+ * @param table Hash table to lookup in.
+ * @param key Key to lookup for.
+ * @param[out] value Location to store the found value, maybe NULL.
+ * @return true if the @a key was found, false otherwise.
+ * @since 0.1.0
+ *
+ * Unlike u_htable_lookup(), the (#ptr_t) -1 value can be stored in the table
+ * and found as any other one.
+ */
+U_API bool
+u_htable_lookup_extended(const htable_t *table, const_ptr_t key,
+  ptr_t *value);
+
+/*!@brief Searches for a key in a hash table and inserts it if missing.
+ * @param table Hash table to lookup in.
+ * @param key Key to lookup for or insert.
+ * @param[out] found Location to store whether the @a key already existed,
+ * maybe NULL.
+ * @return Pointer to the value slot of the @a key in case of success, NULL
+ * otherwise.
+ * @since 0.1.0
+ *
+ * A newly inserted @a key gets a NULL value, store the real one through the
+ * returned pointer. The key is hashed only once, and a missing key is stored
+ * right where the lookup probe stopped, which makes get-or-create paths
+ * cheaper than u_htable_lookup() followed by u_htable_insert(). Only an
+ * insertion which grows the table, or happens while an earlier growth is
+ * still being rehashed, probes the buckets a second time.
+ *
+ * The returned pointer is valid until the next modification of the table.
+ */
+U_API ptr_t *
+u_htable_lookup_or_insert(htable_t *table, ptr_t key, bool *found);
+
+/*!@brief Calls a specified function for each key-value pair.
+ * @param table Hash table to go through.
+ * @param func Function to call, return true from it to stop the iteration.
+ * @param user_data User defined data, may be NULL.
+ * @since 0.1.0
+ *
+ * The buckets are walked in place, no memory is allocated. The table must not
+ * be modified from within @a func.
+ */
+U_API void
+u_htable_foreach(htable_t *table, traverse_fn_t func, ptr_t user_data);
+
+/*!@brief Initializes an iterator over a hash table.
+ * @param iter Iterator to initialize.
+ * @param table Hash table to iterate over.
+ * @since 0.1.0
+ *
+ * The iterator doesn't need to be freed, it holds no resources.
+ */
+U_API void
+u_htable_iter_init(htable_iter_t *iter, htable_t *table);
+
+/*!@brief Advances an iterator to the next key-value pair.
+ * @param iter Iterator initialized with u_htable_iter_init().
+ * @param[out] key Key of the pair, maybe NULL.
+ * @param[out] value Value of the pair, maybe NULL.
+ * @return true if the next pair was found, false if the iteration is over.
+ * @since 0.1.0
+ */
+U_API bool
+u_htable_iter_next(htable_iter_t *iter, ptr_t *key, ptr_t *value);
+
+/*!@brief Removes the pair returned by the last u_htable_iter_next() call.
+ * @param iter Iterator to remove the current pair with.
+ * @since 0.1.0
+ *
+ * The iteration can be continued after the removal and visits every
+ * remaining pair exactly once. If destroy notification functions were
+ * provided they are called on the removed key and value.
+ */
+U_API void
+u_htable_iter_remove(htable_iter_t *iter);
+
 /*!@brief Gives a list of all the stored keys in the hash table.
  * @param table Hash table to collect the keys from.
  * @return List of all the stored keys, the list can be empty if no keys were
@@ -107,6 +334,29 @@ u_htable_keys(const htable_t *table);
 U_API list_t *
 u_htable_values(const htable_t *table);
 
+/*!@brief Gives a vector of all the stored keys in the hash table.
+ * @param table Hash table to collect the keys from.
+ * @return #vec_t of #ptr_t elements, NULL in case of error.
+ * @since 0.1.0
+ * @note You should manually free the returned vector with u_vec_free() after
+ * using it.
+ *
+ * The storage is allocated once for all the keys, so this is cheaper than
+ * u_htable_keys() for large tables.
+ */
+U_API vec_t *
+u_htable_keys_vec(const htable_t *table);
+
+/*!@brief Gives a vector of all the stored values in the hash table.
+ * @param table Hash table to collect the values from.
+ * @return #vec_t of #ptr_t elements, NULL in case of error.
+ * @since 0.1.0
+ * @note You should manually free the returned vector with u_vec_free() after
+ * using it.
+ */
+U_API vec_t *
+u_htable_values_vec(const htable_t *table);
+
 /*!@brief Frees a previously initialized #htable_t.
  * @param table Hash table to free.
  * @since 0.0.1
@@ -118,6 +368,9 @@ u_htable_free(htable_t *table);
  * @param table Hash table to remove the key from.
  * @param key Key to remove (if exists).
  * @since 0.0.1
+ *
+ * If destroy notification functions were provided they are called on the
+ * removed key and value.
  */
 U_API void
 u_htable_remove(htable_t *table, const_ptr_t key);
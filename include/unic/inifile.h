@@ -87,6 +87,7 @@
 #include "unic/macros.h"
 #include "unic/types.h"
 #include "unic/list.h"
+#include "unic/vec.h"
 #include "unic/err.h"
 
 /*!@brief INI file opaque data structure. */
@@ -127,7 +128,7 @@ u_inifile_is_parsed(const inifile_t *file);
 /*!@brief Gets all the sections from a given file.
  * @param file #inifile_t to get the sections from. The @a file should be parsed
  * before.
- * @return #list_t of section names.
+ * @return #list_t of section names in the file order.
  * @since 0.0.1
  * @note It's a caller responsibility to u_free() each returned string and to
  * free the returned list with u_list_free().
@@ -147,6 +148,29 @@ u_inifile_sections(const inifile_t *file);
 U_API list_t *
 u_inifile_keys(const inifile_t *file, const byte_t *section);
 
+/*!@brief Gets all the sections from a given file as a vector.
+ * @param file #inifile_t to get the sections from. The @a file should be parsed
+ * before.
+ * @return #vec_t of section names (byte_t * elements) in the file order.
+ * @since 0.1.0
+ * @note It's a caller responsibility to u_free() each returned string and to
+ * free the returned vector with u_vec_free().
+ */
+U_API vec_t *
+u_inifile_sections_vec(const inifile_t *file);
+
+/*!@brief Gets all the keys from a given section as a vector.
+ * @param file #inifile_t to get the keys from. The @a file should be parsed
+ * before.
+ * @param section Section name to get the keys from.
+ * @return #vec_t of key names (byte_t * elements) in the file order.
+ * @since 0.1.0
+ * @note It's a caller responsibility to u_free() each returned string and to
+ * free the returned vector with u_vec_free().
+ */
+U_API vec_t *
+u_inifile_keys_vec(const inifile_t *file, const byte_t *section);
+
 /*!@brief Checks whether a key exists.
  * @param file #inifile_t to check in. The @a file should be parsed before.
  * @param section Section to check the key in.
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!@file unic/lfhtable.h
+ * @brief Lock-free hash table
+ * @author Alexander Saprykin
+ *
+ * #lfhtable_t is a concurrent hash table which never blocks: readers and
+ * writers only use atomic pointer operations, so a preempted writer can not
+ * stall any other thread. It fits read-mostly data shared between many
+ * threads, like routing or configuration tables.
+ *
+ * The table is a split-ordered list: all the pairs live in a single sorted
+ * lock-free linked list, and the buckets are shortcuts pointing into it. The
+ * list is ordered by the bit-reversed hash values, so doubling the number of
+ * buckets only splits the existing ones and never moves any pair. Buckets are
+ * allocated lazily in segments upon first access.
+ *
+ * Removed pairs are reclaimed using epochs: the key and value destroy
+ * functions are deferred until no thread may be traversing the removed pair
+ * anymore, which can happen after u_lfhtable_remove() returns.
+ *
+ * Unlike #htable_t, u_lfhtable_insert() never replaces an existing pair, it
+ * returns false instead. To change a value remove the key and insert it again.
+ *
+ * Values returned by u_lfhtable_lookup() are not protected after the call
+ * returns: if another thread removes the pair, the value may be destroyed
+ * after a short while. Use a value destroy function only when it is safe for
+ * your data.
+ */
+#ifndef U_LFHTABLE_H__
+# define U_LFHTABLE_H__
+
+#include "unic/macros.h"
+#include "unic/types.h"
+
+/*!@brief Opaque data structure for a lock-free hash table. */
+typedef struct lfhtable lfhtable_t;
+
+/*!@brief Initializes a new lock-free hash table with pointer keys.
+ * @return Pointer to a newly initialized #lfhtable_t structure in case of
+ * success, NULL otherwise.
+ * @since 0.1.0
+ * @note Free with u_lfhtable_free() after usage.
+ */
+U_API lfhtable_t *
+u_lfhtable_new(void);
+
+/*!@brief Initializes a new lock-free hash table with custom key handling.
+ * @param hash_func Function to calculate key hash values, NULL to hash keys
+ * as pointers.
+ * @param equal_func Function to check keys for equality, NULL to compare keys
+ * as pointers.
+ * @param key_destroy Function to call on every key when its pair is
+ * reclaimed, maybe NULL.
+ * @param value_destroy Function to call on every value when its pair is
+ * reclaimed, maybe NULL.
+ * @return Pointer to a newly initialized #lfhtable_t structure in case of
+ * success, NULL otherwise.
+ * @since 0.1.0
+ * @note Free with u_lfhtable_free() after usage.
+ */
+U_API lfhtable_t *
+u_lfhtable_new_full(hash_fn_t hash_func, equal_fn_t equal_func,
+  destroy_fn_t key_destroy, destroy_fn_t value_destroy);
+
+/*!@brief Inserts a new key-value pair into a lock-free hash table.
+ * @param table Initialized lock-free hash table.
+ * @param key Key to insert.
+ * @param value Value to insert.
+ * @return true if the pair was inserted, false if the @a key already exists
+ * or in case of error.
+ * @since 0.1.0
+ *
+ * The table takes ownership of @a key and @a value only if true is returned.
+ */
+U_API bool
+u_lfhtable_insert(lfhtable_t *table, ptr_t key, ptr_t value);
+
+/*!@brief Searches for a specifed key in a lock-free hash table.
+ * @param table Lock-free hash table to lookup in.
+ * @param key Key to lookup for.
+ * @return Value related to its key pair (can be NULL), (#ptr_t) -1 if no
+ * value was found.
+ * @since 0.1.0
+ *
+ * Lookups never write to shared memory except when a bucket is accessed for
+ * the first time.
+ */
+U_API ptr_t
+u_lfhtable_lookup(lfhtable_t *table, const_ptr_t key);
+
+/*!@brief Removes @a key from a lock-free hash table.
+ * @param table Lock-free hash table to remove the key from.
+ * @param key Key to remove.
+ * @return true if the key was removed by this call, false otherwise.
+ * @since 0.1.0
+ *
+ * The destroy functions are called later, once no other thread may access
+ * the removed pair.
+ */
+U_API bool
+u_lfhtable_remove(lfhtable_t *table, const_ptr_t key);
+
+/*!@brief Gets the number of pairs in a lock-free hash table.
+ * @param table Lock-free hash table to get the size for.
+ * @return Number of pairs, 0 if @a table is NULL.
+ * @since 0.1.0
+ *
+ * The value is exact only when no other thread modifies the table.
+ */
+U_API size_t
+u_lfhtable_size(const lfhtable_t *table);
+
+/*!@brief Frees a previously initialized #lfhtable_t.
+ * @param table Lock-free hash table to free.
+ * @since 0.1.0
+ *
+ * The table must not be used by other threads anymore. Pairs removed before
+ * may still be reclaimed later.
+ */
+U_API void
+u_lfhtable_free(lfhtable_t *table);
+
+#endif /* !U_LFHTABLE_H__ */
@@ -66,6 +66,25 @@
  *
  * If you need to add large amount of nodes at once it is better to prepend them
  * and then reverse the list.
+ *
+ * Code which builds a lot of short-lived lists can take the nodes from a
+ * #list_pool_t instead of allocating each of them separately. A pool carves
+ * the nodes from contiguous slabs and recycles them on release, so it makes
+ * almost no calls to the memory allocator:
+ * @code
+ * list_pool_t *pool;
+ * list_t      *list;
+ *
+ * pool = u_list_pool_new ();
+ * list = NULL;
+ * list = u_list_pool_append (pool, list, data);
+ * ...
+ * u_list_pool_release (pool, list);
+ * u_list_pool_free (pool);
+ * @endcode
+ * The nodes taken from a pool must be removed and released only through the
+ * same pool, never with u_list_remove() or u_list_free(). A pool is not
+ * thread-safe, use a separate pool for each thread.
  */
 #ifndef U_LIST_H__
 # define U_LIST_H__
@@ -76,6 +95,9 @@
 /*!@brief Typedef for a list node. */
 typedef struct list list_t;
 
+/*!@brief Opaque pool of list nodes. */
+typedef struct list_pool list_pool_t;
+
 /*!@brief Node for a singly linked list. */
 struct list {
 
@@ -177,4 +199,126 @@ u_list_prepend(list_t *list, ptr_t data) U_GNUC_WARN_UNUSED_RESULT;
 U_API list_t *
 u_list_reverse(list_t *list) U_GNUC_WARN_UNUSED_RESULT;
 
+/*!@brief Sorts a list.
+ * @param list #list_t to sort.
+ * @param func Function to compare the nodes data with.
+ * @return Pointer to the top of the sorted list.
+ * @since 0.1.0
+ *
+ * This is a bottom-up merge sort which takes O(N log N) time and doesn't
+ * allocate any memory. The sort is stable: nodes with equal data keep their
+ * relative order.
+ */
+U_API list_t *
+u_list_sort(list_t *list, cmp_fn_t func) U_GNUC_WARN_UNUSED_RESULT;
+
+/*!@brief Concatenates two lists.
+ * @param list1 #list_t to attach the nodes to, may be NULL.
+ * @param list2 #list_t to attach after the last node of @a list1, may be NULL.
+ * @return Pointer to the top of the joined list.
+ * @since 0.1.0
+ *
+ * No nodes are copied, @a list2 becomes a part of the returned list and must
+ * not be freed separately. It takes O(N) time to find the end of @a list1. If
+ * you join lists in a loop, keep track of the last node with u_list_last()
+ * and concatenate to it instead of the list top, so every step takes O(1).
+ */
+U_API list_t *
+u_list_concat(list_t *list1, list_t *list2) U_GNUC_WARN_UNUSED_RESULT;
+
+/*!@brief Searches for a node using a custom compare function.
+ * @param list #list_t to search in.
+ * @param data Data to compare the nodes data with.
+ * @param func Function to compare the node data (the first argument) with
+ * @a data (the second argument), if NULL then the data are compared as
+ * pointers.
+ * @return Pointer to the first node for which @a func returned 0, NULL if no
+ * such node was found.
+ * @since 0.1.0
+ */
+U_API list_t *
+u_list_find_custom(list_t *list, const_ptr_t data, cmp_fn_t func);
+
+/*!@brief Removes all the nodes matching the given data.
+ * @param list #list_t to remove the nodes from.
+ * @param data Data to compare the nodes data with.
+ * @param func Function to compare the node data (the first argument) with
+ * @a data (the second argument), if NULL then the data are compared as
+ * pointers.
+ * @param data_destroy Function to call on the data of every removed node,
+ * may be NULL.
+ * @return Pointer to the updated list.
+ * @since 0.1.0
+ *
+ * All the matching nodes are removed in a single pass, which is much faster
+ * than calling u_list_remove() repeatedly for large lists.
+ */
+U_API list_t *
+u_list_remove_if(list_t *list, const_ptr_t data, cmp_fn_t func,
+  destroy_fn_t data_destroy) U_GNUC_WARN_UNUSED_RESULT;
+
+/*!@brief Creates a new list node pool.
+ * @return Pointer to the newly created pool in case of success, NULL
+ * otherwise.
+ * @since 0.1.0
+ *
+ * The pool does not allocate any nodes until the first one is requested.
+ */
+U_API list_pool_t *
+u_list_pool_new(void);
+
+/*!@brief Frees a list node pool.
+ * @param pool Pool to free.
+ * @since 0.1.0
+ *
+ * All the slabs are freed at once, so every list which still holds the nodes
+ * from the @a pool becomes invalid.
+ */
+U_API void
+u_list_pool_free(list_pool_t *pool);
+
+/*!@brief Appends data to a list using a node from the pool.
+ * @param pool Pool to take the node from.
+ * @param list #list_t for appending the data.
+ * @param data Data to append.
+ * @return Pointer to the updated list in case of success, @a list otherwise.
+ * @since 0.1.0
+ */
+U_API list_t *
+u_list_pool_append(list_pool_t *pool, list_t *list,
+  ptr_t data) U_GNUC_WARN_UNUSED_RESULT;
+
+/*!@brief Prepends data to a list using a node from the pool.
+ * @param pool Pool to take the node from.
+ * @param list #list_t for prepending the data.
+ * @param data Data to prepend.
+ * @return Pointer to the updated list in case of success, @a list otherwise.
+ * @since 0.1.0
+ */
+U_API list_t *
+u_list_pool_prepend(list_pool_t *pool, list_t *list,
+  ptr_t data) U_GNUC_WARN_UNUSED_RESULT;
+
+/*!@brief Removes data from a list and returns the node to the pool.
+ * @param pool Pool the @a list nodes were taken from.
+ * @param list List to remove the data from.
+ * @param data Data to remove.
+ * @return Pointer to the updated list in case of success, @a list otherwise.
+ * @since 0.1.0
+ */
+U_API list_t *
+u_list_pool_remove(list_pool_t *pool, list_t *list,
+  ptr_t data) U_GNUC_WARN_UNUSED_RESULT;
+
+/*!@brief Returns all the list nodes to the pool.
+ * @param pool Pool the @a list nodes were taken from.
+ * @param list List to release.
+ * @since 0.1.0
+ *
+ * This is the pooled counterpart of u_list_free(): the nodes are kept by the
+ * @a pool for reuse instead of being freed.
+ */
+U_API void
+u_list_pool_release(list_pool_t *pool, list_t *list);
+
 #endif /* !U_LIST_H__ */
@@ -28,9 +28,12 @@
  * You can also mix these two families of calls, but it is not recommended.
  *
  * By default u_* routines are mapped to system calls, thus only NULL-checking
- * is additionally performed. If you want to use the custom memory allocator,
- * then fill in #mem_vtable_t structure and pass it to the u_mem_set_vtable(). To
- * restore system calls back use u_mem_restore_vtable().
+ * is additionally performed. The system routines are called directly in this
+ * case, without going through the table, and u_malloc0() relies on calloc()
+ * which avoids clearing memory the system returns zeroed already. If you want
+ * to use the custom memory allocator, then fill in #mem_vtable_t structure and
+ * pass it to the u_mem_set_vtable(). To restore system calls back use
+ * u_mem_restore_vtable().
  *
  * Be careful when using the custom memory allocator: all memory chunks
  * allocated with the custom allocator must be freed with the same allocator. If
@@ -48,11 +51,63 @@
  * i.e. custom memory allocator can request a large block first, and then it
  * allocates chunks of memory within the block upon request.
  *
+ * u_mem_mmap_full() extends u_mem_mmap() with an explicit alignment and the
+ * #mem_map_flags_t options for large tables: huge pages to cut the number of
+ * TLB misses, and prefaulting to take the page faults upfront. Every option
+ * falls back gracefully when the system does not support it, so the only
+ * guarantee is a mapped block with the requested alignment. The block is
+ * released with u_mem_munmap() as usual.
+ *
+ * u_malloc_aligned() allocates a block with an arbitrary alignment through the
+ * regular memory table, release it with u_free_aligned() only.
+ *
  * @note OS/2 supports non-backed memory pages allocation, but in a specific
  * way: an exception handler to control access to uncommitted pages must be
  * allocated on the stack of each thread before using the mapped memory. To
  * unify the behaviour, on OS/2 all memory mapped allocations are already
  * committed to the backing storage.
+ *
+ * #arena_t is a region allocator for objects which die together, i.e. all the
+ * data of a single request. It carves allocations out of memory mapped chunks
+ * by bumping a pointer, so u_arena_alloc() is a few instructions in the common
+ * case, and releases everything at once with u_arena_reset(). The chunks are
+ * kept for reuse after the reset, so a long-living arena reaches a steady state
+ * where it does not call the system at all:
+ * @code
+ * arena_t *arena = u_arena_new (0);
+ *
+ * while (next_request (&req)) {
+ *   handle_request (&req, arena);   // calls u_arena_alloc (arena, ...)
+ *   u_arena_reset (arena);
+ * }
+ *
+ * u_arena_free (arena);
+ * @endcode
+ * Memory from the arena must not be passed to u_free() or u_realloc().
+ *
+ * To find out where the memory goes, the u_* routines can be instrumented with
+ * u_mem_stats_enable() at the start of the program, before the library
+ * initialization and before any memory is allocated. Every block is then
+ * accounted to the call site which allocated it: the number of live blocks and
+ * bytes, and the cumulative ones. A histogram of the block sizes is collected
+ * as well. The counters are spread over several shards to keep the threads
+ * from fighting over the same cache lines and are merged on read by
+ * u_mem_stats_get() and u_mem_stats_get_sites(). u_mem_stats_dump() prints a
+ * report with the top call sites, which can be resolved with addr2line or a
+ * debugger:
+ * @code
+ * u_mem_stats_enable ();
+ * u_libsys_init ();
+ *
+ * run_workload ();
+ * u_mem_stats_dump ();
+ *
+ * u_libsys_shutdown ();
+ * u_mem_stats_dump ();   // the blocks still live after the shutdown are leaks
+ * @endcode
+ * The call site is the return address of the u_* routine, so the blocks are
+ * accounted to the function which called it. It is available with GCC and
+ * Clang only, the other compilers account everything to the unknown site.
  */
 #ifndef U_MEM_H__
 # define U_MEM_H__
@@ -65,6 +120,45 @@
 
 typedef struct mem_vtable mem_vtable_t;
 
+/*!@brief Options for u_mem_mmap_full(). */
+enum mem_map_flags {
+
+  /*!@brief Regular pages mapped on demand. */
+  U_MEM_MAP_DEFAULT = 0,
+
+  /*!@brief Use huge pages if possible: reserved huge pages first, then the
+   * transparent ones. */
+  U_MEM_MAP_HUGE_PAGES = 1 << 0,
+
+  /*!@brief Commit all the pages before returning. */
+  U_MEM_MAP_POPULATE = 1 << 1
+};
+
+/*!@brief Options for u_mem_mmap_full(), combined with bitwise OR. */
+typedef enum mem_map_flags mem_map_flags_t;
+
+/*!@brief Huge page size assumed by #U_MEM_MAP_HUGE_PAGES, bytes. */
+#define U_MEM_HUGE_PAGE_SIZE 2097152
+
+/*!@brief Arena opaque data structure. */
+typedef struct arena arena_t;
+
+/*!@brief Default arena chunk size in bytes. */
+#define U_ARENA_DEFAULT_CHUNK_SIZE 65536
+
+/*!@brief Default alignment of the arena allocations, enough for any scalar
+ * type. */
+#define U_ARENA_DEFAULT_ALIGNMENT 16
+
+/*!@brief Number of the size classes in #mem_stats_t. */
+#define U_MEM_STATS_SIZE_CLASSES 16
+
+/*!@brief Maximum number of the call sites tracked separately. */
+#define U_MEM_STATS_MAX_SITES 256
+
+typedef struct mem_stats mem_stats_t;
+typedef struct mem_stats_site mem_stats_site_t;
+
 /*!@brief Memory management table. */
 struct mem_vtable {
 
@@ -78,6 +172,47 @@ struct mem_vtable {
   void (*free)(ptr_t mem);
 };
 
+/*!@brief Allocation statistics of the instrumented mode. */
+struct mem_stats {
+
+  /*!@brief Size of the live blocks, bytes. */
+  size_t live_bytes;
+
+  /*!@brief Number of the live blocks. */
+  size_t live_count;
+
+  /*!@brief Size of all the blocks ever allocated, bytes. */
+  size_t total_bytes;
+
+  /*!@brief Number of all the blocks ever allocated. */
+  size_t total_count;
+
+  /*!@brief Number of the allocated blocks by size: class @a i holds the blocks
+   * up to 16 << @a i bytes not fitting into the previous class, the last class
+   * holds all the larger blocks. */
+  size_t size_classes[U_MEM_STATS_SIZE_CLASSES];
+};
+
+/*!@brief Allocation statistics of a single call site. */
+struct mem_stats_site {
+
+  /*!@brief Code address of the call site, NULL for the blocks with unknown
+   * origin or the sites which did not fit into the table. */
+  ptr_t site;
+
+  /*!@brief Size of the live blocks, bytes. */
+  size_t live_bytes;
+
+  /*!@brief Number of the live blocks. */
+  size_t live_count;
+
+  /*!@brief Size of all the blocks ever allocated, bytes. */
+  size_t total_bytes;
+
+  /*!@brief Number of all the blocks ever allocated. */
+  size_t total_count;
+};
+
 /*!@brief Allocates a memory block for the specified number of bytes.
  * @param n_bytes Size of the memory block in bytes.
  * @return Pointer to a newly allocated memory block in case of success, NULL
@@ -97,6 +232,30 @@ u_malloc(size_t n_bytes);
 U_API ptr_t
 u_malloc0(size_t n_bytes);
 
+/*!@brief Allocates a memory block for an array.
+ * @param count Number of the array elements.
+ * @param size Size of an element in bytes.
+ * @return Pointer to a newly allocated memory block in case of success, NULL
+ * otherwise.
+ * @since 0.1.0
+ *
+ * Fails if the total size overflows.
+ */
+U_API ptr_t
+u_malloc_n(size_t count, size_t size);
+
+/*!@brief Allocates a memory block for an array and fills it with zeros.
+ * @param count Number of the array elements.
+ * @param size Size of an element in bytes.
+ * @return Pointer to a newly allocated memory block filled with zeros in case
+ * of success, NULL otherwise.
+ * @since 0.1.0
+ *
+ * Fails if the total size overflows.
+ */
+U_API ptr_t
+u_malloc0_n(size_t count, size_t size);
+
 /*!@brief Changes the memory block size.
  * @param mem Pointer to the memory block.
  * @param n_bytes New size for @a mem block.
@@ -120,6 +279,26 @@ u_realloc(ptr_t mem, size_t n_bytes);
 U_API void
 u_free(ptr_t mem);
 
+/*!@brief Allocates a memory block with the given alignment.
+ * @param n_bytes Size of the memory block in bytes.
+ * @param alignment Alignment of the block, must be a power of two.
+ * @return Pointer to a newly allocated memory block in case of success, NULL
+ * otherwise.
+ * @since 0.1.0
+ *
+ * The block is allocated with u_malloc(), so custom memory tables are
+ * respected. Free it with u_free_aligned() only.
+ */
+U_API ptr_t
+u_malloc_aligned(size_t n_bytes, size_t alignment);
+
+/*!@brief Frees a memory block allocated with u_malloc_aligned().
+ * @param mem Pointer to the memory block to free, maybe NULL.
+ * @since 0.1.0
+ */
+U_API void
+u_free_aligned(ptr_t mem);
+
 /*!@brief Sets custom memory management routines.
  * @param table Table of the memory routines to use.
  * @return true if the table was accepted, false otherwise.
@@ -145,6 +324,74 @@ u_mem_set_vtable(const mem_vtable_t *table);
 U_API void
 u_mem_restore_vtable(void);
 
+/*!@brief Enables the allocation statistics.
+ * @return true if the statistics were enabled, false if some memory was
+ * allocated through the table already.
+ * @note This call is not thread-safe.
+ * @since 0.1.0
+ *
+ * Call it at the start of the program, before u_libsys_init() and before
+ * any memory is allocated through the u_* routines. Every instrumented block
+ * carries a small header with its size and call site, so the mode cannot be
+ * turned on once a block without the header was handed out, even if it has
+ * been freed since or the library was shut down. For the same reason the
+ * statistics cannot be enabled again after u_mem_stats_disable().
+ *
+ * The statistics use the current memory table as a backend, a custom table
+ * can still be installed with u_mem_set_vtable() or u_libsys_init_full()
+ * afterwards.
+ */
+U_API bool
+u_mem_stats_enable(void);
+
+/*!@brief Disables the allocation statistics.
+ * @return true if the statistics were disabled, false if there are
+ * instrumented blocks still live.
+ * @note This call is not thread-safe.
+ * @since 0.1.0
+ */
+U_API bool
+u_mem_stats_disable(void);
+
+/*!@brief Checks whether the allocation statistics are enabled.
+ * @return true if the statistics are enabled, false otherwise.
+ * @since 0.1.0
+ */
+U_API bool
+u_mem_stats_is_enabled(void);
+
+/*!@brief Gets the allocation statistics.
+ * @param[out] stats Statistics to fill in.
+ * @since 0.1.0
+ *
+ * The counters are merged from all the shards without stopping the other
+ * threads, so the result is a consistent snapshot only when the memory is not
+ * allocated concurrently.
+ */
+U_API void
+u_mem_stats_get(mem_stats_t *stats);
+
+/*!@brief Gets the allocation statistics per call site.
+ * @param[out] sites Array to fill in.
+ * @param max_sites Size of @a sites.
+ * @return Number of the call sites written to @a sites.
+ * @since 0.1.0
+ *
+ * The call sites are sorted by the live bytes, the largest first. At most
+ * #U_MEM_STATS_MAX_SITES sites are reported.
+ */
+U_API int
+u_mem_stats_get_sites(mem_stats_site_t *sites, int max_sites);
+
+/*!@brief Prints the allocation statistics to the standard error.
+ * @since 0.1.0
+ *
+ * The report contains the totals, the size histogram and the top call sites
+ * by the live bytes.
+ */
+U_API void
+u_mem_stats_dump(void);
+
 /*!@brief Gets a memory mapped block from the system.
  * @param n_bytes Size of the memory block in bytes.
  * @param[out] error Error report object, NULL to ignore.
@@ -164,6 +411,29 @@ u_mem_restore_vtable(void);
 U_API ptr_t
 u_mem_mmap(size_t n_bytes, err_t **error);
 
+/*!@brief Gets a memory mapped block from the system with extended options.
+ * @param n_bytes Size of the memory block in bytes.
+ * @param alignment Alignment of the block, must be a power of two, 0 for the
+ * system default.
+ * @param flags Combination of #mem_map_flags_t options.
+ * @param[out] error Error report object, NULL to ignore.
+ * @return Pointer to the allocated memory block in case of success, NULL
+ * otherwise.
+ * @since 0.1.0
+ *
+ * The block is aligned to the page size at least. With
+ * #U_MEM_MAP_HUGE_PAGES the reserved huge pages are used when @a n_bytes is a
+ * multiple of #U_MEM_HUGE_PAGE_SIZE and the system has enough of them,
+ * otherwise the block is aligned to #U_MEM_HUGE_PAGE_SIZE and marked for the
+ * transparent huge pages. With #U_MEM_MAP_POPULATE every page is committed
+ * before the call returns.
+ *
+ * Alignment stricter than the allocation granularity is supported only on
+ * the systems with POSIX memory mapping.
+ */
+U_API ptr_t
+u_mem_mmap_full(size_t n_bytes, size_t alignment, int flags, err_t **error);
+
 /*!@brief Unmaps memory back to the system.
  * @param mem Pointer to a memory block previously allocated using the
  * u_mem_mmap() call.
@@ -175,4 +445,48 @@ u_mem_mmap(size_t n_bytes, err_t **error);
 U_API bool
 u_mem_munmap(ptr_t mem, size_t n_bytes, err_t **error);
 
+/*!@brief Creates a new arena.
+ * @param chunk_size Size of the memory mapped chunks in bytes, 0 to use
+ * #U_ARENA_DEFAULT_CHUNK_SIZE.
+ * @return Pointer to the newly created arena in case of success, NULL
+ * otherwise.
+ * @since 0.1.0
+ *
+ * No memory is mapped until the first allocation. The chunk size is rounded up
+ * to 4096 bytes. Larger allocations get a dedicated chunk of their own.
+ */
+U_API arena_t *
+u_arena_new(size_t chunk_size);
+
+/*!@brief Allocates a memory block from an arena.
+ * @param arena Arena to allocate from.
+ * @param n_bytes Size of the memory block in bytes.
+ * @param alignment Alignment of the block, must be a power of two, 0 to use
+ * #U_ARENA_DEFAULT_ALIGNMENT.
+ * @return Pointer to the memory block in case of success, NULL otherwise.
+ * @since 0.1.0
+ *
+ * The block is not initialized. It stays valid until u_arena_reset() or
+ * u_arena_free() is called for the arena.
+ */
+U_API ptr_t
+u_arena_alloc(arena_t *arena, size_t n_bytes, size_t alignment);
+
+/*!@brief Releases all the blocks allocated from an arena at once.
+ * @param arena Arena to reset.
+ * @since 0.1.0
+ *
+ * The regular chunks are kept to serve the next allocations, the dedicated
+ * chunks of large blocks are unmapped.
+ */
+U_API void
+u_arena_reset(arena_t *arena);
+
+/*!@brief Frees an arena with all its memory.
+ * @param arena Arena to free.
+ * @since 0.1.0
+ */
+U_API void
+u_arena_free(arena_t *arena);
+
 #endif /* !U_MEM_H__ */
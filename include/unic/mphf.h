@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!@file unic/mphf.h
+ * @brief Minimal perfect hash function
+ * @author Alexander Saprykin
+ *
+ * A minimal perfect hash function maps every key of a static set of n keys to
+ * a distinct index in [0, n). It fits the lookup tables which are known at
+ * load time, like command or section names: the index is used to address a
+ * plain array holding the data, so a lookup costs one hash computation, one
+ * memory read and one key comparison.
+ *
+ * The function is built with u_mphf_build() using the hash and displace
+ * method: keys are spread over small buckets and every bucket gets a pilot
+ * value which moves all its keys into free slots. Only the pilots are kept,
+ * which takes a few bits per key regardless of the key length.
+ *
+ * Keys outside of the set are mapped to some index as well, so the key stored
+ * at the returned index must be compared with the looked up one:
+ * @code
+ * mphf_t *mphf = u_mphf_build (names, n);
+ * ...
+ * size_t i = u_mphf_lookup (mphf, name);
+ *
+ * if (strcmp (names_by_index[i], name) == 0)
+ *   ...
+ * @endcode
+ */
+#ifndef U_MPHF_H__
+# define U_MPHF_H__
+
+#include "unic/macros.h"
+#include "unic/types.h"
+
+/*!@brief Opaque data structure for a minimal perfect hash function. */
+typedef struct mphf mphf_t;
+
+/*!@brief Builds a minimal perfect hash function for a key set.
+ * @param keys Array of distinct NUL-terminated keys.
+ * @param n Number of keys, must be greater than 0.
+ * @return Pointer to a newly built #mphf_t structure in case of success, NULL
+ * otherwise.
+ * @since 0.1.0
+ * @note Free with u_mphf_free() after usage.
+ *
+ * The keys are not referenced after the call. Building fails if the array
+ * contains duplicate keys.
+ */
+U_API mphf_t *
+u_mphf_build(const byte_t *const *keys, size_t n);
+
+/*!@brief Gets the index of a key.
+ * @param mphf Minimal perfect hash function.
+ * @param key NUL-terminated key.
+ * @return Index of the @a key in [0, n), where n is the number of keys the
+ * function was built for, 0 if @a mphf or @a key is NULL.
+ * @since 0.1.0
+ *
+ * The result is meaningful only for the keys of the built set.
+ */
+U_API size_t
+u_mphf_lookup(const mphf_t *mphf, const byte_t *key);
+
+/*!@brief Gets the number of keys a function was built for.
+ * @param mphf Minimal perfect hash function.
+ * @return Number of keys, 0 if @a mphf is NULL.
+ * @since 0.1.0
+ */
+U_API size_t
+u_mphf_get_size(const mphf_t *mphf);
+
+/*!@brief Frees a previously built #mphf_t.
+ * @param mphf Minimal perfect hash function to free.
+ * @since 0.1.0
+ */
+U_API void
+u_mphf_free(mphf_t *mphf);
+
+#endif /* !U_MPHF_H__ */
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!@file unic/pool.h
+ * @brief Fixed-size object pool
+ * @author Alexander Saprykin
+ *
+ * #pool_t allocates objects of a single size much faster than the system
+ * allocator. It is meant for small structures which are created and destroyed
+ * all the time, like list nodes or request descriptors.
+ *
+ * Every thread keeps a cache of two magazines per pool, each magazine holds up
+ * to #U_POOL_MAGAZINE_SIZE free objects. Most u_pool_alloc() and
+ * u_pool_release() calls only pop or push a magazine of the calling thread, so
+ * they take no locks and never touch memory shared with other threads. When
+ * both magazines of a thread run empty or full, a whole magazine is exchanged
+ * with the depot shared by all the threads, which is guarded by a spinlock.
+ * New objects are carved from large chunks a magazine at a time, so a thread
+ * mostly gets objects lying next to each other. This is not a guarantee
+ * against false sharing: the runs are not aligned to cache lines, and the
+ * objects released by other threads get mixed in.
+ *
+ * An object may be released by any thread, not only by the one which has
+ * allocated it. The magazines of an exiting thread are returned to the depot.
+ *
+ * Objects are aligned to 8 bytes. Pool memory is returned to the system only
+ * by u_pool_free(), which releases all the objects of the pool at once. No
+ * thread may use the pool during or after this call.
+ */
+#ifndef U_POOL_H__
+# define U_POOL_H__
+
+#include "unic/macros.h"
+#include "unic/types.h"
+
+/*!@brief Object pool opaque data structure. */
+typedef struct pool pool_t;
+
+/*!@brief Number of objects in a magazine. */
+#define U_POOL_MAGAZINE_SIZE 32
+
+/*!@brief Creates a new object pool.
+ * @param object_size Size of the objects in bytes.
+ * @return Pointer to the newly created pool in case of success, NULL
+ * otherwise.
+ * @since 0.1.0
+ */
+U_API pool_t *
+u_pool_new(size_t object_size);
+
+/*!@brief Allocates an object from a pool.
+ * @param pool Pool to allocate from.
+ * @return Pointer to the uninitialized object in case of success, NULL
+ * otherwise.
+ * @since 0.1.0
+ */
+U_API ptr_t
+u_pool_alloc(pool_t *pool);
+
+/*!@brief Allocates an object from a pool and fills it with zeros.
+ * @param pool Pool to allocate from.
+ * @return Pointer to the zeroed object in case of success, NULL otherwise.
+ * @since 0.1.0
+ */
+U_API ptr_t
+u_pool_alloc0(pool_t *pool);
+
+/*!@brief Returns an object to a pool.
+ * @param pool Pool the object was allocated from.
+ * @param obj Object to release, maybe NULL.
+ * @since 0.1.0
+ */
+U_API void
+u_pool_release(pool_t *pool, ptr_t obj);
+
+/*!@brief Frees a pool with all its objects.
+ * @param pool Pool to free.
+ * @since 0.1.0
+ *
+ * All the objects of the pool become invalid, even if they were not released.
+ */
+U_API void
+u_pool_free(pool_t *pool);
+
+#endif /* !U_POOL_H__ */
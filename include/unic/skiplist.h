@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!@file unic/skiplist.h
+ * @brief Lock-free ordered map
+ * @author Alexander Saprykin
+ *
+ * #skiplist_t is a concurrent ordered map built as a lock-free skip list: all
+ * the pairs are kept in a sorted linked list, and every pair also takes part
+ * in a random number of sparser express lists above it, so searching takes
+ * O(log n) steps on average. Readers and writers only use atomic pointer
+ * operations, lookups and scans never write to shared memory, so reads scale
+ * with the number of cores while other threads insert and remove pairs. Use it
+ * instead of a #tree_t guarded by a #rwlock_t for read-mostly ordered indexes.
+ *
+ * The API follows #tree_t: pairs are ordered by a compare function, and the
+ * map supports lookups, ordered traversing with u_skiplist_foreach(), range
+ * scans with u_skiplist_foreach_from() and u_skiplist_lower_bound(). Scans
+ * are weakly consistent: they see every pair which stays in the map during
+ * the whole scan and never see a pair twice, while pairs inserted or removed
+ * concurrently may or may not be visited.
+ *
+ * Removed pairs are reclaimed using epochs, the same way as in #lfhtable_t:
+ * the key and value destroy functions are deferred until no thread may be
+ * traversing the removed pair anymore, which can happen after
+ * u_skiplist_remove() returns.
+ *
+ * Unlike #tree_t, u_skiplist_insert() never replaces an existing pair, it
+ * returns false instead. To change a value remove the key and insert it again.
+ *
+ * Keys and values returned by the lookup functions are not protected after
+ * the call returns: if another thread removes the pair, they may be destroyed
+ * after a short while. Use destroy functions only when it is safe for your
+ * data, or process the pairs inside the u_skiplist_foreach() callbacks.
+ */
+#ifndef U_SKIPLIST_H__
+# define U_SKIPLIST_H__
+
+#include "unic/macros.h"
+#include "unic/types.h"
+
+/*!@brief Opaque data structure for a lock-free skip list. */
+typedef struct skiplist skiplist_t;
+
+/*!@brief Initializes a new lock-free skip list.
+ * @param func Key compare function.
+ * @return Pointer to a newly initialized #skiplist_t structure in case of
+ * success, NULL otherwise.
+ * @since 0.1.0
+ * @note Free with u_skiplist_free() after usage.
+ */
+U_API skiplist_t *
+u_skiplist_new(cmp_fn_t func);
+
+/*!@brief Initializes a new lock-free skip list with additional data and
+ * memory management.
+ * @param func Key compare function.
+ * @param data Data to be passed to @a func along with the keys.
+ * @param key_destroy Function to call on every key when its pair is
+ * reclaimed, maybe NULL.
+ * @param value_destroy Function to call on every value when its pair is
+ * reclaimed, maybe NULL.
+ * @return Pointer to a newly initialized #skiplist_t structure in case of
+ * success, NULL otherwise.
+ * @since 0.1.0
+ * @note Free with u_skiplist_free() after usage.
+ */
+U_API skiplist_t *
+u_skiplist_new_full(cmp_data_fn_t func, ptr_t data, destroy_fn_t key_destroy,
+  destroy_fn_t value_destroy);
+
+/*!@brief Inserts a new key-value pair into a lock-free skip list.
+ * @param list Initialized lock-free skip list.
+ * @param key Key to insert.
+ * @param value Value to insert.
+ * @return true if the pair was inserted, false if the @a key already exists
+ * or in case of error.
+ * @since 0.1.0
+ *
+ * The list takes ownership of @a key and @a value only if true is returned.
+ */
+U_API bool
+u_skiplist_insert(skiplist_t *list, ptr_t key, ptr_t value);
+
+/*!@brief Searches for a specifed key in a lock-free skip list.
+ * @param list Lock-free skip list to lookup in.
+ * @param key Key to lookup for.
+ * @return Value related to its key pair (can be NULL), (#ptr_t) -1 if no
+ * value was found.
+ * @since 0.1.0
+ */
+U_API ptr_t
+u_skiplist_lookup(skiplist_t *list, const_ptr_t key);
+
+/*!@brief Removes @a key from a lock-free skip list.
+ * @param list Lock-free skip list to remove the key from.
+ * @param key Key to remove.
+ * @return true if the key was removed by this call, false otherwise.
+ * @since 0.1.0
+ *
+ * The destroy functions are called later, once no other thread may access
+ * the removed pair.
+ */
+U_API bool
+u_skiplist_remove(skiplist_t *list, const_ptr_t key);
+
+/*!@brief Finds the first pair with a key not less than the given one.
+ * @param list Lock-free skip list to search in.
+ * @param key Key to search for.
+ * @param[out] found_key Key of the found pair, may be NULL.
+ * @param[out] value Value of the found pair, may be NULL.
+ * @return true if the pair was found, false otherwise.
+ * @since 0.1.0
+ */
+U_API bool
+u_skiplist_lower_bound(skiplist_t *list, const_ptr_t key, ptr_t *found_key,
+  ptr_t *value);
+
+/*!@brief Gets the pair with the smallest key.
+ * @param list Lock-free skip list to search in.
+ * @param[out] key Key of the pair, may be NULL.
+ * @param[out] value Value of the pair, may be NULL.
+ * @return true if the list is not empty, false otherwise.
+ * @since 0.1.0
+ */
+U_API bool
+u_skiplist_min(skiplist_t *list, ptr_t *key, ptr_t *value);
+
+/*!@brief Gets the pair with the largest key.
+ * @param list Lock-free skip list to search in.
+ * @param[out] key Key of the pair, may be NULL.
+ * @param[out] value Value of the pair, may be NULL.
+ * @return true if the list is not empty, false otherwise.
+ * @since 0.1.0
+ */
+U_API bool
+u_skiplist_max(skiplist_t *list, ptr_t *key, ptr_t *value);
+
+/*!@brief Iterates through the pairs in the ascending key order.
+ * @param list Lock-free skip list to traverse.
+ * @param traverse_func Function for traversing.
+ * @param user_data Additional (maybe NULL) user-provided data for the
+ * @a traverse_func.
+ * @since 0.1.0
+ *
+ * The pairs passed to @a traverse_func are not reclaimed until it returns.
+ * Other threads may modify the list meanwhile, but @a traverse_func must not
+ * modify it on its own.
+ */
+U_API void
+u_skiplist_foreach(skiplist_t *list, traverse_fn_t traverse_func,
+  ptr_t user_data);
+
+/*!@brief Iterates in the ascending key order starting from a given key.
+ * @param list Lock-free skip list to traverse.
+ * @param key Key to start from, the first visited pair has a key not less
+ * than @a key.
+ * @param traverse_func Function for traversing, return true from it to stop
+ * at the end of the range.
+ * @param user_data Additional (maybe NULL) user-provided data for the
+ * @a traverse_func.
+ * @since 0.1.0
+ *
+ * Takes O(log n) steps to find the first pair, then visits the pairs one by
+ * one. The same rules as for u_skiplist_foreach() apply.
+ */
+U_API void
+u_skiplist_foreach_from(skiplist_t *list, const_ptr_t key,
+  traverse_fn_t traverse_func, ptr_t user_data);
+
+/*!@brief Gets the number of pairs in a lock-free skip list.
+ * @param list Lock-free skip list to get the size for.
+ * @return Number of pairs, 0 if @a list is NULL.
+ * @since 0.1.0
+ *
+ * The value is exact only when no other thread modifies the list.
+ */
+U_API size_t
+u_skiplist_size(const skiplist_t *list);
+
+/*!@brief Frees a previously initialized #skiplist_t.
+ * @param list Lock-free skip list to free.
+ * @since 0.1.0
+ *
+ * The list must not be used by other threads anymore. Pairs removed before
+ * may still be reclaimed later.
+ */
+U_API void
+u_skiplist_free(skiplist_t *list);
+
+#endif /* !U_SKIPLIST_H__ */
@@ -27,7 +27,14 @@
  * Currently #tree_t supports the following tree types:
  * - unbalanced binary search tree;
  * - red-black self-balancing tree;
- * - AVL self-balancing tree.
+ * - AVL self-balancing tree;
+ * - B-tree.
+ *
+ * The B-tree stores up to 15 keys with their values inline in every node, so a
+ * lookup touches a few cache lines per level and the tree is several times
+ * shallower than the binary ones. It is the best choice for large trees where
+ * the lookup is dominated by cache misses. All the tree types share the same
+ * API and semantics.
  *
  * Use u_tree_new(), or its detailed variations like u_tree_new_with_data() and
  * u_tree_new_full() to create a tree structure. Take attention that a caller
@@ -35,12 +42,40 @@
  * should manually free the memory after the tree usage. Or you can provide
  * destroy notification functions for the keys and the values separately.
  *
+ * Trees with integer or string keys should be created with u_tree_new_int() or
+ * u_tree_new_str(): their keys are compared inline, without an indirect call
+ * per visited node.
+ *
  * New key-value pairs can be inserted with u_tree_insert() and removed with
  * u_tree_remove().
  *
  * Use u_tree_lookup() to find the value by a given key. You can also traverse
  * the tree in-order with u_tree_foreach().
  *
+ * Ordered queries are served by u_tree_lower_bound(), u_tree_upper_bound(),
+ * u_tree_min() and u_tree_max(). A range can be scanned with the #tree_iter_t
+ * cursor which starts at any key and moves in both directions, visiting only
+ * the nodes in the range:
+ * @code
+ * tree_iter_t iter;
+ * ptr_t       key, value;
+ *
+ * u_tree_iter_init (&iter, tree);
+ * u_tree_iter_seek (&iter, from);
+ *
+ * while (u_tree_iter_next (&iter, &key, &value) && my_cmp (key, to) < 0)
+ *   process (key, value);
+ * @endcode
+ * Unlike u_tree_foreach() the cursor never modifies the tree, so several
+ * threads can scan the same tree at once as long as nobody changes it. Any
+ * insertion or removal invalidates all the cursors of the tree.
+ *
+ * Red-black and AVL trees can answer order statistics queries in O(log n)
+ * once u_tree_enable_ranks() is called: u_tree_select() finds the pair with
+ * the given in-order index and u_tree_rank() counts the keys less than the
+ * given one, which is enough for percentiles and top-k queries. Ranked trees
+ * pay an extra walk up to the root on every insertion and removal.
+ *
  * Release memory with u_tree_free() or clear a tree with u_tree_clear(). Keys
  * and values would be destroyed only if the corresponding notification
  * functions were provided.
@@ -57,6 +92,23 @@
 /*!@brief Tree opaque data structure. */
 typedef struct tree tree_t;
 
+/*!@brief Tree cursor. */
+typedef struct tree_iter tree_iter_t;
+
+/*!@brief Maximum node path length kept by #tree_iter_t. */
+#define U_TREE_ITER_MAX_DEPTH 64
+
+/*!@brief Tree cursor, allocate it on the stack and initialize with
+ * u_tree_iter_init(). All the fields are private. */
+struct tree_iter {
+  tree_t *tree;
+  ptr_t node;
+  ptr_t path[U_TREE_ITER_MAX_DEPTH];
+  int indexes[U_TREE_ITER_MAX_DEPTH];
+  int depth;
+  bool is_before;
+};
+
 /*!@brief Internal data organization algorithm for #tree_t. */
 enum tree_kind {
 
@@ -67,7 +119,10 @@ enum tree_kind {
   U_TREE_TYPE_RB = 1,
 
   /*!@brief AVL self-balancing tree. */
-  U_TREE_TYPE_AVL = 2
+  U_TREE_TYPE_AVL = 2,
+
+  /*!@brief B-tree with multiple keys per node. */
+  U_TREE_TYPE_BTREE = 3
 };
 
 typedef enum tree_kind tree_kind_t;
@@ -113,6 +168,33 @@ U_API tree_t *
 u_tree_new_full(tree_kind_t type, cmp_data_fn_t func, ptr_t data,
   destroy_fn_t key_destroy, destroy_fn_t value_destroy);
 
+/*!@brief Initializes new #tree_t with integer keys.
+ * @param type Tree algorithm type to use, can't be changed later.
+ * @return Newly initialized #tree_t object in case of success, NULL otherwise.
+ * @since 0.1.0
+ *
+ * Keys are integers stored with #PINT_TO_POINTER and ordered as signed
+ * values. The keys are compared inline instead of calling a compare function.
+ */
+U_API tree_t *
+u_tree_new_int(tree_kind_t type);
+
+/*!@brief Initializes new #tree_t with string keys.
+ * @param type Tree algorithm type to use, can't be changed later.
+ * @param key_destroy Function to call on every key before the node destruction,
+ * maybe NULL.
+ * @param value_destroy Function to call on every value before the node
+ * destruction, maybe NULL.
+ * @return Newly initialized #tree_t object in case of success, NULL otherwise.
+ * @since 0.1.0
+ *
+ * Keys are NULL-terminated strings ordered with strcmp(), which is called
+ * directly instead of through a compare function pointer.
+ */
+U_API tree_t *
+u_tree_new_str(tree_kind_t type, destroy_fn_t key_destroy,
+  destroy_fn_t value_destroy);
+
 /*!@brief Inserts a new key-value pair into a tree.
  * @param tree #tree_t to insert a node in.
  * @param key Key to insert.
@@ -127,6 +209,24 @@ u_tree_new_full(tree_kind_t type, cmp_data_fn_t func, ptr_t data,
 U_API void
 u_tree_insert(tree_t *tree, ptr_t key, ptr_t value);
 
+/*!@brief Replaces the contents of a tree with sorted key-value pairs.
+ * @param tree #tree_t to fill.
+ * @param keys Keys in strictly ascending order.
+ * @param values Values corresponding to the @a keys, NULL to set all the
+ * values to NULL.
+ * @param n Number of pairs.
+ * @return true in case of success, false otherwise.
+ * @since 0.1.0
+ *
+ * The tree is built directly in a balanced shape in O(n) time, without any
+ * lookups or rebalancing, which makes it the fastest way to restore an ordered
+ * index. The previous contents are cleared as with u_tree_clear(). If the keys
+ * are not strictly ascending according to the tree compare function or memory
+ * allocation fails, the tree is left untouched.
+ */
+U_API bool
+u_tree_build_sorted(tree_t *tree, ptr_t *keys, ptr_t *values, int n);
+
 /*!@brief Removes a key from a tree.
  * @param tree #tree_t to remove a key from.
  * @param key A key to lookup.
@@ -193,6 +293,147 @@ u_tree_get_type(const tree_t *tree);
 U_API int
 u_tree_get_nnodes(const tree_t *tree);
 
+/*!@brief Finds the first pair with a key not less than the given one.
+ * @param tree #tree_t to search in.
+ * @param key Key to search for.
+ * @param[out] found_key Key of the found pair, maybe NULL.
+ * @param[out] value Value of the found pair, maybe NULL.
+ * @return true if such a pair exists, false otherwise.
+ * @since 0.1.0
+ */
+U_API bool
+u_tree_lower_bound(tree_t *tree, const_ptr_t key, ptr_t *found_key,
+  ptr_t *value);
+
+/*!@brief Finds the first pair with a key greater than the given one.
+ * @param tree #tree_t to search in.
+ * @param key Key to search for.
+ * @param[out] found_key Key of the found pair, maybe NULL.
+ * @param[out] value Value of the found pair, maybe NULL.
+ * @return true if such a pair exists, false otherwise.
+ * @since 0.1.0
+ */
+U_API bool
+u_tree_upper_bound(tree_t *tree, const_ptr_t key, ptr_t *found_key,
+  ptr_t *value);
+
+/*!@brief Gets the pair with the smallest key.
+ * @param tree #tree_t to get the pair from.
+ * @param[out] key Smallest key, maybe NULL.
+ * @param[out] value Value of the smallest key, maybe NULL.
+ * @return true in case of success, false if the @a tree is empty.
+ * @since 0.1.0
+ */
+U_API bool
+u_tree_min(tree_t *tree, ptr_t *key, ptr_t *value);
+
+/*!@brief Gets the pair with the largest key.
+ * @param tree #tree_t to get the pair from.
+ * @param[out] key Largest key, maybe NULL.
+ * @param[out] value Value of the largest key, maybe NULL.
+ * @return true in case of success, false if the @a tree is empty.
+ * @since 0.1.0
+ */
+U_API bool
+u_tree_max(tree_t *tree, ptr_t *key, ptr_t *value);
+
+/*!@brief Enables order statistics for a tree.
+ * @param tree #tree_t to enable order statistics for.
+ * @return true in case of success, false otherwise.
+ * @since 0.1.0
+ *
+ * Only #U_TREE_TYPE_RB and #U_TREE_TYPE_AVL trees are supported. The nodes
+ * keep their subtree sizes from now on, which allows to use u_tree_select()
+ * and u_tree_rank(). The sizes of the existing nodes are computed in O(n),
+ * enabling it for an empty tree costs nothing. Calling it again does nothing.
+ */
+U_API bool
+u_tree_enable_ranks(tree_t *tree);
+
+/*!@brief Gets a pair by its in-order position.
+ * @param tree #tree_t with order statistics enabled.
+ * @param index Zero-based position of the pair in the key order.
+ * @param[out] key Key of the pair, may be NULL.
+ * @param[out] value Value of the pair, may be NULL.
+ * @return true if the pair was found, false otherwise.
+ * @since 0.1.0
+ *
+ * Takes O(log n) time. Returns false if the @a index is out of range or
+ * order statistics are not enabled with u_tree_enable_ranks().
+ */
+U_API bool
+u_tree_select(tree_t *tree, int index, ptr_t *key, ptr_t *value);
+
+/*!@brief Counts the keys less than a given one.
+ * @param tree #tree_t with order statistics enabled.
+ * @param key Key to get the rank for, it doesn't need to be in the tree.
+ * @return Number of the keys less than the @a key in case of success, -1 if
+ * order statistics are not enabled with u_tree_enable_ranks().
+ * @since 0.1.0
+ *
+ * Takes O(log n) time. For a key stored in the tree the result is its index
+ * for u_tree_select().
+ */
+U_API int
+u_tree_rank(tree_t *tree, const_ptr_t key);
+
+/*!@brief Initializes a tree cursor.
+ * @param iter Cursor to initialize.
+ * @param tree #tree_t to walk through.
+ * @since 0.1.0
+ *
+ * The cursor is placed before the first pair. It doesn't need to be freed,
+ * it holds no resources.
+ */
+U_API void
+u_tree_iter_init(tree_iter_t *iter, tree_t *tree);
+
+/*!@brief Places a tree cursor before the first pair with a key not less than
+ * the given one.
+ * @param iter Cursor initialized with u_tree_iter_init().
+ * @param key Key to seek to.
+ * @since 0.1.0
+ *
+ * The following u_tree_iter_next() call returns the found pair, while
+ * u_tree_iter_prev() returns the pair right before it. If all the keys are
+ * less than @a key the cursor is placed after the last pair.
+ */
+U_API void
+u_tree_iter_seek(tree_iter_t *iter, const_ptr_t key);
+
+/*!@brief Places a tree cursor after the last pair.
+ * @param iter Cursor initialized with u_tree_iter_init().
+ * @since 0.1.0
+ *
+ * Use it to walk the tree backwards with u_tree_iter_prev().
+ */
+U_API void
+u_tree_iter_seek_end(tree_iter_t *iter);
+
+/*!@brief Moves a tree cursor forward.
+ * @param iter Cursor initialized with u_tree_iter_init().
+ * @param[out] key Key of the passed pair, maybe NULL.
+ * @param[out] value Value of the passed pair, maybe NULL.
+ * @return true if the cursor moved over a pair, false if it is at the end.
+ * @since 0.1.0
+ *
+ * The cursor stands between the pairs, so calling u_tree_iter_prev() right
+ * after u_tree_iter_next() returns the same pair again.
+ */
+U_API bool
+u_tree_iter_next(tree_iter_t *iter, ptr_t *key, ptr_t *value);
+
+/*!@brief Moves a tree cursor backward.
+ * @param iter Cursor initialized with u_tree_iter_init().
+ * @param[out] key Key of the passed pair, maybe NULL.
+ * @param[out] value Value of the passed pair, maybe NULL.
+ * @return true if the cursor moved over a pair, false if it is at the
+ * beginning.
+ * @since 0.1.0
+ */
+U_API bool
+u_tree_iter_prev(tree_iter_t *iter, ptr_t *key, ptr_t *value);
+
 /*!@brief Frees a previously initialized tree object.
  * @param tree #tree_t object to free.
  * @since 0.0.1
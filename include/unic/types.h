@@ -1011,6 +1011,21 @@ typedef int (*cmp_fn_t)(const_ptr_t a, const_ptr_t b);
  */
 typedef int(*cmp_data_fn_t)(const_ptr_t a, const_ptr_t b, ptr_t data);
 
+/*!@brief Calculates a hash value for a key.
+ * @param key Key to calculate the hash value for.
+ * @return Hash value of the @a key, equal keys must have equal hash values.
+ * @since 0.1.0
+ */
+typedef size_t (*hash_fn_t)(const_ptr_t key);
+
+/*!@brief Checks two keys for equality.
+ * @param a First key to check.
+ * @param b Second key to check.
+ * @return true if the keys are equal, false otherwise.
+ * @since 0.1.0
+ */
+typedef bool (*equal_fn_t)(const_ptr_t a, const_ptr_t b);
+
 #include <stdlib.h>
 #include <stddef.h>
 #include <stdarg.h>
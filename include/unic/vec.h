@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!@file unic/vec.h
+ * @brief Growable vector
+ * @author Alexander Saprykin
+ *
+ * #vec_t is a contiguous array of fixed-size elements which grows on demand.
+ * The element size is given upon creation, the elements are copied into the
+ * vector by value. Appending to the end takes an amortized O(1) time as the
+ * capacity doubles every time it runs out, while inserting or removing in the
+ * middle moves the tail of the array.
+ *
+ * The elements can be accessed directly through u_vec_data() as a plain C
+ * array, which is the fastest way to iterate over them:
+ * @code
+ * vec_t *vec;
+ * int    val, *data;
+ * size_t i;
+ *
+ * vec = u_vec_new (sizeof (int));
+ * val = 10;
+ * u_vec_push (vec, &val);
+ * data = u_vec_data (vec);
+ *
+ * for (i = 0; i < u_vec_get_size (vec); ++i)
+ *   printf ("%d\n", data[i]);
+ *
+ * u_vec_free (vec);
+ * @endcode
+ * Note that any call which grows the vector may move the elements, so don't
+ * keep the pointers returned by u_vec_data() and u_vec_at() across it.
+ *
+ * The compare functions passed to u_vec_sort() and u_vec_bsearch() receive
+ * pointers to the elements, just like qsort() does.
+ */
+#ifndef U_VEC_H__
+# define U_VEC_H__
+
+#include "unic/macros.h"
+#include "unic/types.h"
+
+/*!@brief Opaque data structure for a growable vector. */
+typedef struct vec vec_t;
+
+/*!@brief Creates a new empty vector.
+ * @param elem_size Size of a single element in bytes.
+ * @return Pointer to a newly created #vec_t in case of success, NULL
+ * otherwise.
+ * @since 0.1.0
+ * @note Free with u_vec_free() after usage.
+ */
+U_API vec_t *
+u_vec_new(size_t elem_size);
+
+/*!@brief Frees a vector.
+ * @param vec #vec_t to free.
+ * @since 0.1.0
+ *
+ * The elements are not touched, free any memory they point to beforehand.
+ */
+U_API void
+u_vec_free(vec_t *vec);
+
+/*!@brief Gets the number of elements in a vector.
+ * @param vec #vec_t to get the size of.
+ * @return Number of elements in the @a vec.
+ * @since 0.1.0
+ */
+U_API size_t
+u_vec_get_size(const vec_t *vec);
+
+/*!@brief Gets the number of elements a vector can hold without growing.
+ * @param vec #vec_t to get the capacity of.
+ * @return Capacity of the @a vec in elements.
+ * @since 0.1.0
+ */
+U_API size_t
+u_vec_get_capacity(const vec_t *vec);
+
+/*!@brief Gets the element array of a vector.
+ * @param vec #vec_t to get the elements of.
+ * @return Pointer to the first element, NULL if the @a vec has no storage.
+ * @since 0.1.0
+ */
+U_API ptr_t
+u_vec_data(const vec_t *vec);
+
+/*!@brief Gets an element of a vector.
+ * @param vec #vec_t to get the element from.
+ * @param index Index of the element.
+ * @return Pointer to the element, NULL if @a index is out of range.
+ * @since 0.1.0
+ */
+U_API ptr_t
+u_vec_at(const vec_t *vec, size_t index);
+
+/*!@brief Appends an element to the end of a vector.
+ * @param vec #vec_t to append the element to.
+ * @param elem Pointer to the element to copy, NULL to append a zeroed one.
+ * @return true in case of success, false otherwise.
+ * @since 0.1.0
+ */
+U_API bool
+u_vec_push(vec_t *vec, const_ptr_t elem);
+
+/*!@brief Removes the last element of a vector.
+ * @param vec #vec_t to remove the element from.
+ * @param elem Buffer to copy the removed element into, may be NULL.
+ * @return true if the element was removed, false if the @a vec is empty.
+ * @since 0.1.0
+ */
+U_API bool
+u_vec_pop(vec_t *vec, ptr_t elem);
+
+/*!@brief Appends several elements to the end of a vector.
+ * @param vec #vec_t to append the elements to.
+ * @param elems Array of @a n elements to copy.
+ * @param n Number of elements to append.
+ * @return true in case of success, false otherwise.
+ * @since 0.1.0
+ *
+ * The storage grows at most once and the elements are copied in a single
+ * block, which is much faster than calling u_vec_push() in a loop.
+ */
+U_API bool
+u_vec_append(vec_t *vec, const_ptr_t elems, size_t n);
+
+/*!@brief Inserts an element into a vector.
+ * @param vec #vec_t to insert the element into.
+ * @param index Position to insert at, must not exceed the vector size.
+ * @param elem Pointer to the element to copy, NULL to insert a zeroed one.
+ * @return true in case of success, false otherwise.
+ * @since 0.1.0
+ */
+U_API bool
+u_vec_insert(vec_t *vec, size_t index, const_ptr_t elem);
+
+/*!@brief Removes an element from a vector preserving the order.
+ * @param vec #vec_t to remove the element from.
+ * @param index Index of the element to remove.
+ * @param elem Buffer to copy the removed element into, may be NULL.
+ * @return true if the element was removed, false if @a index is out of range.
+ * @since 0.1.0
+ */
+U_API bool
+u_vec_remove(vec_t *vec, size_t index, ptr_t elem);
+
+/*!@brief Removes all the elements from a vector.
+ * @param vec #vec_t to clear.
+ * @since 0.1.0
+ *
+ * The storage is kept for reuse, call u_vec_shrink() to release it.
+ */
+U_API void
+u_vec_clear(vec_t *vec);
+
+/*!@brief Makes sure a vector can hold a given number of elements.
+ * @param vec #vec_t to reserve the storage in.
+ * @param n Number of elements to reserve the storage for.
+ * @return true in case of success, false otherwise.
+ * @since 0.1.0
+ */
+U_API bool
+u_vec_reserve(vec_t *vec, size_t n);
+
+/*!@brief Shrinks the storage of a vector to its size.
+ * @param vec #vec_t to shrink.
+ * @return true in case of success, false otherwise.
+ * @since 0.1.0
+ */
+U_API bool
+u_vec_shrink(vec_t *vec);
+
+/*!@brief Sorts the elements of a vector.
+ * @param vec #vec_t to sort.
+ * @param func Function to compare the elements with.
+ * @since 0.1.0
+ */
+U_API void
+u_vec_sort(vec_t *vec, cmp_fn_t func);
+
+/*!@brief Searches for an element in a sorted vector.
+ * @param vec Sorted #vec_t to search in.
+ * @param key Pointer to the key to search for.
+ * @param func Function to compare an element (the first argument) with the
+ * @a key (the second argument).
+ * @param index Location to store the index of the found element, or the
+ * position to insert @a key at to keep the order if it was not found, may
+ * be NULL.
+ * @return true if the element was found, false otherwise.
+ * @since 0.1.0
+ */
+U_API bool
+u_vec_bsearch(const vec_t *vec, const_ptr_t key, cmp_fn_t func,
+  size_t *index);
+
+#endif /* !U_VEC_H__ */
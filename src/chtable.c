@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "unic/mem.h"
+#include "unic/htable.h"
+#include "unic/rwlock.h"
+#include "unic/thread.h"
+#include "unic/chtable.h"
+
+/* Shards per ideal thread when the count is not given */
+#define U_CHTABLE_SHARDS_PER_THREAD 4
+
+/* Upper limit for the number of shards */
+#define U_CHTABLE_MAX_SHARDS 65536
+
+typedef struct chtable_shard chtable_shard_t;
+
+struct chtable_shard {
+  rwlock_t *lock;
+  htable_t *table;
+};
+
+struct chtable {
+  chtable_shard_t *shards;
+  size_t mask;
+  hash_fn_t hash_func;
+};
+
+static chtable_shard_t *
+pp_chtable_get_shard(const chtable_t *table, const_ptr_t key);
+
+static chtable_shard_t *
+pp_chtable_get_shard(const chtable_t *table, const_ptr_t key) {
+  size_t hash;
+
+  hash = table->hash_func != NULL
+    ? table->hash_func(key) : u_htable_ptr_hash(key);
+
+  /* Buckets are indexed with the low bits, select the shard with the high
+   * ones of a multiplicative remix */
+  return &table->shards[
+    (((u32_t) hash * 0x9E3779B9U) >> 16) & table->mask
+  ];
+}
+
+chtable_t *
+u_chtable_new(void) {
+  return u_chtable_new_full(0, NULL, NULL, NULL, NULL);
+}
+
+chtable_t *
+u_chtable_new_full(size_t nshards, hash_fn_t hash_func, equal_fn_t equal_func,
+  destroy_fn_t key_destroy, destroy_fn_t value_destroy) {
+  chtable_t *ret;
+  size_t n, i;
+
+  if (nshards == 0) {
+    nshards = (size_t) u_thread_ideal_count() * U_CHTABLE_SHARDS_PER_THREAD;
+  }
+  if (nshards > U_CHTABLE_MAX_SHARDS) {
+    nshards = U_CHTABLE_MAX_SHARDS;
+  }
+  for (n = 1; n < nshards; n <<= 1);
+  if (U_UNLIKELY ((ret = u_malloc0(sizeof(chtable_t))) == NULL)) {
+    U_ERROR ("chtable_t::u_chtable_new_full: failed(1) to allocate memory");
+    return NULL;
+  }
+  if (U_UNLIKELY (
+    (ret->shards = u_malloc0(n * sizeof(chtable_shard_t))) == NULL)) {
+    U_ERROR ("chtable_t::u_chtable_new_full: failed(2) to allocate memory");
+    u_free(ret);
+    return NULL;
+  }
+  ret->mask = n - 1;
+  ret->hash_func = hash_func;
+  for (i = 0; i < n; ++i) {
+    ret->shards[i].lock = u_rwlock_new();
+    ret->shards[i].table = u_htable_new_full(
+      hash_func, equal_func, key_destroy, value_destroy
+    );
+    if (U_UNLIKELY (
+      ret->shards[i].lock == NULL || ret->shards[i].table == NULL)) {
+      U_ERROR ("chtable_t::u_chtable_new_full: failed to create shard");
+      u_chtable_free(ret);
+      return NULL;
+    }
+  }
+  return ret;
+}
+
+void
+u_chtable_insert(chtable_t *table, ptr_t key, ptr_t value) {
+  chtable_shard_t *shard;
+
+  if (U_UNLIKELY (table == NULL)) {
+    return;
+  }
+  shard = pp_chtable_get_shard(table, key);
+  u_rwlock_writer_lock(shard->lock);
+  u_htable_insert(shard->table, key, value);
+  u_rwlock_writer_unlock(shard->lock);
+}
+
+ptr_t
+u_chtable_lookup(chtable_t *table, const_ptr_t key) {
+  chtable_shard_t *shard;
+  ptr_t ret;
+
+  if (U_UNLIKELY (table == NULL)) {
+    return NULL;
+  }
+  shard = pp_chtable_get_shard(table, key);
+  u_rwlock_reader_lock(shard->lock);
+  ret = u_htable_lookup(shard->table, key);
+  u_rwlock_reader_unlock(shard->lock);
+  return ret;
+}
+
+void
+u_chtable_remove(chtable_t *table, const_ptr_t key) {
+  chtable_shard_t *shard;
+
+  if (U_UNLIKELY (table == NULL)) {
+    return;
+  }
+  shard = pp_chtable_get_shard(table, key);
+  u_rwlock_writer_lock(shard->lock);
+  u_htable_remove(shard->table, key);
+  u_rwlock_writer_unlock(shard->lock);
+}
+
+void
+u_chtable_foreach(chtable_t *table, traverse_fn_t func, ptr_t user_data) {
+  htable_iter_t iter;
+  ptr_t key, value;
+  size_t i;
+  bool need_stop;
+
+  if (U_UNLIKELY (table == NULL || func == NULL)) {
+    return;
+  }
+  need_stop = false;
+  for (i = 0; i <= table->mask && need_stop == false; ++i) {
+    u_rwlock_reader_lock(table->shards[i].lock);
+    u_htable_iter_init(&iter, table->shards[i].table);
+    while (need_stop == false && u_htable_iter_next(&iter, &key, &value)) {
+      need_stop = func(key, value, user_data);
+    }
+    u_rwlock_reader_unlock(table->shards[i].lock);
+  }
+}
+
+size_t
+u_chtable_get_nshards(const chtable_t *table) {
+  if (U_UNLIKELY (table == NULL)) {
+    return 0;
+  }
+  return table->mask + 1;
+}
+
+void
+u_chtable_free(chtable_t *table) {
+  size_t i;
+
+  if (U_UNLIKELY (table == NULL)) {
+    return;
+  }
+  for (i = 0; i <= table->mask; ++i) {
+    u_rwlock_free(table->shards[i].lock);
+    u_htable_free(table->shards[i].table);
+  }
+  u_free(table->shards);
+  u_free(table);
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "unic/dlist.h"
+
+void
+u_dlist_init(dlist_t *list) {
+  if (U_UNLIKELY (list == NULL)) {
+    return;
+  }
+  list->head = NULL;
+  list->tail = NULL;
+  list->count = 0;
+}
+
+void
+u_dlist_append(dlist_t *list, dlist_node_t *node) {
+  u_dlist_insert_before(list, NULL, node);
+}
+
+void
+u_dlist_prepend(dlist_t *list, dlist_node_t *node) {
+  u_dlist_insert_after(list, NULL, node);
+}
+
+void
+u_dlist_insert_before(dlist_t *list, dlist_node_t *pos, dlist_node_t *node) {
+  if (U_UNLIKELY (list == NULL || node == NULL)) {
+    return;
+  }
+  node->next = pos;
+  node->prev = pos == NULL ? list->tail : pos->prev;
+  if (node->prev == NULL) {
+    list->head = node;
+  } else {
+    node->prev->next = node;
+  }
+  if (pos == NULL) {
+    list->tail = node;
+  } else {
+    pos->prev = node;
+  }
+  ++list->count;
+}
+
+void
+u_dlist_insert_after(dlist_t *list, dlist_node_t *pos, dlist_node_t *node) {
+  if (U_UNLIKELY (list == NULL || node == NULL)) {
+    return;
+  }
+  node->prev = pos;
+  node->next = pos == NULL ? list->head : pos->next;
+  if (node->next == NULL) {
+    list->tail = node;
+  } else {
+    node->next->prev = node;
+  }
+  if (pos == NULL) {
+    list->head = node;
+  } else {
+    pos->next = node;
+  }
+  ++list->count;
+}
+
+void
+u_dlist_remove(dlist_t *list, dlist_node_t *node) {
+  if (U_UNLIKELY (list == NULL || node == NULL)) {
+    return;
+  }
+  if (node->prev == NULL) {
+    list->head = node->next;
+  } else {
+    node->prev->next = node->next;
+  }
+  if (node->next == NULL) {
+    list->tail = node->prev;
+  } else {
+    node->next->prev = node->prev;
+  }
+  node->next = NULL;
+  node->prev = NULL;
+  --list->count;
+}
+
+dlist_node_t *
+u_dlist_pop_front(dlist_t *list) {
+  dlist_node_t *ret;
+
+  if (U_UNLIKELY (list == NULL || (ret = list->head) == NULL)) {
+    return NULL;
+  }
+  u_dlist_remove(list, ret);
+  return ret;
+}
+
+dlist_node_t *
+u_dlist_pop_back(dlist_t *list) {
+  dlist_node_t *ret;
+
+  if (U_UNLIKELY (list == NULL || (ret = list->tail) == NULL)) {
+    return NULL;
+  }
+  u_dlist_remove(list, ret);
+  return ret;
+}
+
+void
+u_dlist_move_to_front(dlist_t *list, dlist_node_t *node) {
+  if (U_UNLIKELY (list == NULL || node == NULL) || list->head == node) {
+    return;
+  }
+  u_dlist_remove(list, node);
+  u_dlist_insert_after(list, NULL, node);
+}
+
+void
+u_dlist_move_to_back(dlist_t *list, dlist_node_t *node) {
+  if (U_UNLIKELY (list == NULL || node == NULL) || list->tail == node) {
+    return;
+  }
+  u_dlist_remove(list, node);
+  u_dlist_insert_before(list, NULL, node);
+}
+
+void
+u_dlist_foreach(dlist_t *list, fn_t func, ptr_t user_data) {
+  dlist_node_t *node, *next;
+
+  if (U_UNLIKELY (list == NULL || func == NULL)) {
+    return;
+  }
+  for (node = list->head; node != NULL; node = next) {
+    next = node->next;
+    func(node, user_data);
+  }
+}
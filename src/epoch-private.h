@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNIC_HEADER_PEPOCH_PRIVATE_H
+# define UNIC_HEADER_PEPOCH_PRIVATE_H
+
+#include "unic/macros.h"
+#include "unic/types.h"
+
+/*!@brief Retired object header, embed it into lock-free nodes. */
+typedef struct epoch_entry {
+
+  /*!@brief Next retired object of the same thread. */
+  struct epoch_entry *next;
+
+  /*!@brief Function to reclaim the object, gets the entry pointer. */
+  destroy_fn_t free_func;
+} epoch_entry_t;
+
+/*!@brief Enters an epoch protected critical section.
+ * @return true in case of success, false if the per-thread record could not
+ * be allocated.
+ *
+ * Pointers read from lock-free structures stay valid until the matching
+ * u_epoch_leave() call. Critical sections can be nested.
+ */
+bool
+u_epoch_enter(void);
+
+/*!@brief Leaves an epoch protected critical section. */
+void
+u_epoch_leave(void);
+
+/*!@brief Defers reclamation of an unlinked object.
+ * @param entry Header embedded into the object.
+ * @param free_func Function to call with @a entry once no thread can hold a
+ * reference to the object anymore.
+ *
+ * Must be called inside a critical section after the object was unlinked
+ * from any shared structure.
+ */
+void
+u_epoch_retire(epoch_entry_t *entry, destroy_fn_t free_func);
+
+#endif /* UNIC_HEADER_PEPOCH_PRIVATE_H */
@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Epoch based memory reclamation for the lock-free containers.
+ *
+ * Every thread owns a record which is published in a global lock-free list.
+ * Entering a critical section stores the current global epoch in the record
+ * together with the active bit. Unlinked objects are tagged with the global
+ * epoch read after the unlink: no reader may still reference an object tagged
+ * with epoch E once the global epoch reached E + 2, because the epoch can
+ * only advance when all the active threads have observed its current value.
+ *
+ * Epochs are counted in steps of two, so the lowest bit of a record state is
+ * free to mark the active threads. */
+
+#include "unic/atomic.h"
+#include "unic/mem.h"
+#include "unic/thread.h"
+#include "epoch-private.h"
+
+/* Retired objects per thread before trying to advance the epoch */
+#define U_EPOCH_COLLECT_THRESHOLD 64
+
+/* Step of the global epoch, keeps the active bit free */
+#define U_EPOCH_STEP 2U
+
+/* Number of epochs an object must age before reclamation */
+#define U_EPOCH_GRACE (2 * U_EPOCH_STEP)
+
+typedef struct epoch_record epoch_record_t;
+
+struct epoch_record {
+  volatile int state;
+  volatile int in_use;
+  int nesting;
+  size_t nretired;
+  epoch_entry_t *limbo[3];
+  uint_t limbo_epoch[3];
+  epoch_record_t *next;
+};
+
+static volatile int pp_epoch_global = 0;
+static ptr_t volatile pp_epoch_records = NULL;
+static thread_key_t *pp_epoch_key = NULL;
+
+static void
+pp_epoch_free_list(epoch_entry_t *list);
+
+static void
+pp_epoch_collect(epoch_record_t *record, uint_t epoch);
+
+static bool
+pp_epoch_try_advance(uint_t epoch);
+
+static void
+pp_epoch_thread_exit(ptr_t data);
+
+static epoch_record_t *
+pp_epoch_get_record(void);
+
+static void
+pp_epoch_free_list(epoch_entry_t *list) {
+  epoch_entry_t *next;
+
+  for (; list != NULL; list = next) {
+    next = list->next;
+    list->free_func(list);
+  }
+}
+
+static void
+pp_epoch_collect(epoch_record_t *record, uint_t epoch) {
+  epoch_entry_t *list;
+  int i;
+
+  for (i = 0; i < 3; ++i) {
+    if (record->limbo[i] != NULL
+      && epoch - record->limbo_epoch[i] >= U_EPOCH_GRACE) {
+      list = record->limbo[i];
+      record->limbo[i] = NULL;
+      pp_epoch_free_list(list);
+    }
+  }
+}
+
+static bool
+pp_epoch_try_advance(uint_t epoch) {
+  epoch_record_t *record;
+  int state;
+
+  record = (epoch_record_t *) u_atomic_pointer_get(&pp_epoch_records);
+  for (; record != NULL; record = record->next) {
+    state = u_atomic_int_get(&record->state);
+    if ((state & 1) != 0 && ((uint_t) state & ~1U) != epoch) {
+      return false;
+    }
+  }
+  return u_atomic_int_compare_and_exchange(
+    &pp_epoch_global, (int) epoch, (int) (epoch + U_EPOCH_STEP)
+  );
+}
+
+static void
+pp_epoch_thread_exit(ptr_t data) {
+  epoch_record_t *record;
+
+  /* Pending objects stay in the record and are reclaimed by the next thread
+   * which takes it over, or on shutdown */
+  record = (epoch_record_t *) data;
+  record->nesting = 0;
+  u_atomic_int_set(&record->state, 0);
+  u_atomic_int_set(&record->in_use, 0);
+}
+
+static epoch_record_t *
+pp_epoch_get_record(void) {
+  epoch_record_t *record;
+  ptr_t head;
+
+  record = (epoch_record_t *) u_thread_get_local(pp_epoch_key);
+  if (U_LIKELY (record != NULL)) {
+    return record;
+  }
+  record = (epoch_record_t *) u_atomic_pointer_get(&pp_epoch_records);
+  for (; record != NULL; record = record->next) {
+    if (u_atomic_int_get(&record->in_use) == 0
+      && u_atomic_int_compare_and_exchange(&record->in_use, 0, 1)) {
+      break;
+    }
+  }
+  if (record == NULL) {
+    if (U_UNLIKELY ((record = u_malloc0(sizeof(epoch_record_t))) == NULL)) {
+      U_ERROR ("EPOCH::pp_epoch_get_record: failed to allocate memory");
+      return NULL;
+    }
+    record->in_use = 1;
+    do {
+      head = u_atomic_pointer_get(&pp_epoch_records);
+      record->next = (epoch_record_t *) head;
+    } while (!u_atomic_pointer_compare_and_exchange(
+      &pp_epoch_records, head, record
+    ));
+  }
+  u_thread_set_local(pp_epoch_key, record);
+  return record;
+}
+
+bool
+u_epoch_enter(void) {
+  epoch_record_t *record;
+
+  if (U_UNLIKELY ((record = pp_epoch_get_record()) == NULL)) {
+    return false;
+  }
+  if (record->nesting++ == 0) {
+    u_atomic_int_set(
+      &record->state, (int) ((uint_t) u_atomic_int_get(&pp_epoch_global) | 1U)
+    );
+  }
+  return true;
+}
+
+void
+u_epoch_leave(void) {
+  epoch_record_t *record;
+
+  record = (epoch_record_t *) u_thread_get_local(pp_epoch_key);
+  if (U_UNLIKELY (record == NULL || record->nesting == 0)) {
+    return;
+  }
+  if (--record->nesting == 0) {
+    u_atomic_int_set(&record->state, 0);
+  }
+}
+
+void
+u_epoch_retire(epoch_entry_t *entry, destroy_fn_t free_func) {
+  epoch_record_t *record;
+  uint_t epoch;
+  int i;
+
+  record = (epoch_record_t *) u_thread_get_local(pp_epoch_key);
+  if (U_UNLIKELY (record == NULL || record->nesting == 0)) {
+    U_WARNING ("EPOCH::u_epoch_retire: called outside critical section");
+    return;
+  }
+  epoch = (uint_t) u_atomic_int_get(&pp_epoch_global);
+  i = (int) ((epoch / U_EPOCH_STEP) % 3);
+  if (record->limbo[i] != NULL && record->limbo_epoch[i] != epoch) {
+    /* The list holds objects at least three epochs old */
+    pp_epoch_free_list(record->limbo[i]);
+    record->limbo[i] = NULL;
+  }
+  entry->free_func = free_func;
+  entry->next = record->limbo[i];
+  record->limbo[i] = entry;
+  record->limbo_epoch[i] = epoch;
+  if (++record->nretired >= U_EPOCH_COLLECT_THRESHOLD) {
+    record->nretired = 0;
+    if (pp_epoch_try_advance(epoch)) {
+      epoch += U_EPOCH_STEP;
+    } else {
+      epoch = (uint_t) u_atomic_int_get(&pp_epoch_global);
+    }
+    pp_epoch_collect(record, epoch);
+  }
+}
+
+void
+u_epoch_init(void) {
+  if (U_LIKELY (pp_epoch_key == NULL)) {
+    pp_epoch_key = u_thread_local_new(pp_epoch_thread_exit);
+  }
+}
+
+void
+u_epoch_shutdown(void) {
+  epoch_record_t *record, *next;
+  int i;
+
+  /* No thread may be inside a critical section anymore */
+  record = (epoch_record_t *) u_atomic_pointer_get(&pp_epoch_records);
+  u_atomic_pointer_set(&pp_epoch_records, NULL);
+  for (; record != NULL; record = next) {
+    next = record->next;
+    for (i = 0; i < 3; ++i) {
+      pp_epoch_free_list(record->limbo[i]);
+    }
+    u_free(record);
+  }
+  u_thread_local_free(pp_epoch_key);
+  pp_epoch_key = NULL;
+}
@@ -0,0 +1,546 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "unic/err.h"
+#include "unic/mem.h"
+#include "unic/hindex.h"
+#include "err-private.h"
+
+#if !defined (U_OS_WIN) && !defined (U_OS_BEOS) && !defined (U_OS_OS2)
+# include <unistd.h>
+# include <fcntl.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include "sysclose-private.h"
+# define UNIC_HINDEX_MMAP
+#endif
+
+/* File layout, all numbers are little-endian:
+ *
+ * header, U_HINDEX_HEADER_SIZE bytes:
+ *   0  magic "UHIX"
+ *   4  u32 format version
+ *   8  u64 number of keys
+ *   16 u64 number of slots, a power of two
+ *   24 u64 offset of the slot array
+ *   32 u64 offset of the entries
+ *   40 u64 total file size
+ *   48 reserved, zeros
+ *
+ * slot, U_HINDEX_SLOT_SIZE bytes, linear probing:
+ *   0  u64 entry offset, 0 for an empty slot
+ *   8  u32 low 32 bits of the key hash
+ *   12 reserved, zeros
+ *
+ * entry, padded to U_HINDEX_ALIGN bytes:
+ *   0  u32 key length
+ *   4  u32 value length, U_HINDEX_NULL_VALUE for a NULL value
+ *   8  key bytes and NUL, then value bytes and NUL if any
+ */
+#define U_HINDEX_MAGIC "UHIX"
+#define U_HINDEX_VERSION 1
+#define U_HINDEX_HEADER_SIZE 64
+#define U_HINDEX_SLOT_SIZE 16
+#define U_HINDEX_ENTRY_HEADER_SIZE 8
+#define U_HINDEX_ALIGN 8
+#define U_HINDEX_MIN_SLOTS 16
+#define U_HINDEX_NULL_VALUE 0xFFFFFFFFU
+
+struct hindex {
+  ptr_t map;
+  const ubyte_t *data;
+  size_t size;
+  size_t count;
+  size_t mask;
+  size_t slots_offset;
+};
+
+static u32_t
+pp_hindex_read32(const ubyte_t *p);
+
+static u64_t
+pp_hindex_read64(const ubyte_t *p);
+
+static void
+pp_hindex_write32(ubyte_t *p, u32_t value);
+
+static void
+pp_hindex_write64(ubyte_t *p, u64_t value);
+
+static u64_t
+pp_hindex_entry_size(size_t key_len, const byte_t *value);
+
+static bool
+pp_hindex_write_entry(FILE *file, const byte_t *key, const byte_t *value);
+
+static ptr_t
+pp_hindex_map(const byte_t *path, size_t *size, err_t **error);
+
+static u32_t
+pp_hindex_read32(const ubyte_t *p) {
+  return (u32_t) p[0] | ((u32_t) p[1] << 8) | ((u32_t) p[2] << 16)
+    | ((u32_t) p[3] << 24);
+}
+
+static u64_t
+pp_hindex_read64(const ubyte_t *p) {
+  return (u64_t) pp_hindex_read32(p) | ((u64_t) pp_hindex_read32(p + 4) << 32);
+}
+
+static void
+pp_hindex_write32(ubyte_t *p, u32_t value) {
+  p[0] = (ubyte_t) value;
+  p[1] = (ubyte_t) (value >> 8);
+  p[2] = (ubyte_t) (value >> 16);
+  p[3] = (ubyte_t) (value >> 24);
+}
+
+static void
+pp_hindex_write64(ubyte_t *p, u64_t value) {
+  pp_hindex_write32(p, (u32_t) value);
+  pp_hindex_write32(p + 4, (u32_t) (value >> 32));
+}
+
+static u64_t
+pp_hindex_entry_size(size_t key_len, const byte_t *value) {
+  u64_t size;
+
+  size = U_HINDEX_ENTRY_HEADER_SIZE + (u64_t) key_len + 1;
+  if (value != NULL) {
+    size += (u64_t) strlen(value) + 1;
+  }
+  return (size + U_HINDEX_ALIGN - 1) & ~((u64_t) U_HINDEX_ALIGN - 1);
+}
+
+static bool
+pp_hindex_write_entry(FILE *file, const byte_t *key, const byte_t *value) {
+  ubyte_t buf[U_HINDEX_ENTRY_HEADER_SIZE + U_HINDEX_ALIGN];
+  size_t key_len, value_len, pad;
+
+  key_len = strlen(key);
+  value_len = value == NULL ? 0 : strlen(value);
+  pp_hindex_write32(buf, (u32_t) key_len);
+  pp_hindex_write32(
+    buf + 4, value == NULL ? U_HINDEX_NULL_VALUE : (u32_t) value_len
+  );
+  if (fwrite(buf, U_HINDEX_ENTRY_HEADER_SIZE, 1, file) != 1
+    || fwrite(key, 1, key_len + 1, file) != key_len + 1) {
+    return false;
+  }
+  if (value != NULL && fwrite(value, 1, value_len + 1, file) != value_len + 1) {
+    return false;
+  }
+  pad = (size_t) (pp_hindex_entry_size(key_len, value)
+    - U_HINDEX_ENTRY_HEADER_SIZE - key_len - 1
+    - (value == NULL ? 0 : value_len + 1));
+  memset(buf, 0, sizeof(buf));
+  return pad == 0 || fwrite(buf, 1, pad, file) == pad;
+}
+
+bool
+u_hindex_write(const htable_t *table, const byte_t *path, err_t **error) {
+  htable_iter_t iter;
+  ptr_t key, value;
+  ubyte_t header[U_HINDEX_HEADER_SIZE];
+  ubyte_t *slots, *slot;
+  u64_t count, nslots, offset, size;
+  size_t key_len, mask, idx;
+  u32_t hash;
+  FILE *file;
+  bool ret;
+
+  if (U_UNLIKELY (table == NULL || path == NULL)) {
+    u_err_set_err_p(
+      error,
+      (int) U_ERR_IO_INVALID_ARGUMENT,
+      0,
+      "Invalid input argument"
+    );
+    return false;
+  }
+
+  /* Size everything up first, the slot array goes before the entries */
+  count = 0;
+  size = 0;
+  u_htable_iter_init(&iter, (htable_t *) table);
+  while (u_htable_iter_next(&iter, &key, &value)) {
+    if (U_UNLIKELY (key == NULL || (key_len = strlen(key)) >= U_MAXUINT32
+      || (value != NULL && strlen(value) >= U_MAXUINT32))) {
+      u_err_set_err_p(
+        error,
+        (int) U_ERR_IO_INVALID_ARGUMENT,
+        0,
+        "Invalid key or value in hash table"
+      );
+      return false;
+    }
+    ++count;
+    size += pp_hindex_entry_size(key_len, value);
+  }
+  for (nslots = U_HINDEX_MIN_SLOTS; nslots < count * 2; nslots <<= 1);
+  if (U_UNLIKELY (nslots > U_MAXSIZE / U_HINDEX_SLOT_SIZE)) {
+    u_err_set_err_p(
+      error,
+      (int) U_ERR_IO_NO_RESOURCES,
+      0,
+      "Too many keys for index"
+    );
+    return false;
+  }
+  if (U_UNLIKELY ((
+    slots = u_malloc0((size_t) nslots * U_HINDEX_SLOT_SIZE)) == NULL)) {
+    u_err_set_err_p(
+      error,
+      (int) U_ERR_IO_NO_RESOURCES,
+      0,
+      "Failed to allocate memory for index slots"
+    );
+    return false;
+  }
+  mask = (size_t) nslots - 1;
+  offset = U_HINDEX_HEADER_SIZE + nslots * U_HINDEX_SLOT_SIZE;
+  u_htable_iter_init(&iter, (htable_t *) table);
+  while (u_htable_iter_next(&iter, &key, &value)) {
+    key_len = strlen(key);
+    hash = (u32_t) u_htable_bytes_hash(key, key_len);
+    for (idx = hash & mask;; idx = (idx + 1) & mask) {
+      slot = slots + idx * U_HINDEX_SLOT_SIZE;
+      if (pp_hindex_read64(slot) == 0) {
+        break;
+      }
+    }
+    pp_hindex_write64(slot, offset);
+    pp_hindex_write32(slot + 8, hash);
+    offset += pp_hindex_entry_size(key_len, value);
+  }
+  memset(header, 0, sizeof(header));
+  memcpy(header, U_HINDEX_MAGIC, 4);
+  pp_hindex_write32(header + 4, U_HINDEX_VERSION);
+  pp_hindex_write64(header + 8, count);
+  pp_hindex_write64(header + 16, nslots);
+  pp_hindex_write64(header + 24, U_HINDEX_HEADER_SIZE);
+  pp_hindex_write64(header + 32, U_HINDEX_HEADER_SIZE
+    + nslots * U_HINDEX_SLOT_SIZE);
+  pp_hindex_write64(header + 40, offset);
+  if (U_UNLIKELY ((file = fopen(path, "wb")) == NULL)) {
+    u_err_set_err_p(
+      error,
+      (int) u_err_get_last_io(),
+      u_err_get_last_system(),
+      "Failed to open file for writing"
+    );
+    u_free(slots);
+    return false;
+  }
+  ret = fwrite(header, sizeof(header), 1, file) == 1
+    && fwrite(slots, (size_t) nslots * U_HINDEX_SLOT_SIZE, 1, file) == 1;
+  u_free(slots);
+  u_htable_iter_init(&iter, (htable_t *) table);
+  while (ret && u_htable_iter_next(&iter, &key, &value)) {
+    ret = pp_hindex_write_entry(file, key, value);
+  }
+  if (U_UNLIKELY (ret == false)) {
+    u_err_set_err_p(
+      error,
+      (int) u_err_get_last_io(),
+      u_err_get_last_system(),
+      "Failed to write index file"
+    );
+    fclose(file);
+    return false;
+  }
+  if (U_UNLIKELY (fclose(file) != 0)) {
+    u_err_set_err_p(
+      error,
+      (int) u_err_get_last_io(),
+      u_err_get_last_system(),
+      "Failed to close index file"
+    );
+    return false;
+  }
+  return true;
+}
+
+static ptr_t
+pp_hindex_map(const byte_t *path, size_t *size, err_t **error) {
+  ptr_t addr;
+#if defined (U_OS_WIN)
+  HANDLE file, mapping;
+  LARGE_INTEGER file_size;
+
+  if (U_UNLIKELY ((file = CreateFileA((LPCSTR) path, GENERIC_READ,
+    FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL))
+    == INVALID_HANDLE_VALUE)) {
+    u_err_set_err_p(
+      error,
+      (int) u_err_get_last_io(),
+      u_err_get_last_system(),
+      "Failed to call CreateFileA() to open index file"
+    );
+    return NULL;
+  }
+  if (U_UNLIKELY (!GetFileSizeEx(file, &file_size)
+    || file_size.QuadPart < U_HINDEX_HEADER_SIZE
+    || (u64_t) file_size.QuadPart > U_MAXSIZE)) {
+    u_err_set_err_p(
+      error,
+      (int) U_ERR_IO_INVALID_ARGUMENT,
+      0,
+      "Invalid index file size"
+    );
+    CloseHandle(file);
+    return NULL;
+  }
+  *size = (size_t) file_size.QuadPart;
+  mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (U_UNLIKELY (mapping == NULL)) {
+    u_err_set_err_p(
+      error,
+      (int) u_err_get_last_io(),
+      u_err_get_last_system(),
+      "Failed to call CreateFileMapping() to map index file"
+    );
+    return NULL;
+  }
+  addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (U_UNLIKELY (addr == NULL)) {
+    u_err_set_err_p(
+      error,
+      (int) u_err_get_last_io(),
+      u_err_get_last_system(),
+      "Failed to call MapViewOfFile() to map index file"
+    );
+    return NULL;
+  }
+#elif defined (UNIC_HINDEX_MMAP)
+  struct stat st;
+  int fd;
+
+  if (U_UNLIKELY ((fd = open(path, O_RDONLY)) == -1)) {
+    u_err_set_err_p(
+      error,
+      (int) u_err_get_last_io(),
+      u_err_get_last_system(),
+      "Failed to call open() to open index file"
+    );
+    return NULL;
+  }
+  if (U_UNLIKELY (fstat(fd, &st) != 0 || st.st_size < U_HINDEX_HEADER_SIZE
+    || (u64_t) st.st_size > U_MAXSIZE)) {
+    u_err_set_err_p(
+      error,
+      (int) U_ERR_IO_INVALID_ARGUMENT,
+      0,
+      "Invalid index file size"
+    );
+    u_sys_close(fd);
+    return NULL;
+  }
+  *size = (size_t) st.st_size;
+  addr = mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+  if (U_UNLIKELY (u_sys_close(fd) != 0)) {
+    U_WARNING ("hindex_t::pp_hindex_map: failed to close file descriptor");
+  }
+  if (U_UNLIKELY (addr == MAP_FAILED)) {
+    u_err_set_err_p(
+      error,
+      (int) u_err_get_last_io(),
+      u_err_get_last_system(),
+      "Failed to call mmap() to map index file"
+    );
+    return NULL;
+  }
+#else
+  FILE *file;
+  long file_size;
+
+  /* No file mapping here, load the file into anonymous memory */
+  if (U_UNLIKELY ((file = fopen(path, "rb")) == NULL)) {
+    u_err_set_err_p(
+      error,
+      (int) u_err_get_last_io(),
+      u_err_get_last_system(),
+      "Failed to open index file"
+    );
+    return NULL;
+  }
+  if (U_UNLIKELY (fseek(file, 0, SEEK_END) != 0
+    || (file_size = ftell(file)) < U_HINDEX_HEADER_SIZE
+    || fseek(file, 0, SEEK_SET) != 0)) {
+    u_err_set_err_p(
+      error,
+      (int) U_ERR_IO_INVALID_ARGUMENT,
+      0,
+      "Invalid index file size"
+    );
+    fclose(file);
+    return NULL;
+  }
+  *size = (size_t) file_size;
+  if (U_UNLIKELY ((addr = u_mem_mmap(*size, error)) == NULL)) {
+    fclose(file);
+    return NULL;
+  }
+  if (U_UNLIKELY (fread(addr, *size, 1, file) != 1)) {
+    u_err_set_err_p(
+      error,
+      (int) u_err_get_last_io(),
+      u_err_get_last_system(),
+      "Failed to read index file"
+    );
+    u_mem_munmap(addr, *size, NULL);
+    fclose(file);
+    return NULL;
+  }
+  fclose(file);
+#endif
+  return addr;
+}
+
+hindex_t *
+u_hindex_open(const byte_t *path, err_t **error) {
+  hindex_t *ret;
+  const ubyte_t *data;
+  u64_t nslots, slots_offset, data_offset;
+
+  if (U_UNLIKELY (path == NULL)) {
+    u_err_set_err_p(
+      error,
+      (int) U_ERR_IO_INVALID_ARGUMENT,
+      0,
+      "Invalid input argument"
+    );
+    return NULL;
+  }
+  if (U_UNLIKELY ((ret = u_malloc0(sizeof(hindex_t))) == NULL)) {
+    u_err_set_err_p(
+      error,
+      (int) U_ERR_IO_NO_RESOURCES,
+      0,
+      "Failed to allocate memory for index"
+    );
+    return NULL;
+  }
+  if (U_UNLIKELY ((ret->map = pp_hindex_map(path, &ret->size, error))
+    == NULL)) {
+    u_free(ret);
+    return NULL;
+  }
+  data = (const ubyte_t *) ret->map;
+  nslots = pp_hindex_read64(data + 16);
+  slots_offset = pp_hindex_read64(data + 24);
+  data_offset = pp_hindex_read64(data + 32);
+  if (U_UNLIKELY (memcmp(data, U_HINDEX_MAGIC, 4) != 0
+    || pp_hindex_read32(data + 4) != U_HINDEX_VERSION
+    || pp_hindex_read64(data + 40) != ret->size
+    || nslots == 0 || (nslots & (nslots - 1)) != 0
+    || pp_hindex_read64(data + 8) > nslots
+    || slots_offset < U_HINDEX_HEADER_SIZE || slots_offset > ret->size
+    || nslots > (ret->size - slots_offset) / U_HINDEX_SLOT_SIZE
+    || data_offset < slots_offset + nslots * U_HINDEX_SLOT_SIZE
+    || data_offset > ret->size)) {
+    u_err_set_err_p(
+      error,
+      (int) U_ERR_IO_INVALID_ARGUMENT,
+      0,
+      "Invalid index file format"
+    );
+    u_mem_munmap(ret->map, ret->size, NULL);
+    u_free(ret);
+    return NULL;
+  }
+  ret->data = data;
+  ret->count = (size_t) pp_hindex_read64(data + 8);
+  ret->mask = (size_t) nslots - 1;
+  ret->slots_offset = (size_t) slots_offset;
+  return ret;
+}
+
+bool
+u_hindex_lookup(const hindex_t *index, const byte_t *key,
+  const byte_t **value) {
+  const ubyte_t *slot, *entry;
+  size_t key_len, idx, n;
+  u64_t offset;
+  u32_t hash, value_len;
+
+  if (U_UNLIKELY (index == NULL || key == NULL)) {
+    return false;
+  }
+  key_len = strlen(key);
+  hash = (u32_t) u_htable_bytes_hash(key, key_len);
+  idx = hash & index->mask;
+  for (n = 0; n <= index->mask; ++n, idx = (idx + 1) & index->mask) {
+    slot = index->data + index->slots_offset + idx * U_HINDEX_SLOT_SIZE;
+    if ((offset = pp_hindex_read64(slot)) == 0) {
+      return false;
+    }
+    if (pp_hindex_read32(slot + 8) != hash) {
+      continue;
+    }
+
+    /* Never trust offsets and lengths from the file */
+    if (U_UNLIKELY (offset > index->size - U_HINDEX_ENTRY_HEADER_SIZE)) {
+      return false;
+    }
+    entry = index->data + (size_t) offset;
+    if (pp_hindex_read32(entry) != key_len
+      || key_len >= index->size - (size_t) offset - U_HINDEX_ENTRY_HEADER_SIZE
+      || memcmp(entry + U_HINDEX_ENTRY_HEADER_SIZE, key, key_len) != 0) {
+      continue;
+    }
+    if (value != NULL) {
+      value_len = pp_hindex_read32(entry + 4);
+      if (value_len == U_HINDEX_NULL_VALUE) {
+        *value = NULL;
+      } else if (U_UNLIKELY ((u64_t) value_len + key_len + 2
+        > index->size - (size_t) offset - U_HINDEX_ENTRY_HEADER_SIZE
+        || entry[U_HINDEX_ENTRY_HEADER_SIZE + key_len + 1 + value_len] != 0)) {
+        return false;
+      } else {
+        *value = (const byte_t *) entry + U_HINDEX_ENTRY_HEADER_SIZE
+          + key_len + 1;
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+size_t
+u_hindex_get_size(const hindex_t *index) {
+  if (U_UNLIKELY (index == NULL)) {
+    return 0;
+  }
+  return index->count;
+}
+
+void
+u_hindex_close(hindex_t *index) {
+  if (U_UNLIKELY (index == NULL)) {
+    return;
+  }
+  if (U_UNLIKELY (u_mem_munmap(index->map, index->size, NULL) == false)) {
+    U_WARNING ("hindex_t::u_hindex_close: failed to unmap index file");
+  }
+  u_free(index);
+}
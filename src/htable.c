@@ -15,8 +15,13 @@
  * along with this library; if not, see <http://www.gnu.org/licenses/>.
  */
 
-/* Hash table organized like this: table[hash key]->[list with values]
- * Note: this implementation is not intended to use on huge loads */
+/* Hash table organized like this: table[hash & mask] -> bucket, collisions
+ * are resolved with Robin Hood linear probing. When the load factor is
+ * exceeded a twice larger bucket array is allocated and entries are migrated
+ * from the old array a few slots at a time on every following modification,
+ * so no single insert pays for the whole rehash. */
+
+#include <string.h>
 
 #include "unic/mem.h"
 #include "unic/htable.h"
@@ -24,90 +29,607 @@
 typedef struct bucket bucket_t;
 
 struct bucket {
-  bucket_t *next;
   ptr_t key;
   ptr_t value;
+  u32_t hash;
+  u32_t dist;
 };
 
 struct htable {
-  bucket_t **table;
+  bucket_t *buckets;
+  size_t mask;
+  bucket_t *old_buckets;
+  size_t old_mask;
+  size_t old_size;
+  size_t migrate_pos;
   size_t size;
+  hash_fn_t hash_func;
+  equal_fn_t equal_func;
+  destroy_fn_t key_destroy_func;
+  destroy_fn_t value_destroy_func;
 };
 
-/* Size of unique hash keys in hash table */
-#define U_HASH_TABLE_SIZE 101
+/* Initial number of buckets, must be a power of two */
+#define U_HTABLE_MIN_CAPACITY 16
+
+/* Maximum load factor is U_HTABLE_LOAD_NUM / U_HTABLE_LOAD_DEN */
+#define U_HTABLE_LOAD_NUM 7
+#define U_HTABLE_LOAD_DEN 8
+
+/* Number of old buckets to migrate on every modification */
+#define U_HTABLE_MIGRATE_STEP 64
+
+/* Marks a migrated or removed bucket of the old array, keeps probe distance */
+#define U_HTABLE_TOMB ((u32_t) 0x80000000U)
+
+#define U_HTABLE_IS_LIVE(bucket) \
+  ((bucket)->dist != 0 && ((bucket)->dist & U_HTABLE_TOMB) == 0)
+
+static void
+pp_htable_mum(u64_t *a, u64_t *b);
+
+static u64_t
+pp_htable_mix(u64_t a, u64_t b);
+
+static u64_t
+pp_htable_read64(const ubyte_t *p);
+
+static u64_t
+pp_htable_read32(const ubyte_t *p);
+
+static u32_t
+pp_htable_calc_hash(const htable_t *table, const_ptr_t key);
+
+static bucket_t *
+pp_htable_find_bucket(const htable_t *table, bucket_t *buckets, size_t mask,
+  u32_t hash, const_ptr_t key, size_t *stop);
+
+static bucket_t *
+pp_htable_find_node(const htable_t *table, const_ptr_t key, u32_t hash);
+
+static bucket_t *
+pp_htable_next_node(htable_iter_t *iter);
+
+static bucket_t *
+pp_htable_put_at(bucket_t *buckets, size_t mask, size_t idx, ptr_t key,
+  ptr_t value, u32_t hash);
+
+static bucket_t *
+pp_htable_put(bucket_t *buckets, size_t mask, ptr_t key, ptr_t value,
+  u32_t hash);
+
+static void
+pp_htable_erase(bucket_t *buckets, size_t mask, bucket_t *bucket);
+
+static void
+pp_htable_migrate(htable_t *table, size_t nslots);
+
+static bool
+pp_htable_resize(htable_t *table, size_t capacity);
+
+static size_t
+pp_htable_capacity_for(size_t n);
+
+static void
+pp_htable_replace(htable_t *table, bucket_t *node, ptr_t key, ptr_t value);
+
+static bucket_t *
+pp_htable_add(htable_t *table, ptr_t key, ptr_t value, u32_t hash);
+
+static void
+pp_htable_mum(u64_t *a, u64_t *b) {
+#if defined (__SIZEOF_INT128__)
+  __uint128_t r;
+
+  r = (__uint128_t) *a * *b;
+  *a = (u64_t) r;
+  *b = (u64_t) (r >> 64);
+#else
+  u64_t ha, hb, la, lb, rh, rm0, rm1, rl, t, lo;
+  u64_t c;
+
+  ha = *a >> 32;
+  hb = *b >> 32;
+  la = (u32_t) *a;
+  lb = (u32_t) *b;
+  rh = ha * hb;
+  rm0 = ha * lb;
+  rm1 = hb * la;
+  rl = la * lb;
+  t = rl + (rm0 << 32);
+  c = t < rl;
+  lo = t + (rm1 << 32);
+  c += lo < t;
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static u64_t
+pp_htable_mix(u64_t a, u64_t b) {
+  pp_htable_mum(&a, &b);
+  return a ^ b;
+}
+
+static u64_t
+pp_htable_read64(const ubyte_t *p) {
+  /* Byte order independent, compilers fold it into a single load */
+  return (u64_t) p[0] | ((u64_t) p[1] << 8) | ((u64_t) p[2] << 16)
+    | ((u64_t) p[3] << 24) | ((u64_t) p[4] << 32) | ((u64_t) p[5] << 40)
+    | ((u64_t) p[6] << 48) | ((u64_t) p[7] << 56);
+}
+
+static u64_t
+pp_htable_read32(const ubyte_t *p) {
+  return (u64_t) p[0] | ((u64_t) p[1] << 8) | ((u64_t) p[2] << 16)
+    | ((u64_t) p[3] << 24);
+}
 
-static uint_t
-pp_htable_calc_hash(const_ptr_t pointer, size_t modulo);
+static u32_t
+pp_htable_calc_hash(const htable_t *table, const_ptr_t key) {
+  if (table->hash_func != NULL) {
+    return (u32_t) table->hash_func(key);
+  }
+  return (u32_t) u_htable_ptr_hash(key);
+}
 
 static bucket_t *
-pp_htable_find_node(const htable_t *table,
-  const_ptr_t key);
+pp_htable_find_bucket(const htable_t *table, bucket_t *buckets, size_t mask,
+  u32_t hash, const_ptr_t key, size_t *stop) {
+  bucket_t *bucket;
+  size_t idx;
+  u32_t dist;
 
-static uint_t
-pp_htable_calc_hash(const_ptr_t pointer, size_t modulo) {
-  /* As simple as we can :) */
-  return (uint_t) (((size_t) (U_POINTER_TO_INT(pointer) + 37)) % modulo);
+  if (buckets == NULL) {
+    return NULL;
+  }
+  idx = hash & mask;
+  for (dist = 1;; ++dist) {
+    bucket = &buckets[idx];
+
+    /* Robin Hood invariant: the key can't be further than this, which is
+     * also the place to insert it */
+    if ((bucket->dist & ~U_HTABLE_TOMB) < dist) {
+      if (stop != NULL) {
+        *stop = idx;
+      }
+      return NULL;
+    }
+    if (bucket->dist == dist && bucket->hash == hash) {
+      if (table->equal_func == NULL) {
+        if (bucket->key == key) {
+          return bucket;
+        }
+      } else if (table->equal_func(bucket->key, key)) {
+        return bucket;
+      }
+    }
+    idx = (idx + 1) & mask;
+  }
 }
 
 static bucket_t *
-pp_htable_find_node(const htable_t *table, const_ptr_t key) {
-  uint_t hash;
+pp_htable_find_node(const htable_t *table, const_ptr_t key, u32_t hash) {
   bucket_t *ret;
 
-  hash = pp_htable_calc_hash(key, table->size);
-  for (ret = table->table[hash]; ret != NULL; ret = ret->next) {
-    if (ret->key == key) {
-      return ret;
+  ret = pp_htable_find_bucket(
+    table, table->buckets, table->mask, hash, key, NULL
+  );
+  if (ret == NULL && table->old_buckets != NULL) {
+    ret = pp_htable_find_bucket(
+      table, table->old_buckets, table->old_mask, hash, key, NULL
+    );
+  }
+  return ret;
+}
+
+static bucket_t *
+pp_htable_next_node(htable_iter_t *iter) {
+  const htable_t *table;
+  bucket_t *node;
+  size_t pos;
+
+  table = iter->table;
+  if (table == NULL || table->buckets == NULL) {
+    return NULL;
+  }
+
+  /* Walk the current buckets first, then the ones left to migrate */
+  while (iter->pos <= table->mask) {
+    node = &table->buckets[(iter->start + iter->pos++) & table->mask];
+    if (U_HTABLE_IS_LIVE (node)) {
+      return node;
+    }
+  }
+  while (table->old_buckets != NULL) {
+    pos = iter->pos - table->mask - 1;
+    if (pos > table->old_mask) {
+      break;
+    }
+    node = &table->old_buckets[pos];
+    ++iter->pos;
+    if (U_HTABLE_IS_LIVE (node)) {
+      return node;
     }
   }
   return NULL;
 }
 
+static bucket_t *
+pp_htable_put_at(bucket_t *buckets, size_t mask, size_t idx, ptr_t key,
+  ptr_t value, u32_t hash) {
+  bucket_t entry, tmp;
+  bucket_t *bucket, *ret;
+
+  entry.key = key;
+  entry.value = value;
+  entry.hash = hash;
+  entry.dist = (u32_t) ((idx - (hash & mask)) & mask) + 1;
+  ret = NULL;
+  for (;; ++entry.dist) {
+    bucket = &buckets[idx];
+    if (bucket->dist == 0) {
+      *bucket = entry;
+      return ret == NULL ? bucket : ret;
+    }
+
+    /* Take the place of a richer entry and carry it further */
+    if (bucket->dist < entry.dist) {
+      tmp = *bucket;
+      *bucket = entry;
+      entry = tmp;
+      if (ret == NULL) {
+        ret = bucket;
+      }
+    }
+    idx = (idx + 1) & mask;
+  }
+}
+
+static bucket_t *
+pp_htable_put(bucket_t *buckets, size_t mask, ptr_t key, ptr_t value,
+  u32_t hash) {
+  return pp_htable_put_at(buckets, mask, hash & mask, key, value, hash);
+}
+
+static void
+pp_htable_erase(bucket_t *buckets, size_t mask, bucket_t *bucket) {
+  size_t idx, next;
+
+  /* Shift following entries back instead of leaving a tombstone */
+  idx = (size_t) (bucket - buckets);
+  for (;;) {
+    next = (idx + 1) & mask;
+    if (buckets[next].dist <= 1) {
+      buckets[idx].dist = 0;
+      return;
+    }
+    buckets[idx] = buckets[next];
+    --buckets[idx].dist;
+    idx = next;
+  }
+}
+
+static void
+pp_htable_migrate(htable_t *table, size_t nslots) {
+  bucket_t *bucket;
+
+  while (nslots > 0 && table->old_size > 0) {
+    bucket = &table->old_buckets[table->migrate_pos++];
+    if (U_HTABLE_IS_LIVE (bucket)) {
+      pp_htable_put(
+        table->buckets, table->mask, bucket->key, bucket->value, bucket->hash
+      );
+      bucket->dist |= U_HTABLE_TOMB;
+      --table->old_size;
+    }
+    --nslots;
+  }
+  if (table->old_buckets != NULL && table->old_size == 0) {
+    u_free(table->old_buckets);
+    table->old_buckets = NULL;
+    table->migrate_pos = 0;
+  }
+}
+
+static bool
+pp_htable_resize(htable_t *table, size_t capacity) {
+  bucket_t *buckets;
+
+  /* Only one migration can be in progress */
+  if (table->old_buckets != NULL) {
+    pp_htable_migrate(table, (size_t) -1);
+  }
+  if (U_UNLIKELY (
+    (buckets = u_malloc0(capacity * sizeof(bucket_t))) == NULL)) {
+    return false;
+  }
+  if (table->size == 0) {
+    u_free(table->buckets);
+  } else {
+    table->old_buckets = table->buckets;
+    table->old_mask = table->mask;
+    table->old_size = table->size;
+    table->migrate_pos = 0;
+  }
+  table->buckets = buckets;
+  table->mask = capacity - 1;
+  return true;
+}
+
+static size_t
+pp_htable_capacity_for(size_t n) {
+  size_t capacity;
+
+  if (U_UNLIKELY (n > U_MAXSIZE / U_HTABLE_LOAD_DEN / sizeof(bucket_t))) {
+    return 0;
+  }
+  for (capacity = U_HTABLE_MIN_CAPACITY;
+    n * U_HTABLE_LOAD_DEN > capacity * U_HTABLE_LOAD_NUM; capacity <<= 1);
+  return capacity;
+}
+
+static void
+pp_htable_replace(htable_t *table, bucket_t *node, ptr_t key, ptr_t value) {
+  if (table->key_destroy_func != NULL && node->key != key) {
+    table->key_destroy_func(node->key);
+  }
+  if (table->value_destroy_func != NULL && node->value != value) {
+    table->value_destroy_func(node->value);
+  }
+  node->key = key;
+  node->value = value;
+}
+
+static bucket_t *
+pp_htable_add(htable_t *table, ptr_t key, ptr_t value, u32_t hash) {
+  bucket_t *ret;
+  size_t capacity;
+
+  capacity = table->buckets == NULL ? 0 : table->mask + 1;
+  if ((table->size + 1) * U_HTABLE_LOAD_DEN > capacity * U_HTABLE_LOAD_NUM) {
+    if (U_UNLIKELY (pp_htable_resize(table, capacity == 0
+      ? U_HTABLE_MIN_CAPACITY : capacity << 1) == false)) {
+      /* Keep at least one free bucket to terminate probing */
+      if (capacity == 0 || table->size + 1 >= capacity) {
+        return NULL;
+      }
+    }
+  }
+
+  /* Migrate first, so that the new entry is not displaced afterwards */
+  pp_htable_migrate(table, U_HTABLE_MIGRATE_STEP);
+  ret = pp_htable_put(table->buckets, table->mask, key, value, hash);
+  ++table->size;
+  return ret;
+}
+
 htable_t *
 u_htable_new(void) {
+  return u_htable_new_full(NULL, NULL, NULL, NULL);
+}
+
+htable_t *
+u_htable_new_full(hash_fn_t hash_func, equal_fn_t equal_func,
+  destroy_fn_t key_destroy, destroy_fn_t value_destroy) {
   htable_t *ret;
 
   if (U_UNLIKELY ((ret = u_malloc0(sizeof(htable_t))) == NULL)) {
-    U_ERROR ("htable_t::u_htable_new: failed(1) to allocate memory");
+    U_ERROR ("htable_t::u_htable_new_full: failed to allocate memory");
     return NULL;
   }
-  if (U_UNLIKELY (
-    (ret->table = u_malloc0(U_HASH_TABLE_SIZE * sizeof(bucket_t *)))
-      == NULL)) {
-    U_ERROR ("htable_t::u_htable_new: failed(2) to allocate memory");
-    u_free(ret);
-    return NULL;
-  }
-  ret->size = U_HASH_TABLE_SIZE;
+  ret->hash_func = hash_func;
+  ret->equal_func = equal_func;
+  ret->key_destroy_func = key_destroy;
+  ret->value_destroy_func = value_destroy;
   return ret;
 }
 
+size_t
+u_htable_ptr_hash(const_ptr_t key) {
+  u64_t x;
+
+  /* Pointers are aligned, mix all the bits down to the low ones */
+  x = (u64_t) (uptr_t) key;
+  x ^= x >> 33;
+  x *= 0xFF51AFD7ED558CCDULL;
+  x ^= x >> 33;
+  x *= 0xC4CEB9FE1A85EC53ULL;
+  x ^= x >> 33;
+  return (size_t) x;
+}
+
+bool
+u_htable_ptr_equal(const_ptr_t a, const_ptr_t b) {
+  return a == b;
+}
+
+size_t
+u_htable_bytes_hash(const_ptr_t data, size_t len) {
+  const u64_t s0 = 0xA0761D6478BD642FULL;
+  const u64_t s1 = 0xE7037ED1A0B428DBULL;
+  const u64_t s2 = 0x8EBC6AF09C88C6E3ULL;
+  const u64_t s3 = 0x589965CC75374CC3ULL;
+  const ubyte_t *p;
+  u64_t seed, see1, see2, a, b;
+  size_t i;
+
+  /* wyhash: consumes 48 bytes per round in three independent lanes */
+  p = (const ubyte_t *) data;
+  seed = pp_htable_mix(s0, s1);
+  if (U_LIKELY (len <= 16)) {
+    if (len >= 4) {
+      a = (pp_htable_read32(p) << 32)
+        | pp_htable_read32(p + ((len >> 3) << 2));
+      b = (pp_htable_read32(p + len - 4) << 32)
+        | pp_htable_read32(p + len - 4 - ((len >> 3) << 2));
+    } else if (len > 0) {
+      a = ((u64_t) p[0] << 16) | ((u64_t) p[len >> 1] << 8) | p[len - 1];
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    i = len;
+    if (U_UNLIKELY (i > 48)) {
+      see1 = seed;
+      see2 = seed;
+      do {
+        seed = pp_htable_mix(
+          pp_htable_read64(p) ^ s1, pp_htable_read64(p + 8) ^ seed
+        );
+        see1 = pp_htable_mix(
+          pp_htable_read64(p + 16) ^ s2, pp_htable_read64(p + 24) ^ see1
+        );
+        see2 = pp_htable_mix(
+          pp_htable_read64(p + 32) ^ s3, pp_htable_read64(p + 40) ^ see2
+        );
+        p += 48;
+        i -= 48;
+      } while (U_LIKELY (i > 48));
+      seed ^= see1 ^ see2;
+    }
+    while (U_UNLIKELY (i > 16)) {
+      seed = pp_htable_mix(
+        pp_htable_read64(p) ^ s1, pp_htable_read64(p + 8) ^ seed
+      );
+      i -= 16;
+      p += 16;
+    }
+    a = pp_htable_read64(p + i - 16);
+    b = pp_htable_read64(p + i - 8);
+  }
+  a ^= s1;
+  b ^= seed;
+  pp_htable_mum(&a, &b);
+  return (size_t) pp_htable_mix(a ^ s0 ^ (u64_t) len, b ^ s1);
+}
+
+size_t
+u_htable_str_hash(const_ptr_t key) {
+  if (U_UNLIKELY (key == NULL)) {
+    return 0;
+  }
+  return u_htable_bytes_hash(key, strlen((const byte_t *) key));
+}
+
+bool
+u_htable_str_equal(const_ptr_t a, const_ptr_t b) {
+  if (a == b) {
+    return true;
+  }
+  if (U_UNLIKELY (a == NULL || b == NULL)) {
+    return false;
+  }
+  return strcmp((const byte_t *) a, (const byte_t *) b) == 0;
+}
+
 void
 u_htable_insert(htable_t *table, ptr_t key, ptr_t value) {
   bucket_t *node;
-  uint_t hash;
+  u32_t hash;
 
   if (U_UNLIKELY (table == NULL)) {
     return;
   }
-  if ((node = pp_htable_find_node(table, key)) == NULL) {
-    if (U_UNLIKELY ((node = u_malloc0(sizeof(bucket_t))) == NULL)) {
-      U_ERROR ("htable_t::u_htable_insert: failed to allocate memory");
-      return;
+  hash = pp_htable_calc_hash(table, key);
+  if ((node = pp_htable_find_node(table, key, hash)) != NULL) {
+    pp_htable_replace(table, node, key, value);
+    return;
+  }
+  if (U_UNLIKELY (pp_htable_add(table, key, value, hash) == NULL)) {
+    U_ERROR ("htable_t::u_htable_insert: failed to allocate memory");
+  }
+}
+
+void
+u_htable_insert_many(htable_t *table, ptr_t const *keys, ptr_t const *values,
+  size_t n) {
+  bucket_t *node;
+  ptr_t value;
+  u32_t hash;
+  size_t i;
+
+  if (U_UNLIKELY (table == NULL || keys == NULL)) {
+    return;
+  }
+
+  /* Duplicates may leave the table larger than needed, which is fine */
+  if (U_UNLIKELY (n > U_MAXSIZE - table->size
+    || u_htable_reserve(table, table->size + n) == false)) {
+    for (i = 0; i < n; ++i) {
+      u_htable_insert(table, keys[i], values == NULL ? NULL : values[i]);
     }
-    hash = pp_htable_calc_hash(key, table->size);
+    return;
+  }
 
-    /* Insert a new node in front of others */
-    node->key = key;
-    node->value = value;
-    node->next = table->table[hash];
-    table->table[hash] = node;
-  } else {
-    node->value = value;
+  /* No migration is pending after the reservation */
+  for (i = 0; i < n; ++i) {
+    value = values == NULL ? NULL : values[i];
+    hash = pp_htable_calc_hash(table, keys[i]);
+    if ((node = pp_htable_find_bucket(
+      table, table->buckets, table->mask, hash, keys[i], NULL)) != NULL) {
+      pp_htable_replace(table, node, keys[i], value);
+      continue;
+    }
+    pp_htable_put(table->buckets, table->mask, keys[i], value, hash);
+    ++table->size;
   }
 }
 
+bool
+u_htable_reserve(htable_t *table, size_t n) {
+  size_t capacity;
+
+  if (U_UNLIKELY (table == NULL)) {
+    return false;
+  }
+  if (U_UNLIKELY ((capacity = pp_htable_capacity_for(n)) == 0)) {
+    return false;
+  }
+  if (table->buckets != NULL && capacity <= table->mask + 1) {
+    /* Bulk insertion relies on the new buckets only */
+    if (table->old_buckets != NULL) {
+      pp_htable_migrate(table, (size_t) -1);
+    }
+    return true;
+  }
+  if (U_UNLIKELY (pp_htable_resize(table, capacity) == false)) {
+    U_ERROR ("htable_t::u_htable_reserve: failed to allocate memory");
+    return false;
+  }
+  pp_htable_migrate(table, (size_t) -1);
+  return true;
+}
+
+bool
+u_htable_shrink(htable_t *table) {
+  size_t capacity;
+
+  if (U_UNLIKELY (table == NULL)) {
+    return false;
+  }
+  if (table->old_buckets != NULL) {
+    pp_htable_migrate(table, (size_t) -1);
+  }
+  if (table->size == 0) {
+    u_free(table->buckets);
+    table->buckets = NULL;
+    table->mask = 0;
+    return true;
+  }
+  capacity = pp_htable_capacity_for(table->size);
+  if (capacity >= table->mask + 1) {
+    return true;
+  }
+  if (U_UNLIKELY (pp_htable_resize(table, capacity) == false)) {
+    U_ERROR ("htable_t::u_htable_shrink: failed to allocate memory");
+    return false;
+  }
+  pp_htable_migrate(table, (size_t) -1);
+  return true;
+}
+
 ptr_t
 u_htable_lookup(const htable_t *table, const_ptr_t key) {
   bucket_t *node;
@@ -115,114 +637,322 @@ u_htable_lookup(const htable_t *table, const_ptr_t key) {
   if (U_UNLIKELY (table == NULL)) {
     return NULL;
   }
-  return ((node = pp_htable_find_node(table, key)) == NULL)
+  return ((node = pp_htable_find_node(
+    table, key, pp_htable_calc_hash(table, key))) == NULL)
     ? (ptr_t) (-1) : node->value;
 }
 
+bool
+u_htable_lookup_extended(const htable_t *table, const_ptr_t key,
+  ptr_t *value) {
+  bucket_t *node;
+
+  if (U_UNLIKELY (table == NULL)) {
+    return false;
+  }
+  if ((node = pp_htable_find_node(
+    table, key, pp_htable_calc_hash(table, key))) == NULL) {
+    return false;
+  }
+  if (value != NULL) {
+    *value = node->value;
+  }
+  return true;
+}
+
+ptr_t *
+u_htable_lookup_or_insert(htable_t *table, ptr_t key, bool *found) {
+  bucket_t *node;
+  size_t stop;
+  u32_t hash;
+
+  if (U_UNLIKELY (table == NULL)) {
+    return NULL;
+  }
+  hash = pp_htable_calc_hash(table, key);
+  stop = (size_t) -1;
+  if ((node = pp_htable_find_bucket(
+    table, table->buckets, table->mask, hash, key, &stop)) == NULL
+    && table->old_buckets != NULL) {
+    node = pp_htable_find_bucket(
+      table, table->old_buckets, table->old_mask, hash, key, NULL
+    );
+  }
+  if (node != NULL) {
+    if (found != NULL) {
+      *found = true;
+    }
+    return &node->value;
+  }
+
+  /* Insert where the probe stopped unless the buckets are about to change */
+  if (stop != (size_t) -1 && table->old_buckets == NULL
+    && (table->size + 1) * U_HTABLE_LOAD_DEN
+    <= (table->mask + 1) * U_HTABLE_LOAD_NUM) {
+    node = pp_htable_put_at(table->buckets, table->mask, stop, key, NULL, hash);
+    ++table->size;
+  } else {
+    node = pp_htable_add(table, key, NULL, hash);
+  }
+  if (U_UNLIKELY (node == NULL)) {
+    U_ERROR ("htable_t::u_htable_lookup_or_insert: failed to allocate memory");
+    return NULL;
+  }
+  if (found != NULL) {
+    *found = false;
+  }
+  return &node->value;
+}
+
 list_t *
 u_htable_keys(const htable_t *table) {
+  htable_iter_t iter;
   list_t *ret = NULL;
   bucket_t *node;
-  uint_t i;
 
   if (U_UNLIKELY (table == NULL)) {
     return NULL;
   }
-  for (i = 0; i < table->size; ++i) {
-    for (node = table->table[i]; node != NULL; node = node->next) {
-      ret = u_list_append(ret, node->key);
-    }
+  u_htable_iter_init(&iter, (htable_t *) table);
+  while ((node = pp_htable_next_node(&iter)) != NULL) {
+    ret = u_list_prepend(ret, node->key);
   }
   return ret;
 }
 
 list_t *
 u_htable_values(const htable_t *table) {
+  htable_iter_t iter;
   list_t *ret = NULL;
   bucket_t *node;
-  uint_t i;
 
   if (U_UNLIKELY (table == NULL)) {
     return NULL;
   }
-  for (i = 0; i < table->size; ++i) {
-    for (node = table->table[i]; node != NULL; node = node->next) {
-      ret = u_list_append(ret, node->value);
-    }
+  u_htable_iter_init(&iter, (htable_t *) table);
+  while ((node = pp_htable_next_node(&iter)) != NULL) {
+    ret = u_list_prepend(ret, node->value);
+  }
+  return ret;
+}
+
+vec_t *
+u_htable_keys_vec(const htable_t *table) {
+  htable_iter_t iter;
+  vec_t *ret;
+  bucket_t *node;
+
+  if (U_UNLIKELY (table == NULL)) {
+    return NULL;
+  }
+  if (U_UNLIKELY ((ret = u_vec_new(sizeof(ptr_t))) == NULL)) {
+    return NULL;
+  }
+  if (U_UNLIKELY (!u_vec_reserve(ret, table->size))) {
+    u_vec_free(ret);
+    return NULL;
+  }
+  u_htable_iter_init(&iter, (htable_t *) table);
+  while ((node = pp_htable_next_node(&iter)) != NULL) {
+    u_vec_push(ret, &node->key);
+  }
+  return ret;
+}
+
+vec_t *
+u_htable_values_vec(const htable_t *table) {
+  htable_iter_t iter;
+  vec_t *ret;
+  bucket_t *node;
+
+  if (U_UNLIKELY (table == NULL)) {
+    return NULL;
+  }
+  if (U_UNLIKELY ((ret = u_vec_new(sizeof(ptr_t))) == NULL)) {
+    return NULL;
+  }
+  if (U_UNLIKELY (!u_vec_reserve(ret, table->size))) {
+    u_vec_free(ret);
+    return NULL;
+  }
+  u_htable_iter_init(&iter, (htable_t *) table);
+  while ((node = pp_htable_next_node(&iter)) != NULL) {
+    u_vec_push(ret, &node->value);
   }
   return ret;
 }
 
 void
 u_htable_free(htable_t *table) {
-  bucket_t *node, *next_node;
-  uint_t i;
+  htable_iter_t iter;
+  bucket_t *node;
 
   if (U_UNLIKELY (table == NULL)) {
     return;
   }
-  for (i = 0; i < table->size; ++i) {
-    for (node = table->table[i]; node != NULL;) {
-      next_node = node->next;
-      u_free(node);
-      node = next_node;
+  if (table->key_destroy_func != NULL || table->value_destroy_func != NULL) {
+    u_htable_iter_init(&iter, table);
+    while ((node = pp_htable_next_node(&iter)) != NULL) {
+      if (table->key_destroy_func != NULL) {
+        table->key_destroy_func(node->key);
+      }
+      if (table->value_destroy_func != NULL) {
+        table->value_destroy_func(node->value);
+      }
     }
   }
-  u_free(table->table);
+  u_free(table->old_buckets);
+  u_free(table->buckets);
   u_free(table);
 }
 
 void
 u_htable_remove(htable_t *table, const_ptr_t key) {
-  bucket_t *node, *prev_node;
-  uint_t hash;
+  bucket_t *node;
+  ptr_t old_key, old_value;
+  u32_t hash;
 
   if (U_UNLIKELY (table == NULL)) {
     return;
   }
-  if (pp_htable_find_node(table, key) != NULL) {
-    hash = pp_htable_calc_hash(key, table->size);
-    node = table->table[hash];
-    prev_node = NULL;
-    while (node != NULL) {
-      if (node->key == key) {
-        if (prev_node == NULL) {
-          table->table[hash] = node->next;
-        } else {
-          prev_node->next = node->next;
-        }
-        u_free(node);
-        break;
-      } else {
-        prev_node = node;
-        node = node->next;
-      }
-    }
+  hash = pp_htable_calc_hash(table, key);
+  if ((node = pp_htable_find_bucket(
+    table, table->buckets, table->mask, hash, key, NULL)) != NULL) {
+    old_key = node->key;
+    old_value = node->value;
+    pp_htable_erase(table->buckets, table->mask, node);
+  } else if ((node = pp_htable_find_bucket(
+    table, table->old_buckets, table->old_mask, hash, key, NULL)) != NULL) {
+    old_key = node->key;
+    old_value = node->value;
+
+    /* Old buckets are only drained, keep the probe chain intact */
+    node->dist |= U_HTABLE_TOMB;
+    --table->old_size;
+  } else {
+    return;
+  }
+  if (table->key_destroy_func != NULL) {
+    table->key_destroy_func(old_key);
   }
+  if (table->value_destroy_func != NULL) {
+    table->value_destroy_func(old_value);
+  }
+  --table->size;
+  pp_htable_migrate(table, U_HTABLE_MIGRATE_STEP);
 }
 
 list_t *
 u_htable_lookup_by_value(const htable_t *table, const_ptr_t val,
   cmp_fn_t func) {
+  htable_iter_t iter;
   list_t *ret = NULL;
   bucket_t *node;
-  uint_t i;
   bool res;
 
   if (U_UNLIKELY (table == NULL)) {
     return NULL;
   }
-  for (i = 0; i < table->size; ++i) {
-    for (node = table->table[i]; node != NULL; node = node->next) {
-      if (func == NULL) {
-        res = (node->value == val);
-      } else {
-        res = (func(node->value, val) == 0);
-      }
-      if (res) {
-        ret = u_list_append(ret, node->key);
-      }
+  u_htable_iter_init(&iter, (htable_t *) table);
+  while ((node = pp_htable_next_node(&iter)) != NULL) {
+    if (func == NULL) {
+      res = (node->value == val);
+    } else {
+      res = (func(node->value, val) == 0);
+    }
+    if (res) {
+      ret = u_list_prepend(ret, node->key);
     }
   }
   return ret;
 }
+
+void
+u_htable_foreach(htable_t *table, traverse_fn_t func, ptr_t user_data) {
+  htable_iter_t iter;
+  bucket_t *node;
+
+  if (U_UNLIKELY (table == NULL || func == NULL)) {
+    return;
+  }
+  u_htable_iter_init(&iter, table);
+  while ((node = pp_htable_next_node(&iter)) != NULL) {
+    if (func(node->key, node->value, user_data) == true) {
+      break;
+    }
+  }
+}
+
+void
+u_htable_iter_init(htable_iter_t *iter, htable_t *table) {
+  if (U_UNLIKELY (iter == NULL)) {
+    return;
+  }
+  iter->table = table;
+  iter->node = NULL;
+  iter->pos = 0;
+  iter->start = 0;
+  if (table == NULL || table->buckets == NULL) {
+    return;
+  }
+
+  /* Start at a free bucket: removals shift entries back only within a probe
+   * chain, so they never move an already visited entry */
+  while (table->buckets[iter->start].dist != 0) {
+    ++iter->start;
+  }
+}
+
+bool
+u_htable_iter_next(htable_iter_t *iter, ptr_t *key, ptr_t *value) {
+  bucket_t *node;
+
+  if (U_UNLIKELY (iter == NULL)) {
+    return false;
+  }
+  if ((node = pp_htable_next_node(iter)) == NULL) {
+    iter->node = NULL;
+    return false;
+  }
+  iter->node = node;
+  if (key != NULL) {
+    *key = node->key;
+  }
+  if (value != NULL) {
+    *value = node->value;
+  }
+  return true;
+}
+
+void
+u_htable_iter_remove(htable_iter_t *iter) {
+  htable_t *table;
+  bucket_t *node;
+
+  if (U_UNLIKELY (iter == NULL || iter->node == NULL)) {
+    return;
+  }
+  table = iter->table;
+  node = (bucket_t *) iter->node;
+  iter->node = NULL;
+  if (table->key_destroy_func != NULL) {
+    table->key_destroy_func(node->key);
+  }
+  if (table->value_destroy_func != NULL) {
+    table->value_destroy_func(node->value);
+  }
+
+  /* No migration here, it would move entries behind the iterator */
+  if (iter->pos <= table->mask + 1) {
+    pp_htable_erase(table->buckets, table->mask, node);
+
+    /* Visit the entry shifted into the freed bucket */
+    if (node->dist != 0) {
+      --iter->pos;
+    }
+  } else {
+    node->dist |= U_HTABLE_TOMB;
+    --table->old_size;
+  }
+  --table->size;
+}
@@ -56,6 +56,12 @@ static byte_t *
 pp_inifile_find_parameter(const inifile_t *file,
   const byte_t *section, const byte_t *key);
 
+static bool
+pp_inifile_vec_push_name(vec_t *vec, const byte_t *name);
+
+static vec_t *
+pp_inifile_vec_finish(vec_t *vec, bool is_ok);
+
 static PIniParameter *
 pp_inifile_parameter_new(const byte_t *name,
   const byte_t *val) {
@@ -274,7 +280,7 @@ u_inifile_parse(inifile_t *file,
     if (section->keys == NULL) {
       pp_inifile_section_free(section);
     } else {
-      file->sections = u_list_append(file->sections, section);
+      file->sections = u_list_prepend(file->sections, section);
     }
   }
   if (U_UNLIKELY (fclose(in_file) != 0))
@@ -291,6 +297,44 @@ u_inifile_is_parsed(const inifile_t *file) {
   return file->is_parsed;
 }
 
+static bool
+pp_inifile_vec_push_name(vec_t *vec, const byte_t *name) {
+  byte_t *dup;
+
+  if (U_UNLIKELY ((dup = u_strdup(name)) == NULL)) {
+    return false;
+  }
+  if (U_UNLIKELY (!u_vec_push(vec, &dup))) {
+    u_free(dup);
+    return false;
+  }
+  return true;
+}
+
+static vec_t *
+pp_inifile_vec_finish(vec_t *vec, bool is_ok) {
+  byte_t **names, *tmp;
+  size_t i, n;
+
+  names = u_vec_data(vec);
+  n = u_vec_get_size(vec);
+  if (U_UNLIKELY (!is_ok)) {
+    for (i = 0; i < n; ++i) {
+      u_free(names[i]);
+    }
+    u_vec_free(vec);
+    return NULL;
+  }
+
+  /* Items are stored in the reverse order */
+  for (i = 0; i < n / 2; ++i) {
+    tmp = names[i];
+    names[i] = names[n - i - 1];
+    names[n - i - 1] = tmp;
+  }
+  return vec;
+}
+
 list_t *
 u_inifile_sections(const inifile_t *file) {
   list_t *ret;
@@ -330,6 +374,54 @@ u_inifile_keys(const inifile_t *file,
   return ret;
 }
 
+vec_t *
+u_inifile_sections_vec(const inifile_t *file) {
+  vec_t *ret;
+  list_t *sec;
+  bool is_ok;
+  if (U_UNLIKELY (file == NULL || file->is_parsed == false)) {
+    return NULL;
+  }
+  if (U_UNLIKELY ((ret = u_vec_new(sizeof(byte_t *))) == NULL)) {
+    return NULL;
+  }
+  is_ok = u_vec_reserve(ret, u_list_length(file->sections));
+  for (sec = file->sections; is_ok && sec != NULL; sec = sec->next) {
+    is_ok = pp_inifile_vec_push_name(ret, ((PIniSection *) sec->data)->name);
+  }
+  return pp_inifile_vec_finish(ret, is_ok);
+}
+
+vec_t *
+u_inifile_keys_vec(const inifile_t *file,
+  const byte_t *section) {
+  vec_t *ret;
+  list_t *item;
+  bool is_ok;
+  if (U_UNLIKELY (
+    file == NULL || file->is_parsed == false || section == NULL)) {
+      return NULL;
+  }
+  for (item = file->sections; item != NULL; item = item->next) {
+    if (strcmp(((PIniSection *) item->data)->name, section) == 0) {
+      break;
+    }
+  }
+  if (item == NULL) {
+    return NULL;
+  }
+  if (U_UNLIKELY ((ret = u_vec_new(sizeof(byte_t *))) == NULL)) {
+    return NULL;
+  }
+  item = ((PIniSection *) item->data)->keys;
+  is_ok = u_vec_reserve(ret, u_list_length(item));
+  for (; is_ok && item != NULL; item = item->next) {
+    is_ok = pp_inifile_vec_push_name(ret,
+      ((PIniParameter *) item->data)->name);
+  }
+  return pp_inifile_vec_finish(ret, is_ok);
+}
+
 bool
 u_inifile_is_key_exists(const inifile_t *file,
   const byte_t *section,
@@ -0,0 +1,471 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "unic/atomic.h"
+#include "unic/mem.h"
+#include "unic/htable.h"
+#include "unic/lfhtable.h"
+#include "epoch-private.h"
+
+/* Number of bits in the first bucket segment, the following segments double
+ * the number of buckets each */
+#define U_LFHTABLE_SEGMENT_BITS 6
+
+/* The highest hash bit marks regular nodes, so the bucket count is limited to
+ * half of the hash range */
+#define U_LFHTABLE_MAX_SEGMENTS \
+  (sizeof(size_t) * 8 - U_LFHTABLE_SEGMENT_BITS)
+
+/* Average number of pairs per bucket before doubling the bucket count */
+#define U_LFHTABLE_LOAD 2
+
+/* Logical deletion mark kept in the lowest bit of the next pointer */
+#define U_LFHTABLE_MARK ((uptr_t) 1)
+
+#define U_LFHTABLE_IS_MARKED(ptr) (((uptr_t) (ptr) & U_LFHTABLE_MARK) != 0)
+#define U_LFHTABLE_UNMARK(ptr) \
+  ((lfhtable_node_t *) ((uptr_t) (ptr) & ~U_LFHTABLE_MARK))
+
+typedef struct lfhtable_node lfhtable_node_t;
+
+struct lfhtable_node {
+  epoch_entry_t entry;
+  ptr_t volatile next;
+  size_t so_key;
+  ptr_t key;
+  ptr_t value;
+  lfhtable_t *table;
+};
+
+struct lfhtable {
+  ptr_t volatile segments[U_LFHTABLE_MAX_SEGMENTS];
+  volatile size_t nbuckets;
+  volatile size_t size;
+  volatile int ref_count;
+  hash_fn_t hash_func;
+  equal_fn_t equal_func;
+  destroy_fn_t key_destroy_func;
+  destroy_fn_t value_destroy_func;
+};
+
+static size_t
+pp_lfhtable_reverse(size_t value);
+
+static int
+pp_lfhtable_highbit(size_t value);
+
+static size_t
+pp_lfhtable_calc_hash(const lfhtable_t *table, const_ptr_t key);
+
+static ptr_t volatile *
+pp_lfhtable_get_slot(lfhtable_t *table, size_t bucket, bool create);
+
+static lfhtable_node_t *
+pp_lfhtable_get_bucket(lfhtable_t *table, size_t bucket);
+
+static bool
+pp_lfhtable_find(lfhtable_t *table, lfhtable_node_t *head, size_t so_key,
+  const_ptr_t key, ptr_t volatile **prev_out, lfhtable_node_t **cur_out);
+
+static void
+pp_lfhtable_unref(lfhtable_t *table);
+
+static void
+pp_lfhtable_node_free(ptr_t data);
+
+static void
+pp_lfhtable_retire(lfhtable_t *table, lfhtable_node_t *node);
+
+static size_t
+pp_lfhtable_reverse(size_t value) {
+  size_t mask;
+  size_t shift;
+
+  shift = sizeof(size_t) * 4;
+  mask = U_MAXSIZE >> shift;
+  while (shift > 0) {
+    value = ((value >> shift) & mask) | ((value & mask) << shift);
+    shift >>= 1;
+    mask ^= mask << shift;
+  }
+  return value;
+}
+
+static int
+pp_lfhtable_highbit(size_t value) {
+  int ret;
+
+  ret = 0;
+  while (value >>= 1) {
+    ++ret;
+  }
+  return ret;
+}
+
+static size_t
+pp_lfhtable_calc_hash(const lfhtable_t *table, const_ptr_t key) {
+  return table->hash_func != NULL
+    ? table->hash_func(key) : u_htable_ptr_hash(key);
+}
+
+static ptr_t volatile *
+pp_lfhtable_get_slot(lfhtable_t *table, size_t bucket, bool create) {
+  ptr_t volatile *segment;
+  ptr_t volatile *new_segment;
+  size_t seg_size;
+  int seg, bit;
+
+  if (bucket < ((size_t) 1 << U_LFHTABLE_SEGMENT_BITS)) {
+    seg = 0;
+    seg_size = (size_t) 1 << U_LFHTABLE_SEGMENT_BITS;
+  } else {
+    bit = pp_lfhtable_highbit(bucket);
+    seg = bit - U_LFHTABLE_SEGMENT_BITS + 1;
+    seg_size = (size_t) 1 << bit;
+    bucket -= seg_size;
+  }
+  segment = (ptr_t volatile *) u_atomic_pointer_get(&table->segments[seg]);
+  if (segment == NULL) {
+    if (create == false || U_UNLIKELY (
+      (new_segment = u_malloc0(seg_size * sizeof(ptr_t))) == NULL)) {
+      return NULL;
+    }
+    if (u_atomic_pointer_compare_and_exchange(
+      &table->segments[seg], NULL, (ptr_t) new_segment)) {
+      segment = new_segment;
+    } else {
+      u_free((ptr_t) new_segment);
+      segment = (ptr_t volatile *) u_atomic_pointer_get(&table->segments[seg]);
+    }
+  }
+  return &segment[bucket];
+}
+
+static lfhtable_node_t *
+pp_lfhtable_get_bucket(lfhtable_t *table, size_t bucket) {
+  lfhtable_node_t *parent, *dummy, *cur;
+  ptr_t volatile *slot;
+  ptr_t volatile *prev;
+
+  slot = pp_lfhtable_get_slot(table, bucket, true);
+  if (slot != NULL) {
+    dummy = (lfhtable_node_t *) u_atomic_pointer_get(slot);
+    if (U_LIKELY (dummy != NULL)) {
+      return dummy;
+    }
+  }
+
+  /* The first access splits the parent bucket, bucket 0 always exists */
+  parent = pp_lfhtable_get_bucket(
+    table, bucket & ~((size_t) 1 << pp_lfhtable_highbit(bucket))
+  );
+
+  /* Searching from the parent bucket is still correct, only slower */
+  if (U_UNLIKELY (slot == NULL)) {
+    return parent;
+  }
+  if (U_UNLIKELY ((dummy = u_malloc0(sizeof(lfhtable_node_t))) == NULL)) {
+    return parent;
+  }
+  dummy->so_key = pp_lfhtable_reverse(bucket);
+  for (;;) {
+    if (pp_lfhtable_find(table, parent, dummy->so_key, NULL, &prev, &cur)) {
+      u_free(dummy);
+      dummy = cur;
+      break;
+    }
+    dummy->next = cur;
+    if (u_atomic_pointer_compare_and_exchange(prev, cur, dummy)) {
+      break;
+    }
+  }
+  u_atomic_pointer_compare_and_exchange(slot, NULL, dummy);
+  return dummy;
+}
+
+static bool
+pp_lfhtable_find(lfhtable_t *table, lfhtable_node_t *head, size_t so_key,
+  const_ptr_t key, ptr_t volatile **prev_out, lfhtable_node_t **cur_out) {
+  ptr_t volatile *prev;
+  lfhtable_node_t *cur;
+  ptr_t next;
+
+retry:
+  prev = &head->next;
+  cur = (lfhtable_node_t *) u_atomic_pointer_get(prev);
+  for (;;) {
+    if (cur == NULL) {
+      break;
+    }
+    next = u_atomic_pointer_get(&cur->next);
+    if (U_LFHTABLE_IS_MARKED (next)) {
+      /* Help to unlink the logically removed node */
+      if (!u_atomic_pointer_compare_and_exchange(
+        prev, cur, U_LFHTABLE_UNMARK (next))) {
+        goto retry;
+      }
+      pp_lfhtable_retire(table, cur);
+      cur = U_LFHTABLE_UNMARK (next);
+      continue;
+    }
+    if (cur->so_key > so_key) {
+      break;
+    }
+    if (cur->so_key == so_key && ((so_key & 1) == 0
+      || (table->equal_func != NULL
+        ? table->equal_func(cur->key, key) : cur->key == key))) {
+      *prev_out = prev;
+      *cur_out = cur;
+      return true;
+    }
+    prev = &cur->next;
+    cur = (lfhtable_node_t *) next;
+  }
+  *prev_out = prev;
+  *cur_out = cur;
+  return false;
+}
+
+static void
+pp_lfhtable_unref(lfhtable_t *table) {
+  if (u_atomic_int_dec_and_test(&table->ref_count)) {
+    u_free(table);
+  }
+}
+
+static void
+pp_lfhtable_node_free(ptr_t data) {
+  lfhtable_node_t *node;
+  lfhtable_t *table;
+
+  node = (lfhtable_node_t *) data;
+  table = node->table;
+  if (table->key_destroy_func != NULL) {
+    table->key_destroy_func(node->key);
+  }
+  if (table->value_destroy_func != NULL) {
+    table->value_destroy_func(node->value);
+  }
+  u_free(node);
+  pp_lfhtable_unref(table);
+}
+
+static void
+pp_lfhtable_retire(lfhtable_t *table, lfhtable_node_t *node) {
+  /* Retired nodes keep the table alive for their destroy functions */
+  u_atomic_int_inc(&table->ref_count);
+  node->table = table;
+  u_epoch_retire(&node->entry, pp_lfhtable_node_free);
+}
+
+lfhtable_t *
+u_lfhtable_new(void) {
+  return u_lfhtable_new_full(NULL, NULL, NULL, NULL);
+}
+
+lfhtable_t *
+u_lfhtable_new_full(hash_fn_t hash_func, equal_fn_t equal_func,
+  destroy_fn_t key_destroy, destroy_fn_t value_destroy) {
+  lfhtable_t *ret;
+  ptr_t volatile *slot;
+  lfhtable_node_t *dummy;
+
+  if (U_UNLIKELY ((ret = u_malloc0(sizeof(lfhtable_t))) == NULL)) {
+    U_ERROR ("lfhtable_t::u_lfhtable_new_full: failed(1) to allocate memory");
+    return NULL;
+  }
+  ret->nbuckets = 2;
+  ret->ref_count = 1;
+  ret->hash_func = hash_func;
+  ret->equal_func = equal_func;
+  ret->key_destroy_func = key_destroy;
+  ret->value_destroy_func = value_destroy;
+  if (U_UNLIKELY ((slot = pp_lfhtable_get_slot(ret, 0, true)) == NULL)) {
+    U_ERROR ("lfhtable_t::u_lfhtable_new_full: failed(2) to allocate memory");
+    u_free(ret);
+    return NULL;
+  }
+  if (U_UNLIKELY ((dummy = u_malloc0(sizeof(lfhtable_node_t))) == NULL)) {
+    U_ERROR ("lfhtable_t::u_lfhtable_new_full: failed(3) to allocate memory");
+    u_free(ret->segments[0]);
+    u_free(ret);
+    return NULL;
+  }
+  *slot = dummy;
+  return ret;
+}
+
+bool
+u_lfhtable_insert(lfhtable_t *table, ptr_t key, ptr_t value) {
+  lfhtable_node_t *node, *head, *cur;
+  ptr_t volatile *prev;
+  size_t hash, nbuckets, size;
+
+  if (U_UNLIKELY (table == NULL)) {
+    return false;
+  }
+  if (U_UNLIKELY ((node = u_malloc0(sizeof(lfhtable_node_t))) == NULL)) {
+    U_ERROR ("lfhtable_t::u_lfhtable_insert: failed to allocate memory");
+    return false;
+  }
+  if (U_UNLIKELY (u_epoch_enter() == false)) {
+    u_free(node);
+    return false;
+  }
+  hash = pp_lfhtable_calc_hash(table, key);
+  node->so_key = pp_lfhtable_reverse(hash | ~(U_MAXSIZE >> 1));
+  node->key = key;
+  node->value = value;
+  nbuckets = (size_t) u_atomic_pointer_get(&table->nbuckets);
+  head = pp_lfhtable_get_bucket(table, hash & (nbuckets - 1));
+  for (;;) {
+    if (pp_lfhtable_find(table, head, node->so_key, key, &prev, &cur)) {
+      u_epoch_leave();
+      u_free(node);
+      return false;
+    }
+    node->next = cur;
+    if (u_atomic_pointer_compare_and_exchange(prev, cur, node)) {
+      break;
+    }
+  }
+  size = (size_t) u_atomic_pointer_add(&table->size, 1) + 1;
+  if (size / U_LFHTABLE_LOAD > nbuckets
+    && nbuckets <= (U_MAXSIZE >> 2)) {
+    u_atomic_pointer_compare_and_exchange(
+      &table->nbuckets, (ptr_t) nbuckets, (ptr_t) (nbuckets << 1)
+    );
+  }
+  u_epoch_leave();
+  return true;
+}
+
+ptr_t
+u_lfhtable_lookup(lfhtable_t *table, const_ptr_t key) {
+  lfhtable_node_t *cur;
+  ptr_t next, ret;
+  size_t hash, so_key;
+
+  if (U_UNLIKELY (table == NULL)) {
+    return NULL;
+  }
+  if (U_UNLIKELY (u_epoch_enter() == false)) {
+    return (ptr_t) -1;
+  }
+  hash = pp_lfhtable_calc_hash(table, key);
+  so_key = pp_lfhtable_reverse(hash | ~(U_MAXSIZE >> 1));
+  cur = pp_lfhtable_get_bucket(
+    table, hash & ((size_t) u_atomic_pointer_get(&table->nbuckets) - 1)
+  );
+  ret = (ptr_t) -1;
+
+  /* Read-only walk, removed nodes are skipped rather than unlinked */
+  for (;;) {
+    cur = U_LFHTABLE_UNMARK (u_atomic_pointer_get(&cur->next));
+    if (cur == NULL || cur->so_key > so_key) {
+      break;
+    }
+    if (cur->so_key == so_key && (table->equal_func != NULL
+      ? table->equal_func(cur->key, key) : cur->key == key)) {
+      next = u_atomic_pointer_get(&cur->next);
+      if (!U_LFHTABLE_IS_MARKED (next)) {
+        ret = cur->value;
+      }
+      break;
+    }
+  }
+  u_epoch_leave();
+  return ret;
+}
+
+bool
+u_lfhtable_remove(lfhtable_t *table, const_ptr_t key) {
+  lfhtable_node_t *head, *cur;
+  ptr_t volatile *prev;
+  ptr_t next;
+  size_t hash, so_key;
+
+  if (U_UNLIKELY (table == NULL)) {
+    return false;
+  }
+  if (U_UNLIKELY (u_epoch_enter() == false)) {
+    return false;
+  }
+  hash = pp_lfhtable_calc_hash(table, key);
+  so_key = pp_lfhtable_reverse(hash | ~(U_MAXSIZE >> 1));
+  head = pp_lfhtable_get_bucket(
+    table, hash & ((size_t) u_atomic_pointer_get(&table->nbuckets) - 1)
+  );
+  for (;;) {
+    if (!pp_lfhtable_find(table, head, so_key, key, &prev, &cur)) {
+      u_epoch_leave();
+      return false;
+    }
+    next = u_atomic_pointer_get(&cur->next);
+    if (U_LFHTABLE_IS_MARKED (next)) {
+      continue;
+    }
+    if (u_atomic_pointer_compare_and_exchange(
+      &cur->next, next, (ptr_t) ((uptr_t) next | U_LFHTABLE_MARK))) {
+      break;
+    }
+  }
+  u_atomic_pointer_add(&table->size, -1);
+  if (u_atomic_pointer_compare_and_exchange(prev, cur, next)) {
+    pp_lfhtable_retire(table, cur);
+  } else {
+    /* Someone changed the predecessor, let the search unlink the node */
+    pp_lfhtable_find(table, head, so_key, key, &prev, &cur);
+  }
+  u_epoch_leave();
+  return true;
+}
+
+size_t
+u_lfhtable_size(const lfhtable_t *table) {
+  if (U_UNLIKELY (table == NULL)) {
+    return 0;
+  }
+  return (size_t) u_atomic_pointer_get(&table->size);
+}
+
+void
+u_lfhtable_free(lfhtable_t *table) {
+  lfhtable_node_t *node, *next;
+  size_t i;
+
+  if (U_UNLIKELY (table == NULL)) {
+    return;
+  }
+  node = (lfhtable_node_t *) ((ptr_t *) table->segments[0])[0];
+  for (; node != NULL; node = next) {
+    next = U_LFHTABLE_UNMARK (node->next);
+    if ((node->so_key & 1) != 0) {
+      if (table->key_destroy_func != NULL) {
+        table->key_destroy_func(node->key);
+      }
+      if (table->value_destroy_func != NULL) {
+        table->value_destroy_func(node->value);
+      }
+    }
+    u_free(node);
+  }
+  for (i = 0; i < U_LFHTABLE_MAX_SEGMENTS; ++i) {
+    u_free(table->segments[i]);
+  }
+  pp_lfhtable_unref(table);
+}
@@ -18,14 +18,34 @@
 #include "unic/mem.h"
 #include "unic/list.h"
 
-list_t *
-u_list_append(list_t *list, ptr_t data) {
-  list_t *item, *cur;
-  if (U_UNLIKELY ((item = u_malloc0(sizeof(list_t))) == NULL)) {
-    U_ERROR ("list_t::u_list_append: failed to allocate memory");
-    return list;
-  }
-  item->data = data;
+#define U_LIST_POOL_SLAB_MIN 32
+#define U_LIST_POOL_SLAB_MAX 1024
+#define U_LIST_SORT_BINS (sizeof(size_t) * 8)
+
+struct list_pool {
+  list_t *free_nodes;
+  list_t *slabs;
+  size_t slab_size;
+};
+
+static list_t *
+pp_list_append_node(list_t *list, list_t *item);
+
+static list_t *
+pp_list_unlink(list_t *list, ptr_t data, list_t **node);
+
+static list_t *
+pp_list_pool_alloc(list_pool_t *pool);
+
+static list_t *
+pp_list_merge(list_t *a, list_t *b, cmp_fn_t func);
+
+static bool
+pp_list_match(const list_t *node, const_ptr_t data, cmp_fn_t func);
+
+static list_t *
+pp_list_append_node(list_t *list, list_t *item) {
+  list_t *cur;
 
   /* List is empty */
   if (U_UNLIKELY (list == NULL)) {
@@ -36,12 +56,11 @@ u_list_append(list_t *list, ptr_t data) {
   return list;
 }
 
-list_t *
-u_list_remove(list_t *list, ptr_t data) {
+static list_t *
+pp_list_unlink(list_t *list, ptr_t data, list_t **node) {
   list_t *cur, *prev, *head;
-  if (U_UNLIKELY (list == NULL)) {
-    return NULL;
-  }
+
+  *node = NULL;
   for (head = list, prev = NULL, cur = list; cur != NULL;
     prev = cur, cur = cur->next) {
     if (cur->data == data) {
@@ -50,13 +69,92 @@ u_list_remove(list_t *list, ptr_t data) {
       } else {
         prev->next = cur->next;
       }
-      u_free(cur);
+      *node = cur;
       break;
     }
   }
   return head;
 }
 
+static list_t *
+pp_list_pool_alloc(list_pool_t *pool) {
+  list_t *slab, *item;
+  size_t i;
+
+  if (U_UNLIKELY (pool->free_nodes == NULL)) {
+    /* The first node of a slab links the slabs together */
+    if (U_UNLIKELY ((slab = u_malloc(
+      (pool->slab_size + 1) * sizeof(list_t))) == NULL)) {
+      return NULL;
+    }
+    slab->data = NULL;
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    for (i = 1; i < pool->slab_size; ++i) {
+      slab[i].next = &slab[i + 1];
+    }
+    slab[pool->slab_size].next = NULL;
+    pool->free_nodes = &slab[1];
+    if (pool->slab_size < U_LIST_POOL_SLAB_MAX) {
+      pool->slab_size *= 2;
+    }
+  }
+  item = pool->free_nodes;
+  pool->free_nodes = item->next;
+  item->next = NULL;
+  return item;
+}
+
+static list_t *
+pp_list_merge(list_t *a, list_t *b, cmp_fn_t func) {
+  list_t head, *tail;
+
+  /* Take from the first list on ties to keep the sort stable */
+  for (tail = &head; a != NULL && b != NULL; tail = tail->next) {
+    if (func(b->data, a->data) < 0) {
+      tail->next = b;
+      b = b->next;
+    } else {
+      tail->next = a;
+      a = a->next;
+    }
+  }
+  tail->next = a != NULL ? a : b;
+  return head.next;
+}
+
+static bool
+pp_list_match(const list_t *node, const_ptr_t data, cmp_fn_t func) {
+  if (func == NULL) {
+    return node->data == data;
+  }
+  return func(node->data, data) == 0;
+}
+
+list_t *
+u_list_append(list_t *list, ptr_t data) {
+  list_t *item;
+  if (U_UNLIKELY ((item = u_malloc0(sizeof(list_t))) == NULL)) {
+    U_ERROR ("list_t::u_list_append: failed to allocate memory");
+    return list;
+  }
+  item->data = data;
+  return pp_list_append_node(list, item);
+}
+
+list_t *
+u_list_remove(list_t *list, ptr_t data) {
+  list_t *node;
+  if (U_UNLIKELY (list == NULL)) {
+    return NULL;
+  }
+  list = pp_list_unlink(list, data, &node);
+  if (node != NULL) {
+    u_free(node);
+  }
+  return list;
+}
+
 void
 u_list_foreach(list_t *list, fn_t func, ptr_t user_data) {
   list_t *cur;
@@ -135,3 +233,161 @@ u_list_reverse(list_t *list) {
   }
   return prev;
 }
+
+list_pool_t *
+u_list_pool_new(void) {
+  list_pool_t *ret;
+
+  if (U_UNLIKELY ((ret = u_malloc0(sizeof(list_pool_t))) == NULL)) {
+    U_ERROR ("list_t::u_list_pool_new: failed to allocate memory");
+    return NULL;
+  }
+  ret->slab_size = U_LIST_POOL_SLAB_MIN;
+  return ret;
+}
+
+void
+u_list_pool_free(list_pool_t *pool) {
+  list_t *slab, *next;
+
+  if (U_UNLIKELY (pool == NULL)) {
+    return;
+  }
+  for (slab = pool->slabs; slab != NULL; slab = next) {
+    next = slab->next;
+    u_free(slab);
+  }
+  u_free(pool);
+}
+
+list_t *
+u_list_pool_append(list_pool_t *pool, list_t *list, ptr_t data) {
+  list_t *item;
+
+  if (U_UNLIKELY (pool == NULL)) {
+    return list;
+  }
+  if (U_UNLIKELY ((item = pp_list_pool_alloc(pool)) == NULL)) {
+    U_ERROR ("list_t::u_list_pool_append: failed to allocate memory");
+    return list;
+  }
+  item->data = data;
+  return pp_list_append_node(list, item);
+}
+
+list_t *
+u_list_pool_prepend(list_pool_t *pool, list_t *list, ptr_t data) {
+  list_t *item;
+
+  if (U_UNLIKELY (pool == NULL)) {
+    return list;
+  }
+  if (U_UNLIKELY ((item = pp_list_pool_alloc(pool)) == NULL)) {
+    U_ERROR ("list_t::u_list_pool_prepend: failed to allocate memory");
+    return list;
+  }
+  item->data = data;
+  item->next = list;
+  return item;
+}
+
+list_t *
+u_list_pool_remove(list_pool_t *pool, list_t *list, ptr_t data) {
+  list_t *node;
+
+  if (U_UNLIKELY (pool == NULL || list == NULL)) {
+    return list;
+  }
+  list = pp_list_unlink(list, data, &node);
+  if (node != NULL) {
+    node->next = pool->free_nodes;
+    pool->free_nodes = node;
+  }
+  return list;
+}
+
+void
+u_list_pool_release(list_pool_t *pool, list_t *list) {
+  list_t *last;
+
+  if (U_UNLIKELY (pool == NULL || list == NULL)) {
+    return;
+  }
+  last = u_list_last(list);
+  last->next = pool->free_nodes;
+  pool->free_nodes = list;
+}
+
+list_t *
+u_list_sort(list_t *list, cmp_fn_t func) {
+  list_t *bins[U_LIST_SORT_BINS];
+  list_t *cur;
+  size_t i, fill;
+
+  if (U_UNLIKELY (list == NULL || func == NULL)) {
+    return list;
+  }
+
+  /* Bin i holds a sorted run of 2^i nodes which precede the later bins */
+  fill = 0;
+  while (list != NULL) {
+    cur = list;
+    list = list->next;
+    cur->next = NULL;
+    for (i = 0; i < fill && bins[i] != NULL; ++i) {
+      cur = pp_list_merge(bins[i], cur, func);
+      bins[i] = NULL;
+    }
+    if (i == fill) {
+      ++fill;
+    }
+    bins[i] = cur;
+  }
+  for (cur = NULL, i = 0; i < fill; ++i) {
+    if (bins[i] != NULL) {
+      cur = pp_list_merge(bins[i], cur, func);
+    }
+  }
+  return cur;
+}
+
+list_t *
+u_list_concat(list_t *list1, list_t *list2) {
+  if (list1 == NULL) {
+    return list2;
+  }
+  u_list_last(list1)->next = list2;
+  return list1;
+}
+
+list_t *
+u_list_find_custom(list_t *list, const_ptr_t data, cmp_fn_t func) {
+  list_t *cur;
+
+  for (cur = list; cur != NULL; cur = cur->next) {
+    if (pp_list_match(cur, data, func)) {
+      return cur;
+    }
+  }
+  return NULL;
+}
+
+list_t *
+u_list_remove_if(list_t *list, const_ptr_t data, cmp_fn_t func,
+  destroy_fn_t data_destroy) {
+  list_t head, *prev, *cur;
+
+  head.next = list;
+  for (prev = &head; (cur = prev->next) != NULL;) {
+    if (pp_list_match(cur, data, func)) {
+      prev->next = cur->next;
+      if (data_destroy != NULL) {
+        data_destroy(cur->data);
+      }
+      u_free(cur);
+    } else {
+      prev = cur;
+    }
+  }
+  return head.next;
+}
@@ -42,6 +42,18 @@ u_thread_init(void);
 extern void
 u_thread_shutdown(void);
 
+extern void
+u_epoch_init(void);
+
+extern void
+u_epoch_shutdown(void);
+
+extern void
+u_pool_init(void);
+
+extern void
+u_pool_shutdown(void);
+
 extern void
 u_condvar_init(void);
 
@@ -74,6 +86,8 @@ u_libsys_init(void) {
   u_atomic_thread_init();
   u_socket_init_once();
   u_thread_init();
+  u_epoch_init();
+  u_pool_init();
   u_condvar_init();
   u_rwlock_init();
   u_profiler_init();
@@ -95,6 +109,8 @@ u_libsys_shutdown(void) {
   u_profiler_shutdown();
   u_rwlock_shutdown();
   u_condvar_shutdown();
+  u_pool_shutdown();
+  u_epoch_shutdown();
   u_thread_shutdown();
   u_socket_close_once();
   u_atomic_thread_shutdown();
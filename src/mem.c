@@ -15,9 +15,11 @@
  * along with this library; if not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
+#include "unic/atomic.h"
 #include "unic/err.h"
 #include "unic/mem.h"
 #include "err-private.h"
@@ -31,13 +33,381 @@
 # include <os2.h>
 # else
 #   include <sys/mman.h>
+#   include <unistd.h>
 # endif
 #endif
 
+#define U_ARENA_MIN_CHUNK_SIZE 4096
+
+/* Chunk header size, keeps the first block aligned by default */
+#define U_ARENA_CHUNK_HEADER                                                   \
+  ((sizeof(arena_chunk_t) + U_ARENA_DEFAULT_ALIGNMENT - 1)                     \
+  & ~((size_t) U_ARENA_DEFAULT_ALIGNMENT - 1))
+
+#if defined (U_CC_GNU) || defined (U_CC_CLANG)
+# define U_MEM_STATS_CALLER() __builtin_return_address(0)
+#else
+# define U_MEM_STATS_CALLER() NULL
+#endif
+
+#define U_MEM_STATS_SHARDS 16
+#define U_MEM_STATS_SHARDS_SHIFT 28
+#define U_MEM_STATS_PROBES 8
+#define U_MEM_STATS_DUMP_SITES 32
+
+/* Block header size, keeps the default malloc() alignment */
+#define U_MEM_STATS_HEADER 16
+
+typedef struct arena_chunk arena_chunk_t;
+typedef struct mem_stats_header mem_stats_header_t;
+typedef struct mem_stats_counters mem_stats_counters_t;
+typedef struct mem_stats_shard mem_stats_shard_t;
+
+struct arena_chunk {
+  arena_chunk_t *next;
+  size_t size;
+};
+
+struct arena {
+  arena_chunk_t *chunks;
+  arena_chunk_t *free_chunks;
+  byte_t *cur;
+  byte_t *end;
+  size_t chunk_size;
+};
+
+struct mem_stats_header {
+  size_t size;
+  size_t site;
+};
+
+struct mem_stats_counters {
+  volatile ssize_t live_bytes;
+  volatile ssize_t live_count;
+  volatile ssize_t total_bytes;
+  volatile ssize_t total_count;
+};
+
+struct mem_stats_shard {
+  mem_stats_counters_t sites[U_MEM_STATS_MAX_SITES];
+  volatile ssize_t size_classes[U_MEM_STATS_SIZE_CLASSES];
+};
+
 static bool u_mem_table_inited = false;
 
+static bool u_mem_table_is_system = true;
+
+static bool u_mem_stats_enabled = false;
+
+/* Set by the first allocation, the statistics can't be enabled afterwards:
+ * the blocks already handed out have no header */
+static bool u_mem_table_used = false;
+
+/* The system allocator is called directly unless a custom table is set or the
+ * statistics are enabled */
+static bool u_mem_table_is_direct = true;
+
 static mem_vtable_t u_mem_table;
 
+/* Call site addresses, the first slot is reserved for the unknown ones */
+static ptr_t volatile u_mem_stats_sites[U_MEM_STATS_MAX_SITES];
+
+static mem_stats_shard_t u_mem_stats_shards[U_MEM_STATS_SHARDS];
+
+static void
+pp_mem_update_mode(void);
+
+static ptr_t
+pp_mem_alloc(size_t n_bytes, bool zero, ptr_t site);
+
+static ptr_t
+pp_mem_alloc_slow(size_t n_bytes, bool zero, ptr_t site);
+
+static mem_stats_shard_t *
+pp_mem_stats_get_shard(void);
+
+static size_t
+pp_mem_stats_get_site(ptr_t site);
+
+static int
+pp_mem_stats_get_size_class(size_t n_bytes);
+
+static void
+pp_mem_stats_account(size_t index, size_t n_bytes, ssize_t sign);
+
+static ptr_t
+pp_mem_stats_alloc(size_t n_bytes, bool zero, ptr_t site);
+
+static ptr_t
+pp_mem_stats_realloc(ptr_t mem, size_t n_bytes, ptr_t site);
+
+static void
+pp_mem_stats_free(ptr_t mem);
+
+static int
+pp_mem_stats_compare_sites(const void *a, const void *b);
+
+static void
+pp_mem_populate(ptr_t mem, size_t n_bytes, size_t page_size);
+
+static arena_chunk_t *
+pp_arena_chunk_new(size_t size);
+
+static ptr_t
+pp_arena_grow(arena_t *arena, size_t n_bytes, size_t alignment);
+
+static void
+pp_mem_update_mode(void) {
+  u_mem_table_is_direct = u_mem_table_is_system && !u_mem_stats_enabled;
+}
+
+static ptr_t
+pp_mem_alloc(size_t n_bytes, bool zero, ptr_t site) {
+  if (U_LIKELY (u_mem_table_is_direct)) {
+    /* Read before writing, so the flag is not stored on every call */
+    if (U_UNLIKELY (!u_mem_table_used)) {
+      u_mem_table_used = true;
+    }
+
+    /* calloc() gets fresh pages for large blocks which are zeroed already */
+    return zero ? calloc(1, n_bytes) : malloc(n_bytes);
+  }
+  return pp_mem_alloc_slow(n_bytes, zero, site);
+}
+
+static ptr_t
+pp_mem_alloc_slow(size_t n_bytes, bool zero, ptr_t site) {
+  ptr_t ret;
+
+  if (U_UNLIKELY (!u_mem_table_used)) {
+    u_mem_table_used = true;
+  }
+  if (u_mem_stats_enabled) {
+    return pp_mem_stats_alloc(n_bytes, zero, site);
+  }
+  if (U_UNLIKELY ((ret = u_mem_table.malloc(n_bytes)) == NULL)) {
+    return NULL;
+  }
+  if (zero) {
+    memset(ret, 0, n_bytes);
+  }
+  return ret;
+}
+
+static mem_stats_shard_t *
+pp_mem_stats_get_shard(void) {
+  size_t addr;
+
+  /* Threads have their stacks apart from each other, which spreads them over
+   * the shards without any thread local storage */
+  addr = (size_t) &addr;
+  return &u_mem_stats_shards[
+    ((u32_t) (addr >> 16) * 2654435769U) >> U_MEM_STATS_SHARDS_SHIFT];
+}
+
+static size_t
+pp_mem_stats_get_site(ptr_t site) {
+  ptr_t cur;
+  size_t hash;
+  size_t index;
+  int i;
+
+  if (site == NULL) {
+    return 0;
+  }
+  hash = ((size_t) site >> 2) * 2654435769U;
+  for (i = 0; i < U_MEM_STATS_PROBES; ++i) {
+    index = 1 + (hash + i) % (U_MEM_STATS_MAX_SITES - 1);
+    cur = u_atomic_pointer_get(&u_mem_stats_sites[index]);
+    if (cur == site) {
+      return index;
+    }
+    if (cur == NULL) {
+      if (u_atomic_pointer_compare_and_exchange(
+        &u_mem_stats_sites[index], NULL, site)) {
+        return index;
+      }
+      if (u_atomic_pointer_get(&u_mem_stats_sites[index]) == site) {
+        return index;
+      }
+    }
+  }
+  return 0;
+}
+
+static int
+pp_mem_stats_get_size_class(size_t n_bytes) {
+  size_t limit = 16;
+  int size_class = 0;
+
+  while (n_bytes > limit && size_class < U_MEM_STATS_SIZE_CLASSES - 1) {
+    limit <<= 1;
+    ++size_class;
+  }
+  return size_class;
+}
+
+static void
+pp_mem_stats_account(size_t index, size_t n_bytes, ssize_t sign) {
+  mem_stats_shard_t *shard;
+  mem_stats_counters_t *counters;
+
+  shard = pp_mem_stats_get_shard();
+  counters = &shard->sites[index];
+  u_atomic_pointer_add(&counters->live_bytes, sign * (ssize_t) n_bytes);
+  u_atomic_pointer_add(&counters->live_count, sign);
+  if (sign > 0) {
+    u_atomic_pointer_add(&counters->total_bytes, (ssize_t) n_bytes);
+    u_atomic_pointer_add(&counters->total_count, 1);
+    u_atomic_pointer_add(
+      &shard->size_classes[pp_mem_stats_get_size_class(n_bytes)], 1);
+  }
+}
+
+static ptr_t
+pp_mem_stats_alloc(size_t n_bytes, bool zero, ptr_t site) {
+  mem_stats_header_t *header;
+
+  if (U_UNLIKELY (n_bytes > (size_t) -1 - U_MEM_STATS_HEADER)) {
+    return NULL;
+  }
+  if (zero && u_mem_table_is_system) {
+    header = calloc(1, n_bytes + U_MEM_STATS_HEADER);
+  } else {
+    header = u_mem_table.malloc(n_bytes + U_MEM_STATS_HEADER);
+  }
+  if (U_UNLIKELY (header == NULL)) {
+    return NULL;
+  }
+  if (zero && !u_mem_table_is_system) {
+    memset((byte_t *) header + U_MEM_STATS_HEADER, 0, n_bytes);
+  }
+  header->size = n_bytes;
+  header->site = pp_mem_stats_get_site(site);
+  pp_mem_stats_account(header->site, n_bytes, 1);
+  return (byte_t *) header + U_MEM_STATS_HEADER;
+}
+
+static ptr_t
+pp_mem_stats_realloc(ptr_t mem, size_t n_bytes, ptr_t site) {
+  mem_stats_header_t *header;
+  size_t old_size;
+  size_t old_site;
+
+  if (U_UNLIKELY (n_bytes > (size_t) -1 - U_MEM_STATS_HEADER)) {
+    return NULL;
+  }
+  header = (mem_stats_header_t *) ((byte_t *) mem - U_MEM_STATS_HEADER);
+  old_size = header->size;
+  old_site = header->site;
+  header = u_mem_table.realloc(header, n_bytes + U_MEM_STATS_HEADER);
+  if (U_UNLIKELY (header == NULL)) {
+    return NULL;
+  }
+
+  /* The block moves to the site which resized it */
+  pp_mem_stats_account(old_site, old_size, -1);
+  header->size = n_bytes;
+  header->site = pp_mem_stats_get_site(site);
+  pp_mem_stats_account(header->site, n_bytes, 1);
+  return (byte_t *) header + U_MEM_STATS_HEADER;
+}
+
+static void
+pp_mem_stats_free(ptr_t mem) {
+  mem_stats_header_t *header;
+
+  header = (mem_stats_header_t *) ((byte_t *) mem - U_MEM_STATS_HEADER);
+  pp_mem_stats_account(header->site, header->size, -1);
+  u_mem_table.free(header);
+}
+
+static int
+pp_mem_stats_compare_sites(const void *a, const void *b) {
+  const mem_stats_site_t *site_a = a;
+  const mem_stats_site_t *site_b = b;
+
+  if (site_a->live_bytes != site_b->live_bytes) {
+    return site_a->live_bytes > site_b->live_bytes ? -1 : 1;
+  }
+  if (site_a->total_bytes != site_b->total_bytes) {
+    return site_a->total_bytes > site_b->total_bytes ? -1 : 1;
+  }
+  return 0;
+}
+
+static void
+pp_mem_populate(ptr_t mem, size_t n_bytes, size_t page_size) {
+  size_t i;
+
+#ifdef MADV_POPULATE_WRITE
+  if (madvise(mem, n_bytes, MADV_POPULATE_WRITE) == 0) {
+    return;
+  }
+#endif
+
+  /* Pages are zeroed, writing a zero commits them without any change */
+  for (i = 0; i < n_bytes; i += page_size) {
+    ((volatile byte_t *) mem)[i] = 0;
+  }
+}
+
+static arena_chunk_t *
+pp_arena_chunk_new(size_t size) {
+  arena_chunk_t *chunk;
+
+  if (U_UNLIKELY ((chunk = u_mem_mmap(size, NULL)) == NULL)) {
+    return NULL;
+  }
+  chunk->next = NULL;
+  chunk->size = size;
+  return chunk;
+}
+
+static ptr_t
+pp_arena_grow(arena_t *arena, size_t n_bytes, size_t alignment) {
+  arena_chunk_t *chunk;
+  size_t need;
+  size_t ptr;
+
+  need = U_ARENA_CHUNK_HEADER + n_bytes + alignment - 1;
+  if (U_UNLIKELY (need < n_bytes)) {
+    return NULL;
+  }
+  if (need > arena->chunk_size) {
+    /* Large blocks get a dedicated chunk behind the current one, which keeps
+     * serving the small blocks */
+    if (U_UNLIKELY ((chunk = pp_arena_chunk_new(need)) == NULL)) {
+      U_ERROR ("arena_t::u_arena_alloc: failed to allocate memory");
+      return NULL;
+    }
+    if (arena->chunks != NULL) {
+      chunk->next = arena->chunks->next;
+      arena->chunks->next = chunk;
+    } else {
+      arena->chunks = chunk;
+    }
+    ptr = ((size_t) chunk + U_ARENA_CHUNK_HEADER + alignment - 1)
+      & ~(alignment - 1);
+    return (ptr_t) ptr;
+  }
+  if (arena->free_chunks != NULL) {
+    chunk = arena->free_chunks;
+    arena->free_chunks = chunk->next;
+  } else if (U_UNLIKELY (
+    (chunk = pp_arena_chunk_new(arena->chunk_size)) == NULL)) {
+    U_ERROR ("arena_t::u_arena_alloc: failed to allocate memory");
+    return NULL;
+  }
+  chunk->next = arena->chunks;
+  arena->chunks = chunk;
+  ptr = ((size_t) chunk + U_ARENA_CHUNK_HEADER + alignment - 1)
+    & ~(alignment - 1);
+  arena->cur = (byte_t *) ptr + n_bytes;
+  arena->end = (byte_t *) chunk + chunk->size;
+  return (ptr_t) ptr;
+}
+
 void
 u_mem_init(void) {
   if (U_UNLIKELY (u_mem_table_inited == true)) {
@@ -51,16 +421,17 @@ u_mem_shutdown(void) {
   if (U_UNLIKELY (!u_mem_table_inited)) {
     return;
   }
-  u_mem_table.malloc = NULL;
-  u_mem_table.realloc = NULL;
-  u_mem_table.free = NULL;
+
+  /* The system routines stay usable after the shutdown, the instrumented
+   * blocks can still be released then */
+  u_mem_restore_vtable();
   u_mem_table_inited = false;
 }
 
 ptr_t
 u_malloc(size_t n_bytes) {
   if (U_LIKELY (n_bytes > 0)) {
-    return u_mem_table.malloc(n_bytes);
+    return pp_mem_alloc(n_bytes, false, U_MEM_STATS_CALLER ());
   } else {
     return NULL;
   }
@@ -68,35 +439,92 @@ u_malloc(size_t n_bytes) {
 
 ptr_t
 u_malloc0(size_t n_bytes) {
-  ptr_t ret;
-
   if (U_LIKELY (n_bytes > 0)) {
-    if (U_UNLIKELY ((ret = u_mem_table.malloc(n_bytes)) == NULL)) {
-      return NULL;
-    }
-    memset(ret, 0, n_bytes);
-    return ret;
+    return pp_mem_alloc(n_bytes, true, U_MEM_STATS_CALLER ());
   } else {
     return NULL;
   }
 }
 
+ptr_t
+u_malloc_n(size_t count, size_t size) {
+  if (U_UNLIKELY (size == 0 || count == 0 || count > (size_t) -1 / size)) {
+    return NULL;
+  }
+  return pp_mem_alloc(count * size, false, U_MEM_STATS_CALLER ());
+}
+
+ptr_t
+u_malloc0_n(size_t count, size_t size) {
+  if (U_UNLIKELY (size == 0 || count == 0 || count > (size_t) -1 / size)) {
+    return NULL;
+  }
+  return pp_mem_alloc(count * size, true, U_MEM_STATS_CALLER ());
+}
+
 ptr_t
 u_realloc(ptr_t mem, size_t n_bytes) {
   if (U_UNLIKELY (n_bytes == 0)) {
     return NULL;
   }
+  if (U_LIKELY (u_mem_table_is_direct)) {
+    if (U_UNLIKELY (!u_mem_table_used)) {
+      u_mem_table_used = true;
+    }
+    return realloc(mem, n_bytes);
+  }
   if (U_UNLIKELY (mem == NULL)) {
-    return u_mem_table.malloc(n_bytes);
-  } else {
-    return u_mem_table.realloc(mem, n_bytes);
+    return pp_mem_alloc_slow(n_bytes, false, U_MEM_STATS_CALLER ());
+  }
+  if (u_mem_stats_enabled) {
+    return pp_mem_stats_realloc(mem, n_bytes, U_MEM_STATS_CALLER ());
   }
+  return u_mem_table.realloc(mem, n_bytes);
 }
 
 void
 u_free(ptr_t mem) {
   if (U_LIKELY (mem != NULL)) {
-    u_mem_table.free(mem);
+    if (U_LIKELY (u_mem_table_is_direct)) {
+      free(mem);
+    } else if (u_mem_stats_enabled) {
+      pp_mem_stats_free(mem);
+    } else {
+      u_mem_table.free(mem);
+    }
+  }
+}
+
+ptr_t
+u_malloc_aligned(size_t n_bytes, size_t alignment) {
+  byte_t *mem;
+  size_t ptr;
+
+  if (U_UNLIKELY (n_bytes == 0 || alignment == 0
+    || (alignment & (alignment - 1)) != 0)) {
+    return NULL;
+  }
+  if (alignment < sizeof(ptr_t)) {
+    alignment = sizeof(ptr_t);
+  }
+  if (U_UNLIKELY (n_bytes > (size_t) -1 - alignment - sizeof(ptr_t))) {
+    return NULL;
+  }
+
+  /* The original pointer is stored right before the aligned block */
+  if (U_UNLIKELY ((mem = pp_mem_alloc(n_bytes + alignment - 1 + sizeof(ptr_t),
+    false, U_MEM_STATS_CALLER ())) == NULL)) {
+    return NULL;
+  }
+  ptr = ((size_t) mem + sizeof(ptr_t) + alignment - 1) & ~(alignment - 1);
+  ((ptr_t *) ptr)[-1] = mem;
+  return (ptr_t) ptr;
+}
+
+void
+u_free_aligned(ptr_t mem) {
+  if (U_LIKELY (mem != NULL)) {
+    u_free(((ptr_t *) mem)[-1]);
   }
 }
 
@@ -112,7 +540,9 @@ u_mem_set_vtable(const mem_vtable_t *table) {
   u_mem_table.malloc = table->malloc;
   u_mem_table.realloc = table->realloc;
   u_mem_table.free = table->free;
+  u_mem_table_is_system = false;
   u_mem_table_inited = true;
+  pp_mem_update_mode();
   return true;
 }
 
@@ -121,7 +551,152 @@ u_mem_restore_vtable(void) {
   u_mem_table.malloc = (ptr_t (*)(size_t)) malloc;
   u_mem_table.realloc = (ptr_t (*)(ptr_t, size_t)) realloc;
   u_mem_table.free = (void (*)(ptr_t)) free;
+  u_mem_table_is_system = true;
   u_mem_table_inited = true;
+  pp_mem_update_mode();
+}
+
+bool
+u_mem_stats_enable(void) {
+  if (u_mem_stats_enabled) {
+    return true;
+  }
+  if (U_UNLIKELY (u_mem_table_used)) {
+    return false;
+  }
+
+  /* Blocks may be allocated before the library initialization */
+  if (!u_mem_table_inited) {
+    u_mem_restore_vtable();
+  }
+  u_mem_stats_enabled = true;
+  pp_mem_update_mode();
+  return true;
+}
+
+bool
+u_mem_stats_disable(void) {
+  mem_stats_t stats;
+
+  if (!u_mem_stats_enabled) {
+    return true;
+  }
+  u_mem_stats_get(&stats);
+  if (U_UNLIKELY (stats.live_count != 0)) {
+    return false;
+  }
+  u_mem_stats_enabled = false;
+  pp_mem_update_mode();
+  return true;
+}
+
+bool
+u_mem_stats_is_enabled(void) {
+  return u_mem_stats_enabled;
+}
+
+void
+u_mem_stats_get(mem_stats_t *stats) {
+  mem_stats_shard_t *shard;
+  mem_stats_counters_t *counters;
+  int i;
+  int j;
+
+  if (U_UNLIKELY (stats == NULL)) {
+    return;
+  }
+  memset(stats, 0, sizeof(mem_stats_t));
+  for (i = 0; i < U_MEM_STATS_SHARDS; ++i) {
+    shard = &u_mem_stats_shards[i];
+    for (j = 0; j < U_MEM_STATS_MAX_SITES; ++j) {
+      counters = &shard->sites[j];
+      stats->live_bytes += (size_t) counters->live_bytes;
+      stats->live_count += (size_t) counters->live_count;
+      stats->total_bytes += (size_t) counters->total_bytes;
+      stats->total_count += (size_t) counters->total_count;
+    }
+    for (j = 0; j < U_MEM_STATS_SIZE_CLASSES; ++j) {
+      stats->size_classes[j] += (size_t) shard->size_classes[j];
+    }
+  }
+}
+
+int
+u_mem_stats_get_sites(mem_stats_site_t *sites, int max_sites) {
+  mem_stats_site_t all[U_MEM_STATS_MAX_SITES];
+  mem_stats_counters_t *counters;
+  int count = 0;
+  int i;
+  int j;
+
+  if (U_UNLIKELY (sites == NULL || max_sites <= 0)) {
+    return 0;
+  }
+  for (j = 0; j < U_MEM_STATS_MAX_SITES; ++j) {
+    memset(&all[count], 0, sizeof(mem_stats_site_t));
+    all[count].site = u_atomic_pointer_get(&u_mem_stats_sites[j]);
+
+    /* Shards are summed up first, a block can be freed in another shard */
+    for (i = 0; i < U_MEM_STATS_SHARDS; ++i) {
+      counters = &u_mem_stats_shards[i].sites[j];
+      all[count].live_bytes += (size_t) counters->live_bytes;
+      all[count].live_count += (size_t) counters->live_count;
+      all[count].total_bytes += (size_t) counters->total_bytes;
+      all[count].total_count += (size_t) counters->total_count;
+    }
+    if (all[count].total_count > 0) {
+      ++count;
+    }
+  }
+  qsort(all, (size_t) count, sizeof(mem_stats_site_t),
+    pp_mem_stats_compare_sites);
+  if (count > max_sites) {
+    count = max_sites;
+  }
+  memcpy(sites, all, (size_t) count * sizeof(mem_stats_site_t));
+  return count;
+}
+
+void
+u_mem_stats_dump(void) {
+  mem_stats_site_t sites[U_MEM_STATS_MAX_SITES];
+  mem_stats_t stats;
+  int count;
+  int i;
+
+  u_mem_stats_get(&stats);
+  count = u_mem_stats_get_sites(sites, U_MEM_STATS_MAX_SITES);
+  fprintf(stderr, "** Memory statistics%s **\n",
+    u_mem_stats_enabled ? "" : " (disabled)");
+  fprintf(stderr, "live: %llu bytes in %llu blocks\n",
+    (unsigned long long) stats.live_bytes,
+    (unsigned long long) stats.live_count);
+  fprintf(stderr, "total: %llu bytes in %llu blocks\n",
+    (unsigned long long) stats.total_bytes,
+    (unsigned long long) stats.total_count);
+  fprintf(stderr, "size classes:\n");
+  for (i = 0; i < U_MEM_STATS_SIZE_CLASSES; ++i) {
+    if (i < U_MEM_STATS_SIZE_CLASSES - 1) {
+      fprintf(stderr, "  <= %-10llu %llu\n", (unsigned long long) 16 << i,
+        (unsigned long long) stats.size_classes[i]);
+    } else {
+      fprintf(stderr, "  >  %-10llu %llu\n", (unsigned long long) 16 << (i - 1),
+        (unsigned long long) stats.size_classes[i]);
+    }
+  }
+  fprintf(stderr, "call sites by live bytes:\n");
+  for (i = 0; i < count && i < U_MEM_STATS_DUMP_SITES; ++i) {
+    fprintf(stderr, "  %-18p live %llu bytes in %llu blocks, "
+      "total %llu bytes in %llu blocks\n",
+      sites[i].site,
+      (unsigned long long) sites[i].live_bytes,
+      (unsigned long long) sites[i].live_count,
+      (unsigned long long) sites[i].total_bytes,
+      (unsigned long long) sites[i].total_count);
+  }
+  if (count > U_MEM_STATS_DUMP_SITES) {
+    fprintf(stderr, "  ... %d more\n", count - U_MEM_STATS_DUMP_SITES);
+  }
 }
 
 ptr_t
@@ -271,6 +846,119 @@ u_mem_mmap(size_t n_bytes, err_t **error) {
   return addr;
 }
 
+ptr_t
+u_mem_mmap_full(size_t n_bytes, size_t alignment, int flags, err_t **error) {
+  ptr_t addr;
+#if !defined (U_OS_WIN) && !defined (U_OS_BEOS) && !defined (U_OS_OS2)
+  size_t page_size;
+  size_t map_size;
+  size_t head;
+#endif
+
+  if (U_UNLIKELY (n_bytes == 0 || (alignment & (alignment - 1)) != 0)) {
+    u_err_set_err_p(
+      error,
+      (int) U_ERR_IO_INVALID_ARGUMENT,
+      0,
+      "Invalid input argument"
+    );
+    return NULL;
+  }
+  if (alignment == 0) {
+    alignment = 1;
+  }
+#if defined (U_OS_WIN) || defined (U_OS_BEOS) || defined (U_OS_OS2)
+  /* No huge pages and no control over the placement, the allocation
+   * granularity may still be enough */
+  if (U_UNLIKELY ((addr = u_mem_mmap(n_bytes, error)) == NULL)) {
+    return NULL;
+  }
+  if (U_UNLIKELY (((size_t) addr & (alignment - 1)) != 0)) {
+    u_mem_munmap(addr, n_bytes, NULL);
+    u_err_set_err_p(
+      error,
+      (int) U_ERR_IO_NOT_SUPPORTED,
+      0,
+      "Requested alignment is not supported"
+    );
+    return NULL;
+  }
+  if ((flags & U_MEM_MAP_POPULATE) != 0) {
+    pp_mem_populate(addr, n_bytes, 4096);
+  }
+  return addr;
+#else
+  page_size = (size_t) sysconf(_SC_PAGESIZE);
+  if (U_UNLIKELY (page_size == 0 || (page_size & (page_size - 1)) != 0)) {
+    page_size = 4096;
+  }
+  if (alignment < page_size) {
+    alignment = page_size;
+  }
+  if ((flags & U_MEM_MAP_HUGE_PAGES) != 0 && n_bytes >= U_MEM_HUGE_PAGE_SIZE
+    && alignment < U_MEM_HUGE_PAGE_SIZE) {
+    alignment = U_MEM_HUGE_PAGE_SIZE;
+  }
+# if defined (MAP_HUGETLB) && (defined (UNIC_MMAP_HAS_MAP_ANONYMOUS) \
+  || defined (UNIC_MMAP_HAS_MAP_ANON))
+  /* Reserved huge pages are aligned to their size, fails if the system has
+   * not enough of them */
+  if ((flags & U_MEM_MAP_HUGE_PAGES) != 0
+    && n_bytes % U_MEM_HUGE_PAGE_SIZE == 0
+    && alignment <= U_MEM_HUGE_PAGE_SIZE) {
+#  ifdef UNIC_MMAP_HAS_MAP_ANONYMOUS
+    addr = mmap(NULL, n_bytes, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#  else
+    addr = mmap(NULL, n_bytes, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANON | MAP_HUGETLB, -1, 0);
+#  endif
+    if (addr != (void *) -1) {
+      if ((flags & U_MEM_MAP_POPULATE) != 0) {
+        pp_mem_populate(addr, n_bytes, U_MEM_HUGE_PAGE_SIZE);
+      }
+      return addr;
+    }
+  }
+# endif
+
+  /* Map enough to find an aligned block inside and trim the rest */
+  if (U_UNLIKELY (n_bytes > (size_t) -1 - alignment - page_size)) {
+    u_err_set_err_p(
+      error,
+      (int) U_ERR_IO_INVALID_ARGUMENT,
+      0,
+      "Invalid input argument"
+    );
+    return NULL;
+  }
+  n_bytes = (n_bytes + page_size - 1) & ~(page_size - 1);
+  map_size = n_bytes + alignment - page_size;
+  if (U_UNLIKELY ((addr = u_mem_mmap(map_size, error)) == NULL)) {
+    return NULL;
+  }
+  head = (((size_t) addr + alignment - 1) & ~(alignment - 1)) - (size_t) addr;
+  if (head > 0) {
+    munmap(addr, head);
+  }
+  if (map_size - head > n_bytes) {
+    munmap((byte_t *) addr + head + n_bytes, map_size - head - n_bytes);
+  }
+  addr = (byte_t *) addr + head;
+# ifdef MADV_HUGEPAGE
+  if ((flags & U_MEM_MAP_HUGE_PAGES) != 0) {
+    madvise(addr, n_bytes, MADV_HUGEPAGE);
+  }
+# endif
+
+  /* Populating after madvise() lets the kernel use the huge pages */
+  if ((flags & U_MEM_MAP_POPULATE) != 0) {
+    pp_mem_populate(addr, n_bytes, page_size);
+  }
+  return addr;
+#endif
+}
+
 bool
 u_mem_munmap(ptr_t mem, size_t n_bytes, err_t **error) {
 #if defined (U_OS_BEOS)
@@ -328,3 +1016,84 @@ u_mem_munmap(ptr_t mem, size_t n_bytes, err_t **error) {
     return true;
   }
 }
+
+arena_t *
+u_arena_new(size_t chunk_size) {
+  arena_t *ret;
+
+  if (chunk_size == 0) {
+    chunk_size = U_ARENA_DEFAULT_CHUNK_SIZE;
+  }
+  if (U_UNLIKELY (chunk_size > (size_t) -1 - U_ARENA_MIN_CHUNK_SIZE)) {
+    return NULL;
+  }
+  if (U_UNLIKELY ((ret = u_malloc0(sizeof(arena_t))) == NULL)) {
+    U_ERROR ("arena_t::u_arena_new: failed to allocate memory");
+    return NULL;
+  }
+  ret->chunk_size = (chunk_size + U_ARENA_MIN_CHUNK_SIZE - 1)
+    & ~((size_t) U_ARENA_MIN_CHUNK_SIZE - 1);
+  return ret;
+}
+
+ptr_t
+u_arena_alloc(arena_t *arena, size_t n_bytes, size_t alignment) {
+  size_t ptr;
+
+  if (U_UNLIKELY (arena == NULL || n_bytes == 0)) {
+    return NULL;
+  }
+  if (alignment == 0) {
+    alignment = U_ARENA_DEFAULT_ALIGNMENT;
+  } else if (U_UNLIKELY ((alignment & (alignment - 1)) != 0)) {
+    return NULL;
+  }
+
+  /* Fast path: bump the pointer within the current chunk, an empty arena
+   * has both pointers NULL and always falls through */
+  ptr = ((size_t) arena->cur + alignment - 1) & ~(alignment - 1);
+  if (U_LIKELY (ptr <= (size_t) arena->end
+    && n_bytes <= (size_t) arena->end - ptr)) {
+    arena->cur = (byte_t *) ptr + n_bytes;
+    return (ptr_t) ptr;
+  }
+  return pp_arena_grow(arena, n_bytes, alignment);
+}
+
+void
+u_arena_reset(arena_t *arena) {
+  arena_chunk_t *chunk;
+  arena_chunk_t *next;
+
+  if (U_UNLIKELY (arena == NULL)) {
+    return;
+  }
+  for (chunk = arena->chunks; chunk != NULL; chunk = next) {
+    next = chunk->next;
+    if (chunk->size == arena->chunk_size) {
+      chunk->next = arena->free_chunks;
+      arena->free_chunks = chunk;
+    } else {
+      u_mem_munmap(chunk, chunk->size, NULL);
+    }
+  }
+  arena->chunks = NULL;
+  arena->cur = NULL;
+  arena->end = NULL;
+}
+
+void
+u_arena_free(arena_t *arena) {
+  arena_chunk_t *chunk;
+  arena_chunk_t *next;
+
+  if (U_UNLIKELY (arena == NULL)) {
+    return;
+  }
+  u_arena_reset(arena);
+  for (chunk = arena->free_chunks; chunk != NULL; chunk = next) {
+    next = chunk->next;
+    u_mem_munmap(chunk, chunk->size, NULL);
+  }
+  u_free(arena);
+}
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "unic/mem.h"
+#include "unic/htable.h"
+#include "unic/mphf.h"
+
+/* Average number of keys per bucket, every bucket costs a 16-bit pilot */
+#define U_MPHF_BUCKET_LOAD 4
+
+/* Largest pilot value before retrying with another seed */
+#define U_MPHF_MAX_PILOT U_MAXUINT16
+
+/* Number of seeds to try before giving up */
+#define U_MPHF_MAX_SEEDS 16
+
+struct mphf {
+  size_t n;
+  size_t m;
+  size_t nbuckets;
+  u64_t seed;
+  u16_t *pilots;
+  u32_t *remap;
+};
+
+static u64_t
+pp_mphf_mix(u64_t x);
+
+static size_t
+pp_mphf_range(u64_t x, size_t range);
+
+static bool
+pp_mphf_try_seed(mphf_t *mphf, const u64_t *base, u64_t *hashes, u32_t *order,
+  size_t *bucket_start, u32_t *bucket_order, ubyte_t *taken, size_t *pos,
+  bool *collision);
+
+static u64_t
+pp_mphf_mix(u64_t x) {
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+  return x;
+}
+
+static size_t
+pp_mphf_range(u64_t x, size_t range) {
+  /* Multiply-shift instead of modulo, range is below 2^32 */
+  return (size_t) (((x >> 32) * (u64_t) range) >> 32);
+}
+
+static bool
+pp_mphf_try_seed(mphf_t *mphf, const u64_t *base, u64_t *hashes, u32_t *order,
+  size_t *bucket_start, u32_t *bucket_order, ubyte_t *taken, size_t *pos,
+  bool *collision) {
+  size_t i, j, l, b, k, size, max_size, start;
+  u64_t pilot_hash;
+  u32_t pilot;
+  bool ok;
+
+  /* Group keys by bucket with a counting sort */
+  memset(bucket_start, 0, (mphf->nbuckets + 1) * sizeof(size_t));
+  for (i = 0; i < mphf->n; ++i) {
+    hashes[i] = pp_mphf_mix(base[i] ^ mphf->seed);
+    ++bucket_start[pp_mphf_range(hashes[i], mphf->nbuckets) + 1];
+  }
+  max_size = 0;
+  for (b = 0; b < mphf->nbuckets; ++b) {
+    if (bucket_start[b + 1] > max_size) {
+      max_size = bucket_start[b + 1];
+    }
+    bucket_start[b + 1] += bucket_start[b];
+  }
+  for (i = 0; i < mphf->n; ++i) {
+    b = pp_mphf_range(hashes[i], mphf->nbuckets);
+    order[bucket_start[b]++] = (u32_t) i;
+  }
+  for (b = mphf->nbuckets; b > 0; --b) {
+    bucket_start[b] = bucket_start[b - 1];
+  }
+  bucket_start[0] = 0;
+
+  /* Keys sharing the whole hash can not be told apart with any seed */
+  for (b = 0; b < mphf->nbuckets; ++b) {
+    for (i = bucket_start[b]; i < bucket_start[b + 1]; ++i) {
+      for (j = bucket_start[b]; j < i; ++j) {
+        if (hashes[order[i]] == hashes[order[j]]) {
+          *collision = true;
+          return false;
+        }
+      }
+    }
+  }
+
+  /* Place the largest buckets first while most slots are free */
+  k = 0;
+  for (size = max_size; size > 0; --size) {
+    for (b = 0; b < mphf->nbuckets; ++b) {
+      if (bucket_start[b + 1] - bucket_start[b] == size) {
+        bucket_order[k++] = (u32_t) b;
+      }
+    }
+  }
+  memset(taken, 0, (mphf->m + 7) / 8);
+  for (i = 0; i < k; ++i) {
+    b = bucket_order[i];
+    start = bucket_start[b];
+    size = bucket_start[b + 1] - start;
+    for (pilot = 0; pilot <= U_MPHF_MAX_PILOT; ++pilot) {
+      pilot_hash = pp_mphf_mix(mphf->seed + pilot);
+      ok = true;
+      for (j = 0; j < size && ok; ++j) {
+        pos[j] = pp_mphf_range(
+          pp_mphf_mix(hashes[order[start + j]] ^ pilot_hash), mphf->m
+        );
+        if ((taken[pos[j] >> 3] & (1 << (pos[j] & 7))) != 0) {
+          ok = false;
+        }
+        for (l = 0; l < j && ok; ++l) {
+          ok = pos[l] != pos[j];
+        }
+      }
+      if (ok) {
+        break;
+      }
+    }
+    if (pilot > U_MPHF_MAX_PILOT) {
+      return false;
+    }
+    for (j = 0; j < size; ++j) {
+      taken[pos[j] >> 3] |= (ubyte_t) (1 << (pos[j] & 7));
+    }
+    mphf->pilots[b] = (u16_t) pilot;
+  }
+
+  /* Slots past n are remapped onto the free slots below n */
+  j = 0;
+  for (i = mphf->n; i < mphf->m; ++i) {
+    if ((taken[i >> 3] & (1 << (i & 7))) != 0) {
+      while ((taken[j >> 3] & (1 << (j & 7))) != 0) {
+        ++j;
+      }
+      mphf->remap[i - mphf->n] = (u32_t) j++;
+    }
+  }
+  return true;
+}
+
+mphf_t *
+u_mphf_build(const byte_t *const *keys, size_t n) {
+  mphf_t *ret;
+  u64_t *base, *hashes;
+  u32_t *order, *bucket_order;
+  size_t *bucket_start, *pos;
+  ubyte_t *taken;
+  size_t i;
+  bool ok, collision;
+
+  if (U_UNLIKELY (keys == NULL || n == 0 || n >= U_MAXUINT32 / 2)) {
+    return NULL;
+  }
+  if (U_UNLIKELY ((ret = u_malloc0(sizeof(mphf_t))) == NULL)) {
+    U_ERROR ("mphf_t::u_mphf_build: failed(1) to allocate memory");
+    return NULL;
+  }
+  ret->n = n;
+  ret->m = n + n / 32 + 1;
+  ret->nbuckets = n / U_MPHF_BUCKET_LOAD + 1;
+  ret->pilots = u_malloc0(ret->nbuckets * sizeof(u16_t));
+  ret->remap = u_malloc0((ret->m - n) * sizeof(u32_t));
+  base = u_malloc(n * sizeof(u64_t));
+  hashes = u_malloc(n * sizeof(u64_t));
+  order = u_malloc(n * sizeof(u32_t));
+  bucket_order = u_malloc(ret->nbuckets * sizeof(u32_t));
+  bucket_start = u_malloc((ret->nbuckets + 1) * sizeof(size_t));
+  pos = u_malloc(n * sizeof(size_t));
+  taken = u_malloc((ret->m + 7) / 8);
+  ok = ret->pilots != NULL && ret->remap != NULL && base != NULL
+    && hashes != NULL && order != NULL && bucket_order != NULL
+    && bucket_start != NULL && pos != NULL && taken != NULL;
+  if (U_UNLIKELY (ok == false)) {
+    U_ERROR ("mphf_t::u_mphf_build: failed(2) to allocate memory");
+  } else {
+    for (i = 0; i < n && ok; ++i) {
+      if (U_UNLIKELY (keys[i] == NULL)) {
+        ok = false;
+      } else {
+        base[i] = (u64_t) u_htable_bytes_hash(keys[i], strlen(keys[i]));
+      }
+    }
+  }
+  collision = false;
+  if (ok) {
+    for (i = 0; i < U_MPHF_MAX_SEEDS; ++i) {
+      ret->seed = pp_mphf_mix(0x9E3779B97F4A7C15ULL * (i + 1));
+      if ((ok = pp_mphf_try_seed(ret, base, hashes, order, bucket_start,
+        bucket_order, taken, pos, &collision)) || collision) {
+        break;
+      }
+    }
+    if (U_UNLIKELY (collision)) {
+      U_WARNING ("mphf_t::u_mphf_build: duplicate keys in the set");
+    }
+  }
+  u_free(taken);
+  u_free(pos);
+  u_free(bucket_start);
+  u_free(bucket_order);
+  u_free(order);
+  u_free(hashes);
+  u_free(base);
+  if (U_UNLIKELY (ok == false)) {
+    u_mphf_free(ret);
+    return NULL;
+  }
+  return ret;
+}
+
+size_t
+u_mphf_lookup(const mphf_t *mphf, const byte_t *key) {
+  u64_t hash;
+  size_t pos;
+
+  if (U_UNLIKELY (mphf == NULL || key == NULL)) {
+    return 0;
+  }
+  hash = pp_mphf_mix(
+    (u64_t) u_htable_bytes_hash(key, strlen(key)) ^ mphf->seed
+  );
+  pos = pp_mphf_range(pp_mphf_mix(hash ^ pp_mphf_mix(
+    mphf->seed + mphf->pilots[pp_mphf_range(hash, mphf->nbuckets)]
+  )), mphf->m);
+  return pos < mphf->n ? pos : mphf->remap[pos - mphf->n];
+}
+
+size_t
+u_mphf_get_size(const mphf_t *mphf) {
+  if (U_UNLIKELY (mphf == NULL)) {
+    return 0;
+  }
+  return mphf->n;
+}
+
+void
+u_mphf_free(mphf_t *mphf) {
+  if (U_UNLIKELY (mphf == NULL)) {
+    return;
+  }
+  u_free(mphf->pilots);
+  u_free(mphf->remap);
+  u_free(mphf);
+}
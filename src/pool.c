@@ -0,0 +1,481 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Magazine allocator, see "Magazines and Vmem: Extending the Slab Allocator
+ * to Many CPUs and Arbitrary Resources" by Jeff Bonwick and Jonathan Adams.
+ *
+ * A thread cache keeps two magazines: the loaded one serves the requests and
+ * the previous one is always either full or empty, so a thread can alternate
+ * between allocations and releases without going to the depot. Caches live in
+ * per-thread records found through a single thread-local key. Pools are
+ * registered with unique IDs, which lets a cache outlive its pool safely: an
+ * exiting thread returns its magazines only to the pools which are still
+ * registered, and drops the caches of the freed ones. */
+
+#include <string.h>
+
+#include "unic/mem.h"
+#include "unic/pool.h"
+#include "unic/spinlock.h"
+#include "unic/thread.h"
+
+/* Object alignment, also the size of a chunk header */
+#define U_POOL_ALIGNMENT 8
+
+/* Approximate size of a chunk in bytes */
+#define U_POOL_CHUNK_SIZE 16384
+
+typedef struct pool_magazine pool_magazine_t;
+typedef struct pool_cache pool_cache_t;
+typedef struct pool_record pool_record_t;
+
+struct pool_magazine {
+  pool_magazine_t *next;
+  int count;
+  ptr_t objects[U_POOL_MAGAZINE_SIZE];
+};
+
+struct pool_cache {
+  pool_cache_t *next;
+  uint_t id;
+  pool_magazine_t *loaded;
+  pool_magazine_t *previous;
+};
+
+struct pool_record {
+  pool_record_t *next;
+  pool_cache_t *caches;
+  bool in_use;
+};
+
+struct pool {
+  pool_t *next;
+  uint_t id;
+  size_t object_size;
+  size_t chunk_objects;
+  spinlock_t *lock;
+  pool_magazine_t *full;
+  pool_magazine_t *empty;
+  ptr_t free_objects;
+  ptr_t chunks;
+  byte_t *cur;
+  byte_t *end;
+};
+
+/* Guards the pool registry and the thread records */
+static spinlock_t *pp_pool_lock = NULL;
+static pool_t *pp_pool_list = NULL;
+static pool_record_t *pp_pool_records = NULL;
+static uint_t pp_pool_last_id = 0;
+static thread_key_t *pp_pool_key = NULL;
+
+static pool_t *
+pp_pool_find(uint_t id);
+
+static void
+pp_pool_cache_free(pool_cache_t *cache);
+
+static void
+pp_pool_cache_flush(pool_t *pool, pool_cache_t *cache);
+
+static void
+pp_pool_thread_exit(ptr_t data);
+
+static pool_record_t *
+pp_pool_get_record(void);
+
+static pool_cache_t *
+pp_pool_get_cache(pool_t *pool);
+
+static int
+pp_pool_fill(pool_t *pool, pool_magazine_t *magazine);
+
+static pool_t *
+pp_pool_find(uint_t id) {
+  pool_t *pool;
+
+  for (pool = pp_pool_list; pool != NULL; pool = pool->next) {
+    if (pool->id == id) {
+      break;
+    }
+  }
+  return pool;
+}
+
+static void
+pp_pool_cache_free(pool_cache_t *cache) {
+  u_free(cache->loaded);
+  u_free(cache->previous);
+  u_free(cache);
+}
+
+static void
+pp_pool_cache_flush(pool_t *pool, pool_cache_t *cache) {
+  pool_magazine_t *magazine;
+  int i;
+
+  /* The objects go to the free list, the magazines to the depot */
+  u_spinlock_lock(pool->lock);
+  for (magazine = cache->loaded; magazine != NULL;) {
+    for (i = 0; i < magazine->count; ++i) {
+      *((ptr_t *) magazine->objects[i]) = pool->free_objects;
+      pool->free_objects = magazine->objects[i];
+    }
+    magazine->count = 0;
+    magazine->next = pool->empty;
+    pool->empty = magazine;
+    magazine = magazine == cache->loaded ? cache->previous : NULL;
+  }
+  u_spinlock_unlock(pool->lock);
+  cache->loaded = NULL;
+  cache->previous = NULL;
+}
+
+static void
+pp_pool_thread_exit(ptr_t data) {
+  pool_record_t *record;
+  pool_cache_t *cache, *next;
+  pool_t *pool;
+
+  record = (pool_record_t *) data;
+  u_spinlock_lock(pp_pool_lock);
+  for (cache = record->caches; cache != NULL; cache = next) {
+    next = cache->next;
+    if ((pool = pp_pool_find(cache->id)) != NULL) {
+      pp_pool_cache_flush(pool, cache);
+    }
+    pp_pool_cache_free(cache);
+  }
+  record->caches = NULL;
+  record->in_use = false;
+  u_spinlock_unlock(pp_pool_lock);
+}
+
+static pool_record_t *
+pp_pool_get_record(void) {
+  pool_record_t *record;
+
+  if (U_LIKELY ((record = u_thread_get_local(pp_pool_key)) != NULL)) {
+    return record;
+  }
+  u_spinlock_lock(pp_pool_lock);
+  for (record = pp_pool_records; record != NULL; record = record->next) {
+    if (!record->in_use) {
+      break;
+    }
+  }
+  if (record == NULL) {
+    if (U_UNLIKELY ((record = u_malloc0(sizeof(pool_record_t))) == NULL)) {
+      u_spinlock_unlock(pp_pool_lock);
+      return NULL;
+    }
+    record->next = pp_pool_records;
+    pp_pool_records = record;
+  }
+  record->in_use = true;
+  u_spinlock_unlock(pp_pool_lock);
+  u_thread_set_local(pp_pool_key, record);
+  return record;
+}
+
+static pool_cache_t *
+pp_pool_get_cache(pool_t *pool) {
+  pool_record_t *record;
+  pool_cache_t *cache, **link;
+
+  if (U_UNLIKELY ((record = pp_pool_get_record()) == NULL)) {
+    return NULL;
+  }
+
+  /* The most recently used cache is kept first */
+  cache = record->caches;
+  if (U_LIKELY (cache != NULL && cache->id == pool->id)) {
+    return cache;
+  }
+  u_spinlock_lock(pp_pool_lock);
+  for (link = &record->caches; (cache = *link) != NULL;) {
+    if (cache->id == pool->id) {
+      *link = cache->next;
+      break;
+    }
+
+    /* Drop the caches of the freed pools on the way */
+    if (pp_pool_find(cache->id) == NULL) {
+      *link = cache->next;
+      pp_pool_cache_free(cache);
+    } else {
+      link = &cache->next;
+    }
+  }
+  u_spinlock_unlock(pp_pool_lock);
+  if (cache == NULL) {
+    if (U_UNLIKELY ((cache = u_malloc0(sizeof(pool_cache_t))) == NULL)) {
+      return NULL;
+    }
+    cache->id = pool->id;
+    cache->loaded = u_malloc0(sizeof(pool_magazine_t));
+    cache->previous = u_malloc0(sizeof(pool_magazine_t));
+    if (U_UNLIKELY (cache->loaded == NULL || cache->previous == NULL)) {
+      pp_pool_cache_free(cache);
+      return NULL;
+    }
+  }
+  cache->next = record->caches;
+  record->caches = cache;
+  return cache;
+}
+
+static int
+pp_pool_fill(pool_t *pool, pool_magazine_t *magazine) {
+  ptr_t chunk;
+
+  /* Called with the pool lock held */
+  while (magazine->count < U_POOL_MAGAZINE_SIZE && pool->free_objects != NULL) {
+    magazine->objects[magazine->count++] = pool->free_objects;
+    pool->free_objects = *((ptr_t *) pool->free_objects);
+  }
+  if (magazine->count == 0 && pool->cur == pool->end) {
+    chunk = u_malloc(
+      U_POOL_ALIGNMENT + pool->chunk_objects * pool->object_size);
+    if (U_UNLIKELY (chunk == NULL)) {
+      return 0;
+    }
+    *((ptr_t *) chunk) = pool->chunks;
+    pool->chunks = chunk;
+    pool->cur = (byte_t *) chunk + U_POOL_ALIGNMENT;
+    pool->end = pool->cur + pool->chunk_objects * pool->object_size;
+  }
+  while (magazine->count < U_POOL_MAGAZINE_SIZE && pool->cur < pool->end) {
+    magazine->objects[magazine->count++] = pool->cur;
+    pool->cur += pool->object_size;
+  }
+  return magazine->count;
+}
+
+pool_t *
+u_pool_new(size_t object_size) {
+  pool_t *ret;
+
+  if (U_UNLIKELY (object_size == 0 || pp_pool_lock == NULL)) {
+    return NULL;
+  }
+  if (U_UNLIKELY ((ret = u_malloc0(sizeof(pool_t))) == NULL)) {
+    U_ERROR ("pool_t::u_pool_new: failed to allocate memory");
+    return NULL;
+  }
+  if (U_UNLIKELY ((ret->lock = u_spinlock_new()) == NULL)) {
+    U_ERROR ("pool_t::u_pool_new: failed to create spinlock");
+    u_free(ret);
+    return NULL;
+  }
+  if (object_size < sizeof(ptr_t)) {
+    object_size = sizeof(ptr_t);
+  }
+  ret->object_size = (object_size + U_POOL_ALIGNMENT - 1)
+    & ~((size_t) U_POOL_ALIGNMENT - 1);
+  ret->chunk_objects = U_POOL_CHUNK_SIZE / ret->object_size;
+  if (ret->chunk_objects < U_POOL_MAGAZINE_SIZE) {
+    ret->chunk_objects = U_POOL_MAGAZINE_SIZE;
+  }
+  u_spinlock_lock(pp_pool_lock);
+  ret->id = ++pp_pool_last_id;
+  ret->next = pp_pool_list;
+  pp_pool_list = ret;
+  u_spinlock_unlock(pp_pool_lock);
+  return ret;
+}
+
+ptr_t
+u_pool_alloc(pool_t *pool) {
+  pool_cache_t *cache;
+  pool_magazine_t *magazine;
+
+  if (U_UNLIKELY (pool == NULL)) {
+    return NULL;
+  }
+  if (U_UNLIKELY ((cache = pp_pool_get_cache(pool)) == NULL)) {
+    U_ERROR ("pool_t::u_pool_alloc: failed to allocate memory");
+    return NULL;
+  }
+  if (U_LIKELY (cache->loaded->count > 0)) {
+    return cache->loaded->objects[--cache->loaded->count];
+  }
+  if (cache->previous->count > 0) {
+    magazine = cache->loaded;
+    cache->loaded = cache->previous;
+    cache->previous = magazine;
+    return cache->loaded->objects[--cache->loaded->count];
+  }
+
+  /* Both magazines are empty: take a full one from the depot, or fill the
+   * loaded one with free or new objects */
+  u_spinlock_lock(pool->lock);
+  if (pool->full != NULL) {
+    magazine = pool->full;
+    pool->full = magazine->next;
+    cache->previous->next = pool->empty;
+    pool->empty = cache->previous;
+    cache->previous = cache->loaded;
+    cache->loaded = magazine;
+  } else if (U_UNLIKELY (pp_pool_fill(pool, cache->loaded) == 0)) {
+    u_spinlock_unlock(pool->lock);
+    U_ERROR ("pool_t::u_pool_alloc: failed to allocate memory");
+    return NULL;
+  }
+  u_spinlock_unlock(pool->lock);
+  return cache->loaded->objects[--cache->loaded->count];
+}
+
+ptr_t
+u_pool_alloc0(pool_t *pool) {
+  ptr_t ret;
+
+  if (U_LIKELY ((ret = u_pool_alloc(pool)) != NULL)) {
+    memset(ret, 0, pool->object_size);
+  }
+  return ret;
+}
+
+void
+u_pool_release(pool_t *pool, ptr_t obj) {
+  pool_cache_t *cache;
+  pool_magazine_t *magazine;
+
+  if (U_UNLIKELY (pool == NULL || obj == NULL)) {
+    return;
+  }
+  if (U_UNLIKELY ((cache = pp_pool_get_cache(pool)) == NULL)) {
+    /* Keep the object in the depot then */
+    u_spinlock_lock(pool->lock);
+    *((ptr_t *) obj) = pool->free_objects;
+    pool->free_objects = obj;
+    u_spinlock_unlock(pool->lock);
+    return;
+  }
+  if (U_LIKELY (cache->loaded->count < U_POOL_MAGAZINE_SIZE)) {
+    cache->loaded->objects[cache->loaded->count++] = obj;
+    return;
+  }
+  if (cache->previous->count == 0) {
+    magazine = cache->loaded;
+    cache->loaded = cache->previous;
+    cache->previous = magazine;
+    cache->loaded->objects[cache->loaded->count++] = obj;
+    return;
+  }
+
+  /* Both magazines are full: pass one to the depot for an empty one */
+  u_spinlock_lock(pool->lock);
+  if ((magazine = pool->empty) != NULL) {
+    pool->empty = magazine->next;
+  }
+  u_spinlock_unlock(pool->lock);
+  if (magazine == NULL
+    && (magazine = u_malloc0(sizeof(pool_magazine_t))) == NULL) {
+    u_spinlock_lock(pool->lock);
+    *((ptr_t *) obj) = pool->free_objects;
+    pool->free_objects = obj;
+    u_spinlock_unlock(pool->lock);
+    return;
+  }
+  u_spinlock_lock(pool->lock);
+  cache->previous->next = pool->full;
+  pool->full = cache->previous;
+  u_spinlock_unlock(pool->lock);
+  cache->previous = cache->loaded;
+  cache->loaded = magazine;
+  magazine->count = 0;
+  magazine->objects[magazine->count++] = obj;
+}
+
+void
+u_pool_free(pool_t *pool) {
+  pool_record_t *record;
+  pool_cache_t *cache, **link;
+  pool_magazine_t *magazine, *next;
+  ptr_t chunk, next_chunk;
+  pool_t **pool_link;
+
+  if (U_UNLIKELY (pool == NULL)) {
+    return;
+  }
+  u_spinlock_lock(pp_pool_lock);
+  for (pool_link = &pp_pool_list; *pool_link != NULL;
+    pool_link = &(*pool_link)->next) {
+    if (*pool_link == pool) {
+      *pool_link = pool->next;
+      break;
+    }
+  }
+  u_spinlock_unlock(pp_pool_lock);
+
+  /* Caches of the other threads are dropped lazily */
+  if ((record = u_thread_get_local(pp_pool_key)) != NULL) {
+    for (link = &record->caches; (cache = *link) != NULL;
+      link = &cache->next) {
+      if (cache->id == pool->id) {
+        *link = cache->next;
+        pp_pool_cache_free(cache);
+        break;
+      }
+    }
+  }
+  for (magazine = pool->full; magazine != NULL; magazine = next) {
+    next = magazine->next;
+    u_free(magazine);
+  }
+  for (magazine = pool->empty; magazine != NULL; magazine = next) {
+    next = magazine->next;
+    u_free(magazine);
+  }
+  for (chunk = pool->chunks; chunk != NULL; chunk = next_chunk) {
+    next_chunk = *((ptr_t *) chunk);
+    u_free(chunk);
+  }
+  u_spinlock_free(pool->lock);
+  u_free(pool);
+}
+
+void
+u_pool_init(void) {
+  if (U_LIKELY (pp_pool_key == NULL)) {
+    pp_pool_key = u_thread_local_new(pp_pool_thread_exit);
+    pp_pool_lock = u_spinlock_new();
+  }
+}
+
+void
+u_pool_shutdown(void) {
+  pool_record_t *record, *next;
+  pool_cache_t *cache, *next_cache;
+
+  /* No thread may use the pools anymore */
+  for (record = pp_pool_records; record != NULL; record = next) {
+    next = record->next;
+    for (cache = record->caches; cache != NULL; cache = next_cache) {
+      next_cache = cache->next;
+      pp_pool_cache_free(cache);
+    }
+    u_free(record);
+  }
+  pp_pool_records = NULL;
+  pp_pool_list = NULL;
+  u_thread_local_free(pp_pool_key);
+  pp_pool_key = NULL;
+  u_spinlock_free(pp_pool_lock);
+  pp_pool_lock = NULL;
+}
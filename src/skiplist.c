@@ -0,0 +1,587 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Lock-free skip list after Herlihy and Shavit.
+ *
+ * Every level is a sorted lock-free linked list, a removed node is first
+ * marked in all of its levels from the top down, and the mark on the lowest
+ * level is the point of removal. Searches unlink the marked nodes they pass.
+ *
+ * A node can be unlinked from the lower levels while its inserter is still
+ * linking the upper ones, so both the inserter and the remover hold a node
+ * reference. The last one to drop it runs another search which unlinks the
+ * node from all the levels, after that nobody can link it again and the node
+ * is handed over to the epoch reclamation. */
+
+#include "unic/atomic.h"
+#include "unic/mem.h"
+#include "unic/skiplist.h"
+#include "epoch-private.h"
+
+/* Every level holds about a quarter of the nodes of the level below, which
+ * gives 1.33 links per node on average and is enough for 2^32 nodes */
+#define U_SKIPLIST_MAX_HEIGHT 16
+
+/* Logical deletion mark kept in the lowest bit of the next pointers */
+#define U_SKIPLIST_MARK ((uptr_t) 1)
+
+#define U_SKIPLIST_IS_MARKED(ptr) (((uptr_t) (ptr) & U_SKIPLIST_MARK) != 0)
+#define U_SKIPLIST_UNMARK(ptr) \
+  ((skiplist_node_t *) ((uptr_t) (ptr) & ~U_SKIPLIST_MARK))
+
+typedef struct skiplist_node skiplist_node_t;
+
+struct skiplist_node {
+  epoch_entry_t entry;
+  ptr_t key;
+  ptr_t value;
+  skiplist_t *list;
+  volatile int ref_count;
+  int height;
+  ptr_t volatile next[1];
+};
+
+struct skiplist {
+  skiplist_node_t *head;
+  volatile int height;
+  volatile int seed;
+  volatile size_t size;
+  volatile int ref_count;
+  cmp_data_fn_t compare_func;
+  ptr_t data;
+  destroy_fn_t key_destroy_func;
+  destroy_fn_t value_destroy_func;
+};
+
+static int
+pp_skiplist_random_height(skiplist_t *list);
+
+static skiplist_node_t *
+pp_skiplist_node_new(int height);
+
+static bool
+pp_skiplist_find(skiplist_t *list, const_ptr_t key, skiplist_node_t **preds,
+  skiplist_node_t **succs);
+
+static skiplist_node_t *
+pp_skiplist_seek(skiplist_t *list, const_ptr_t key, bool *found);
+
+static skiplist_node_t *
+pp_skiplist_next(skiplist_node_t *node);
+
+static void
+pp_skiplist_unref(skiplist_t *list);
+
+static void
+pp_skiplist_node_free(ptr_t data);
+
+static void
+pp_skiplist_release(skiplist_t *list, skiplist_node_t *node);
+
+static int
+pp_skiplist_random_height(skiplist_t *list) {
+  u32_t bits;
+  int height;
+
+  /* A counter scrambled with the MurmurHash3 finalizer, the only shared
+   * state is the counter itself */
+  bits = (u32_t) u_atomic_int_add(&list->seed, 1);
+  bits ^= bits >> 16;
+  bits *= 0x85EBCA6BU;
+  bits ^= bits >> 13;
+  bits *= 0xC2B2AE35U;
+  bits ^= bits >> 16;
+  for (height = 1; height < U_SKIPLIST_MAX_HEIGHT && (bits & 3) == 0;
+    ++height) {
+    bits >>= 2;
+  }
+  return height;
+}
+
+static skiplist_node_t *
+pp_skiplist_node_new(int height) {
+  skiplist_node_t *ret;
+
+  ret = u_malloc0(sizeof(skiplist_node_t) + (height - 1) * sizeof(ptr_t));
+  if (U_UNLIKELY (ret == NULL)) {
+    return NULL;
+  }
+  ret->height = height;
+  return ret;
+}
+
+static bool
+pp_skiplist_find(skiplist_t *list, const_ptr_t key, skiplist_node_t **preds,
+  skiplist_node_t **succs) {
+  skiplist_node_t *pred, *cur;
+  ptr_t next;
+  int level, cmp_result;
+
+retry:
+  pred = list->head;
+  cur = NULL;
+  cmp_result = 1;
+  for (level = u_atomic_int_get(&list->height) - 1; level >= 0; --level) {
+    cur = U_SKIPLIST_UNMARK (u_atomic_pointer_get(&pred->next[level]));
+    for (;;) {
+      if (cur == NULL) {
+        break;
+      }
+      next = u_atomic_pointer_get(&cur->next[level]);
+      if (U_SKIPLIST_IS_MARKED (next)) {
+        /* Help to unlink the logically removed node */
+        if (!u_atomic_pointer_compare_and_exchange(
+          &pred->next[level], cur, U_SKIPLIST_UNMARK (next))) {
+          goto retry;
+        }
+        cur = U_SKIPLIST_UNMARK (next);
+        continue;
+      }
+      if ((cmp_result = list->compare_func(key, cur->key, list->data)) <= 0) {
+        break;
+      }
+      pred = cur;
+      cur = (skiplist_node_t *) next;
+    }
+    preds[level] = pred;
+    succs[level] = cur;
+  }
+  return cur != NULL && cmp_result == 0;
+}
+
+static skiplist_node_t *
+pp_skiplist_seek(skiplist_t *list, const_ptr_t key, bool *found) {
+  skiplist_node_t *pred, *cur, *stop;
+  ptr_t next;
+  int level, cmp_result, stop_result;
+
+  /* Read-only search, removed nodes are skipped rather than unlinked. The
+   * node which stopped the search on the level above is not compared again,
+   * lower levels often stop right at it */
+  pred = list->head;
+  cur = NULL;
+  stop = NULL;
+  stop_result = 1;
+  for (level = u_atomic_int_get(&list->height) - 1; level >= 0; --level) {
+    cur = U_SKIPLIST_UNMARK (u_atomic_pointer_get(&pred->next[level]));
+    while (cur != NULL) {
+      next = u_atomic_pointer_get(&cur->next[level]);
+      if (U_SKIPLIST_IS_MARKED (next)) {
+        cur = U_SKIPLIST_UNMARK (next);
+        continue;
+      }
+      if (cur == stop) {
+        break;
+      }
+      if ((cmp_result = list->compare_func(key, cur->key, list->data)) <= 0) {
+        stop = cur;
+        stop_result = cmp_result;
+        break;
+      }
+      pred = cur;
+      cur = (skiplist_node_t *) next;
+    }
+  }
+  if (found != NULL) {
+    *found = cur != NULL && stop_result == 0;
+  }
+  return cur;
+}
+
+static skiplist_node_t *
+pp_skiplist_next(skiplist_node_t *node) {
+  skiplist_node_t *cur;
+  ptr_t next;
+
+  cur = U_SKIPLIST_UNMARK (u_atomic_pointer_get(&node->next[0]));
+  while (cur != NULL) {
+    next = u_atomic_pointer_get(&cur->next[0]);
+    if (!U_SKIPLIST_IS_MARKED (next)) {
+      break;
+    }
+    cur = U_SKIPLIST_UNMARK (next);
+  }
+  return cur;
+}
+
+static void
+pp_skiplist_unref(skiplist_t *list) {
+  if (u_atomic_int_dec_and_test(&list->ref_count)) {
+    u_free(list);
+  }
+}
+
+static void
+pp_skiplist_node_free(ptr_t data) {
+  skiplist_node_t *node;
+  skiplist_t *list;
+
+  node = (skiplist_node_t *) data;
+  list = node->list;
+  if (list->key_destroy_func != NULL) {
+    list->key_destroy_func(node->key);
+  }
+  if (list->value_destroy_func != NULL) {
+    list->value_destroy_func(node->value);
+  }
+  u_free(node);
+  pp_skiplist_unref(list);
+}
+
+static void
+pp_skiplist_release(skiplist_t *list, skiplist_node_t *node) {
+  skiplist_node_t *preds[U_SKIPLIST_MAX_HEIGHT];
+  skiplist_node_t *succs[U_SKIPLIST_MAX_HEIGHT];
+
+  if (!u_atomic_int_dec_and_test(&node->ref_count)) {
+    return;
+  }
+
+  /* The node is marked in all the levels and nobody links it anymore: the
+   * search passes it in every level where it is still linked */
+  pp_skiplist_find(list, node->key, preds, succs);
+
+  /* Retired nodes keep the list alive for their destroy functions */
+  u_atomic_int_inc(&list->ref_count);
+  node->list = list;
+  u_epoch_retire(&node->entry, pp_skiplist_node_free);
+}
+
+skiplist_t *
+u_skiplist_new(cmp_fn_t func) {
+  return u_skiplist_new_full((cmp_data_fn_t) func, NULL, NULL, NULL);
+}
+
+skiplist_t *
+u_skiplist_new_full(cmp_data_fn_t func, ptr_t data, destroy_fn_t key_destroy,
+  destroy_fn_t value_destroy) {
+  skiplist_t *ret;
+
+  if (U_UNLIKELY (func == NULL)) {
+    return NULL;
+  }
+  if (U_UNLIKELY ((ret = u_malloc0(sizeof(skiplist_t))) == NULL)) {
+    U_ERROR ("skiplist_t::u_skiplist_new_full: failed(1) to allocate memory");
+    return NULL;
+  }
+  if (U_UNLIKELY (
+    (ret->head = pp_skiplist_node_new(U_SKIPLIST_MAX_HEIGHT)) == NULL)) {
+    U_ERROR ("skiplist_t::u_skiplist_new_full: failed(2) to allocate memory");
+    u_free(ret);
+    return NULL;
+  }
+  ret->height = 1;
+  ret->ref_count = 1;
+  ret->compare_func = func;
+  ret->data = data;
+  ret->key_destroy_func = key_destroy;
+  ret->value_destroy_func = value_destroy;
+  return ret;
+}
+
+bool
+u_skiplist_insert(skiplist_t *list, ptr_t key, ptr_t value) {
+  skiplist_node_t *preds[U_SKIPLIST_MAX_HEIGHT];
+  skiplist_node_t *succs[U_SKIPLIST_MAX_HEIGHT];
+  skiplist_node_t *node;
+  ptr_t next;
+  int height, list_height, level;
+
+  if (U_UNLIKELY (list == NULL)) {
+    return false;
+  }
+  height = pp_skiplist_random_height(list);
+  if (U_UNLIKELY ((node = pp_skiplist_node_new(height)) == NULL)) {
+    U_ERROR ("skiplist_t::u_skiplist_insert: failed to allocate memory");
+    return false;
+  }
+  if (U_UNLIKELY (u_epoch_enter() == false)) {
+    u_free(node);
+    return false;
+  }
+  node->key = key;
+  node->value = value;
+
+  /* One reference for the inserter, one for the remover */
+  node->ref_count = 2;
+
+  /* Raise the list height first, so the searches cover all the levels of
+   * the node */
+  do {
+    list_height = u_atomic_int_get(&list->height);
+  } while (list_height < height && !u_atomic_int_compare_and_exchange(
+    &list->height, list_height, height));
+  for (;;) {
+    if (pp_skiplist_find(list, key, preds, succs)) {
+      u_epoch_leave();
+      u_free(node);
+      return false;
+    }
+    for (level = 0; level < height; ++level) {
+      node->next[level] = succs[level];
+    }
+    if (u_atomic_pointer_compare_and_exchange(
+      &preds[0]->next[0], succs[0], node)) {
+      break;
+    }
+  }
+  u_atomic_pointer_add(&list->size, 1);
+
+  /* The pair is in the list now, link the upper levels as shortcuts and give
+   * up as soon as the node gets removed */
+  for (level = 1; level < height; ++level) {
+    for (;;) {
+      next = u_atomic_pointer_get(&node->next[level]);
+      if (U_SKIPLIST_IS_MARKED (next)) {
+        goto done;
+      }
+      if (next != succs[level] && !u_atomic_pointer_compare_and_exchange(
+        &node->next[level], next, succs[level])) {
+        continue;
+      }
+      if (u_atomic_pointer_compare_and_exchange(
+        &preds[level]->next[level], succs[level], node)) {
+        break;
+      }
+      if (!pp_skiplist_find(list, key, preds, succs) || succs[0] != node) {
+        goto done;
+      }
+    }
+  }
+done:
+  pp_skiplist_release(list, node);
+  u_epoch_leave();
+  return true;
+}
+
+ptr_t
+u_skiplist_lookup(skiplist_t *list, const_ptr_t key) {
+  skiplist_node_t *node;
+  ptr_t ret;
+  bool found;
+
+  if (U_UNLIKELY (list == NULL)) {
+    return NULL;
+  }
+  if (U_UNLIKELY (u_epoch_enter() == false)) {
+    return (ptr_t) -1;
+  }
+  node = pp_skiplist_seek(list, key, &found);
+  ret = found ? node->value : (ptr_t) -1;
+  u_epoch_leave();
+  return ret;
+}
+
+bool
+u_skiplist_remove(skiplist_t *list, const_ptr_t key) {
+  skiplist_node_t *preds[U_SKIPLIST_MAX_HEIGHT];
+  skiplist_node_t *succs[U_SKIPLIST_MAX_HEIGHT];
+  skiplist_node_t *node;
+  ptr_t next;
+  int level;
+
+  if (U_UNLIKELY (list == NULL)) {
+    return false;
+  }
+  if (U_UNLIKELY (u_epoch_enter() == false)) {
+    return false;
+  }
+  for (;;) {
+    if (!pp_skiplist_find(list, key, preds, succs)) {
+      u_epoch_leave();
+      return false;
+    }
+    node = succs[0];
+
+    /* Freeze the upper levels, the order matters: a node marked in the
+     * lowest level must be marked everywhere */
+    for (level = node->height - 1; level > 0; --level) {
+      do {
+        next = u_atomic_pointer_get(&node->next[level]);
+      } while (!U_SKIPLIST_IS_MARKED (next)
+        && !u_atomic_pointer_compare_and_exchange(&node->next[level], next,
+          (ptr_t) ((uptr_t) next | U_SKIPLIST_MARK)));
+    }
+
+    /* Only one thread succeeds, the others search again */
+    next = u_atomic_pointer_get(&node->next[0]);
+    while (!U_SKIPLIST_IS_MARKED (next)) {
+      if (u_atomic_pointer_compare_and_exchange(&node->next[0], next,
+        (ptr_t) ((uptr_t) next | U_SKIPLIST_MARK))) {
+        u_atomic_pointer_add(&list->size, -1);
+        pp_skiplist_release(list, node);
+        u_epoch_leave();
+        return true;
+      }
+      next = u_atomic_pointer_get(&node->next[0]);
+    }
+  }
+}
+
+bool
+u_skiplist_lower_bound(skiplist_t *list, const_ptr_t key, ptr_t *found_key,
+  ptr_t *value) {
+  skiplist_node_t *node;
+
+  if (U_UNLIKELY (list == NULL)) {
+    return false;
+  }
+  if (U_UNLIKELY (u_epoch_enter() == false)) {
+    return false;
+  }
+  if ((node = pp_skiplist_seek(list, key, NULL)) != NULL) {
+    if (found_key != NULL) {
+      *found_key = node->key;
+    }
+    if (value != NULL) {
+      *value = node->value;
+    }
+  }
+  u_epoch_leave();
+  return node != NULL;
+}
+
+bool
+u_skiplist_min(skiplist_t *list, ptr_t *key, ptr_t *value) {
+  skiplist_node_t *node;
+
+  if (U_UNLIKELY (list == NULL)) {
+    return false;
+  }
+  if (U_UNLIKELY (u_epoch_enter() == false)) {
+    return false;
+  }
+  if ((node = pp_skiplist_next(list->head)) != NULL) {
+    if (key != NULL) {
+      *key = node->key;
+    }
+    if (value != NULL) {
+      *value = node->value;
+    }
+  }
+  u_epoch_leave();
+  return node != NULL;
+}
+
+bool
+u_skiplist_max(skiplist_t *list, ptr_t *key, ptr_t *value) {
+  skiplist_node_t *pred, *cur;
+  ptr_t next;
+  int level;
+
+  if (U_UNLIKELY (list == NULL)) {
+    return false;
+  }
+  if (U_UNLIKELY (u_epoch_enter() == false)) {
+    return false;
+  }
+
+  /* Go as far to the right as possible on every level */
+  pred = list->head;
+  for (level = u_atomic_int_get(&list->height) - 1; level >= 0; --level) {
+    cur = U_SKIPLIST_UNMARK (u_atomic_pointer_get(&pred->next[level]));
+    while (cur != NULL) {
+      next = u_atomic_pointer_get(&cur->next[level]);
+      if (!U_SKIPLIST_IS_MARKED (next)) {
+        pred = cur;
+      }
+      cur = U_SKIPLIST_UNMARK (next);
+    }
+  }
+  if (pred != list->head) {
+    if (key != NULL) {
+      *key = pred->key;
+    }
+    if (value != NULL) {
+      *value = pred->value;
+    }
+  }
+  u_epoch_leave();
+  return pred != list->head;
+}
+
+void
+u_skiplist_foreach(skiplist_t *list, traverse_fn_t traverse_func,
+  ptr_t user_data) {
+  skiplist_node_t *node;
+
+  if (U_UNLIKELY (list == NULL || traverse_func == NULL)) {
+    return;
+  }
+  if (U_UNLIKELY (u_epoch_enter() == false)) {
+    return;
+  }
+  for (node = pp_skiplist_next(list->head); node != NULL;
+    node = pp_skiplist_next(node)) {
+    if (traverse_func(node->key, node->value, user_data)) {
+      break;
+    }
+  }
+  u_epoch_leave();
+}
+
+void
+u_skiplist_foreach_from(skiplist_t *list, const_ptr_t key,
+  traverse_fn_t traverse_func, ptr_t user_data) {
+  skiplist_node_t *node;
+
+  if (U_UNLIKELY (list == NULL || traverse_func == NULL)) {
+    return;
+  }
+  if (U_UNLIKELY (u_epoch_enter() == false)) {
+    return;
+  }
+  for (node = pp_skiplist_seek(list, key, NULL); node != NULL;
+    node = pp_skiplist_next(node)) {
+    if (traverse_func(node->key, node->value, user_data)) {
+      break;
+    }
+  }
+  u_epoch_leave();
+}
+
+size_t
+u_skiplist_size(const skiplist_t *list) {
+  if (U_UNLIKELY (list == NULL)) {
+    return 0;
+  }
+  return (size_t) u_atomic_pointer_get(&list->size);
+}
+
+void
+u_skiplist_free(skiplist_t *list) {
+  skiplist_node_t *node, *next;
+
+  if (U_UNLIKELY (list == NULL)) {
+    return;
+  }
+
+  /* Nodes still linked in the lowest level were never retired */
+  node = U_SKIPLIST_UNMARK (list->head->next[0]);
+  for (; node != NULL; node = next) {
+    next = U_SKIPLIST_UNMARK (node->next[0]);
+    if (list->key_destroy_func != NULL) {
+      list->key_destroy_func(node->key);
+    }
+    if (list->value_destroy_func != NULL) {
+      list->value_destroy_func(node->value);
+    }
+    u_free(node);
+  }
+  u_free(list->head);
+  pp_skiplist_unref(list);
+}
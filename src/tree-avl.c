@@ -15,13 +15,13 @@
  * along with this library; if not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "unic/mem.h"
 #include "tree-avl.h"
 
 typedef struct PTreeAVLNode_ {
   struct PTreeBaseNode_ base;
   struct PTreeAVLNode_ *parent;
   int balance_factor;
+  int size;
 } PTreeAVLNode;
 
 static void
@@ -46,6 +46,61 @@ static void
 pp_tree_avl_balance_remove(PTreeAVLNode *node,
   PTreeBaseNode **root);
 
+static bool
+pp_tree_avl_build(PTreeSlab *slab, ptr_t *keys, ptr_t *values, int n,
+  PTreeAVLNode *parent, PTreeBaseNode **node, int *height);
+
+static int
+pp_tree_avl_get_size(PTreeBaseNode *node);
+
+static void
+pp_tree_avl_update_size(PTreeAVLNode *node);
+
+static int
+pp_tree_avl_count(PTreeBaseNode *node);
+
+static bool
+pp_tree_avl_insert(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  ptr_t key,
+  ptr_t value,
+  bool is_ranked);
+
+static bool
+pp_tree_avl_remove(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  const_ptr_t key,
+  bool is_ranked);
+
+static int
+pp_tree_avl_get_size(PTreeBaseNode *node) {
+  return node == NULL ? 0 : ((PTreeAVLNode *) node)->size;
+}
+
+static void
+pp_tree_avl_update_size(PTreeAVLNode *node) {
+  node->size = pp_tree_avl_get_size(node->base.left) +
+    pp_tree_avl_get_size(node->base.right) + 1;
+}
+
+static int
+pp_tree_avl_count(PTreeBaseNode *node) {
+  if (node == NULL) {
+    return 0;
+  }
+  ((PTreeAVLNode *) node)->size = pp_tree_avl_count(node->left) +
+    pp_tree_avl_count(node->right) + 1;
+  return ((PTreeAVLNode *) node)->size;
+}
+
 static void
 pp_tree_avl_rotate_left(PTreeAVLNode *node, PTreeBaseNode **root) {
   node->parent->base.right = node->base.left;
@@ -69,6 +124,10 @@ pp_tree_avl_rotate_left(PTreeAVLNode *node, PTreeBaseNode **root) {
   ((PTreeAVLNode *) node)->balance_factor += 1;
   ((PTreeAVLNode *) node->base.left)->balance_factor =
     -((PTreeAVLNode *) node)->balance_factor;
+
+  /* Restore subtree sizes, the lower node goes first */
+  pp_tree_avl_update_size((PTreeAVLNode *) node->base.left);
+  pp_tree_avl_update_size(node);
 }
 
 static void
@@ -94,6 +153,10 @@ pp_tree_avl_rotate_right(PTreeAVLNode *node, PTreeBaseNode **root) {
   ((PTreeAVLNode *) node)->balance_factor -= 1;
   ((PTreeAVLNode *) node->base.right)->balance_factor =
     -((PTreeAVLNode *) node)->balance_factor;
+
+  /* Restore subtree sizes, the lower node goes first */
+  pp_tree_avl_update_size((PTreeAVLNode *) node->base.right);
+  pp_tree_avl_update_size(node);
 }
 
 static void
@@ -135,6 +198,11 @@ pp_tree_avl_rotate_left_right(PTreeAVLNode *node, PTreeBaseNode **root) {
     ((PTreeAVLNode *) tmp_node->base.right)->balance_factor = 0;
   }
   tmp_node->balance_factor = 0;
+
+  /* Restore subtree sizes, the lower nodes go first */
+  pp_tree_avl_update_size((PTreeAVLNode *) tmp_node->base.left);
+  pp_tree_avl_update_size((PTreeAVLNode *) tmp_node->base.right);
+  pp_tree_avl_update_size(tmp_node);
 }
 
 static void
@@ -176,6 +244,11 @@ pp_tree_avl_rotate_right_left(PTreeAVLNode *node, PTreeBaseNode **root) {
     ((PTreeAVLNode *) tmp_node->base.right)->balance_factor = 0;
   }
   tmp_node->balance_factor = 0;
+
+  /* Restore subtree sizes, the lower nodes go first */
+  pp_tree_avl_update_size((PTreeAVLNode *) tmp_node->base.left);
+  pp_tree_avl_update_size((PTreeAVLNode *) tmp_node->base.right);
+  pp_tree_avl_update_size(tmp_node);
 }
 
 static void
@@ -324,23 +397,66 @@ pp_tree_avl_balance_remove(PTreeAVLNode *node, PTreeBaseNode **root) {
   }
 }
 
-bool
-u_tree_avl_insert(PTreeBaseNode **root_node,
+static bool
+pp_tree_avl_build(PTreeSlab *slab, ptr_t *keys, ptr_t *values, int n,
+  PTreeAVLNode *parent, PTreeBaseNode **node, int *height) {
+  PTreeAVLNode *cur_node;
+  int left_height, right_height, mid;
+
+  if (n == 0) {
+    *height = 0;
+    return true;
+  }
+  mid = (n - 1) / 2;
+  if (U_UNLIKELY ((cur_node = u_tree_slab_alloc(slab)) == NULL)) {
+    return false;
+  }
+  *node = (PTreeBaseNode *) cur_node;
+  cur_node->base.key = keys[mid];
+  cur_node->base.value = values == NULL ? NULL : values[mid];
+  cur_node->parent = parent;
+  cur_node->size = n;
+  if (U_UNLIKELY (!pp_tree_avl_build(slab, keys, values, mid, cur_node,
+    &cur_node->base.left, &left_height))) {
+    return false;
+  }
+  if (U_UNLIKELY (!pp_tree_avl_build(slab, keys + mid + 1,
+    values == NULL ? NULL : values + mid + 1, n - mid - 1, cur_node,
+    &cur_node->base.right, &right_height))) {
+    return false;
+  }
+
+  /* The right half is never smaller, so the factor is either 0 or -1 */
+  cur_node->balance_factor = left_height - right_height;
+  *height = (right_height > left_height ? right_height : left_height) + 1;
+  return true;
+}
+
+size_t
+u_tree_avl_node_size(void) {
+  return sizeof(PTreeAVLNode);
+}
+
+static bool
+pp_tree_avl_insert(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
   cmp_data_fn_t compare_func,
   ptr_t data,
   destroy_fn_t key_destroy_func,
   destroy_fn_t value_destroy_func,
   ptr_t key,
-  ptr_t value) {
+  ptr_t value,
+  bool is_ranked) {
   PTreeBaseNode **cur_node;
   PTreeBaseNode *parent_node;
+  PTreeAVLNode *size_node;
   int cmp_result;
   cur_node = root_node;
   parent_node = *root_node;
 
   /* Find where to insert the node */
   while (*cur_node != NULL) {
-    cmp_result = compare_func(key, (*cur_node)->key, data);
+    cmp_result = U_TREE_COMPARE (compare_func, data, key, (*cur_node)->key);
     if (cmp_result < 0) {
       parent_node = *cur_node;
       cur_node = &(*cur_node)->left;
@@ -364,34 +480,48 @@ u_tree_avl_insert(PTreeBaseNode **root_node,
     (*cur_node)->value = value;
     return false;
   }
-  if (U_UNLIKELY ((*cur_node = u_malloc0(sizeof(PTreeAVLNode))) == NULL)) {
+  if (U_UNLIKELY ((*cur_node = u_tree_slab_alloc(slab)) == NULL)) {
     return false;
   }
   (*cur_node)->key = key;
   (*cur_node)->value = value;
   ((PTreeAVLNode *) *cur_node)->balance_factor = 0;
   ((PTreeAVLNode *) *cur_node)->parent = (PTreeAVLNode *) parent_node;
+  ((PTreeAVLNode *) *cur_node)->size = 1;
+
+  /* Account the new node in the ancestors, rotations keep it consistent */
+  if (is_ranked) {
+    for (size_node = (PTreeAVLNode *) parent_node; size_node != NULL;
+      size_node = size_node->parent) {
+      ++size_node->size;
+    }
+  }
 
   /* Balance the tree */
   pp_tree_avl_balance_insert(((PTreeAVLNode *) *cur_node), root_node);
   return true;
 }
 
-bool
-u_tree_avl_remove(PTreeBaseNode **root_node,
+static bool
+pp_tree_avl_remove(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
   cmp_data_fn_t compare_func,
   ptr_t data,
   destroy_fn_t key_destroy_func,
   destroy_fn_t value_destroy_func,
-  const_ptr_t key) {
+  const_ptr_t key,
+  bool is_ranked) {
   PTreeBaseNode *cur_node;
   PTreeBaseNode *prev_node;
+  ptr_t tmp_key;
+  ptr_t tmp_value;
   PTreeBaseNode *child_node;
   PTreeAVLNode *child_parent;
+  PTreeAVLNode *size_node;
   int cmp_result;
   cur_node = *root_node;
   while (cur_node != NULL) {
-    cmp_result = compare_func(key, cur_node->key, data);
+    cmp_result = U_TREE_COMPARE (compare_func, data, key, cur_node->key);
     if (cmp_result < 0) {
       cur_node = cur_node->left;
     } else if (cmp_result > 0) {
@@ -408,12 +538,28 @@ u_tree_avl_remove(PTreeBaseNode **root_node,
     while (prev_node->right != NULL) {
       prev_node = prev_node->right;
     }
+
+    /* Swap the pairs, so the removed one is destroyed with the node */
+    tmp_key = cur_node->key;
+    tmp_value = cur_node->value;
     cur_node->key = prev_node->key;
     cur_node->value = prev_node->value;
+    prev_node->key = tmp_key;
+    prev_node->value = tmp_value;
 
     /* Mark node for removal */
     cur_node = prev_node;
   }
+
+  /* Drop the node from the ancestors first: it may take part in the
+   * rebalancing below, so zero its own size as well */
+  if (is_ranked) {
+    ((PTreeAVLNode *) cur_node)->size = 0;
+    for (size_node = ((PTreeAVLNode *) cur_node)->parent; size_node != NULL;
+      size_node = size_node->parent) {
+      --size_node->size;
+    }
+  }
   child_node = cur_node->left == NULL ? cur_node->right : cur_node->left;
   if (child_node == NULL) {
     pp_tree_avl_balance_remove((PTreeAVLNode *) cur_node, root_node);
@@ -445,11 +591,118 @@ u_tree_avl_remove(PTreeBaseNode **root_node,
   if (value_destroy_func != NULL) {
     value_destroy_func(cur_node->value);
   }
-  u_free(cur_node);
+  u_tree_slab_free(slab, cur_node);
   return true;
 }
 
+bool
+u_tree_avl_build(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  ptr_t *keys,
+  ptr_t *values,
+  int n) {
+  int height;
+
+  *root_node = NULL;
+  return pp_tree_avl_build(slab, keys, values, n, NULL, root_node, &height);
+}
+
+bool
+u_tree_avl_insert(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  ptr_t key,
+  ptr_t value) {
+  return pp_tree_avl_insert(root_node, slab, compare_func, data,
+    key_destroy_func, value_destroy_func, key, value, false);
+}
+
+bool
+u_tree_avl_insert_ranked(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  ptr_t key,
+  ptr_t value) {
+  return pp_tree_avl_insert(root_node, slab, compare_func, data,
+    key_destroy_func, value_destroy_func, key, value, true);
+}
+
+bool
+u_tree_avl_remove(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  const_ptr_t key) {
+  return pp_tree_avl_remove(root_node, slab, compare_func, data,
+    key_destroy_func, value_destroy_func, key, false);
+}
+
+bool
+u_tree_avl_remove_ranked(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  const_ptr_t key) {
+  return pp_tree_avl_remove(root_node, slab, compare_func, data,
+    key_destroy_func, value_destroy_func, key, true);
+}
+
 void
-u_tree_avl_node_free(PTreeBaseNode *node) {
-  u_free(node);
+u_tree_avl_rank_init(PTreeBaseNode *root_node) {
+  pp_tree_avl_count(root_node);
+}
+
+PTreeBaseNode *
+u_tree_avl_select(PTreeBaseNode *root_node, int index) {
+  PTreeBaseNode *cur_node;
+  int left_size;
+
+  cur_node = root_node;
+  while (cur_node != NULL) {
+    left_size = pp_tree_avl_get_size(cur_node->left);
+    if (index < left_size) {
+      cur_node = cur_node->left;
+    } else if (index > left_size) {
+      index -= left_size + 1;
+      cur_node = cur_node->right;
+    } else {
+      break;
+    }
+  }
+  return cur_node;
+}
+
+int
+u_tree_avl_rank(PTreeBaseNode *root_node,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  const_ptr_t key) {
+  PTreeBaseNode *cur_node;
+  int cmp_result;
+  int rank;
+
+  cur_node = root_node;
+  rank = 0;
+  while (cur_node != NULL) {
+    cmp_result = U_TREE_COMPARE (compare_func, data, key, cur_node->key);
+    if (cmp_result < 0) {
+      cur_node = cur_node->left;
+    } else if (cmp_result > 0) {
+      rank += pp_tree_avl_get_size(cur_node->left) + 1;
+      cur_node = cur_node->right;
+    } else {
+      return rank + pp_tree_avl_get_size(cur_node->left);
+    }
+  }
+  return rank;
 }
@@ -15,11 +15,37 @@
  * along with this library; if not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "unic/mem.h"
 #include "tree-bst.h"
 
+static bool
+pp_tree_bst_build(PTreeSlab *slab, ptr_t *keys, ptr_t *values, int n,
+  PTreeBaseNode **node);
+
+static bool
+pp_tree_bst_build(PTreeSlab *slab, ptr_t *keys, ptr_t *values, int n,
+  PTreeBaseNode **node) {
+  int mid;
+
+  if (n == 0) {
+    return true;
+  }
+  mid = (n - 1) / 2;
+  if (U_UNLIKELY ((*node = u_tree_slab_alloc(slab)) == NULL)) {
+    return false;
+  }
+  (*node)->key = keys[mid];
+  (*node)->value = values == NULL ? NULL : values[mid];
+  if (U_UNLIKELY (
+    !pp_tree_bst_build(slab, keys, values, mid, &(*node)->left))) {
+    return false;
+  }
+  return pp_tree_bst_build(slab, keys + mid + 1,
+    values == NULL ? NULL : values + mid + 1, n - mid - 1, &(*node)->right);
+}
+
 bool
 u_tree_bst_insert(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
   cmp_data_fn_t compare_func,
   ptr_t data,
   destroy_fn_t key_destroy_func,
@@ -30,7 +56,7 @@ u_tree_bst_insert(PTreeBaseNode **root_node,
   int cmp_result;
   cur_node = root_node;
   while (*cur_node != NULL) {
-    cmp_result = compare_func(key, (*cur_node)->key, data);
+    cmp_result = U_TREE_COMPARE (compare_func, data, key, (*cur_node)->key);
     if (cmp_result < 0) {
       cur_node = &(*cur_node)->left;
     } else if (cmp_result > 0) {
@@ -40,7 +66,7 @@ u_tree_bst_insert(PTreeBaseNode **root_node,
     }
   }
   if ((*cur_node) == NULL) {
-    if (U_UNLIKELY ((*cur_node = u_malloc0(sizeof(PTreeBaseNode))) == NULL)) {
+    if (U_UNLIKELY ((*cur_node = u_tree_slab_alloc(slab)) == NULL)) {
       return false;
     }
     (*cur_node)->key = key;
@@ -61,6 +87,7 @@ u_tree_bst_insert(PTreeBaseNode **root_node,
 
 bool
 u_tree_bst_remove(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
   cmp_data_fn_t compare_func,
   ptr_t data,
   destroy_fn_t key_destroy_func,
@@ -68,12 +95,14 @@ u_tree_bst_remove(PTreeBaseNode **root_node,
   const_ptr_t key) {
   PTreeBaseNode *cur_node;
   PTreeBaseNode *prev_node;
+  ptr_t tmp_key;
+  ptr_t tmp_value;
   PTreeBaseNode **node_pointer;
   int cmp_result;
   cur_node = *root_node;
   node_pointer = root_node;
   while (cur_node != NULL) {
-    cmp_result = compare_func(key, cur_node->key, data);
+    cmp_result = U_TREE_COMPARE (compare_func, data, key, cur_node->key);
     if (cmp_result < 0) {
       node_pointer = &cur_node->left;
       cur_node = cur_node->left;
@@ -94,8 +123,14 @@ u_tree_bst_remove(PTreeBaseNode **root_node,
       node_pointer = &prev_node->right;
       prev_node = prev_node->right;
     }
+
+    /* Swap the pairs, so the removed one is destroyed with the node */
+    tmp_key = cur_node->key;
+    tmp_value = cur_node->value;
     cur_node->key = prev_node->key;
     cur_node->value = prev_node->value;
+    prev_node->key = tmp_key;
+    prev_node->value = tmp_value;
     cur_node = prev_node;
   }
   *node_pointer = cur_node->left == NULL ? cur_node->right : cur_node->left;
@@ -105,11 +140,16 @@ u_tree_bst_remove(PTreeBaseNode **root_node,
   if (value_destroy_func != NULL) {
     value_destroy_func(cur_node->value);
   }
-  u_free(cur_node);
+  u_tree_slab_free(slab, cur_node);
   return true;
 }
 
-void
-u_tree_bst_node_free(PTreeBaseNode *node) {
-  u_free(node);
+bool
+u_tree_bst_build(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  ptr_t *keys,
+  ptr_t *values,
+  int n) {
+  *root_node = NULL;
+  return pp_tree_bst_build(slab, keys, values, n, root_node);
 }
@@ -24,6 +24,7 @@
 
 bool
 u_tree_bst_insert(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
   cmp_data_fn_t compare_func,
   ptr_t data,
   destroy_fn_t key_destroy_func,
@@ -33,13 +34,18 @@ u_tree_bst_insert(PTreeBaseNode **root_node,
 
 bool
 u_tree_bst_remove(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
   cmp_data_fn_t compare_func,
   ptr_t data,
   destroy_fn_t key_destroy_func,
   destroy_fn_t value_destroy_func,
   const_ptr_t key);
 
-void
-u_tree_bst_node_free(PTreeBaseNode *node);
+bool
+u_tree_bst_build(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  ptr_t *keys,
+  ptr_t *values,
+  int n);
 
 #endif /* UNIC_HEADER_PTREEBST_H */
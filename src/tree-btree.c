@@ -0,0 +1,742 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "tree-btree.h"
+
+/* Minimum degree: every node except the root holds from T - 1 to 2T - 1 keys,
+ * so the keys of a node fit into two cache lines on 64-bit platforms */
+#define U_TREE_BTREE_T 8
+#define U_TREE_BTREE_MAX_KEYS (2 * U_TREE_BTREE_T - 1)
+
+/* Enough for any tree which fits into the address space */
+#define U_TREE_BTREE_MAX_DEPTH 32
+
+typedef enum PTreeBtreeMode_ {
+  U_TREE_BTREE_MODE_KEY = 0,
+  U_TREE_BTREE_MODE_MAX = 1,
+  U_TREE_BTREE_MODE_MIN = 2
+} PTreeBtreeMode;
+
+typedef struct PTreeBtreeNode_ {
+  int nkeys;
+  bool is_leaf;
+  ptr_t keys[U_TREE_BTREE_MAX_KEYS];
+  ptr_t values[U_TREE_BTREE_MAX_KEYS];
+} PTreeBtreeNode;
+
+typedef struct PTreeBtreeInner_ {
+  PTreeBtreeNode base;
+  PTreeBtreeNode *children[U_TREE_BTREE_MAX_KEYS + 1];
+} PTreeBtreeInner;
+
+#define U_TREE_BTREE_CHILDREN(node) (((PTreeBtreeInner *) (node))->children)
+
+static PTreeBtreeNode *
+pp_tree_btree_node_new(PTreeSlab *slab, bool is_leaf);
+
+static void
+pp_tree_btree_node_free(PTreeSlab *slab, PTreeBtreeNode *node);
+
+static int
+pp_tree_btree_search(const PTreeBtreeNode *node, cmp_data_fn_t compare_func,
+  ptr_t data, const_ptr_t key, bool *found);
+
+static void
+pp_tree_btree_insert_at(PTreeBtreeNode *node, int index, ptr_t key,
+  ptr_t value, PTreeBtreeNode *right);
+
+static void
+pp_tree_btree_erase_at(PTreeBtreeNode *node, int index);
+
+static bool
+pp_tree_btree_split_child(PTreeSlab *slab, PTreeBtreeNode *parent, int index);
+
+static void
+pp_tree_btree_merge(PTreeSlab *slab, PTreeBtreeNode *parent, int index);
+
+static void
+pp_tree_btree_rotate_right(PTreeBtreeNode *parent, int index);
+
+static void
+pp_tree_btree_rotate_left(PTreeBtreeNode *parent, int index);
+
+static int
+pp_tree_btree_fill(PTreeSlab *slab, PTreeBtreeNode *parent, int index);
+
+static PTreeBtreeNode *
+pp_tree_btree_build(PTreeSlab *slab, ptr_t *keys, ptr_t *values, int n,
+  size_t child_span, int min_children);
+
+static PTreeBtreeNode *
+pp_tree_btree_node_new(PTreeSlab *slab, bool is_leaf) {
+  PTreeBtreeNode *ret;
+
+  if (U_UNLIKELY ((ret = u_tree_slab_alloc(&slab[is_leaf ? 0 : 1])) == NULL)) {
+    return NULL;
+  }
+  ret->is_leaf = is_leaf;
+  return ret;
+}
+
+static void
+pp_tree_btree_node_free(PTreeSlab *slab, PTreeBtreeNode *node) {
+  u_tree_slab_free(&slab[node->is_leaf ? 0 : 1], node);
+}
+
+static int
+pp_tree_btree_search(const PTreeBtreeNode *node, cmp_data_fn_t compare_func,
+  ptr_t data, const_ptr_t key, bool *found) {
+  int lo, hi, mid, cmp_result;
+
+  lo = 0;
+  hi = node->nkeys;
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    cmp_result = U_TREE_COMPARE (compare_func, data, key, node->keys[mid]);
+    if (cmp_result == 0) {
+      *found = true;
+      return mid;
+    } else if (cmp_result < 0) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  *found = false;
+  return lo;
+}
+
+static void
+pp_tree_btree_insert_at(PTreeBtreeNode *node, int index, ptr_t key,
+  ptr_t value, PTreeBtreeNode *right) {
+  size_t nmove;
+
+  nmove = (size_t) (node->nkeys - index);
+  memmove(&node->keys[index + 1], &node->keys[index], nmove * sizeof(ptr_t));
+  memmove(&node->values[index + 1], &node->values[index],
+    nmove * sizeof(ptr_t));
+  node->keys[index] = key;
+  node->values[index] = value;
+  if (!node->is_leaf) {
+    memmove(&U_TREE_BTREE_CHILDREN (node)[index + 2],
+      &U_TREE_BTREE_CHILDREN (node)[index + 1],
+      nmove * sizeof(PTreeBtreeNode *));
+    U_TREE_BTREE_CHILDREN (node)[index + 1] = right;
+  }
+  ++node->nkeys;
+}
+
+/* Drops the key at index along with the child to the right of it */
+static void
+pp_tree_btree_erase_at(PTreeBtreeNode *node, int index) {
+  size_t nmove;
+
+  nmove = (size_t) (node->nkeys - index - 1);
+  memmove(&node->keys[index], &node->keys[index + 1], nmove * sizeof(ptr_t));
+  memmove(&node->values[index], &node->values[index + 1],
+    nmove * sizeof(ptr_t));
+  if (!node->is_leaf) {
+    memmove(&U_TREE_BTREE_CHILDREN (node)[index + 1],
+      &U_TREE_BTREE_CHILDREN (node)[index + 2],
+      nmove * sizeof(PTreeBtreeNode *));
+  }
+  --node->nkeys;
+}
+
+static bool
+pp_tree_btree_split_child(PTreeSlab *slab, PTreeBtreeNode *parent, int index) {
+  PTreeBtreeNode *child, *sibling;
+
+  child = U_TREE_BTREE_CHILDREN (parent)[index];
+  if (U_UNLIKELY (
+    (sibling = pp_tree_btree_node_new(slab, child->is_leaf)) == NULL)) {
+    return false;
+  }
+  sibling->nkeys = U_TREE_BTREE_T - 1;
+  memcpy(sibling->keys, &child->keys[U_TREE_BTREE_T],
+    (U_TREE_BTREE_T - 1) * sizeof(ptr_t));
+  memcpy(sibling->values, &child->values[U_TREE_BTREE_T],
+    (U_TREE_BTREE_T - 1) * sizeof(ptr_t));
+  if (!child->is_leaf) {
+    memcpy(U_TREE_BTREE_CHILDREN (sibling),
+      &U_TREE_BTREE_CHILDREN (child)[U_TREE_BTREE_T],
+      U_TREE_BTREE_T * sizeof(PTreeBtreeNode *));
+  }
+  child->nkeys = U_TREE_BTREE_T - 1;
+  pp_tree_btree_insert_at(parent, index, child->keys[U_TREE_BTREE_T - 1],
+    child->values[U_TREE_BTREE_T - 1], sibling);
+  return true;
+}
+
+/* Joins the children around the key at index, the key moves down */
+static void
+pp_tree_btree_merge(PTreeSlab *slab, PTreeBtreeNode *parent, int index) {
+  PTreeBtreeNode *left, *right;
+
+  left = U_TREE_BTREE_CHILDREN (parent)[index];
+  right = U_TREE_BTREE_CHILDREN (parent)[index + 1];
+  left->keys[left->nkeys] = parent->keys[index];
+  left->values[left->nkeys] = parent->values[index];
+  memcpy(&left->keys[left->nkeys + 1], right->keys,
+    (size_t) right->nkeys * sizeof(ptr_t));
+  memcpy(&left->values[left->nkeys + 1], right->values,
+    (size_t) right->nkeys * sizeof(ptr_t));
+  if (!left->is_leaf) {
+    memcpy(&U_TREE_BTREE_CHILDREN (left)[left->nkeys + 1],
+      U_TREE_BTREE_CHILDREN (right),
+      (size_t) (right->nkeys + 1) * sizeof(PTreeBtreeNode *));
+  }
+  left->nkeys += right->nkeys + 1;
+  pp_tree_btree_erase_at(parent, index);
+  pp_tree_btree_node_free(slab, right);
+}
+
+/* Moves the last key of the left sibling through the parent */
+static void
+pp_tree_btree_rotate_right(PTreeBtreeNode *parent, int index) {
+  PTreeBtreeNode *child, *left;
+  PTreeBtreeNode *moved;
+
+  child = U_TREE_BTREE_CHILDREN (parent)[index];
+  left = U_TREE_BTREE_CHILDREN (parent)[index - 1];
+  moved = left->is_leaf ? NULL : U_TREE_BTREE_CHILDREN (left)[left->nkeys];
+  memmove(&child->keys[1], child->keys, (size_t) child->nkeys * sizeof(ptr_t));
+  memmove(&child->values[1], child->values,
+    (size_t) child->nkeys * sizeof(ptr_t));
+  if (!child->is_leaf) {
+    memmove(&U_TREE_BTREE_CHILDREN (child)[1], U_TREE_BTREE_CHILDREN (child),
+      (size_t) (child->nkeys + 1) * sizeof(PTreeBtreeNode *));
+    U_TREE_BTREE_CHILDREN (child)[0] = moved;
+  }
+  child->keys[0] = parent->keys[index - 1];
+  child->values[0] = parent->values[index - 1];
+  ++child->nkeys;
+  parent->keys[index - 1] = left->keys[left->nkeys - 1];
+  parent->values[index - 1] = left->values[left->nkeys - 1];
+  --left->nkeys;
+}
+
+/* Moves the first key of the right sibling through the parent */
+static void
+pp_tree_btree_rotate_left(PTreeBtreeNode *parent, int index) {
+  PTreeBtreeNode *child, *right;
+
+  child = U_TREE_BTREE_CHILDREN (parent)[index];
+  right = U_TREE_BTREE_CHILDREN (parent)[index + 1];
+  child->keys[child->nkeys] = parent->keys[index];
+  child->values[child->nkeys] = parent->values[index];
+  if (!child->is_leaf) {
+    U_TREE_BTREE_CHILDREN (child)[child->nkeys + 1] =
+      U_TREE_BTREE_CHILDREN (right)[0];
+    memmove(U_TREE_BTREE_CHILDREN (right), &U_TREE_BTREE_CHILDREN (right)[1],
+      (size_t) right->nkeys * sizeof(PTreeBtreeNode *));
+  }
+  ++child->nkeys;
+  parent->keys[index] = right->keys[0];
+  parent->values[index] = right->values[0];
+  memmove(right->keys, &right->keys[1],
+    (size_t) (right->nkeys - 1) * sizeof(ptr_t));
+  memmove(right->values, &right->values[1],
+    (size_t) (right->nkeys - 1) * sizeof(ptr_t));
+  --right->nkeys;
+}
+
+/* Makes sure the child at index has at least T keys before descending into
+ * it, returns the new index of the child */
+static int
+pp_tree_btree_fill(PTreeSlab *slab, PTreeBtreeNode *parent, int index) {
+  PTreeBtreeNode **children;
+
+  children = U_TREE_BTREE_CHILDREN (parent);
+  if (index > 0 && children[index - 1]->nkeys >= U_TREE_BTREE_T) {
+    pp_tree_btree_rotate_right(parent, index);
+  } else if (index < parent->nkeys &&
+    children[index + 1]->nkeys >= U_TREE_BTREE_T) {
+    pp_tree_btree_rotate_left(parent, index);
+  } else if (index < parent->nkeys) {
+    pp_tree_btree_merge(slab, parent, index);
+  } else {
+    pp_tree_btree_merge(slab, parent, --index);
+  }
+  return index;
+}
+
+/* Builds a subtree from n sorted pairs, every child below gets up to
+ * child_span - 1 pairs. The node takes as few children as possible, but not
+ * less than min_children, and spreads the pairs evenly among them: this keeps
+ * the nodes well filled and never lets any of them underflow */
+static PTreeBtreeNode *
+pp_tree_btree_build(PTreeSlab *slab, ptr_t *keys, ptr_t *values, int n,
+  size_t child_span, int min_children) {
+  PTreeBtreeNode *node;
+  PTreeBtreeNode *child;
+  int nchildren, extra, span, count, i;
+
+  node = pp_tree_btree_node_new(slab, child_span == 1);
+  if (U_UNLIKELY (node == NULL)) {
+    return NULL;
+  }
+  if (node->is_leaf) {
+    node->nkeys = n;
+    memcpy(node->keys, keys, n * sizeof(ptr_t));
+    if (values != NULL) {
+      memcpy(node->values, values, n * sizeof(ptr_t));
+    }
+    return node;
+  }
+  nchildren = (int) ((size_t) n / child_span) + 1;
+  if (nchildren < min_children) {
+    nchildren = min_children;
+  }
+  span = (n + 1) / nchildren;
+  extra = (n + 1) % nchildren;
+  for (i = 0; i < nchildren; ++i) {
+    count = span - 1 + (i < extra ? 1 : 0);
+    child = pp_tree_btree_build(slab, keys, values, count,
+      child_span / (U_TREE_BTREE_MAX_KEYS + 1), U_TREE_BTREE_T);
+    if (U_UNLIKELY (child == NULL)) {
+      return NULL;
+    }
+    U_TREE_BTREE_CHILDREN(node)[i] = child;
+    keys += count;
+    values = values == NULL ? NULL : values + count;
+    if (i < nchildren - 1) {
+      node->keys[i] = *keys++;
+      if (values != NULL) {
+        node->values[i] = *values++;
+      }
+    }
+  }
+  node->nkeys = nchildren - 1;
+  return node;
+}
+
+size_t
+u_tree_btree_leaf_size(void) {
+  return sizeof(PTreeBtreeNode);
+}
+
+size_t
+u_tree_btree_inner_size(void) {
+  return sizeof(PTreeBtreeInner);
+}
+
+bool
+u_tree_btree_insert(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  ptr_t key,
+  ptr_t value) {
+  PTreeBtreeNode **root;
+  PTreeBtreeNode *node, *new_root;
+  int index, cmp_result;
+  bool found;
+
+  root = (PTreeBtreeNode **) root_node;
+  if (*root == NULL) {
+    if (U_UNLIKELY ((*root = pp_tree_btree_node_new(slab, true)) == NULL)) {
+      return false;
+    }
+    pp_tree_btree_insert_at(*root, 0, key, value, NULL);
+    return true;
+  }
+
+  /* Full nodes are split on the way down, so there is always room for the
+   * key which is pushed up from a child */
+  if ((*root)->nkeys == U_TREE_BTREE_MAX_KEYS) {
+    if (U_UNLIKELY ((new_root = pp_tree_btree_node_new(slab, false)) == NULL)) {
+      return false;
+    }
+    U_TREE_BTREE_CHILDREN (new_root)[0] = *root;
+    if (U_UNLIKELY (!pp_tree_btree_split_child(slab, new_root, 0))) {
+      pp_tree_btree_node_free(slab, new_root);
+      return false;
+    }
+    *root = new_root;
+  }
+  node = *root;
+  for (;;) {
+    index = pp_tree_btree_search(node, compare_func, data, key, &found);
+    if (found) {
+      break;
+    }
+    if (node->is_leaf) {
+      pp_tree_btree_insert_at(node, index, key, value, NULL);
+      return true;
+    }
+    if (U_TREE_BTREE_CHILDREN (node)[index]->nkeys == U_TREE_BTREE_MAX_KEYS) {
+      if (U_UNLIKELY (!pp_tree_btree_split_child(slab, node, index))) {
+        return false;
+      }
+      cmp_result = U_TREE_COMPARE (compare_func, data, key, node->keys[index]);
+      if (cmp_result == 0) {
+        found = true;
+        break;
+      } else if (cmp_result > 0) {
+        ++index;
+      }
+    }
+    node = U_TREE_BTREE_CHILDREN (node)[index];
+  }
+  if (key_destroy_func != NULL) {
+    key_destroy_func(node->keys[index]);
+  }
+  if (value_destroy_func != NULL) {
+    value_destroy_func(node->values[index]);
+  }
+  node->keys[index] = key;
+  node->values[index] = value;
+  return false;
+}
+
+bool
+u_tree_btree_remove(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  const_ptr_t key) {
+  PTreeBtreeNode **root, **children;
+  PTreeBtreeNode *node, *child;
+  PTreeBtreeMode mode;
+  ptr_t *target_key, *target_value;
+  int index;
+  bool found, result;
+
+  root = (PTreeBtreeNode **) root_node;
+  if (*root == NULL) {
+    return false;
+  }
+  node = *root;
+  mode = U_TREE_BTREE_MODE_KEY;
+  target_key = NULL;
+  target_value = NULL;
+  found = false;
+  result = false;
+
+  /* Every node we descend into is refilled to at least T keys first, so a
+   * key can be taken out of a leaf without walking back up */
+  for (;;) {
+    if (mode == U_TREE_BTREE_MODE_KEY) {
+      index = pp_tree_btree_search(node, compare_func, data, key, &found);
+    } else {
+      index = mode == U_TREE_BTREE_MODE_MAX ? node->nkeys : 0;
+    }
+    if (node->is_leaf) {
+      if (mode == U_TREE_BTREE_MODE_KEY) {
+        if ((result = found)) {
+          if (key_destroy_func != NULL) {
+            key_destroy_func(node->keys[index]);
+          }
+          if (value_destroy_func != NULL) {
+            value_destroy_func(node->values[index]);
+          }
+          pp_tree_btree_erase_at(node, index);
+        }
+      } else {
+        /* Move the predecessor or the successor in place of the key */
+        if (mode == U_TREE_BTREE_MODE_MAX) {
+          --index;
+        }
+        *target_key = node->keys[index];
+        *target_value = node->values[index];
+        pp_tree_btree_erase_at(node, index);
+        result = true;
+      }
+      break;
+    }
+    children = U_TREE_BTREE_CHILDREN (node);
+    if (found) {
+      found = false;
+      if (children[index]->nkeys < U_TREE_BTREE_T &&
+        children[index + 1]->nkeys < U_TREE_BTREE_T) {
+        /* The key goes down with the merge and is found there again */
+        pp_tree_btree_merge(slab, node, index);
+      } else {
+        if (key_destroy_func != NULL) {
+          key_destroy_func(node->keys[index]);
+        }
+        if (value_destroy_func != NULL) {
+          value_destroy_func(node->values[index]);
+        }
+        target_key = &node->keys[index];
+        target_value = &node->values[index];
+        if (children[index]->nkeys >= U_TREE_BTREE_T) {
+          mode = U_TREE_BTREE_MODE_MAX;
+        } else {
+          mode = U_TREE_BTREE_MODE_MIN;
+          ++index;
+        }
+      }
+    } else if (children[index]->nkeys < U_TREE_BTREE_T) {
+      index = pp_tree_btree_fill(slab, node, index);
+    }
+    child = children[index];
+    if (node->nkeys == 0) {
+      /* Only the root can run out of keys after a merge */
+      pp_tree_btree_node_free(slab, node);
+      *root = child;
+    }
+    node = child;
+  }
+  if ((*root)->nkeys == 0) {
+    pp_tree_btree_node_free(slab, *root);
+    *root = NULL;
+  }
+  return result;
+}
+
+bool
+u_tree_btree_build(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  ptr_t *keys,
+  ptr_t *values,
+  int n) {
+  size_t child_span;
+
+  /* Find the lowest height the pairs fit into */
+  for (child_span = 1;
+    (size_t) n / (U_TREE_BTREE_MAX_KEYS + 1) >= child_span;
+    child_span *= U_TREE_BTREE_MAX_KEYS + 1)
+    ;
+  *root_node = (PTreeBaseNode *) pp_tree_btree_build(slab, keys, values, n,
+    child_span, 2);
+  return *root_node != NULL;
+}
+
+ptr_t
+u_tree_btree_lookup(PTreeBaseNode *root_node,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  const_ptr_t key) {
+  PTreeBtreeNode *node;
+  int index;
+  bool found;
+
+  node = (PTreeBtreeNode *) root_node;
+  while (node != NULL) {
+    index = pp_tree_btree_search(node, compare_func, data, key, &found);
+    if (found) {
+      return node->values[index];
+    }
+    node = node->is_leaf ? NULL : U_TREE_BTREE_CHILDREN (node)[index];
+  }
+  return NULL;
+}
+
+void
+u_tree_btree_foreach(PTreeBaseNode *root_node,
+  traverse_fn_t traverse_func,
+  ptr_t user_data) {
+  PTreeBtreeNode *nodes[U_TREE_BTREE_MAX_DEPTH];
+  int steps[U_TREE_BTREE_MAX_DEPTH];
+  PTreeBtreeNode *node;
+  int depth, step, i;
+
+  if (root_node == NULL) {
+    return;
+  }
+  nodes[0] = (PTreeBtreeNode *) root_node;
+  steps[0] = 0;
+  depth = 0;
+
+  /* Even steps descend into the children, odd steps visit the keys */
+  while (depth >= 0) {
+    node = nodes[depth];
+    if (node->is_leaf) {
+      for (i = 0; i < node->nkeys; ++i) {
+        if (traverse_func(node->keys[i], node->values[i], user_data)) {
+          return;
+        }
+      }
+      --depth;
+      continue;
+    }
+    step = steps[depth]++;
+    if (step > 2 * node->nkeys) {
+      --depth;
+    } else if (step % 2 == 0) {
+      ++depth;
+      nodes[depth] = U_TREE_BTREE_CHILDREN (node)[step / 2];
+      steps[depth] = 0;
+    } else if (traverse_func(node->keys[step / 2], node->values[step / 2],
+      user_data)) {
+      return;
+    }
+  }
+}
+
+void
+u_tree_btree_destroy(PTreeBaseNode *root_node,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func) {
+  PTreeBtreeNode *nodes[U_TREE_BTREE_MAX_DEPTH];
+  int steps[U_TREE_BTREE_MAX_DEPTH];
+  PTreeBtreeNode *node;
+  int depth, i;
+
+  if (root_node == NULL) {
+    return;
+  }
+  nodes[0] = (PTreeBtreeNode *) root_node;
+  steps[0] = 0;
+  depth = 0;
+  while (depth >= 0) {
+    node = nodes[depth];
+    if (!node->is_leaf && steps[depth] <= node->nkeys) {
+      nodes[depth + 1] = U_TREE_BTREE_CHILDREN (node)[steps[depth]++];
+      steps[++depth] = 0;
+      continue;
+    }
+    for (i = 0; i < node->nkeys; ++i) {
+      if (key_destroy_func != NULL) {
+        key_destroy_func(node->keys[i]);
+      }
+      if (value_destroy_func != NULL) {
+        value_destroy_func(node->values[i]);
+      }
+    }
+    --depth;
+  }
+}
+
+void
+u_tree_btree_iter_first(tree_iter_t *iter,
+  PTreeBaseNode *root_node,
+  bool is_last) {
+  PTreeBtreeNode *node;
+
+  iter->depth = 0;
+  for (node = (PTreeBtreeNode *) root_node; node != NULL;) {
+    iter->path[iter->depth] = node;
+    if (node->is_leaf) {
+      iter->indexes[iter->depth++] = is_last ? node->nkeys - 1 : 0;
+      break;
+    }
+    iter->indexes[iter->depth++] = is_last ? node->nkeys : 0;
+    node = U_TREE_BTREE_CHILDREN (node)[is_last ? node->nkeys : 0];
+  }
+  iter->node = iter->depth > 0 ? iter->path[iter->depth - 1] : NULL;
+}
+
+void
+u_tree_btree_iter_seek(tree_iter_t *iter,
+  PTreeBaseNode *root_node,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  const_ptr_t key,
+  bool is_upper) {
+  PTreeBtreeNode *node;
+  int index, bound_depth;
+  bool found;
+
+  iter->depth = 0;
+  bound_depth = 0;
+  for (node = (PTreeBtreeNode *) root_node; node != NULL;) {
+    index = pp_tree_btree_search(node, compare_func, data, key, &found);
+    if (found && is_upper) {
+      ++index;
+    }
+    iter->path[iter->depth] = node;
+    iter->indexes[iter->depth++] = index;
+    if (found && !is_upper) {
+      bound_depth = iter->depth;
+      break;
+    }
+
+    /* The bound is the deepest key on the way down not less than the key */
+    if (index < node->nkeys) {
+      bound_depth = iter->depth;
+    }
+    node = node->is_leaf ? NULL : U_TREE_BTREE_CHILDREN (node)[index];
+  }
+  iter->depth = bound_depth;
+  iter->node = bound_depth > 0 ? iter->path[bound_depth - 1] : NULL;
+}
+
+bool
+u_tree_btree_iter_step(tree_iter_t *iter, bool is_forward) {
+  PTreeBtreeNode *node;
+  int top, index, depth;
+
+  top = iter->depth - 1;
+  node = iter->path[top];
+  index = iter->indexes[top];
+  if (!node->is_leaf) {
+    /* Go to the leftmost or the rightmost key of the adjacent subtree */
+    index = is_forward ? index + 1 : index;
+    iter->indexes[top] = index;
+    node = U_TREE_BTREE_CHILDREN (node)[index];
+    for (;;) {
+      iter->path[iter->depth] = node;
+      if (node->is_leaf) {
+        iter->indexes[iter->depth++] = is_forward ? 0 : node->nkeys - 1;
+        break;
+      }
+      index = is_forward ? 0 : node->nkeys;
+      iter->indexes[iter->depth++] = index;
+      node = U_TREE_BTREE_CHILDREN (node)[index];
+    }
+    iter->node = node;
+    return true;
+  }
+  if (is_forward && index + 1 < node->nkeys) {
+    ++iter->indexes[top];
+    return true;
+  }
+  if (!is_forward && index > 0) {
+    --iter->indexes[top];
+    return true;
+  }
+
+  /* Climb up to the first ancestor with a key on the proper side, keep the
+   * path untouched if there is none */
+  for (depth = iter->depth - 1; depth > 0; --depth) {
+    node = iter->path[depth - 1];
+    index = iter->indexes[depth - 1];
+    if (is_forward ? index < node->nkeys : index > 0) {
+      if (!is_forward) {
+        --iter->indexes[depth - 1];
+      }
+      iter->depth = depth;
+      iter->node = node;
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+u_tree_btree_iter_get(const tree_iter_t *iter, ptr_t *key, ptr_t *value) {
+  const PTreeBtreeNode *node;
+  int index;
+
+  node = iter->path[iter->depth - 1];
+  index = iter->indexes[iter->depth - 1];
+  if (key != NULL) {
+    *key = node->keys[index];
+  }
+  if (value != NULL) {
+    *value = node->values[index];
+  }
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNIC_HEADER_PTREEBTREE_H
+# define UNIC_HEADER_PTREEBTREE_H
+
+#include "unic/macros.h"
+#include "unic/types.h"
+#include "unic/tree.h"
+#include "tree-private.h"
+
+/* B-tree nodes are not binary, so the tree root of this type actually points
+ * to the internal node structure and is never dereferenced as PTreeBaseNode.
+ * Leaves and inner nodes differ in size and come from the first and the
+ * second slab respectively */
+
+/*!@brief Size of a B-tree leaf node. */
+size_t
+u_tree_btree_leaf_size(void);
+
+/*!@brief Size of a B-tree inner node. */
+size_t
+u_tree_btree_inner_size(void);
+
+bool
+u_tree_btree_insert(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  ptr_t key,
+  ptr_t value);
+
+bool
+u_tree_btree_remove(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  const_ptr_t key);
+
+bool
+u_tree_btree_build(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  ptr_t *keys,
+  ptr_t *values,
+  int n);
+
+ptr_t
+u_tree_btree_lookup(PTreeBaseNode *root_node,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  const_ptr_t key);
+
+void
+u_tree_btree_foreach(PTreeBaseNode *root_node,
+  traverse_fn_t traverse_func,
+  ptr_t user_data);
+
+/* Calls the destroy functions on all the pairs, the nodes are released with
+ * the slabs */
+void
+u_tree_btree_destroy(PTreeBaseNode *root_node,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func);
+
+/* Cursor support: the path holds the nodes from the root, the indexes hold
+ * the child taken in every ancestor and the key index in the last node */
+
+void
+u_tree_btree_iter_first(tree_iter_t *iter,
+  PTreeBaseNode *root_node,
+  bool is_last);
+
+void
+u_tree_btree_iter_seek(tree_iter_t *iter,
+  PTreeBaseNode *root_node,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  const_ptr_t key,
+  bool is_upper);
+
+bool
+u_tree_btree_iter_step(tree_iter_t *iter, bool is_forward);
+
+void
+u_tree_btree_iter_get(const tree_iter_t *iter, ptr_t *key, ptr_t *value);
+
+#endif /* UNIC_HEADER_PTREEBTREE_H */
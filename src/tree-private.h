@@ -21,6 +21,8 @@
 #include "unic/macros.h"
 #include "unic/types.h"
 
+#include <string.h>
+
 /*!@brief Base tree leaf structure. */
 typedef struct PTreeBaseNode_ {
 
@@ -37,4 +39,87 @@ typedef struct PTreeBaseNode_ {
   ptr_t value;
 } PTreeBaseNode;
 
+/*!@brief Slab allocator for tree nodes of a fixed size. */
+typedef struct PTreeSlab_ {
+
+  /*!@brief Released nodes, linked through their first pointer. */
+  ptr_t free_nodes;
+
+  /*!@brief Allocated chunks, linked through their first slot. */
+  ptr_t chunks;
+
+  /*!@brief Size of a node in bytes. */
+  size_t node_size;
+
+  /*!@brief Number of nodes in the next chunk. */
+  size_t chunk_nodes;
+} PTreeSlab;
+
+/*!@brief Initializes an empty slab.
+ * @param slab Slab to initialize.
+ * @param node_size Size of a node, not less than the pointer size.
+ */
+void
+u_tree_slab_init(PTreeSlab *slab, size_t node_size);
+
+/*!@brief Allocates a zeroed node from a slab.
+ * @param slab Slab to allocate from.
+ * @return Pointer to the node in case of success, NULL otherwise.
+ */
+ptr_t
+u_tree_slab_alloc(PTreeSlab *slab);
+
+/*!@brief Returns a node to a slab for reuse.
+ * @param slab Slab the node was allocated from.
+ * @param node Node to release.
+ */
+void
+u_tree_slab_free(PTreeSlab *slab, ptr_t node);
+
+/*!@brief Frees all the chunks of a slab at once.
+ * @param slab Slab to release.
+ */
+void
+u_tree_slab_release(PTreeSlab *slab);
+
+/*!@brief Compares integer keys stored with #PINT_TO_POINTER.
+ * @param a First key.
+ * @param b Second key.
+ * @param data Unused.
+ * @return Less than zero, zero or greater than zero as @a a is less than, equal
+ * to or greater than @a b.
+ *
+ * Trees created with u_tree_new_int() use this function, U_TREE_COMPARE
+ * recognizes it and compares the keys inline.
+ */
+int
+u_tree_compare_int(const_ptr_t a, const_ptr_t b, ptr_t data);
+
+/*!@brief Compares NULL-terminated string keys.
+ * @param a First key.
+ * @param b Second key.
+ * @param data Unused.
+ * @return Less than zero, zero or greater than zero as @a a is less than, equal
+ * to or greater than @a b.
+ *
+ * Trees created with u_tree_new_str() use this function, U_TREE_COMPARE
+ * recognizes it and calls strcmp() directly.
+ */
+int
+u_tree_compare_str(const_ptr_t a, const_ptr_t b, ptr_t data);
+
+/*!@brief Compares two integer keys inline. */
+#define U_TREE_COMPARE_INT(a, b)                                               \
+  ((PPOINTER_TO_INT (a) > PPOINTER_TO_INT (b))                                 \
+  - (PPOINTER_TO_INT (a) < PPOINTER_TO_INT (b)))
+
+/*!@brief Compares two keys with a tree compare function. The built-in integer
+ * and string functions are dispatched without an indirect call, so the
+ * comparison of integer keys is inlined into the search loop. */
+#define U_TREE_COMPARE(func, data, a, b)                                       \
+  ((func) == u_tree_compare_int ? U_TREE_COMPARE_INT (a, b)                    \
+  : (func) == u_tree_compare_str                                               \
+    ? strcmp ((const char *) (a), (const char *) (b))                          \
+    : (func) ((a), (b), (data)))
+
 #endif /* UNIC_HEADER_PTREE_PRIVATE_H */
@@ -16,7 +16,6 @@
  * along with this library; if not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "unic/mem.h"
 #include "tree-rb.h"
 
 typedef enum PTreeRBColor_ {
@@ -28,6 +27,7 @@ typedef struct PTreeRBNode_ {
   struct PTreeBaseNode_ base;
   struct PTreeRBNode_ *parent;
   PTreeRBColor color;
+  int size;
 } PTreeRBNode;
 
 static bool
@@ -57,6 +57,40 @@ pp_tree_rb_balance_insert(PTreeRBNode *node, PTreeBaseNode **root);
 static void
 pp_tree_rb_balance_remove(PTreeRBNode *node, PTreeBaseNode **root);
 
+static bool
+pp_tree_rb_build(PTreeSlab *slab, ptr_t *keys, ptr_t *values, int n,
+  PTreeRBNode *parent, int depth, int red_depth, PTreeBaseNode **node);
+
+static int
+pp_tree_rb_get_size(PTreeBaseNode *node);
+
+static void
+pp_tree_rb_update_size(PTreeRBNode *node);
+
+static int
+pp_tree_rb_count(PTreeBaseNode *node);
+
+static bool
+pp_tree_rb_insert(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  ptr_t key,
+  ptr_t value,
+  bool is_ranked);
+
+static bool
+pp_tree_rb_remove(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  const_ptr_t key,
+  bool is_ranked);
+
 static bool
 pp_tree_rb_is_black(PTreeRBNode *node) {
   if (node == NULL) {
@@ -94,6 +128,27 @@ pp_tree_rb_get_sibling(PTreeRBNode *node) {
   }
 }
 
+static int
+pp_tree_rb_get_size(PTreeBaseNode *node) {
+  return node == NULL ? 0 : ((PTreeRBNode *) node)->size;
+}
+
+static void
+pp_tree_rb_update_size(PTreeRBNode *node) {
+  node->size = pp_tree_rb_get_size(node->base.left) +
+    pp_tree_rb_get_size(node->base.right) + 1;
+}
+
+static int
+pp_tree_rb_count(PTreeBaseNode *node) {
+  if (node == NULL) {
+    return 0;
+  }
+  ((PTreeRBNode *) node)->size = pp_tree_rb_count(node->left) +
+    pp_tree_rb_count(node->right) + 1;
+  return ((PTreeRBNode *) node)->size;
+}
+
 static void
 pp_tree_rb_rotate_left(PTreeRBNode *node, PTreeBaseNode **root) {
   PTreeBaseNode *tmp_node;
@@ -115,6 +170,10 @@ pp_tree_rb_rotate_left(PTreeRBNode *node, PTreeBaseNode **root) {
   if (U_UNLIKELY (((PTreeRBNode *) tmp_node)->parent == NULL)) {
     *root = tmp_node;
   }
+
+  /* Restore subtree sizes, the lower node goes first */
+  pp_tree_rb_update_size(node);
+  pp_tree_rb_update_size((PTreeRBNode *) tmp_node);
 }
 
 static void
@@ -138,6 +197,10 @@ pp_tree_rb_rotate_right(PTreeRBNode *node, PTreeBaseNode **root) {
   if (U_UNLIKELY (((PTreeRBNode *) tmp_node)->parent == NULL)) {
     *root = tmp_node;
   }
+
+  /* Restore subtree sizes, the lower node goes first */
+  pp_tree_rb_update_size(node);
+  pp_tree_rb_update_size((PTreeRBNode *) tmp_node);
 }
 
 static void
@@ -314,23 +377,60 @@ pp_tree_rb_balance_remove(PTreeRBNode *node, PTreeBaseNode **root) {
   }
 }
 
-bool
-u_tree_rb_insert(PTreeBaseNode **root_node,
+static bool
+pp_tree_rb_build(PTreeSlab *slab, ptr_t *keys, ptr_t *values, int n,
+  PTreeRBNode *parent, int depth, int red_depth, PTreeBaseNode **node) {
+  PTreeRBNode *cur_node;
+  int mid;
+
+  if (n == 0) {
+    return true;
+  }
+  mid = (n - 1) / 2;
+  if (U_UNLIKELY ((cur_node = u_tree_slab_alloc(slab)) == NULL)) {
+    return false;
+  }
+  *node = (PTreeBaseNode *) cur_node;
+  cur_node->base.key = keys[mid];
+  cur_node->base.value = values == NULL ? NULL : values[mid];
+  cur_node->parent = parent;
+  cur_node->size = n;
+  cur_node->color = depth == red_depth ? U_TREE_RB_COLOR_RED
+    : U_TREE_RB_COLOR_BLACK;
+  if (U_UNLIKELY (!pp_tree_rb_build(slab, keys, values, mid, cur_node,
+    depth + 1, red_depth, &cur_node->base.left))) {
+    return false;
+  }
+  return pp_tree_rb_build(slab, keys + mid + 1,
+    values == NULL ? NULL : values + mid + 1, n - mid - 1, cur_node,
+    depth + 1, red_depth, &cur_node->base.right);
+}
+
+size_t
+u_tree_rb_node_size(void) {
+  return sizeof(PTreeRBNode);
+}
+
+static bool
+pp_tree_rb_insert(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
   cmp_data_fn_t compare_func,
   ptr_t data,
   destroy_fn_t key_destroy_func,
   destroy_fn_t value_destroy_func,
   ptr_t key,
-  ptr_t value) {
+  ptr_t value,
+  bool is_ranked) {
   PTreeBaseNode **cur_node;
   PTreeBaseNode *parent_node;
+  PTreeRBNode *size_node;
   int cmp_result;
   cur_node = root_node;
   parent_node = *root_node;
 
   /* Find where to insert the node */
   while (*cur_node != NULL) {
-    cmp_result = compare_func(key, (*cur_node)->key, data);
+    cmp_result = U_TREE_COMPARE (compare_func, data, key, (*cur_node)->key);
     if (cmp_result < 0) {
       parent_node = *cur_node;
       cur_node = &(*cur_node)->left;
@@ -354,34 +454,48 @@ u_tree_rb_insert(PTreeBaseNode **root_node,
     (*cur_node)->value = value;
     return false;
   }
-  if (U_UNLIKELY ((*cur_node = u_malloc0(sizeof(PTreeRBNode))) == NULL)) {
+  if (U_UNLIKELY ((*cur_node = u_tree_slab_alloc(slab)) == NULL)) {
     return false;
   }
   (*cur_node)->key = key;
   (*cur_node)->value = value;
   ((PTreeRBNode *) *cur_node)->color = U_TREE_RB_COLOR_RED;
   ((PTreeRBNode *) *cur_node)->parent = (PTreeRBNode *) parent_node;
+  ((PTreeRBNode *) *cur_node)->size = 1;
+
+  /* Account the new node in the ancestors, rotations keep it consistent */
+  if (is_ranked) {
+    for (size_node = (PTreeRBNode *) parent_node; size_node != NULL;
+      size_node = size_node->parent) {
+      ++size_node->size;
+    }
+  }
 
   /* Balance the tree */
   pp_tree_rb_balance_insert((PTreeRBNode *) *cur_node, root_node);
   return true;
 }
 
-bool
-u_tree_rb_remove(PTreeBaseNode **root_node,
+static bool
+pp_tree_rb_remove(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
   cmp_data_fn_t compare_func,
   ptr_t data,
   destroy_fn_t key_destroy_func,
   destroy_fn_t value_destroy_func,
-  const_ptr_t key) {
+  const_ptr_t key,
+  bool is_ranked) {
   PTreeBaseNode *cur_node;
   PTreeBaseNode *prev_node;
+  ptr_t tmp_key;
+  ptr_t tmp_value;
   PTreeBaseNode *child_node;
   PTreeRBNode *child_parent;
+  PTreeRBNode *size_node;
   int cmp_result;
   cur_node = *root_node;
   while (cur_node != NULL) {
-    cmp_result = compare_func(key, cur_node->key, data);
+    cmp_result = U_TREE_COMPARE (compare_func, data, key, cur_node->key);
     if (cmp_result < 0) {
       cur_node = cur_node->left;
     } else if (cmp_result > 0) {
@@ -398,12 +512,28 @@ u_tree_rb_remove(PTreeBaseNode **root_node,
     while (prev_node->right != NULL) {
       prev_node = prev_node->right;
     }
+
+    /* Swap the pairs, so the removed one is destroyed with the node */
+    tmp_key = cur_node->key;
+    tmp_value = cur_node->value;
     cur_node->key = prev_node->key;
     cur_node->value = prev_node->value;
+    prev_node->key = tmp_key;
+    prev_node->value = tmp_value;
 
     /* Mark node for removal */
     cur_node = prev_node;
   }
+
+  /* Drop the node from the ancestors first: it may take part in the
+   * rebalancing below, so zero its own size as well */
+  if (is_ranked) {
+    ((PTreeRBNode *) cur_node)->size = 0;
+    for (size_node = ((PTreeRBNode *) cur_node)->parent; size_node != NULL;
+      size_node = size_node->parent) {
+      --size_node->size;
+    }
+  }
   child_node = cur_node->left == NULL ? cur_node->right : cur_node->left;
   if (child_node == NULL
     && pp_tree_rb_is_black((PTreeRBNode *) cur_node) == true) {
@@ -438,11 +568,127 @@ u_tree_rb_remove(PTreeBaseNode **root_node,
   if (value_destroy_func != NULL) {
     value_destroy_func(cur_node->value);
   }
-  u_free(cur_node);
+  u_tree_slab_free(slab, cur_node);
   return true;
 }
 
+bool
+u_tree_rb_build(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  ptr_t *keys,
+  ptr_t *values,
+  int n) {
+  int red_depth;
+
+  /* Halving keeps all the leaves on the last two levels: paint the deepest
+   * level red (unless it is the root) and every path has the same number of
+   * black nodes */
+  for (red_depth = 0; (n >> (red_depth + 1)) > 0; ++red_depth)
+    ;
+  if (red_depth == 0) {
+    red_depth = -1;
+  }
+  *root_node = NULL;
+  return pp_tree_rb_build(slab, keys, values, n, NULL, 0, red_depth,
+    root_node);
+}
+
+bool
+u_tree_rb_insert(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  ptr_t key,
+  ptr_t value) {
+  return pp_tree_rb_insert(root_node, slab, compare_func, data,
+    key_destroy_func, value_destroy_func, key, value, false);
+}
+
+bool
+u_tree_rb_insert_ranked(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  ptr_t key,
+  ptr_t value) {
+  return pp_tree_rb_insert(root_node, slab, compare_func, data,
+    key_destroy_func, value_destroy_func, key, value, true);
+}
+
+bool
+u_tree_rb_remove(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  const_ptr_t key) {
+  return pp_tree_rb_remove(root_node, slab, compare_func, data,
+    key_destroy_func, value_destroy_func, key, false);
+}
+
+bool
+u_tree_rb_remove_ranked(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  const_ptr_t key) {
+  return pp_tree_rb_remove(root_node, slab, compare_func, data,
+    key_destroy_func, value_destroy_func, key, true);
+}
+
 void
-u_tree_rb_node_free(PTreeBaseNode *node) {
-  u_free(node);
+u_tree_rb_rank_init(PTreeBaseNode *root_node) {
+  pp_tree_rb_count(root_node);
+}
+
+PTreeBaseNode *
+u_tree_rb_select(PTreeBaseNode *root_node, int index) {
+  PTreeBaseNode *cur_node;
+  int left_size;
+
+  cur_node = root_node;
+  while (cur_node != NULL) {
+    left_size = pp_tree_rb_get_size(cur_node->left);
+    if (index < left_size) {
+      cur_node = cur_node->left;
+    } else if (index > left_size) {
+      index -= left_size + 1;
+      cur_node = cur_node->right;
+    } else {
+      break;
+    }
+  }
+  return cur_node;
+}
+
+int
+u_tree_rb_rank(PTreeBaseNode *root_node,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  const_ptr_t key) {
+  PTreeBaseNode *cur_node;
+  int cmp_result;
+  int rank;
+
+  cur_node = root_node;
+  rank = 0;
+  while (cur_node != NULL) {
+    cmp_result = U_TREE_COMPARE (compare_func, data, key, cur_node->key);
+    if (cmp_result < 0) {
+      cur_node = cur_node->left;
+    } else if (cmp_result > 0) {
+      rank += pp_tree_rb_get_size(cur_node->left) + 1;
+      cur_node = cur_node->right;
+    } else {
+      return rank + pp_tree_rb_get_size(cur_node->left);
+    }
+  }
+  return rank;
 }
@@ -22,8 +22,12 @@
 #include "unic/types.h"
 #include "tree-private.h"
 
+size_t
+u_tree_rb_node_size(void);
+
 bool
 u_tree_rb_insert(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
   cmp_data_fn_t compare_func,
   ptr_t data,
   destroy_fn_t key_destroy_func,
@@ -33,13 +37,55 @@ u_tree_rb_insert(PTreeBaseNode **root_node,
 
 bool
 u_tree_rb_remove(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  const_ptr_t key);
+
+/* Ranked variants also keep the subtree sizes in the ancestors up to date,
+ * rotations maintain them in both modes */
+
+bool
+u_tree_rb_insert_ranked(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  destroy_fn_t key_destroy_func,
+  destroy_fn_t value_destroy_func,
+  ptr_t key,
+  ptr_t value);
+
+bool
+u_tree_rb_remove_ranked(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
   cmp_data_fn_t compare_func,
   ptr_t data,
   destroy_fn_t key_destroy_func,
   destroy_fn_t value_destroy_func,
   const_ptr_t key);
 
+/* Recomputes all the subtree sizes */
 void
-u_tree_rb_node_free(PTreeBaseNode *node);
+u_tree_rb_rank_init(PTreeBaseNode *root_node);
+
+/* Gets the node with the given zero-based in-order index */
+PTreeBaseNode *
+u_tree_rb_select(PTreeBaseNode *root_node, int index);
+
+/* Gets the number of keys less than the given one */
+int
+u_tree_rb_rank(PTreeBaseNode *root_node,
+  cmp_data_fn_t compare_func,
+  ptr_t data,
+  const_ptr_t key);
+
+bool
+u_tree_rb_build(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  ptr_t *keys,
+  ptr_t *values,
+  int n);
 
 #endif /* UNIC_HEADER_PTREERB_H */
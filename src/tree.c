@@ -15,13 +15,20 @@
  * along with this library; if not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+
 #include "unic/mem.h"
 #include "unic/tree.h"
 #include "tree-avl.h"
 #include "tree-bst.h"
+#include "tree-btree.h"
 #include "tree-rb.h"
 
+#define U_TREE_SLAB_MIN_NODES 16
+#define U_TREE_SLAB_MAX_NODES 1024
+
 typedef bool  (*PTreeInsertNode)(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
   cmp_data_fn_t compare_func,
   ptr_t data,
   destroy_fn_t key_destroy_func,
@@ -30,27 +37,243 @@ typedef bool  (*PTreeInsertNode)(PTreeBaseNode **root_node,
   ptr_t value);
 
 typedef bool  (*PTreeRemoveNode)(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
   cmp_data_fn_t compare_func,
   ptr_t data,
   destroy_fn_t key_destroy_func,
   destroy_fn_t value_destroy_func,
   const_ptr_t key);
 
-typedef void    (*PTreeFreeNode)(PTreeBaseNode *node);
+typedef bool  (*PTreeBuildNodes)(PTreeBaseNode **root_node,
+  PTreeSlab *slab,
+  ptr_t *keys,
+  ptr_t *values,
+  int n);
 
 struct tree {
   PTreeBaseNode *root;
   PTreeInsertNode insert_node_func;
   PTreeRemoveNode remove_node_func;
-  PTreeFreeNode free_node_func;
+  PTreeBuildNodes build_nodes_func;
+  PTreeSlab slabs[2];
   destroy_fn_t key_destroy_func;
   destroy_fn_t value_destroy_func;
   cmp_data_fn_t compare_func;
   ptr_t data;
   tree_kind_t type;
   int nnodes;
+  bool is_ranked;
 };
 
+static void
+pp_tree_iter_push(tree_iter_t *iter, PTreeBaseNode *node);
+
+static void
+pp_tree_iter_first(tree_iter_t *iter, bool is_last);
+
+static void
+pp_tree_iter_seek(tree_iter_t *iter, const_ptr_t key, bool is_upper);
+
+static bool
+pp_tree_iter_step(tree_iter_t *iter, bool is_forward);
+
+static void
+pp_tree_iter_get(const tree_iter_t *iter, ptr_t *key, ptr_t *value);
+
+/* A degenerated binary tree can be deeper than the cursor path, in such a
+ * case the path is dropped and every step searches from the root instead */
+static void
+pp_tree_iter_push(tree_iter_t *iter, PTreeBaseNode *node) {
+  if (iter->depth >= 0 && iter->depth < U_TREE_ITER_MAX_DEPTH) {
+    iter->path[iter->depth++] = node;
+  } else {
+    iter->depth = -1;
+  }
+  iter->node = node;
+}
+
+static void
+pp_tree_iter_first(tree_iter_t *iter, bool is_last) {
+  PTreeBaseNode *node;
+
+  if (iter->tree->type == U_TREE_TYPE_BTREE) {
+    u_tree_btree_iter_first(iter, iter->tree->root, is_last);
+    return;
+  }
+  iter->depth = 0;
+  iter->node = NULL;
+  for (node = iter->tree->root; node != NULL;
+    node = is_last ? node->right : node->left) {
+    pp_tree_iter_push(iter, node);
+  }
+}
+
+static void
+pp_tree_iter_seek(tree_iter_t *iter, const_ptr_t key, bool is_upper) {
+  tree_t *tree;
+  PTreeBaseNode *node, *bound;
+  int cmp_result, bound_depth;
+
+  tree = iter->tree;
+  if (tree->type == U_TREE_TYPE_BTREE) {
+    u_tree_btree_iter_seek(iter, tree->root, tree->compare_func, tree->data,
+      key, is_upper);
+    return;
+  }
+  iter->depth = 0;
+  bound = NULL;
+  bound_depth = 0;
+  for (node = tree->root; node != NULL;) {
+    cmp_result = U_TREE_COMPARE (tree->compare_func, tree->data,
+      key, node->key);
+    pp_tree_iter_push(iter, node);
+    if (cmp_result < 0 || (cmp_result == 0 && !is_upper)) {
+      bound = node;
+      bound_depth = iter->depth;
+      if (cmp_result == 0) {
+        break;
+      }
+      node = node->left;
+    } else {
+      node = node->right;
+    }
+  }
+  if (bound == NULL || iter->depth >= 0) {
+    iter->depth = bound_depth;
+  }
+  iter->node = bound;
+}
+
+static bool
+pp_tree_iter_step(tree_iter_t *iter, bool is_forward) {
+  tree_t *tree;
+  PTreeBaseNode *node, *next;
+  int cmp_result, depth;
+
+  tree = iter->tree;
+  if (tree->type == U_TREE_TYPE_BTREE) {
+    return u_tree_btree_iter_step(iter, is_forward);
+  }
+  if (iter->depth < 0) {
+    next = NULL;
+    for (node = tree->root; node != NULL;) {
+      cmp_result = tree->compare_func(
+        ((PTreeBaseNode *) iter->node)->key, node->key, tree->data);
+      if (is_forward ? cmp_result < 0 : cmp_result > 0) {
+        next = node;
+        node = is_forward ? node->left : node->right;
+      } else {
+        node = is_forward ? node->right : node->left;
+      }
+    }
+    if (next == NULL) {
+      return false;
+    }
+    iter->node = next;
+    return true;
+  }
+  node = iter->node;
+  if ((next = is_forward ? node->right : node->left) != NULL) {
+    for (; next != NULL; next = is_forward ? next->left : next->right) {
+      pp_tree_iter_push(iter, next);
+    }
+    return true;
+  }
+
+  /* Climb up until we come from the proper side, keep the path untouched
+   * if there is no such ancestor */
+  for (depth = iter->depth - 1; depth > 0; --depth) {
+    node = iter->path[depth - 1];
+    if ((is_forward ? node->left : node->right) == iter->path[depth]) {
+      iter->depth = depth;
+      iter->node = node;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void
+pp_tree_iter_get(const tree_iter_t *iter, ptr_t *key, ptr_t *value) {
+  if (iter->tree->type == U_TREE_TYPE_BTREE) {
+    u_tree_btree_iter_get(iter, key, value);
+    return;
+  }
+  if (key != NULL) {
+    *key = ((PTreeBaseNode *) iter->node)->key;
+  }
+  if (value != NULL) {
+    *value = ((PTreeBaseNode *) iter->node)->value;
+  }
+}
+
+void
+u_tree_slab_init(PTreeSlab *slab, size_t node_size) {
+  slab->free_nodes = NULL;
+  slab->chunks = NULL;
+  slab->node_size = node_size;
+  slab->chunk_nodes = U_TREE_SLAB_MIN_NODES;
+}
+
+ptr_t
+u_tree_slab_alloc(PTreeSlab *slab) {
+  byte_t *chunk;
+  ptr_t ret;
+  size_t i;
+
+  if (U_UNLIKELY (slab->free_nodes == NULL)) {
+    /* The first slot of a chunk links the chunks together */
+    chunk = u_malloc((slab->chunk_nodes + 1) * slab->node_size);
+    if (U_UNLIKELY (chunk == NULL)) {
+      return NULL;
+    }
+    *((ptr_t *) chunk) = slab->chunks;
+    slab->chunks = chunk;
+    for (i = slab->chunk_nodes; i > 0; --i) {
+      *((ptr_t *) (chunk + i * slab->node_size)) = slab->free_nodes;
+      slab->free_nodes = chunk + i * slab->node_size;
+    }
+    if (slab->chunk_nodes < U_TREE_SLAB_MAX_NODES) {
+      slab->chunk_nodes *= 2;
+    }
+  }
+  ret = slab->free_nodes;
+  slab->free_nodes = *((ptr_t *) ret);
+  memset(ret, 0, slab->node_size);
+  return ret;
+}
+
+void
+u_tree_slab_free(PTreeSlab *slab, ptr_t node) {
+  *((ptr_t *) node) = slab->free_nodes;
+  slab->free_nodes = node;
+}
+
+void
+u_tree_slab_release(PTreeSlab *slab) {
+  ptr_t chunk, next;
+
+  for (chunk = slab->chunks; chunk != NULL; chunk = next) {
+    next = *((ptr_t *) chunk);
+    u_free(chunk);
+  }
+  slab->free_nodes = NULL;
+  slab->chunks = NULL;
+  slab->chunk_nodes = U_TREE_SLAB_MIN_NODES;
+}
+
+int
+u_tree_compare_int(const_ptr_t a, const_ptr_t b, ptr_t data) {
+  U_UNUSED (data);
+  return U_TREE_COMPARE_INT (a, b);
+}
+
+int
+u_tree_compare_str(const_ptr_t a, const_ptr_t b, ptr_t data) {
+  U_UNUSED (data);
+  return strcmp((const char *) a, (const char *) b);
+}
+
 tree_t *
 u_tree_new(tree_kind_t type, cmp_fn_t func) {
   return u_tree_new_full(type, (cmp_data_fn_t) func, NULL, NULL, NULL);
@@ -61,12 +284,24 @@ u_tree_new_with_data(tree_kind_t type, cmp_data_fn_t func, ptr_t data) {
   return u_tree_new_full(type, func, data, NULL, NULL);
 }
 
+tree_t *
+u_tree_new_int(tree_kind_t type) {
+  return u_tree_new_full(type, u_tree_compare_int, NULL, NULL, NULL);
+}
+
+tree_t *
+u_tree_new_str(tree_kind_t type, destroy_fn_t key_destroy,
+  destroy_fn_t value_destroy) {
+  return u_tree_new_full(type, u_tree_compare_str, NULL, key_destroy,
+    value_destroy);
+}
+
 tree_t *
 u_tree_new_full(tree_kind_t type, cmp_data_fn_t func, ptr_t data,
   destroy_fn_t key_destroy, destroy_fn_t value_destroy) {
   tree_t *ret;
 
-  if (U_UNLIKELY (type < U_TREE_TYPE_BINARY || type > U_TREE_TYPE_AVL)) {
+  if (U_UNLIKELY (type < U_TREE_TYPE_BINARY || type > U_TREE_TYPE_BTREE)) {
     return NULL;
   }
   if (U_UNLIKELY (func == NULL)) {
@@ -85,17 +320,27 @@ u_tree_new_full(tree_kind_t type, cmp_data_fn_t func, ptr_t data,
     case U_TREE_TYPE_BINARY:
       ret->insert_node_func = u_tree_bst_insert;
       ret->remove_node_func = u_tree_bst_remove;
-      ret->free_node_func = u_tree_bst_node_free;
+      ret->build_nodes_func = u_tree_bst_build;
+      u_tree_slab_init(&ret->slabs[0], sizeof(PTreeBaseNode));
       break;
     case U_TREE_TYPE_RB:
       ret->insert_node_func = u_tree_rb_insert;
       ret->remove_node_func = u_tree_rb_remove;
-      ret->free_node_func = u_tree_rb_node_free;
+      ret->build_nodes_func = u_tree_rb_build;
+      u_tree_slab_init(&ret->slabs[0], u_tree_rb_node_size());
       break;
     case U_TREE_TYPE_AVL:
       ret->insert_node_func = u_tree_avl_insert;
       ret->remove_node_func = u_tree_avl_remove;
-      ret->free_node_func = u_tree_avl_node_free;
+      ret->build_nodes_func = u_tree_avl_build;
+      u_tree_slab_init(&ret->slabs[0], u_tree_avl_node_size());
+      break;
+    case U_TREE_TYPE_BTREE:
+      ret->insert_node_func = u_tree_btree_insert;
+      ret->remove_node_func = u_tree_btree_remove;
+      ret->build_nodes_func = u_tree_btree_build;
+      u_tree_slab_init(&ret->slabs[0], u_tree_btree_leaf_size());
+      u_tree_slab_init(&ret->slabs[1], u_tree_btree_inner_size());
       break;
   }
   return ret;
@@ -110,6 +355,7 @@ u_tree_insert(tree_t *tree, ptr_t key, ptr_t value) {
   }
   result = tree->insert_node_func(
     &tree->root,
+    tree->slabs,
     tree->compare_func,
     tree->data,
     tree->key_destroy_func,
@@ -122,6 +368,40 @@ u_tree_insert(tree_t *tree, ptr_t key, ptr_t value) {
   }
 }
 
+bool
+u_tree_build_sorted(tree_t *tree, ptr_t *keys, ptr_t *values, int n) {
+  PTreeBaseNode *root;
+  PTreeSlab slabs[2];
+  int i;
+
+  if (U_UNLIKELY (tree == NULL || n < 0 || (keys == NULL && n > 0))) {
+    return false;
+  }
+  for (i = 1; i < n; ++i) {
+    if (U_UNLIKELY (tree->compare_func(keys[i - 1], keys[i], tree->data)
+      >= 0)) {
+      return false;
+    }
+  }
+
+  /* Build into separate slabs to keep the tree intact on failure */
+  u_tree_slab_init(&slabs[0], tree->slabs[0].node_size);
+  u_tree_slab_init(&slabs[1], tree->slabs[1].node_size);
+  root = NULL;
+  if (n > 0 && U_UNLIKELY (!tree->build_nodes_func(&root, slabs, keys, values,
+    n))) {
+    u_tree_slab_release(&slabs[0]);
+    u_tree_slab_release(&slabs[1]);
+    return false;
+  }
+  u_tree_clear(tree);
+  tree->root = root;
+  tree->slabs[0] = slabs[0];
+  tree->slabs[1] = slabs[1];
+  tree->nnodes = n;
+  return true;
+}
+
 bool
 u_tree_remove(tree_t *tree, const_ptr_t key) {
   bool result;
@@ -131,14 +411,17 @@ u_tree_remove(tree_t *tree, const_ptr_t key) {
   }
   result = tree->remove_node_func(
     &tree->root,
+    tree->slabs,
     tree->compare_func,
     tree->data,
     tree->key_destroy_func,
     tree->value_destroy_func,
     key
   );
-  if (result == true) {
-    --tree->nnodes;
+  if (result == true && --tree->nnodes == 0) {
+    /* Give the memory back once the tree is empty */
+    u_tree_slab_release(&tree->slabs[0]);
+    u_tree_slab_release(&tree->slabs[1]);
   }
   return result;
 }
@@ -151,9 +434,13 @@ u_tree_lookup(tree_t *tree, const_ptr_t key) {
   if (U_UNLIKELY (tree == NULL)) {
     return NULL;
   }
+  if (tree->type == U_TREE_TYPE_BTREE) {
+    return u_tree_btree_lookup(tree->root, tree->compare_func, tree->data, key);
+  }
   cur_node = tree->root;
   while (cur_node != NULL) {
-    cmp_result = tree->compare_func(key, cur_node->key, tree->data);
+    cmp_result = U_TREE_COMPARE (tree->compare_func, tree->data,
+      key, cur_node->key);
     if (cmp_result < 0) {
       cur_node = cur_node->left;
     } else if (cmp_result > 0) {
@@ -178,6 +465,10 @@ u_tree_foreach(tree_t *tree, traverse_fn_t traverse_func, ptr_t user_data) {
   if (U_UNLIKELY (tree->root == NULL)) {
     return;
   }
+  if (tree->type == U_TREE_TYPE_BTREE) {
+    u_tree_btree_foreach(tree->root, traverse_func, user_data);
+    return;
+  }
   cur_node = tree->root;
   mod_counter = 0;
   need_stop = false;
@@ -225,10 +516,21 @@ u_tree_clear(tree_t *tree) {
   PTreeBaseNode *prev_node;
   PTreeBaseNode *next_node;
 
-  if (U_UNLIKELY (tree == NULL || tree->root == NULL)) {
+  if (U_UNLIKELY (tree == NULL)) {
     return;
   }
-  cur_node = tree->root;
+
+  /* Nodes are released with the slabs, walk the tree only to destroy the
+   * pairs, breaking the links on the way as the nodes are dropped anyway */
+  if (tree->key_destroy_func == NULL && tree->value_destroy_func == NULL) {
+    cur_node = NULL;
+  } else if (tree->type == U_TREE_TYPE_BTREE) {
+    u_tree_btree_destroy(tree->root, tree->key_destroy_func,
+      tree->value_destroy_func);
+    cur_node = NULL;
+  } else {
+    cur_node = tree->root;
+  }
   while (cur_node != NULL) {
     if (cur_node->left == NULL) {
       next_node = cur_node->right;
@@ -238,8 +540,6 @@ u_tree_clear(tree_t *tree) {
       if (tree->value_destroy_func != NULL) {
         tree->value_destroy_func(cur_node->value);
       }
-      tree->free_node_func(cur_node);
-      --tree->nnodes;
       cur_node = next_node;
     } else {
       prev_node = cur_node->left;
@@ -252,7 +552,188 @@ u_tree_clear(tree_t *tree) {
       cur_node = next_node;
     }
   }
+  u_tree_slab_release(&tree->slabs[0]);
+  u_tree_slab_release(&tree->slabs[1]);
   tree->root = NULL;
+  tree->nnodes = 0;
+}
+
+bool
+u_tree_lower_bound(tree_t *tree, const_ptr_t key, ptr_t *found_key,
+  ptr_t *value) {
+  tree_iter_t iter;
+
+  if (U_UNLIKELY (tree == NULL)) {
+    return false;
+  }
+  u_tree_iter_init(&iter, tree);
+  u_tree_iter_seek(&iter, key);
+  return u_tree_iter_next(&iter, found_key, value);
+}
+
+bool
+u_tree_upper_bound(tree_t *tree, const_ptr_t key, ptr_t *found_key,
+  ptr_t *value) {
+  tree_iter_t iter;
+
+  if (U_UNLIKELY (tree == NULL)) {
+    return false;
+  }
+  u_tree_iter_init(&iter, tree);
+  pp_tree_iter_seek(&iter, key, true);
+  return u_tree_iter_next(&iter, found_key, value);
+}
+
+bool
+u_tree_min(tree_t *tree, ptr_t *key, ptr_t *value) {
+  tree_iter_t iter;
+
+  if (U_UNLIKELY (tree == NULL)) {
+    return false;
+  }
+  u_tree_iter_init(&iter, tree);
+  return u_tree_iter_next(&iter, key, value);
+}
+
+bool
+u_tree_max(tree_t *tree, ptr_t *key, ptr_t *value) {
+  tree_iter_t iter;
+
+  if (U_UNLIKELY (tree == NULL)) {
+    return false;
+  }
+  u_tree_iter_init(&iter, tree);
+  u_tree_iter_seek_end(&iter);
+  return u_tree_iter_prev(&iter, key, value);
+}
+
+bool
+u_tree_enable_ranks(tree_t *tree) {
+  if (U_UNLIKELY (tree == NULL)) {
+    return false;
+  }
+  if (tree->is_ranked) {
+    return true;
+  }
+  switch (tree->type) {
+    case U_TREE_TYPE_RB:
+      tree->insert_node_func = u_tree_rb_insert_ranked;
+      tree->remove_node_func = u_tree_rb_remove_ranked;
+      u_tree_rb_rank_init(tree->root);
+      break;
+    case U_TREE_TYPE_AVL:
+      tree->insert_node_func = u_tree_avl_insert_ranked;
+      tree->remove_node_func = u_tree_avl_remove_ranked;
+      u_tree_avl_rank_init(tree->root);
+      break;
+    default:
+      return false;
+  }
+  tree->is_ranked = true;
+  return true;
+}
+
+bool
+u_tree_select(tree_t *tree, int index, ptr_t *key, ptr_t *value) {
+  PTreeBaseNode *node;
+
+  if (U_UNLIKELY (tree == NULL || !tree->is_ranked)) {
+    return false;
+  }
+  if (index < 0 || index >= tree->nnodes) {
+    return false;
+  }
+  if (tree->type == U_TREE_TYPE_RB) {
+    node = u_tree_rb_select(tree->root, index);
+  } else {
+    node = u_tree_avl_select(tree->root, index);
+  }
+  if (key != NULL) {
+    *key = node->key;
+  }
+  if (value != NULL) {
+    *value = node->value;
+  }
+  return true;
+}
+
+int
+u_tree_rank(tree_t *tree, const_ptr_t key) {
+  if (U_UNLIKELY (tree == NULL || !tree->is_ranked)) {
+    return -1;
+  }
+  if (tree->type == U_TREE_TYPE_RB) {
+    return u_tree_rb_rank(tree->root, tree->compare_func, tree->data, key);
+  }
+  return u_tree_avl_rank(tree->root, tree->compare_func, tree->data, key);
+}
+
+void
+u_tree_iter_init(tree_iter_t *iter, tree_t *tree) {
+  if (U_UNLIKELY (iter == NULL)) {
+    return;
+  }
+  iter->tree = tree;
+  iter->node = NULL;
+  iter->depth = 0;
+  iter->is_before = true;
+  if (tree != NULL) {
+    pp_tree_iter_first(iter, false);
+  }
+}
+
+void
+u_tree_iter_seek(tree_iter_t *iter, const_ptr_t key) {
+  if (U_UNLIKELY (iter == NULL || iter->tree == NULL)) {
+    return;
+  }
+  pp_tree_iter_seek(iter, key, false);
+  iter->is_before = true;
+}
+
+void
+u_tree_iter_seek_end(tree_iter_t *iter) {
+  if (U_UNLIKELY (iter == NULL)) {
+    return;
+  }
+  iter->node = NULL;
+  iter->depth = 0;
+}
+
+/* The cursor stands right before or right after the node it points to, no
+ * node means the position after the last pair */
+bool
+u_tree_iter_next(tree_iter_t *iter, ptr_t *key, ptr_t *value) {
+  if (U_UNLIKELY (iter == NULL || iter->tree == NULL || iter->node == NULL)) {
+    return false;
+  }
+  if (iter->is_before) {
+    iter->is_before = false;
+  } else if (!pp_tree_iter_step(iter, true)) {
+    iter->node = NULL;
+    iter->depth = 0;
+    return false;
+  }
+  pp_tree_iter_get(iter, key, value);
+  return true;
+}
+
+bool
+u_tree_iter_prev(tree_iter_t *iter, ptr_t *key, ptr_t *value) {
+  if (U_UNLIKELY (iter == NULL || iter->tree == NULL)) {
+    return false;
+  }
+  if (iter->node == NULL) {
+    pp_tree_iter_first(iter, true);
+    if (iter->node == NULL) {
+      return false;
+    }
+  } else if (iter->is_before && !pp_tree_iter_step(iter, false)) {
+    return false;
+  }
+  iter->is_before = true;
+  pp_tree_iter_get(iter, key, value);
+  return true;
 }
 
 tree_kind_t
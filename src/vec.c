@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "unic/mem.h"
+#include "unic/vec.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define U_VEC_MIN_CAPACITY 8
+
+struct vec {
+  byte_t *data;
+  size_t elem_size;
+  size_t size;
+  size_t capacity;
+};
+
+static bool
+pp_vec_resize(vec_t *vec, size_t capacity);
+
+static bool
+pp_vec_grow(vec_t *vec, size_t n);
+
+static bool
+pp_vec_resize(vec_t *vec, size_t capacity) {
+  byte_t *data;
+
+  if (capacity > ((size_t) -1) / vec->elem_size) {
+    return false;
+  }
+  if (capacity == 0) {
+    u_free(vec->data);
+    vec->data = NULL;
+  } else {
+    if ((data = u_realloc(vec->data, capacity * vec->elem_size)) == NULL) {
+      return false;
+    }
+    vec->data = data;
+  }
+  vec->capacity = capacity;
+  return true;
+}
+
+static bool
+pp_vec_grow(vec_t *vec, size_t n) {
+  size_t capacity;
+
+  if (n > ((size_t) -1) - vec->size) {
+    return false;
+  }
+  if (vec->size + n <= vec->capacity) {
+    return true;
+  }
+  capacity = vec->capacity < U_VEC_MIN_CAPACITY ?
+    U_VEC_MIN_CAPACITY : vec->capacity;
+  while (capacity < vec->size + n) {
+    if (capacity > ((size_t) -1) / 2) {
+      capacity = vec->size + n;
+      break;
+    }
+    capacity *= 2;
+  }
+  return pp_vec_resize(vec, capacity);
+}
+
+vec_t *
+u_vec_new(size_t elem_size) {
+  vec_t *ret;
+
+  if (U_UNLIKELY (elem_size == 0)) {
+    return NULL;
+  }
+  if (U_UNLIKELY ((ret = u_malloc0(sizeof(vec_t))) == NULL)) {
+    U_ERROR ("vec_t::u_vec_new: failed to allocate memory");
+    return NULL;
+  }
+  ret->elem_size = elem_size;
+  return ret;
+}
+
+void
+u_vec_free(vec_t *vec) {
+  if (U_UNLIKELY (vec == NULL)) {
+    return;
+  }
+  u_free(vec->data);
+  u_free(vec);
+}
+
+size_t
+u_vec_get_size(const vec_t *vec) {
+  if (U_UNLIKELY (vec == NULL)) {
+    return 0;
+  }
+  return vec->size;
+}
+
+size_t
+u_vec_get_capacity(const vec_t *vec) {
+  if (U_UNLIKELY (vec == NULL)) {
+    return 0;
+  }
+  return vec->capacity;
+}
+
+ptr_t
+u_vec_data(const vec_t *vec) {
+  if (U_UNLIKELY (vec == NULL)) {
+    return NULL;
+  }
+  return vec->data;
+}
+
+ptr_t
+u_vec_at(const vec_t *vec, size_t index) {
+  if (U_UNLIKELY (vec == NULL || index >= vec->size)) {
+    return NULL;
+  }
+  return vec->data + index * vec->elem_size;
+}
+
+bool
+u_vec_push(vec_t *vec, const_ptr_t elem) {
+  return u_vec_insert(vec, u_vec_get_size(vec), elem);
+}
+
+bool
+u_vec_pop(vec_t *vec, ptr_t elem) {
+  if (U_UNLIKELY (vec == NULL || vec->size == 0)) {
+    return false;
+  }
+  return u_vec_remove(vec, vec->size - 1, elem);
+}
+
+bool
+u_vec_append(vec_t *vec, const_ptr_t elems, size_t n) {
+  if (U_UNLIKELY (vec == NULL || (elems == NULL && n > 0))) {
+    return false;
+  }
+  if (n == 0) {
+    return true;
+  }
+  if (U_UNLIKELY (!pp_vec_grow(vec, n))) {
+    U_ERROR ("vec_t::u_vec_append: failed to allocate memory");
+    return false;
+  }
+  memcpy(vec->data + vec->size * vec->elem_size, elems, n * vec->elem_size);
+  vec->size += n;
+  return true;
+}
+
+bool
+u_vec_insert(vec_t *vec, size_t index, const_ptr_t elem) {
+  byte_t *pos;
+
+  if (U_UNLIKELY (vec == NULL || index > vec->size)) {
+    return false;
+  }
+  if (U_UNLIKELY (!pp_vec_grow(vec, 1))) {
+    U_ERROR ("vec_t::u_vec_insert: failed to allocate memory");
+    return false;
+  }
+  pos = vec->data + index * vec->elem_size;
+  if (index < vec->size) {
+    memmove(pos + vec->elem_size, pos, (vec->size - index) * vec->elem_size);
+  }
+  if (elem != NULL) {
+    memcpy(pos, elem, vec->elem_size);
+  } else {
+    memset(pos, 0, vec->elem_size);
+  }
+  ++vec->size;
+  return true;
+}
+
+bool
+u_vec_remove(vec_t *vec, size_t index, ptr_t elem) {
+  byte_t *pos;
+
+  if (U_UNLIKELY (vec == NULL || index >= vec->size)) {
+    return false;
+  }
+  pos = vec->data + index * vec->elem_size;
+  if (elem != NULL) {
+    memcpy(elem, pos, vec->elem_size);
+  }
+  --vec->size;
+  if (index < vec->size) {
+    memmove(pos, pos + vec->elem_size, (vec->size - index) * vec->elem_size);
+  }
+  return true;
+}
+
+void
+u_vec_clear(vec_t *vec) {
+  if (U_UNLIKELY (vec == NULL)) {
+    return;
+  }
+  vec->size = 0;
+}
+
+bool
+u_vec_reserve(vec_t *vec, size_t n) {
+  if (U_UNLIKELY (vec == NULL)) {
+    return false;
+  }
+  if (n <= vec->capacity) {
+    return true;
+  }
+  if (U_UNLIKELY (!pp_vec_resize(vec, n))) {
+    U_ERROR ("vec_t::u_vec_reserve: failed to allocate memory");
+    return false;
+  }
+  return true;
+}
+
+bool
+u_vec_shrink(vec_t *vec) {
+  if (U_UNLIKELY (vec == NULL)) {
+    return false;
+  }
+  if (vec->size == vec->capacity) {
+    return true;
+  }
+  return pp_vec_resize(vec, vec->size);
+}
+
+void
+u_vec_sort(vec_t *vec, cmp_fn_t func) {
+  if (U_UNLIKELY (vec == NULL || func == NULL)) {
+    return;
+  }
+  if (vec->size > 1) {
+    qsort(vec->data, vec->size, vec->elem_size, func);
+  }
+}
+
+bool
+u_vec_bsearch(const vec_t *vec, const_ptr_t key, cmp_fn_t func,
+  size_t *index) {
+  size_t lo, hi, mid;
+
+  if (U_UNLIKELY (vec == NULL || func == NULL)) {
+    return false;
+  }
+
+  /* Lower bound, so the first of several equal elements is found */
+  lo = 0;
+  hi = vec->size;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (func(vec->data + mid * vec->elem_size, key) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (index != NULL) {
+    *index = lo;
+  }
+  return lo < vec->size && func(vec->data + lo * vec->elem_size, key) == 0;
+}
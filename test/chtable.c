@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include "cute.h"
+#include "unic.h"
+
+CUTEST_DATA {
+  int dummy;
+};
+
+CUTEST_SETUP { u_libsys_init(); }
+
+CUTEST_TEARDOWN { u_libsys_shutdown(); }
+
+#define PCHTABLE_THREADS 4
+#define PCHTABLE_THREAD_KEYS 20000
+
+static chtable_t *test_table = NULL;
+static volatile int pp_chtable_destroy_count = 0;
+
+ptr_t
+pmem_alloc(size_t nbytes) {
+  U_UNUSED(nbytes);
+  return (ptr_t) NULL;
+}
+
+ptr_t
+pmem_realloc(ptr_t block, size_t nbytes) {
+  U_UNUSED(block);
+  U_UNUSED(nbytes);
+  return (ptr_t) NULL;
+}
+
+void
+pmem_free(ptr_t block) {
+  U_UNUSED(block);
+}
+
+static void
+test_chtable_destroy(ptr_t data) {
+  U_UNUSED(data);
+  u_atomic_int_inc(&pp_chtable_destroy_count);
+}
+
+static bool
+test_chtable_traverse(ptr_t key, ptr_t value, ptr_t user_data) {
+  int *counter;
+
+  counter = (int *) user_data;
+  if (PPOINTER_TO_INT (key) * 10 != PPOINTER_TO_INT (value)) {
+    ++counter[1];
+  }
+  return ++counter[0] == counter[2];
+}
+
+static void *
+test_chtable_thread_func(void *data) {
+  int base;
+  int i;
+
+  base = PPOINTER_TO_INT (data) * PCHTABLE_THREAD_KEYS + 1;
+  for (i = 0; i < PCHTABLE_THREAD_KEYS; ++i) {
+    u_chtable_insert(
+      test_table, PINT_TO_POINTER (base + i), PINT_TO_POINTER ((base + i) * 10)
+    );
+  }
+  for (i = 0; i < PCHTABLE_THREAD_KEYS; ++i) {
+    if (u_chtable_lookup(test_table, PINT_TO_POINTER (base + i))
+      != PINT_TO_POINTER ((base + i) * 10)) {
+      u_thread_exit(-1);
+    }
+  }
+  for (i = 0; i < PCHTABLE_THREAD_KEYS; i += 2) {
+    u_chtable_remove(test_table, PINT_TO_POINTER (base + i));
+  }
+  for (i = 0; i < PCHTABLE_THREAD_KEYS; ++i) {
+    if ((u_chtable_lookup(test_table, PINT_TO_POINTER (base + i))
+      == (ptr_t) -1) != (i % 2 == 0)) {
+      u_thread_exit(-1);
+    }
+  }
+  u_thread_exit(0);
+  return NULL;
+}
+
+CUTEST(chtable, nomem) {
+  mem_vtable_t vtable;
+
+  vtable.free = pmem_free;
+  vtable.malloc = pmem_alloc;
+  vtable.realloc = pmem_realloc;
+  ASSERT(u_mem_set_vtable(&vtable) == true);
+  ASSERT(u_chtable_new() == NULL);
+  u_mem_restore_vtable();
+  return CUTE_SUCCESS;
+}
+
+CUTEST(chtable, invalid) {
+  ASSERT(u_chtable_lookup(NULL, NULL) == NULL);
+  ASSERT(u_chtable_get_nshards(NULL) == 0);
+  u_chtable_insert(NULL, NULL, NULL);
+  u_chtable_remove(NULL, NULL);
+  u_chtable_foreach(NULL, NULL, NULL);
+  u_chtable_free(NULL);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(chtable, general) {
+  chtable_t *table;
+  int counter[3];
+  int i;
+
+  table = u_chtable_new_full(
+    5, NULL, NULL, NULL, test_chtable_destroy
+  );
+  ASSERT(table != NULL);
+  ASSERT(u_chtable_get_nshards(table) == 8);
+  ASSERT(u_chtable_lookup(table, PINT_TO_POINTER (1)) == (ptr_t) -1);
+  for (i = 1; i <= 1000; ++i) {
+    u_chtable_insert(table, PINT_TO_POINTER (i), PINT_TO_POINTER (i * 10));
+  }
+  for (i = 1; i <= 1000; ++i) {
+    ASSERT(u_chtable_lookup(table, PINT_TO_POINTER (i))
+      == PINT_TO_POINTER (i * 10));
+  }
+  memset(counter, 0, sizeof(counter));
+  u_chtable_foreach(table, test_chtable_traverse, counter);
+  ASSERT(counter[0] == 1000);
+  ASSERT(counter[1] == 0);
+  memset(counter, 0, sizeof(counter));
+  counter[2] = 10;
+  u_chtable_foreach(table, test_chtable_traverse, counter);
+  ASSERT(counter[0] == 10);
+  pp_chtable_destroy_count = 0;
+  for (i = 1; i <= 1000; i += 2) {
+    u_chtable_remove(table, PINT_TO_POINTER (i));
+  }
+  ASSERT(pp_chtable_destroy_count == 500);
+  for (i = 1; i <= 1000; ++i) {
+    ASSERT((u_chtable_lookup(table, PINT_TO_POINTER (i)) == (ptr_t) -1)
+      == (i % 2 == 1));
+  }
+  u_chtable_free(table);
+  ASSERT(pp_chtable_destroy_count == 1000);
+  table = u_chtable_new();
+  ASSERT(table != NULL);
+  ASSERT(u_chtable_get_nshards(table) >= 1);
+  u_chtable_free(table);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(chtable, threads) {
+  thread_t *threads[PCHTABLE_THREADS];
+  int counter[3];
+  int i;
+
+  test_table = u_chtable_new();
+  ASSERT(test_table != NULL);
+  for (i = 0; i < PCHTABLE_THREADS; ++i) {
+    threads[i] = u_thread_create(
+      (thread_fn_t) test_chtable_thread_func, PINT_TO_POINTER (i), true
+    );
+    ASSERT(threads[i] != NULL);
+  }
+  for (i = 0; i < PCHTABLE_THREADS; ++i) {
+    ASSERT(u_thread_join(threads[i]) == 0);
+    u_thread_unref(threads[i]);
+  }
+  memset(counter, 0, sizeof(counter));
+  u_chtable_foreach(test_table, test_chtable_traverse, counter);
+  ASSERT(counter[0] == PCHTABLE_THREADS * PCHTABLE_THREAD_KEYS / 2);
+  ASSERT(counter[1] == 0);
+  u_chtable_free(test_table);
+  test_table = NULL;
+  return CUTE_SUCCESS;
+}
+
+int
+main(int ac, char **av) {
+  CUTEST_DATA test = {0};
+
+  CUTEST_PASS(chtable, nomem);
+  CUTEST_PASS(chtable, invalid);
+  CUTEST_PASS(chtable, general);
+  CUTEST_PASS(chtable, threads);
+  return EXIT_SUCCESS;
+}
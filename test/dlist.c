@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include "cute.h"
+#include "unic.h"
+
+CUTEST_DATA {
+  int dummy;
+};
+
+CUTEST_SETUP { u_libsys_init(); }
+
+CUTEST_TEARDOWN { u_libsys_shutdown(); }
+
+typedef struct test_item {
+  int id;
+  dlist_node_t node;
+} test_item_t;
+
+static int
+test_dlist_id(dlist_node_t *node) {
+  return U_DLIST_ENTRY (node, test_item_t, node)->id;
+}
+
+/* Checks links in both directions against the expected ids */
+static bool
+test_dlist_check(const dlist_t *list, const int *ids, size_t n) {
+  dlist_node_t *node;
+  size_t i;
+
+  if (list->count != n) {
+    return false;
+  }
+  for (i = 0, node = list->head; node != NULL; node = node->next, ++i) {
+    if (i >= n || test_dlist_id(node) != ids[i]) {
+      return false;
+    }
+  }
+  if (i != n) {
+    return false;
+  }
+  for (node = list->tail; node != NULL; node = node->prev) {
+    if (test_dlist_id(node) != ids[--i]) {
+      return false;
+    }
+  }
+  return i == 0;
+}
+
+static void
+test_dlist_free_item(ptr_t data, ptr_t user_data) {
+  ++*((int *) user_data);
+  u_free(U_DLIST_ENTRY (data, test_item_t, node));
+}
+
+CUTEST(dlist, invalid) {
+  dlist_t list;
+  dlist_node_t node;
+
+  u_dlist_init(NULL);
+  u_dlist_append(NULL, &node);
+  u_dlist_prepend(NULL, &node);
+  u_dlist_insert_before(NULL, NULL, &node);
+  u_dlist_insert_after(NULL, NULL, &node);
+  u_dlist_remove(NULL, &node);
+  u_dlist_move_to_front(NULL, &node);
+  u_dlist_move_to_back(NULL, &node);
+  u_dlist_foreach(NULL, NULL, NULL);
+  ASSERT(u_dlist_pop_front(NULL) == NULL);
+  ASSERT(u_dlist_pop_back(NULL) == NULL);
+  u_dlist_init(&list);
+  u_dlist_append(&list, NULL);
+  u_dlist_remove(&list, NULL);
+  u_dlist_foreach(&list, NULL, NULL);
+  ASSERT(list.count == 0);
+  ASSERT(u_dlist_pop_front(&list) == NULL);
+  ASSERT(u_dlist_pop_back(&list) == NULL);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(dlist, general) {
+  test_item_t items[6];
+  dlist_t list;
+  int i;
+
+  for (i = 0; i < 6; ++i) {
+    items[i].id = i;
+  }
+  u_dlist_init(&list);
+  ASSERT(list.head == NULL && list.tail == NULL && list.count == 0);
+  u_dlist_append(&list, &items[1].node);
+  u_dlist_append(&list, &items[2].node);
+  u_dlist_prepend(&list, &items[0].node);
+  {
+    int ids[] = {0, 1, 2};
+    ASSERT(test_dlist_check(&list, ids, 3));
+  }
+  u_dlist_insert_before(&list, &items[0].node, &items[3].node);
+  u_dlist_insert_after(&list, &items[2].node, &items[4].node);
+  u_dlist_insert_after(&list, &items[0].node, &items[5].node);
+  {
+    int ids[] = {3, 0, 5, 1, 2, 4};
+    ASSERT(test_dlist_check(&list, ids, 6));
+  }
+  u_dlist_remove(&list, &items[5].node);
+  ASSERT(items[5].node.next == NULL && items[5].node.prev == NULL);
+  u_dlist_remove(&list, &items[3].node);
+  u_dlist_remove(&list, &items[4].node);
+  {
+    int ids[] = {0, 1, 2};
+    ASSERT(test_dlist_check(&list, ids, 3));
+  }
+  ASSERT(u_dlist_pop_front(&list) == &items[0].node);
+  ASSERT(u_dlist_pop_back(&list) == &items[2].node);
+  {
+    int ids[] = {1};
+    ASSERT(test_dlist_check(&list, ids, 1));
+  }
+  ASSERT(u_dlist_pop_back(&list) == &items[1].node);
+  ASSERT(test_dlist_check(&list, NULL, 0));
+  ASSERT(list.head == NULL && list.tail == NULL);
+  u_dlist_insert_before(&list, NULL, &items[0].node);
+  u_dlist_insert_after(&list, NULL, &items[1].node);
+  {
+    int ids[] = {1, 0};
+    ASSERT(test_dlist_check(&list, ids, 2));
+  }
+  return CUTE_SUCCESS;
+}
+
+CUTEST(dlist, lru) {
+  test_item_t *item;
+  dlist_node_t *node;
+  dlist_t list;
+  int i, freed;
+
+  /* Keep the 100 most recently used of 1000 ids */
+  u_dlist_init(&list);
+  for (i = 0; i < 1000; ++i) {
+    item = u_malloc0(sizeof(test_item_t));
+    ASSERT(item != NULL);
+    item->id = i;
+    u_dlist_append(&list, &item->node);
+    if (list.count > 100) {
+      node = u_dlist_pop_front(&list);
+      u_free(U_DLIST_ENTRY (node, test_item_t, node));
+    }
+    if (i % 10 == 0) {
+      u_dlist_move_to_back(&list, list.head);
+    }
+  }
+  ASSERT(list.count == 100);
+  ASSERT(test_dlist_id(list.tail) == 999);
+  u_dlist_move_to_front(&list, list.tail);
+  ASSERT(test_dlist_id(list.head) == 999);
+  u_dlist_move_to_front(&list, list.head);
+  u_dlist_move_to_back(&list, list.tail);
+  ASSERT(test_dlist_id(list.head) == 999);
+  freed = 0;
+  u_dlist_foreach(&list, test_dlist_free_item, &freed);
+  ASSERT(freed == 100);
+  u_dlist_init(&list);
+  return CUTE_SUCCESS;
+}
+
+int
+main(int ac, char **av) {
+  CUTEST_DATA test = {0};
+
+  CUTEST_PASS(dlist, invalid);
+  CUTEST_PASS(dlist, general);
+  CUTEST_PASS(dlist, lru);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include "cute.h"
+#include "unic.h"
+
+CUTEST_DATA {
+  int dummy;
+};
+
+CUTEST_SETUP { u_libsys_init(); }
+
+CUTEST_TEARDOWN { u_libsys_shutdown(); }
+
+#define PHINDEX_TEST_FILE "." U_DIR_SEP "u_hindex_test_file.idx"
+#define PHINDEX_TEST_COUNT 20000
+
+ptr_t
+pmem_alloc(size_t nbytes) {
+  U_UNUSED(nbytes);
+  return (ptr_t) NULL;
+}
+
+ptr_t
+pmem_realloc(ptr_t block, size_t nbytes) {
+  U_UNUSED(block);
+  U_UNUSED(nbytes);
+  return (ptr_t) NULL;
+}
+
+void
+pmem_free(ptr_t block) {
+  U_UNUSED(block);
+}
+
+CUTEST(hindex, nomem) {
+  htable_t *table;
+  hindex_t *index;
+  mem_vtable_t vtable;
+  err_t *error;
+
+  table = u_htable_new();
+  ASSERT(table != NULL);
+  u_htable_insert(table, "key", "value");
+  ASSERT(u_hindex_write(table, PHINDEX_TEST_FILE, NULL) == true);
+  vtable.free = pmem_free;
+  vtable.malloc = pmem_alloc;
+  vtable.realloc = pmem_realloc;
+  ASSERT(u_mem_set_vtable(&vtable) == true);
+  index = u_hindex_open(PHINDEX_TEST_FILE, &error);
+  ASSERT(index == NULL);
+  ASSERT(u_hindex_write(table, PHINDEX_TEST_FILE, NULL) == false);
+  u_mem_restore_vtable();
+  u_htable_free(table);
+  ASSERT(u_file_remove(PHINDEX_TEST_FILE, NULL) == true);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(hindex, invalid) {
+  htable_t *table;
+  err_t *error;
+  FILE *file;
+  const byte_t *value;
+  byte_t buf[128];
+
+  error = NULL;
+  ASSERT(u_hindex_write(NULL, NULL, &error) == false);
+  ASSERT(error != NULL);
+  u_err_free(error);
+  error = NULL;
+  ASSERT(u_hindex_open(NULL, &error) == NULL);
+  ASSERT(error != NULL);
+  u_err_free(error);
+  error = NULL;
+  ASSERT(u_hindex_open("./bad_file_path/fake.idx", &error) == NULL);
+  ASSERT(error != NULL);
+  u_err_free(error);
+  ASSERT(u_hindex_lookup(NULL, "key", &value) == false);
+  ASSERT(u_hindex_get_size(NULL) == 0);
+  u_hindex_close(NULL);
+
+  /* Tables with NULL keys can not be written */
+  table = u_htable_new();
+  ASSERT(table != NULL);
+  u_htable_insert(table, NULL, "value");
+  ASSERT(u_hindex_write(table, PHINDEX_TEST_FILE, NULL) == false);
+  u_htable_free(table);
+
+  /* Not an index file */
+  memset(buf, 'x', sizeof(buf));
+  file = fopen(PHINDEX_TEST_FILE, "wb");
+  ASSERT(file != NULL);
+  ASSERT(fwrite(buf, sizeof(buf), 1, file) == 1);
+  fclose(file);
+  error = NULL;
+  ASSERT(u_hindex_open(PHINDEX_TEST_FILE, &error) == NULL);
+  ASSERT(error != NULL);
+  u_err_free(error);
+
+  /* Too short for a header */
+  file = fopen(PHINDEX_TEST_FILE, "wb");
+  ASSERT(file != NULL);
+  fclose(file);
+  ASSERT(u_hindex_open(PHINDEX_TEST_FILE, NULL) == NULL);
+  ASSERT(u_file_remove(PHINDEX_TEST_FILE, NULL) == true);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(hindex, general) {
+  htable_t *table;
+  hindex_t *index;
+  byte_t **keys;
+  byte_t buf[64];
+  const byte_t *value;
+  int i;
+
+  keys = u_malloc0(PHINDEX_TEST_COUNT * sizeof(byte_t *));
+  ASSERT(keys != NULL);
+  table = u_htable_new_full(u_htable_str_hash, u_htable_str_equal, NULL, NULL);
+  ASSERT(table != NULL);
+  for (i = 0; i < PHINDEX_TEST_COUNT; ++i) {
+    snprintf(buf, sizeof(buf), "key-%d", i);
+    keys[i] = u_strdup(buf);
+    ASSERT(keys[i] != NULL);
+    u_htable_insert(table, keys[i], i % 100 == 0 ? NULL : keys[i] + 4);
+  }
+  u_htable_insert(table, "", "empty");
+  ASSERT(u_hindex_write(table, PHINDEX_TEST_FILE, NULL) == true);
+  u_htable_free(table);
+  index = u_hindex_open(PHINDEX_TEST_FILE, NULL);
+  ASSERT(index != NULL);
+  ASSERT(u_hindex_get_size(index) == PHINDEX_TEST_COUNT + 1);
+  for (i = 0; i < PHINDEX_TEST_COUNT; ++i) {
+    value = "not-null";
+    ASSERT(u_hindex_lookup(index, keys[i], &value) == true);
+    if (i % 100 == 0) {
+      ASSERT(value == NULL);
+    } else {
+      ASSERT(value != NULL && strcmp(value, keys[i] + 4) == 0);
+    }
+    ASSERT(u_hindex_lookup(index, keys[i], NULL) == true);
+  }
+  ASSERT(u_hindex_lookup(index, "", &value) == true);
+  ASSERT(strcmp(value, "empty") == 0);
+  ASSERT(u_hindex_lookup(index, "key-", &value) == false);
+  ASSERT(u_hindex_lookup(index, "missing", NULL) == false);
+  u_hindex_close(index);
+
+  /* Empty tables make valid indexes */
+  table = u_htable_new();
+  ASSERT(table != NULL);
+  ASSERT(u_hindex_write(table, PHINDEX_TEST_FILE, NULL) == true);
+  u_htable_free(table);
+  index = u_hindex_open(PHINDEX_TEST_FILE, NULL);
+  ASSERT(index != NULL);
+  ASSERT(u_hindex_get_size(index) == 0);
+  ASSERT(u_hindex_lookup(index, "key-1", NULL) == false);
+  u_hindex_close(index);
+  for (i = 0; i < PHINDEX_TEST_COUNT; ++i) {
+    u_free(keys[i]);
+  }
+  u_free(keys);
+  ASSERT(u_file_remove(PHINDEX_TEST_FILE, NULL) == true);
+  return CUTE_SUCCESS;
+}
+
+int
+main(int ac, char **av) {
+  CUTEST_DATA test = {0};
+
+  CUTEST_PASS(hindex, nomem);
+  CUTEST_PASS(hindex, invalid);
+  CUTEST_PASS(hindex, general);
+  return EXIT_SUCCESS;
+}
@@ -28,6 +28,13 @@ CUTEST_SETUP { u_libsys_init(); }
 CUTEST_TEARDOWN { u_libsys_shutdown(); }
 
 #define PHASHTABLE_STRESS_COUNT  10000
+#define PHASHTABLE_GROW_COUNT  100000
+
+/* Just past the 7/8 load of 65536 buckets, so the table is still migrating */
+#define PHASHTABLE_MIGRATE_COUNT  57400
+
+/* Just past the 7/8 load of 128 buckets, leaves a short migration pending */
+#define PHASHTABLE_MIGRATE_SMALL  113
 
 ptr_t
 pmem_alloc(size_t nbytes) {
@@ -47,6 +54,25 @@ pmem_free(ptr_t block) {
   U_UNUSED (block);
 }
 
+static int pp_htable_destroy_count = 0;
+
+static void
+test_htable_destroy(ptr_t data) {
+  ++pp_htable_destroy_count;
+  u_free(data);
+}
+
+static bool
+test_htable_traverse(ptr_t key, ptr_t value, ptr_t user_data) {
+  int *counter;
+
+  counter = (int *) user_data;
+  if (PPOINTER_TO_INT(key) * 2 != PPOINTER_TO_INT(value)) {
+    counter[1]++;
+  }
+  return ++counter[0] == counter[2];
+}
+
 static int
 test_htable_values(const_ptr_t a, const_ptr_t b) {
   return a > b ? 0 : (a < b ? -1 : 1);
@@ -66,25 +92,45 @@ CUTEST(htable, nomem) {
   u_htable_insert(table, PINT_TO_POINTER (1), PINT_TO_POINTER (10));
   ASSERT(u_htable_keys(table) == NULL);
   ASSERT(u_htable_values(table) == NULL);
+  ASSERT(u_htable_keys_vec(table) == NULL);
+  ASSERT(u_htable_values_vec(table) == NULL);
   u_mem_restore_vtable();
   u_htable_free(table);
   return CUTE_SUCCESS;
 }
 
 CUTEST(htable, invalid) {
+  htable_iter_t iter;
+
   ASSERT(u_htable_keys(NULL) == NULL);
   ASSERT(u_htable_values(NULL) == NULL);
+  ASSERT(u_htable_keys_vec(NULL) == NULL);
+  ASSERT(u_htable_values_vec(NULL) == NULL);
   ASSERT(u_htable_lookup(NULL, NULL) == NULL);
   ASSERT(u_htable_lookup_by_value(NULL, NULL, NULL) == NULL);
   u_htable_insert(NULL, NULL, NULL);
   u_htable_remove(NULL, NULL);
   u_htable_free(NULL);
+  u_htable_foreach(NULL, NULL, NULL);
+  u_htable_iter_init(NULL, NULL);
+  u_htable_iter_init(&iter, NULL);
+  ASSERT(u_htable_iter_next(&iter, NULL, NULL) == false);
+  ASSERT(u_htable_iter_next(NULL, NULL, NULL) == false);
+  u_htable_iter_remove(&iter);
+  u_htable_iter_remove(NULL);
+  u_htable_insert_many(NULL, NULL, NULL, 0);
+  ASSERT(u_htable_reserve(NULL, 0) == false);
+  ASSERT(u_htable_shrink(NULL) == false);
+  ASSERT(u_htable_lookup_extended(NULL, NULL, NULL) == false);
+  ASSERT(u_htable_lookup_or_insert(NULL, NULL, NULL) == NULL);
   return CUTE_SUCCESS;
 }
 
 CUTEST(htable, general) {
   htable_t *table;
   list_t *list;
+  vec_t *vec;
+  ptr_t *data;
 
   table = u_htable_new();
   ASSERT(table != NULL);
@@ -157,6 +203,18 @@ CUTEST(htable, general) {
     PPOINTER_TO_INT(list->next->data) +
     PPOINTER_TO_INT(list->next->next->data) == 6);
   u_list_free(list);
+  vec = u_htable_keys_vec(table);
+  ASSERT(u_vec_get_size(vec) == 3);
+  data = u_vec_data(vec);
+  ASSERT(PPOINTER_TO_INT(data[0]) + PPOINTER_TO_INT(data[1]) +
+    PPOINTER_TO_INT(data[2]) == 6);
+  u_vec_free(vec);
+  vec = u_htable_values_vec(table);
+  ASSERT(u_vec_get_size(vec) == 3);
+  data = u_vec_data(vec);
+  ASSERT(PPOINTER_TO_INT(data[0]) + PPOINTER_TO_INT(data[1]) +
+    PPOINTER_TO_INT(data[2]) == 65);
+  u_vec_free(vec);
   ASSERT(PPOINTER_TO_INT(u_htable_lookup(table, PINT_TO_POINTER(1))) == 15);
   ASSERT(PPOINTER_TO_INT(u_htable_lookup(table, PINT_TO_POINTER(2))) == 20);
   ASSERT(PPOINTER_TO_INT(u_htable_lookup(table, PINT_TO_POINTER(3))) == 30);
@@ -265,6 +323,332 @@ CUTEST(htable, stress) {
   return CUTE_SUCCESS;
 }
 
+CUTEST(htable, grow) {
+  htable_t *table;
+  int i;
+
+  table = u_htable_new();
+  ASSERT(table != NULL);
+
+  /* Interleave removals with inserts so that they hit migrating buckets */
+  for (i = 1; i <= PHASHTABLE_GROW_COUNT; ++i) {
+    u_htable_insert(table, PINT_TO_POINTER (i), PINT_TO_POINTER (i * 2));
+    if (i % 3 == 0) {
+      u_htable_remove(table, PINT_TO_POINTER (i - 1));
+    }
+  }
+  for (i = 1; i <= PHASHTABLE_GROW_COUNT; ++i) {
+    if (i % 3 == 2 && i < PHASHTABLE_GROW_COUNT) {
+      ASSERT(u_htable_lookup(table, PINT_TO_POINTER(i)) == (ptr_t) -1);
+    } else {
+      ASSERT(u_htable_lookup(table, PINT_TO_POINTER(i)) ==
+        PINT_TO_POINTER(i * 2));
+    }
+  }
+
+  /* Replace values while the table keeps growing */
+  for (i = 1; i <= PHASHTABLE_GROW_COUNT; i += 3) {
+    u_htable_insert(table, PINT_TO_POINTER (i), PINT_TO_POINTER (i));
+    u_htable_insert(table, PINT_TO_POINTER (-i), PINT_TO_POINTER (-i));
+  }
+  for (i = 1; i <= PHASHTABLE_GROW_COUNT; i += 3) {
+    ASSERT(u_htable_lookup(table, PINT_TO_POINTER(i)) == PINT_TO_POINTER(i));
+    ASSERT(u_htable_lookup(table, PINT_TO_POINTER(-i)) ==
+      PINT_TO_POINTER(-i));
+  }
+  u_htable_free(table);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(htable, bulk) {
+  htable_t *table;
+  htable_iter_t iter;
+  ptr_t *keys, *values;
+  int i, count;
+
+  keys = u_malloc0(PHASHTABLE_GROW_COUNT * sizeof(ptr_t));
+  values = u_malloc0(PHASHTABLE_GROW_COUNT * sizeof(ptr_t));
+  ASSERT(keys != NULL && values != NULL);
+
+  /* Every key is present twice, the later value wins */
+  for (i = 0; i < PHASHTABLE_GROW_COUNT; ++i) {
+    keys[i] = PINT_TO_POINTER (i % (PHASHTABLE_GROW_COUNT / 2) + 1);
+    values[i] = PINT_TO_POINTER (i);
+  }
+  table = u_htable_new();
+  ASSERT(table != NULL);
+  ASSERT(u_htable_reserve(table, PHASHTABLE_GROW_COUNT) == true);
+  u_htable_insert_many(table, keys, values, PHASHTABLE_GROW_COUNT);
+  for (i = 0; i < PHASHTABLE_GROW_COUNT / 2; ++i) {
+    ASSERT(u_htable_lookup(table, PINT_TO_POINTER (i + 1))
+      == PINT_TO_POINTER (i + PHASHTABLE_GROW_COUNT / 2));
+  }
+
+  /* Shrink a table with most pairs gone */
+  for (i = 11; i <= PHASHTABLE_GROW_COUNT / 2; ++i) {
+    u_htable_remove(table, PINT_TO_POINTER (i));
+  }
+  ASSERT(u_htable_shrink(table) == true);
+  count = 0;
+  u_htable_iter_init(&iter, table);
+  while (u_htable_iter_next(&iter, NULL, NULL)) {
+    ++count;
+  }
+  ASSERT(count == 10);
+  for (i = 1; i <= 10; ++i) {
+    ASSERT(u_htable_lookup(table, PINT_TO_POINTER (i))
+      == PINT_TO_POINTER (i - 1 + PHASHTABLE_GROW_COUNT / 2));
+  }
+
+  /* Bulk insert into a small table grows it in one step */
+  u_htable_insert_many(table, keys, NULL, PHASHTABLE_MIGRATE_COUNT);
+  for (i = 0; i < PHASHTABLE_MIGRATE_COUNT; ++i) {
+    ASSERT(u_htable_lookup(table, keys[i]) == NULL);
+  }
+  u_htable_free(table);
+
+  /* Shrinking an empty table drops its buckets */
+  table = u_htable_new();
+  ASSERT(table != NULL);
+  u_htable_insert_many(table, keys, values, 100);
+  for (i = 0; i < 100; ++i) {
+    u_htable_remove(table, keys[i]);
+  }
+  ASSERT(u_htable_shrink(table) == true);
+  ASSERT(u_htable_lookup(table, keys[0]) == (ptr_t) -1);
+  u_htable_insert(table, keys[0], values[0]);
+  ASSERT(u_htable_lookup(table, keys[0]) == values[0]);
+  u_htable_free(table);
+
+  /* Bulk insert of existing keys while the table is migrating */
+  table = u_htable_new();
+  ASSERT(table != NULL);
+  for (i = 1; i <= PHASHTABLE_MIGRATE_SMALL; ++i) {
+    u_htable_insert(table, PINT_TO_POINTER (i), PINT_TO_POINTER (i));
+  }
+  for (i = 0; i < PHASHTABLE_MIGRATE_SMALL; ++i) {
+    keys[i] = PINT_TO_POINTER (i + 1);
+    values[i] = PINT_TO_POINTER (-(i + 1));
+    u_htable_insert_many(table, &keys[i], &values[i], 1);
+  }
+  count = 0;
+  u_htable_iter_init(&iter, table);
+  while (u_htable_iter_next(&iter, NULL, NULL)) {
+    ++count;
+  }
+  ASSERT(count == PHASHTABLE_MIGRATE_SMALL);
+  for (i = 1; i <= PHASHTABLE_MIGRATE_SMALL; ++i) {
+    ASSERT(u_htable_lookup(table, PINT_TO_POINTER (i)) == PINT_TO_POINTER (-i));
+    u_htable_remove(table, PINT_TO_POINTER (i));
+  }
+  u_htable_iter_init(&iter, table);
+  ASSERT(u_htable_iter_next(&iter, NULL, NULL) == false);
+  u_htable_free(table);
+  u_free(keys);
+  u_free(values);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(htable, extended) {
+  htable_t *table;
+  htable_iter_t iter;
+  ptr_t key_ptr;
+  ptr_t value;
+  ptr_t *slot;
+  bool found;
+  int i, key, count;
+
+  table = u_htable_new();
+  ASSERT(table != NULL);
+  ASSERT(u_htable_lookup_extended(table, PINT_TO_POINTER (1), &value)
+    == false);
+
+  /* The not-found marker of u_htable_lookup() is a valid value here */
+  u_htable_insert(table, PINT_TO_POINTER (1), (ptr_t) -1);
+  value = NULL;
+  ASSERT(u_htable_lookup_extended(table, PINT_TO_POINTER (1), &value) == true);
+  ASSERT(value == (ptr_t) -1);
+  ASSERT(u_htable_lookup_extended(table, PINT_TO_POINTER (1), NULL) == true);
+
+  /* Count occurrences with get-or-create, across table growth */
+  for (i = 0; i < PHASHTABLE_MIGRATE_COUNT * 2; ++i) {
+    slot = u_htable_lookup_or_insert(
+      table, PINT_TO_POINTER (i % PHASHTABLE_MIGRATE_COUNT + 2), &found
+    );
+    ASSERT(slot != NULL);
+    ASSERT(found == (i >= PHASHTABLE_MIGRATE_COUNT));
+    ASSERT(*slot == (found ? PINT_TO_POINTER (1) : NULL));
+    *slot = PINT_TO_POINTER (PPOINTER_TO_INT (*slot) + 1);
+  }
+  for (i = 0; i < PHASHTABLE_MIGRATE_COUNT; ++i) {
+    ASSERT(u_htable_lookup_extended(table, PINT_TO_POINTER (i + 2), &value)
+      == true);
+    ASSERT(value == PINT_TO_POINTER (2));
+  }
+  slot = u_htable_lookup_or_insert(table, PINT_TO_POINTER (1), NULL);
+  ASSERT(slot != NULL && *slot == (ptr_t) -1);
+  u_htable_free(table);
+
+  /* Inserts at the probe position mixed with removals in a stable table */
+  table = u_htable_new();
+  ASSERT(table != NULL);
+  ASSERT(u_htable_reserve(table, PHASHTABLE_STRESS_COUNT) == true);
+  for (i = 0; i < PHASHTABLE_STRESS_COUNT * 4; ++i) {
+    key = (i * 7919) % PHASHTABLE_STRESS_COUNT + 1;
+    if (i % 5 == 4) {
+      u_htable_remove(table, PINT_TO_POINTER (key));
+      continue;
+    }
+    slot = u_htable_lookup_or_insert(table, PINT_TO_POINTER (key), &found);
+    ASSERT(slot != NULL);
+    ASSERT(found == (*slot != NULL));
+    *slot = PINT_TO_POINTER (key);
+  }
+  count = 0;
+  u_htable_iter_init(&iter, table);
+  while (u_htable_iter_next(&iter, &key_ptr, &value)) {
+    ASSERT(key_ptr == value);
+    ASSERT(u_htable_lookup(table, key_ptr) == value);
+    ++count;
+  }
+  for (i = 1; i <= PHASHTABLE_STRESS_COUNT; ++i) {
+    if (u_htable_lookup(table, PINT_TO_POINTER (i)) != (ptr_t) -1) {
+      --count;
+    }
+  }
+  ASSERT(count == 0);
+  u_htable_free(table);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(htable, strings) {
+  htable_t *table;
+  byte_t buf[32];
+  byte_t data[64];
+  int i;
+
+  pp_htable_destroy_count = 0;
+  table = u_htable_new_full(
+    u_htable_str_hash,
+    u_htable_str_equal,
+    (destroy_fn_t) test_htable_destroy,
+    NULL
+  );
+  ASSERT(table != NULL);
+  for (i = 0; i < 1000; ++i) {
+    sprintf(buf, "key-%d", i);
+    u_htable_insert(table, u_strdup(buf), PINT_TO_POINTER (i));
+  }
+
+  /* Look up by contents, not by pointer */
+  for (i = 0; i < 1000; ++i) {
+    sprintf(buf, "key-%d", i);
+    ASSERT(u_htable_lookup(table, buf) == PINT_TO_POINTER(i));
+  }
+  ASSERT(u_htable_lookup(table, "key-1000") == (ptr_t) -1);
+
+  /* Replacing the pair destroys the old key */
+  u_htable_insert(table, u_strdup("key-10"), PINT_TO_POINTER (-10));
+  ASSERT(pp_htable_destroy_count == 1);
+  ASSERT(u_htable_lookup(table, "key-10") == PINT_TO_POINTER(-10));
+  u_htable_remove(table, "key-11");
+  ASSERT(pp_htable_destroy_count == 2);
+  ASSERT(u_htable_lookup(table, "key-11") == (ptr_t) -1);
+  u_htable_free(table);
+  ASSERT(pp_htable_destroy_count == 1001);
+
+  /* Byte hashes depend only on the contents */
+  for (i = 0; i < (int) sizeof(data); ++i) {
+    data[i] = (byte_t) i;
+  }
+  for (i = 0; i < (int) sizeof(data); ++i) {
+    memcpy(buf, data, (size_t) i < sizeof(buf) ? (size_t) i : sizeof(buf));
+    if ((size_t) i <= sizeof(buf)) {
+      ASSERT(u_htable_bytes_hash(buf, (size_t) i) ==
+        u_htable_bytes_hash(data, (size_t) i));
+    }
+    if (i > 0) {
+      ASSERT(u_htable_bytes_hash(data, (size_t) i) !=
+        u_htable_bytes_hash(data, (size_t) i - 1));
+    }
+  }
+  ASSERT(u_htable_str_hash("abc") == u_htable_bytes_hash("abc", 3));
+  ASSERT(u_htable_str_equal("abc", "abc") == true);
+  ASSERT(u_htable_str_equal("abc", "abd") == false);
+  ASSERT(u_htable_str_equal(NULL, "abc") == false);
+  ASSERT(u_htable_ptr_equal(buf, buf) == true);
+  ASSERT(u_htable_ptr_hash(buf) == u_htable_ptr_hash(buf));
+  return CUTE_SUCCESS;
+}
+
+CUTEST(htable, iter) {
+  htable_t *table;
+  htable_iter_t iter;
+  ptr_t key, value;
+  byte_t *seen;
+  int counter[3];
+  int i;
+
+  table = u_htable_new();
+  ASSERT(table != NULL);
+  u_htable_iter_init(&iter, table);
+  ASSERT(u_htable_iter_next(&iter, &key, &value) == false);
+  seen = (byte_t *) u_malloc0(PHASHTABLE_MIGRATE_COUNT + 1);
+  ASSERT(seen != NULL);
+
+  /* Stop in the middle of a migration to iterate over both arrays */
+  for (i = 1; i <= PHASHTABLE_MIGRATE_COUNT; ++i) {
+    u_htable_insert(table, PINT_TO_POINTER (i), PINT_TO_POINTER (i * 2));
+  }
+  memset(counter, 0, sizeof(counter));
+  u_htable_foreach(table, test_htable_traverse, counter);
+  ASSERT(counter[0] == PHASHTABLE_MIGRATE_COUNT);
+  ASSERT(counter[1] == 0);
+  memset(counter, 0, sizeof(counter));
+  counter[2] = 10;
+  u_htable_foreach(table, test_htable_traverse, counter);
+  ASSERT(counter[0] == 10);
+
+  /* Remove odd keys while iterating, each pair is visited once */
+  u_htable_iter_init(&iter, table);
+  while (u_htable_iter_next(&iter, &key, &value)) {
+    i = PPOINTER_TO_INT(key);
+    ASSERT(i > 0 && i <= PHASHTABLE_MIGRATE_COUNT);
+    ASSERT(seen[i] == 0);
+    ASSERT(PPOINTER_TO_INT(value) == i * 2);
+    seen[i] = 1;
+    if (i % 2 == 1) {
+      u_htable_iter_remove(&iter);
+      u_htable_iter_remove(&iter);
+    }
+  }
+  for (i = 1; i <= PHASHTABLE_MIGRATE_COUNT; ++i) {
+    ASSERT(seen[i] == 1);
+    if (i % 2 == 1) {
+      ASSERT(u_htable_lookup(table, PINT_TO_POINTER(i)) == (ptr_t) -1);
+    } else {
+      ASSERT(u_htable_lookup(table, PINT_TO_POINTER(i)) ==
+        PINT_TO_POINTER(i * 2));
+    }
+  }
+  memset(counter, 0, sizeof(counter));
+  u_htable_foreach(table, test_htable_traverse, counter);
+  ASSERT(counter[0] == PHASHTABLE_MIGRATE_COUNT / 2);
+  ASSERT(counter[1] == 0);
+
+  /* Remove everything */
+  u_htable_iter_init(&iter, table);
+  while (u_htable_iter_next(&iter, NULL, NULL)) {
+    u_htable_iter_remove(&iter);
+  }
+  u_htable_iter_init(&iter, table);
+  ASSERT(u_htable_iter_next(&iter, NULL, NULL) == false);
+  ASSERT(u_htable_keys(table) == NULL);
+  u_free(seen);
+  u_htable_free(table);
+  return CUTE_SUCCESS;
+}
+
 int
 main(int ac, char **av) {
   CUTEST_DATA test = {0};
@@ -273,5 +657,10 @@ main(int ac, char **av) {
   CUTEST_PASS(htable, invalid);
   CUTEST_PASS(htable, general);
   CUTEST_PASS(htable, stress);
+  CUTEST_PASS(htable, grow);
+  CUTEST_PASS(htable, bulk);
+  CUTEST_PASS(htable, extended);
+  CUTEST_PASS(htable, strings);
+  CUTEST_PASS(htable, iter);
   return EXIT_SUCCESS;
 }
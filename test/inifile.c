@@ -158,6 +158,8 @@ CUTEST(inifile, bad_input) {
   );
   ASSERT(u_inifile_sections(ini) == NULL);
   ASSERT(u_inifile_keys(ini, "string_section") == NULL);
+  ASSERT(u_inifile_sections_vec(ini) == NULL);
+  ASSERT(u_inifile_keys_vec(ini, "string_section") == NULL);
   ASSERT(
     u_inifile_parameter_boolean(
       ini, "boolean_section", "boolean_parameter_1",
@@ -195,6 +197,8 @@ CUTEST(inifile, read) {
   list_t *list;
   list_t *iter;
   list_t *list_val;
+  vec_t *vec;
+  size_t i;
   int int_sum;
   double flt_sum;
   bool bool_sum;
@@ -212,6 +216,16 @@ CUTEST(inifile, read) {
   ASSERT(list != NULL);
   ASSERT(u_list_length(list) == 4);
 
+  /* Vector must hold the same sections in the same order */
+  vec = u_inifile_sections_vec(ini);
+  ASSERT(vec != NULL);
+  ASSERT(u_vec_get_size(vec) == 4);
+  for (i = 0, iter = list; iter != NULL; iter = iter->next, ++i) {
+    ASSERT(strcmp(*((byte_t **) u_vec_at(vec, i)), iter->data) == 0);
+    u_free(*((byte_t **) u_vec_at(vec, i)));
+  }
+  u_vec_free(vec);
+
   u_list_foreach(list, (fn_t) u_free, NULL);
   u_list_free(list);
 
@@ -222,6 +236,13 @@ CUTEST(inifile, read) {
   /* Test numeric section */
   list = u_inifile_keys(ini, "numeric_section");
   ASSERT(u_list_length(list) == 5);
+  vec = u_inifile_keys_vec(ini, "numeric_section");
+  ASSERT(u_vec_get_size(vec) == 5);
+  for (i = 0, iter = list; iter != NULL; iter = iter->next, ++i) {
+    ASSERT(strcmp(*((byte_t **) u_vec_at(vec, i)), iter->data) == 0);
+    u_free(*((byte_t **) u_vec_at(vec, i)));
+  }
+  u_vec_free(vec);
   u_list_foreach(list, (fn_t) u_free, NULL);
   u_list_free(list);
 
@@ -428,6 +449,45 @@ CUTEST(inifile, read) {
   return CUTE_SUCCESS;
 }
 
+CUTEST(inifile, order) {
+  const byte_t *names[] = {
+    "numeric_section", "string_section", "boolean_section", "list_section"
+  };
+  inifile_t *ini;
+  list_t *list;
+  list_t *iter;
+  vec_t *vec;
+  size_t i;
+
+  /* The last section is not empty here */
+  ASSERT(create_test_ini_file(false));
+  ini = u_inifile_new("." U_DIR_SEP "u_ini_test_file.ini");
+  ASSERT(ini != NULL);
+  ASSERT(u_inifile_parse(ini, NULL) == true);
+
+  /* Sections come in the file order, the empty one is skipped */
+  list = u_inifile_sections(ini);
+  ASSERT(u_list_length(list) == 4);
+  for (i = 0, iter = list; iter != NULL; iter = iter->next, ++i) {
+    ASSERT(strcmp(iter->data, names[i]) == 0);
+  }
+  u_list_foreach(list, (fn_t) u_free, NULL);
+  u_list_free(list);
+  vec = u_inifile_sections_vec(ini);
+  ASSERT(vec != NULL);
+  ASSERT(u_vec_get_size(vec) == 4);
+  for (i = 0; i < 4; ++i) {
+    ASSERT(strcmp(*((byte_t **) u_vec_at(vec, i)), names[i]) == 0);
+    u_free(*((byte_t **) u_vec_at(vec, i)));
+  }
+  u_vec_free(vec);
+  u_inifile_free(ini);
+
+  ASSERT(u_file_remove("."U_DIR_SEP"u_ini_test_file.ini", NULL) == true);
+
+  return CUTE_SUCCESS;
+}
+
 int
 main(int ac, char **av) {
   CUTEST_DATA test = {0};
@@ -435,5 +495,6 @@ main(int ac, char **av) {
   CUTEST_PASS(inifile, nomem);
   CUTEST_PASS(inifile, bad_input);
   CUTEST_PASS(inifile, read);
+  CUTEST_PASS(inifile, order);
   return EXIT_SUCCESS;
 }
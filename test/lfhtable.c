@@ -0,0 +1,291 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include "cute.h"
+#include "unic.h"
+
+CUTEST_DATA {
+  int dummy;
+};
+
+CUTEST_SETUP { u_libsys_init(); }
+
+CUTEST_TEARDOWN { u_libsys_shutdown(); }
+
+#define PLFHTABLE_THREADS 4
+#define PLFHTABLE_THREAD_KEYS 20000
+#define PLFHTABLE_SHARED_KEYS 512
+#define PLFHTABLE_SHARED_ROUNDS 20000
+
+static lfhtable_t *test_table = NULL;
+static volatile int pp_lfhtable_destroy_count = 0;
+static volatile int pp_lfhtable_removed_count = 0;
+
+ptr_t
+pmem_alloc(size_t nbytes) {
+  U_UNUSED(nbytes);
+  return (ptr_t) NULL;
+}
+
+ptr_t
+pmem_realloc(ptr_t block, size_t nbytes) {
+  U_UNUSED(block);
+  U_UNUSED(nbytes);
+  return (ptr_t) NULL;
+}
+
+void
+pmem_free(ptr_t block) {
+  U_UNUSED(block);
+}
+
+static void
+test_lfhtable_destroy(ptr_t data) {
+  U_UNUSED(data);
+  u_atomic_int_inc(&pp_lfhtable_destroy_count);
+}
+
+static void *
+test_lfhtable_private_func(void *data) {
+  int base;
+  int i;
+
+  base = PPOINTER_TO_INT (data) * PLFHTABLE_THREAD_KEYS + 1;
+  for (i = 0; i < PLFHTABLE_THREAD_KEYS; ++i) {
+    if (!u_lfhtable_insert(test_table, PINT_TO_POINTER (base + i),
+      PINT_TO_POINTER ((base + i) * 10))) {
+      u_thread_exit(-1);
+    }
+  }
+  for (i = 0; i < PLFHTABLE_THREAD_KEYS; ++i) {
+    if (u_lfhtable_lookup(test_table, PINT_TO_POINTER (base + i))
+      != PINT_TO_POINTER ((base + i) * 10)) {
+      u_thread_exit(-1);
+    }
+  }
+  for (i = 0; i < PLFHTABLE_THREAD_KEYS; i += 2) {
+    if (!u_lfhtable_remove(test_table, PINT_TO_POINTER (base + i))) {
+      u_thread_exit(-1);
+    }
+  }
+  for (i = 0; i < PLFHTABLE_THREAD_KEYS; ++i) {
+    if ((u_lfhtable_lookup(test_table, PINT_TO_POINTER (base + i))
+      == (ptr_t) -1) != (i % 2 == 0)) {
+      u_thread_exit(-1);
+    }
+  }
+  u_thread_exit(0);
+  return NULL;
+}
+
+static void *
+test_lfhtable_shared_func(void *data) {
+  u32_t state;
+  ptr_t key, value;
+  int i;
+
+  state = 2463534242U + (u32_t) PPOINTER_TO_INT (data);
+  for (i = 0; i < PLFHTABLE_SHARED_ROUNDS; ++i) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    key = PUINT_TO_POINTER (state % PLFHTABLE_SHARED_KEYS + 1);
+    switch (state >> 30) {
+      case 0:
+        u_lfhtable_insert(test_table, key, key);
+        break;
+      case 1:
+        if (u_lfhtable_remove(test_table, key)) {
+          u_atomic_int_inc(&pp_lfhtable_removed_count);
+        }
+        break;
+      default:
+        value = u_lfhtable_lookup(test_table, key);
+        if (value != (ptr_t) -1 && value != key) {
+          u_thread_exit(-1);
+        }
+    }
+  }
+  u_thread_exit(0);
+  return NULL;
+}
+
+CUTEST(lfhtable, nomem) {
+  lfhtable_t *table;
+  mem_vtable_t vtable;
+
+  table = u_lfhtable_new();
+  ASSERT(table != NULL);
+  vtable.free = pmem_free;
+  vtable.malloc = pmem_alloc;
+  vtable.realloc = pmem_realloc;
+  ASSERT(u_mem_set_vtable(&vtable) == true);
+  ASSERT(u_lfhtable_new() == NULL);
+  ASSERT(u_lfhtable_insert(table, PINT_TO_POINTER (1), NULL) == false);
+  u_mem_restore_vtable();
+  ASSERT(u_lfhtable_size(table) == 0);
+  u_lfhtable_free(table);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(lfhtable, invalid) {
+  ASSERT(u_lfhtable_lookup(NULL, NULL) == NULL);
+  ASSERT(u_lfhtable_insert(NULL, NULL, NULL) == false);
+  ASSERT(u_lfhtable_remove(NULL, NULL) == false);
+  ASSERT(u_lfhtable_size(NULL) == 0);
+  u_lfhtable_free(NULL);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(lfhtable, general) {
+  lfhtable_t *table;
+  int i;
+
+  pp_lfhtable_destroy_count = 0;
+  table = u_lfhtable_new_full(
+    NULL, NULL, NULL, test_lfhtable_destroy
+  );
+  ASSERT(table != NULL);
+  ASSERT(u_lfhtable_lookup(table, PINT_TO_POINTER (1)) == (ptr_t) -1);
+  ASSERT(u_lfhtable_remove(table, PINT_TO_POINTER (1)) == false);
+  for (i = 1; i <= 10000; ++i) {
+    ASSERT(u_lfhtable_insert(
+      table, PINT_TO_POINTER (i), PINT_TO_POINTER (i * 10)
+    ) == true);
+  }
+  ASSERT(u_lfhtable_size(table) == 10000);
+  ASSERT(u_lfhtable_insert(table, PINT_TO_POINTER (5), NULL) == false);
+  ASSERT(u_lfhtable_lookup(table, PINT_TO_POINTER (5)) == PINT_TO_POINTER (50));
+  for (i = 1; i <= 10000; ++i) {
+    ASSERT(u_lfhtable_lookup(table, PINT_TO_POINTER (i))
+      == PINT_TO_POINTER (i * 10));
+  }
+  for (i = 1; i <= 10000; i += 2) {
+    ASSERT(u_lfhtable_remove(table, PINT_TO_POINTER (i)) == true);
+  }
+  ASSERT(u_lfhtable_remove(table, PINT_TO_POINTER (1)) == false);
+  ASSERT(u_lfhtable_size(table) == 5000);
+  for (i = 1; i <= 10000; ++i) {
+    ASSERT((u_lfhtable_lookup(table, PINT_TO_POINTER (i)) == (ptr_t) -1)
+      == (i % 2 == 1));
+  }
+  ASSERT(u_lfhtable_insert(table, PINT_TO_POINTER (1), NULL) == true);
+  ASSERT(u_lfhtable_lookup(table, PINT_TO_POINTER (1)) == NULL);
+  u_lfhtable_free(table);
+
+  /* Flush the deferred reclamation */
+  u_libsys_shutdown();
+  u_libsys_init();
+  ASSERT(pp_lfhtable_destroy_count == 10001);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(lfhtable, strings) {
+  lfhtable_t *table;
+  byte_t buf[32];
+  byte_t *key;
+  int i;
+
+  table = u_lfhtable_new_full(
+    u_htable_str_hash, u_htable_str_equal, u_free, NULL
+  );
+  ASSERT(table != NULL);
+  for (i = 0; i < 1000; ++i) {
+    snprintf(buf, sizeof(buf), "key-%d", i);
+    key = u_strdup(buf);
+    ASSERT(u_lfhtable_insert(table, key, PINT_TO_POINTER (i)) == true);
+  }
+  for (i = 0; i < 1000; ++i) {
+    snprintf(buf, sizeof(buf), "key-%d", i);
+    ASSERT(u_lfhtable_lookup(table, buf) == PINT_TO_POINTER (i));
+  }
+  ASSERT(u_lfhtable_remove(table, "key-10") == true);
+  ASSERT(u_lfhtable_lookup(table, "key-10") == (ptr_t) -1);
+  ASSERT(u_lfhtable_lookup(table, "key-1000") == (ptr_t) -1);
+  u_lfhtable_free(table);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(lfhtable, threads) {
+  thread_t *threads[PLFHTABLE_THREADS];
+  int i;
+
+  test_table = u_lfhtable_new();
+  ASSERT(test_table != NULL);
+  for (i = 0; i < PLFHTABLE_THREADS; ++i) {
+    threads[i] = u_thread_create(
+      (thread_fn_t) test_lfhtable_private_func, PINT_TO_POINTER (i), true
+    );
+    ASSERT(threads[i] != NULL);
+  }
+  for (i = 0; i < PLFHTABLE_THREADS; ++i) {
+    ASSERT(u_thread_join(threads[i]) == 0);
+    u_thread_unref(threads[i]);
+  }
+  ASSERT(u_lfhtable_size(test_table)
+    == PLFHTABLE_THREADS * PLFHTABLE_THREAD_KEYS / 2);
+  u_lfhtable_free(test_table);
+  test_table = NULL;
+  return CUTE_SUCCESS;
+}
+
+CUTEST(lfhtable, contention) {
+  thread_t *threads[PLFHTABLE_THREADS];
+  size_t count;
+  int i;
+
+  pp_lfhtable_destroy_count = 0;
+  pp_lfhtable_removed_count = 0;
+  test_table = u_lfhtable_new_full(NULL, NULL, NULL, test_lfhtable_destroy);
+  ASSERT(test_table != NULL);
+  for (i = 0; i < PLFHTABLE_THREADS; ++i) {
+    threads[i] = u_thread_create(
+      (thread_fn_t) test_lfhtable_shared_func, PINT_TO_POINTER (i), true
+    );
+    ASSERT(threads[i] != NULL);
+  }
+  for (i = 0; i < PLFHTABLE_THREADS; ++i) {
+    ASSERT(u_thread_join(threads[i]) == 0);
+    u_thread_unref(threads[i]);
+  }
+  count = 0;
+  for (i = 1; i <= PLFHTABLE_SHARED_KEYS; ++i) {
+    if (u_lfhtable_lookup(test_table, PINT_TO_POINTER (i)) != (ptr_t) -1) {
+      ++count;
+    }
+  }
+  ASSERT(u_lfhtable_size(test_table) == count);
+  u_lfhtable_free(test_table);
+  test_table = NULL;
+  u_libsys_shutdown();
+  u_libsys_init();
+  ASSERT(pp_lfhtable_destroy_count
+    == pp_lfhtable_removed_count + (int) count);
+  return CUTE_SUCCESS;
+}
+
+int
+main(int ac, char **av) {
+  CUTEST_DATA test = {0};
+
+  CUTEST_PASS(lfhtable, nomem);
+  CUTEST_PASS(lfhtable, invalid);
+  CUTEST_PASS(lfhtable, general);
+  CUTEST_PASS(lfhtable, strings);
+  CUTEST_PASS(lfhtable, threads);
+  CUTEST_PASS(lfhtable, contention);
+  return EXIT_SUCCESS;
+}
@@ -64,6 +64,26 @@ foreach_test_func(ptr_t data, ptr_t user_data) {
   ++test_data->index;
 }
 
+static int
+test_list_cmp_high(const_ptr_t a, const_ptr_t b) {
+  int va = U_POINTER_TO_INT (a) / 100, vb = U_POINTER_TO_INT (b) / 100;
+
+  return va < vb ? -1 : (va > vb ? 1 : 0);
+}
+
+static int
+test_list_cmp_mod(const_ptr_t a, const_ptr_t b) {
+  return U_POINTER_TO_INT (a) % 3 == U_POINTER_TO_INT (b) ? 0 : 1;
+}
+
+static volatile int test_list_destroyed = 0;
+
+static void
+test_list_destroy(ptr_t data) {
+  U_UNUSED (data);
+  ++test_list_destroyed;
+}
+
 CUTEST(list, nomem) {
   mem_vtable_t vtable;
 
@@ -73,6 +93,7 @@ CUTEST(list, nomem) {
   ASSERT(u_mem_set_vtable(&vtable) == true);
   ASSERT(u_list_append(NULL, PINT_TO_POINTER(10)) == NULL);
   ASSERT(u_list_prepend(NULL, PINT_TO_POINTER(10)) == NULL);
+  ASSERT(u_list_pool_new() == NULL);
   u_mem_restore_vtable();
   return CUTE_SUCCESS;
 }
@@ -84,6 +105,15 @@ CUTEST(list, invalid) {
   ASSERT(u_list_reverse(NULL) == NULL);
   u_list_free(NULL);
   u_list_foreach(NULL, NULL, NULL);
+  ASSERT(u_list_pool_append(NULL, NULL, NULL) == NULL);
+  ASSERT(u_list_pool_prepend(NULL, NULL, NULL) == NULL);
+  ASSERT(u_list_pool_remove(NULL, NULL, NULL) == NULL);
+  u_list_pool_release(NULL, NULL);
+  u_list_pool_free(NULL);
+  ASSERT(u_list_sort(NULL, NULL) == NULL);
+  ASSERT(u_list_concat(NULL, NULL) == NULL);
+  ASSERT(u_list_find_custom(NULL, NULL, NULL) == NULL);
+  ASSERT(u_list_remove_if(NULL, NULL, NULL, NULL) == NULL);
   return CUTE_SUCCESS;
 }
 
@@ -157,6 +187,122 @@ CUTEST(list, general) {
   return CUTE_SUCCESS;
 }
 
+CUTEST(list, pool) {
+  list_pool_t *pool;
+  list_t *list, *first;
+  test_data_t test_data;
+  mem_vtable_t vtable;
+  int i;
+
+  pool = u_list_pool_new();
+  ASSERT(pool != NULL);
+  list = NULL;
+  list = u_list_pool_append(pool, list, U_INT_TO_POINTER (32));
+  list = u_list_pool_append(pool, list, U_INT_TO_POINTER (64));
+  list = u_list_pool_prepend(pool, list, U_INT_TO_POINTER (128));
+  ASSERT(u_list_length(list) == 3);
+  memset(&test_data, 0, sizeof(test_data));
+  u_list_foreach(list, (fn_t) foreach_test_func, (ptr_t) &test_data);
+  ASSERT(test_data.index == 3);
+  ASSERT(test_data.test_array[0] == 128);
+  ASSERT(test_data.test_array[1] == 32);
+  ASSERT(test_data.test_array[2] == 64);
+  list = u_list_pool_remove(pool, list, U_INT_TO_POINTER (32));
+  list = u_list_pool_remove(pool, list, U_INT_TO_POINTER (256));
+  ASSERT(u_list_length(list) == 2);
+  ASSERT(U_POINTER_TO_INT(list->data) == 128);
+  ASSERT(U_POINTER_TO_INT(u_list_last(list)->data) == 64);
+  u_list_pool_release(pool, list);
+
+  /* Released nodes must be reused without touching the allocator */
+  vtable.free = pmem_free;
+  vtable.malloc = pmem_alloc;
+  vtable.realloc = pmem_realloc;
+  ASSERT(u_mem_set_vtable(&vtable) == true);
+  list = NULL;
+  for (i = 0; i < 32; ++i) {
+    list = u_list_pool_prepend(pool, list, U_INT_TO_POINTER (i));
+  }
+  ASSERT(u_list_length(list) == 32);
+  first = list;
+  list = u_list_pool_prepend(pool, list, U_INT_TO_POINTER (32));
+  ASSERT(list == first);
+  u_mem_restore_vtable();
+  u_list_pool_release(pool, list);
+
+  /* Large lists span several slabs */
+  list = NULL;
+  for (i = 0; i < 10000; ++i) {
+    list = u_list_pool_prepend(pool, list, U_INT_TO_POINTER (i));
+  }
+  ASSERT(u_list_length(list) == 10000);
+  ASSERT(U_POINTER_TO_INT(list->data) == 9999);
+  ASSERT(U_POINTER_TO_INT(u_list_last(list)->data) == 0);
+  u_list_pool_release(pool, list);
+  u_list_pool_free(pool);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(list, batch) {
+  list_t *list, *other, *cur;
+  int i, prev;
+
+  /* Stable sort on the hundreds, the units keep the insertion order */
+  list = NULL;
+  for (i = 0; i < 1000; ++i) {
+    list = u_list_prepend(list,
+      U_INT_TO_POINTER ((i * 7) % 10 * 100 + (999 - i) / 10));
+  }
+  list = u_list_sort(list, test_list_cmp_high);
+  ASSERT(u_list_length(list) == 1000);
+  for (prev = -1, cur = list; cur != NULL; cur = cur->next) {
+    i = U_POINTER_TO_INT (cur->data);
+    ASSERT(i / 100 > prev / 100 || (i / 100 == prev / 100 && i > prev) ||
+      prev == -1);
+    prev = i;
+  }
+  u_list_free(list);
+  list = u_list_sort(u_list_append(NULL, U_INT_TO_POINTER (1)),
+    test_list_cmp_high);
+  ASSERT(u_list_length(list) == 1);
+
+  /* Concatenation */
+  other = u_list_append(NULL, U_INT_TO_POINTER (2));
+  other = u_list_append(other, U_INT_TO_POINTER (3));
+  ASSERT(u_list_concat(NULL, other) == other);
+  ASSERT(u_list_concat(other, NULL) == other);
+  list = u_list_concat(list, other);
+  ASSERT(u_list_length(list) == 3);
+  ASSERT(U_POINTER_TO_INT (u_list_last(list)->data) == 3);
+
+  /* Custom search */
+  ASSERT(u_list_find_custom(list, U_INT_TO_POINTER (2), NULL) == list->next);
+  ASSERT(u_list_find_custom(list, U_INT_TO_POINTER (4), NULL) == NULL);
+  ASSERT(u_list_find_custom(list, U_INT_TO_POINTER (0), test_list_cmp_mod)
+    == u_list_last(list));
+  u_list_free(list);
+
+  /* Batch removal */
+  list = NULL;
+  for (i = 0; i < 300; ++i) {
+    list = u_list_prepend(list, U_INT_TO_POINTER (i));
+  }
+  test_list_destroyed = 0;
+  list = u_list_remove_if(list, U_INT_TO_POINTER (1), test_list_cmp_mod,
+    test_list_destroy);
+  ASSERT(test_list_destroyed == 100);
+  ASSERT(u_list_length(list) == 200);
+  ASSERT(u_list_find_custom(list, U_INT_TO_POINTER (1), test_list_cmp_mod)
+    == NULL);
+  list = u_list_remove_if(list, U_INT_TO_POINTER (299), NULL, NULL);
+  ASSERT(u_list_length(list) == 199);
+  ASSERT(U_POINTER_TO_INT (list->data) == 297);
+  list = u_list_remove_if(list, U_INT_TO_POINTER (1), NULL, NULL);
+  ASSERT(u_list_length(list) == 199);
+  u_list_free(list);
+  return CUTE_SUCCESS;
+}
+
 int
 main(int ac, char **av) {
   CUTEST_DATA test = {0};
@@ -164,5 +310,7 @@ main(int ac, char **av) {
   CUTEST_PASS(list, nomem);
   CUTEST_PASS(list, invalid);
   CUTEST_PASS(list, general);
+  CUTEST_PASS(list, pool);
+  CUTEST_PASS(list, batch);
   return EXIT_SUCCESS;
 }
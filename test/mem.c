@@ -42,6 +42,12 @@ pmem_realloc(ptr_t block, size_t nbytes) {
   return (ptr_t) realloc(block, nbytes);
 }
 
+ptr_t
+pmem_alloc_fail(size_t nbytes) {
+  U_UNUSED (nbytes);
+  return NULL;
+}
+
 void
 pmem_free(ptr_t block) {
   ++free_counter;
@@ -57,6 +63,10 @@ CUTEST(mem, bad_input) {
   ASSERT(u_malloc(0) == NULL);
   ASSERT(u_malloc0(0) == NULL);
   ASSERT(u_realloc(NULL, 0) == NULL);
+  ASSERT(u_malloc_n(0, 16) == NULL);
+  ASSERT(u_malloc_n((size_t) -1 / 2, 4) == NULL);
+  ASSERT(u_malloc0_n(16, 0) == NULL);
+  ASSERT(u_malloc0_n(4, (size_t) -1 / 2) == NULL);
   ASSERT(u_mem_set_vtable(NULL) == false);
   ASSERT(u_mem_set_vtable(&vtable) == false);
   u_free(NULL);
@@ -112,8 +122,35 @@ CUTEST(mem, general) {
   ASSERT(alloc_counter > 0);
   ASSERT(realloc_counter > 0);
   ASSERT(free_counter > 0);
+
+  /* Array and zeroed allocations go through the table as well */
+  alloc_counter = 0;
+  free_counter = 0;
+  ptr = u_malloc_n(16, 64);
+  ASSERT(ptr != NULL);
+  u_free(ptr);
+  ptr = u_malloc0_n(16, 64);
+  ASSERT(ptr != NULL);
+  for (i = 0; i < 1024; ++i)
+    ASSERT(*(((byte_t *) ptr) + i) == 0);
+  u_free(ptr);
+  ASSERT(alloc_counter == 2);
+  ASSERT(free_counter == 2);
   u_mem_restore_vtable();
 
+  /* System allocator */
+  ptr = u_malloc0_n(1024, 1024);
+  ASSERT(ptr != NULL);
+  for (i = 0; i < 1024 * 1024; i += 4096)
+    ASSERT(*(((byte_t *) ptr) + i) == 0);
+  ptr = u_realloc(ptr, 2 * 1024 * 1024);
+  ASSERT(ptr != NULL);
+  u_free(ptr);
+  ptr = u_malloc_n(1024, 1024);
+  ASSERT(ptr != NULL);
+  u_free(ptr);
+  alloc_counter = 0;
+
   /* Test memory mapping */
   ptr = u_mem_mmap(0, NULL);
   ASSERT(ptr == NULL);
@@ -129,11 +166,165 @@ CUTEST(mem, general) {
   return CUTE_SUCCESS;
 }
 
+CUTEST(mem, aligned) {
+  mem_vtable_t vtable;
+  byte_t *ptr;
+  size_t align, size;
+  int i;
+
+  ASSERT(u_malloc_aligned(0, 16) == NULL);
+  ASSERT(u_malloc_aligned(16, 0) == NULL);
+  ASSERT(u_malloc_aligned(16, 24) == NULL);
+  ASSERT(u_malloc_aligned((size_t) -1, 16) == NULL);
+  u_free_aligned(NULL);
+  for (i = 0; i < 14; ++i) {
+    align = (size_t) 1 << i;
+    ptr = u_malloc_aligned(100, align);
+    ASSERT(ptr != NULL);
+    ASSERT(((size_t) ptr & (align - 1)) == 0);
+    memset(ptr, 0x5B, 100);
+    u_free_aligned(ptr);
+  }
+
+  /* Goes through the memory table */
+  alloc_counter = 0;
+  free_counter = 0;
+  vtable.free = pmem_free;
+  vtable.malloc = pmem_alloc;
+  vtable.realloc = pmem_realloc;
+  ASSERT(u_mem_set_vtable(&vtable) == true);
+  ptr = u_malloc_aligned(64, 64);
+  ASSERT(ptr != NULL);
+  u_free_aligned(ptr);
+  ASSERT(alloc_counter == 1 && free_counter == 1);
+  vtable.malloc = pmem_alloc_fail;
+  ASSERT(u_mem_set_vtable(&vtable) == true);
+  ASSERT(u_malloc_aligned(64, 64) == NULL);
+  u_mem_restore_vtable();
+
+  /* Mapped blocks */
+  ASSERT(u_mem_mmap_full(0, 0, U_MEM_MAP_DEFAULT, NULL) == NULL);
+  ASSERT(u_mem_mmap_full(4096, 3, U_MEM_MAP_DEFAULT, NULL) == NULL);
+  ptr = u_mem_mmap_full(1000, 0, U_MEM_MAP_POPULATE, NULL);
+  ASSERT(ptr != NULL);
+  ASSERT(ptr[0] == 0 && ptr[999] == 0);
+  memset(ptr, 0x5B, 1000);
+  ASSERT(u_mem_munmap(ptr, 1000, NULL) == true);
+  for (i = 0; i < 4; ++i) {
+    align = (size_t) 65536 << (i * 2);
+    size = (size_t) 3 * 1024 * 1024 + 100;
+    ptr = u_mem_mmap_full(size, align, i % 2 == 0 ? U_MEM_MAP_POPULATE
+      : U_MEM_MAP_DEFAULT, NULL);
+    ASSERT(ptr != NULL);
+    ASSERT(((size_t) ptr & (align - 1)) == 0);
+    ptr[0] = 1;
+    ptr[size - 1] = 1;
+    ASSERT(u_mem_munmap(ptr, size, NULL) == true);
+  }
+
+  /* Huge pages fall back to the regular ones if needed */
+  size = 2 * U_MEM_HUGE_PAGE_SIZE;
+  ptr = u_mem_mmap_full(size, 0, U_MEM_MAP_HUGE_PAGES | U_MEM_MAP_POPULATE,
+    NULL);
+  ASSERT(ptr != NULL);
+  ASSERT(ptr[0] == 0 && ptr[size - 1] == 0);
+  memset(ptr, 0x5B, size);
+  ASSERT(u_mem_munmap(ptr, size, NULL) == true);
+  ptr = u_mem_mmap_full(100, 0, U_MEM_MAP_HUGE_PAGES, NULL);
+  ASSERT(ptr != NULL);
+  ASSERT(u_mem_munmap(ptr, 100, NULL) == true);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(mem, arena) {
+  mem_vtable_t vtable;
+  arena_t *arena;
+  byte_t *blocks[1000];
+  byte_t *ptr, *first;
+  size_t align;
+  int i, j;
+
+  ASSERT(u_arena_alloc(NULL, 16, 0) == NULL);
+  u_arena_reset(NULL);
+  u_arena_free(NULL);
+  vtable.free = pmem_free;
+  vtable.malloc = pmem_alloc_fail;
+  vtable.realloc = pmem_realloc;
+  ASSERT(u_mem_set_vtable(&vtable) == true);
+  ASSERT(u_arena_new(0) == NULL);
+  u_mem_restore_vtable();
+  arena = u_arena_new(100);
+  ASSERT(arena != NULL);
+  ASSERT(u_arena_alloc(arena, 0, 0) == NULL);
+  ASSERT(u_arena_alloc(arena, 16, 3) == NULL);
+  ASSERT(u_arena_alloc(arena, (size_t) -1, 0) == NULL);
+
+  /* Small blocks of any alignment spread over several chunks */
+  for (j = 0; j < 3; ++j) {
+    for (i = 0; i < 1000; ++i) {
+      align = (size_t) 1 << (i % 8);
+      blocks[i] = u_arena_alloc(arena, (size_t) (i % 50 + 1), align);
+      ASSERT(blocks[i] != NULL);
+      ASSERT(((size_t) blocks[i] & (align - 1)) == 0);
+      memset(blocks[i], i % 127, (size_t) (i % 50 + 1));
+    }
+    ptr = u_arena_alloc(arena, 100000, 0);
+    ASSERT(ptr != NULL);
+    ASSERT(((size_t) ptr & (U_ARENA_DEFAULT_ALIGNMENT - 1)) == 0);
+    memset(ptr, 0x5B, 100000);
+    for (i = 0; i < 1000; ++i) {
+      ASSERT(blocks[i][0] == i % 127 && blocks[i][i % 50] == i % 127);
+    }
+    ASSERT(ptr[0] == 0x5B && ptr[99999] == 0x5B);
+
+    /* The chunks are reused after the reset */
+    first = blocks[0];
+    u_arena_reset(arena);
+    ASSERT(u_arena_alloc(arena, 1, 1) == first);
+    u_arena_reset(arena);
+  }
+  u_arena_free(arena);
+
+  /* The arena may be freed with the blocks in use */
+  arena = u_arena_new(0);
+  ASSERT(arena != NULL);
+  for (i = 0; i < 10000; ++i) {
+    ASSERT(u_arena_alloc(arena, 24, 8) != NULL);
+  }
+  u_arena_free(arena);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(mem, stats) {
+  mem_stats_site_t sites[1];
+  mem_stats_t stats;
+
+  /* Blocks without the header were allocated already */
+  ASSERT(u_mem_stats_enable() == false);
+  ASSERT(u_mem_stats_is_enabled() == false);
+  u_libsys_shutdown();
+  ASSERT(u_mem_stats_enable() == false);
+  ASSERT(u_mem_stats_is_enabled() == false);
+  u_libsys_init();
+  ASSERT(u_mem_stats_disable() == true);
+
+  u_mem_stats_get(NULL);
+  u_mem_stats_get(&stats);
+  ASSERT(stats.live_count == 0);
+  ASSERT(stats.total_count == 0);
+  ASSERT(u_mem_stats_get_sites(NULL, 1) == 0);
+  ASSERT(u_mem_stats_get_sites(sites, 1) == 0);
+  return CUTE_SUCCESS;
+}
+
 int
 main(int ac, char **av) {
   CUTEST_DATA test = {0};
 
   CUTEST_PASS(mem, bad_input);
   CUTEST_PASS(mem, general);
+  CUTEST_PASS(mem, aligned);
+  CUTEST_PASS(mem, arena);
+  CUTEST_PASS(mem, stats);
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cute.h"
+#include "unic.h"
+
+CUTEST_DATA {
+  int dummy;
+};
+
+CUTEST_SETUP { u_libsys_init(); }
+
+CUTEST_TEARDOWN { u_libsys_shutdown(); }
+
+CUTEST(memstats, general) {
+  mem_stats_site_t sites[U_MEM_STATS_MAX_SITES];
+  mem_stats_t before;
+  mem_stats_t stats;
+  ptr_t ptrs[4];
+  ptr_t ptr;
+  int count;
+  int i;
+
+  /* Enabled by main() before the first allocation */
+  ASSERT(u_mem_stats_is_enabled() == true);
+  ASSERT(u_mem_stats_enable() == true);
+
+  u_mem_stats_get(&before);
+  for (i = 0; i < 4; ++i) {
+    ptrs[i] = u_malloc(1000);
+    ASSERT(ptrs[i] != NULL);
+    ASSERT(((size_t) ptrs[i] & (sizeof(ptr_t) - 1)) == 0);
+    memset(ptrs[i], 0x5B, 1000);
+  }
+  ptr = u_malloc0(100);
+  ASSERT(ptr != NULL);
+  for (i = 0; i < 100; ++i) {
+    ASSERT(((byte_t *) ptr)[i] == 0);
+  }
+  memset(ptr, 0x5B, 100);
+  ptr = u_realloc(ptr, 5000);
+  ASSERT(ptr != NULL);
+  for (i = 0; i < 100; ++i) {
+    ASSERT(((byte_t *) ptr)[i] == 0x5B);
+  }
+
+  u_mem_stats_get(&stats);
+  ASSERT(stats.live_count == before.live_count + 5);
+  ASSERT(stats.live_bytes == before.live_bytes + 9000);
+  ASSERT(stats.total_count == before.total_count + 6);
+  ASSERT(stats.total_bytes == before.total_bytes + 9100);
+  ASSERT(stats.size_classes[3] == before.size_classes[3] + 1);
+  ASSERT(stats.size_classes[6] == before.size_classes[6] + 4);
+  ASSERT(stats.size_classes[9] == before.size_classes[9] + 1);
+
+  ASSERT(u_mem_stats_get_sites(NULL, 10) == 0);
+  ASSERT(u_mem_stats_get_sites(sites, 0) == 0);
+  ASSERT(u_mem_stats_get_sites(sites, 1) == 1);
+  count = u_mem_stats_get_sites(sites, U_MEM_STATS_MAX_SITES);
+  ASSERT(count > 0);
+  for (i = 1; i < count; ++i) {
+    ASSERT(sites[i - 1].live_bytes >= sites[i].live_bytes);
+  }
+  for (i = 0; i < count; ++i) {
+    if (sites[i].live_count >= 4 && sites[i].live_bytes >= 4000) {
+      break;
+    }
+  }
+  ASSERT(i < count);
+
+  /* Live blocks keep the statistics on */
+  ASSERT(u_mem_stats_disable() == false);
+  for (i = 0; i < 4; ++i) {
+    u_free(ptrs[i]);
+  }
+  u_free(ptr);
+
+  u_mem_stats_get(&stats);
+  ASSERT(stats.live_count == before.live_count);
+  ASSERT(stats.live_bytes == before.live_bytes);
+  ASSERT(stats.total_count == before.total_count + 6);
+  u_mem_stats_dump();
+
+  /* Thread local keys are never released, so some blocks may stay live */
+  u_libsys_shutdown();
+  u_mem_stats_get(&stats);
+  ASSERT(stats.live_count <= before.live_count);
+  ASSERT(u_mem_stats_disable() == (stats.live_count == 0));
+  ASSERT(u_mem_stats_is_enabled() == (stats.live_count != 0));
+  if (!u_mem_stats_is_enabled()) {
+    ASSERT(u_mem_stats_enable() == false);
+  }
+  u_libsys_init();
+  return CUTE_SUCCESS;
+}
+
+int
+main(int ac, char **av) {
+  CUTEST_DATA test = {0};
+
+  /* The statistics must be enabled before any memory is allocated */
+  if (!u_mem_stats_enable()) {
+    return EXIT_FAILURE;
+  }
+  CUTEST_PASS(memstats, general);
+  return EXIT_SUCCESS;
+}
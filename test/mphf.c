@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include "cute.h"
+#include "unic.h"
+
+CUTEST_DATA {
+  int dummy;
+};
+
+CUTEST_SETUP { u_libsys_init(); }
+
+CUTEST_TEARDOWN { u_libsys_shutdown(); }
+
+#define PMPHF_STRESS_COUNT 200000
+
+ptr_t
+pmem_alloc(size_t nbytes) {
+  U_UNUSED(nbytes);
+  return (ptr_t) NULL;
+}
+
+ptr_t
+pmem_realloc(ptr_t block, size_t nbytes) {
+  U_UNUSED(block);
+  U_UNUSED(nbytes);
+  return (ptr_t) NULL;
+}
+
+void
+pmem_free(ptr_t block) {
+  U_UNUSED(block);
+}
+
+static bool
+test_mphf_check(size_t n) {
+  mphf_t *mphf;
+  byte_t **keys;
+  byte_t *seen;
+  byte_t buf[32];
+  size_t i, idx;
+  bool ret;
+
+  keys = u_malloc0(n * sizeof(byte_t *));
+  seen = u_malloc0(n);
+  if (keys == NULL || seen == NULL) {
+    return false;
+  }
+  for (i = 0; i < n; ++i) {
+    snprintf(buf, sizeof(buf), "key-%lu", (unsigned long) i);
+    keys[i] = u_strdup(buf);
+  }
+  ret = (mphf = u_mphf_build((const byte_t *const *) keys, n)) != NULL
+    && u_mphf_get_size(mphf) == n;
+
+  /* Every key gets its own index */
+  for (i = 0; i < n && ret; ++i) {
+    idx = u_mphf_lookup(mphf, keys[i]);
+    ret = idx < n && seen[idx] == 0;
+    if (ret) {
+      seen[idx] = 1;
+    }
+  }
+  if (ret) {
+    ret = u_mphf_lookup(mphf, "not-a-key") < n;
+  }
+  u_mphf_free(mphf);
+  for (i = 0; i < n; ++i) {
+    u_free(keys[i]);
+  }
+  u_free(keys);
+  u_free(seen);
+  return ret;
+}
+
+CUTEST(mphf, nomem) {
+  mem_vtable_t vtable;
+  const byte_t *keys[] = {"a", "b", "c"};
+
+  vtable.free = pmem_free;
+  vtable.malloc = pmem_alloc;
+  vtable.realloc = pmem_realloc;
+  ASSERT(u_mem_set_vtable(&vtable) == true);
+  ASSERT(u_mphf_build(keys, 3) == NULL);
+  u_mem_restore_vtable();
+  return CUTE_SUCCESS;
+}
+
+CUTEST(mphf, invalid) {
+  const byte_t *keys[] = {"a", NULL, "c"};
+  const byte_t *dups[] = {"a", "b", "c", "b"};
+
+  ASSERT(u_mphf_build(NULL, 0) == NULL);
+  ASSERT(u_mphf_build(keys, 0) == NULL);
+  ASSERT(u_mphf_build(keys, 3) == NULL);
+  ASSERT(u_mphf_build(dups, 4) == NULL);
+  ASSERT(u_mphf_lookup(NULL, "a") == 0);
+  ASSERT(u_mphf_get_size(NULL) == 0);
+  u_mphf_free(NULL);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(mphf, general) {
+  const byte_t *keys[] = {
+    "GET", "HEAD", "POST", "PUT", "DELETE", "CONNECT", "OPTIONS", "TRACE",
+    "PATCH"
+  };
+  mphf_t *mphf;
+  size_t i;
+  int seen;
+
+  mphf = u_mphf_build(keys, (sizeof(keys) / sizeof(keys[0])));
+  ASSERT(mphf != NULL);
+  ASSERT(u_mphf_get_size(mphf) == (sizeof(keys) / sizeof(keys[0])));
+  seen = 0;
+  for (i = 0; i < (sizeof(keys) / sizeof(keys[0])); ++i) {
+    ASSERT(u_mphf_lookup(mphf, keys[i]) < (sizeof(keys) / sizeof(keys[0])));
+    seen |= 1 << u_mphf_lookup(mphf, keys[i]);
+  }
+  ASSERT(seen == (1 << (sizeof(keys) / sizeof(keys[0]))) - 1);
+  u_mphf_free(mphf);
+  for (i = 1; i <= 64; ++i) {
+    ASSERT(test_mphf_check(i) == true);
+  }
+  return CUTE_SUCCESS;
+}
+
+CUTEST(mphf, stress) {
+  ASSERT(test_mphf_check(PMPHF_STRESS_COUNT) == true);
+  return CUTE_SUCCESS;
+}
+
+int
+main(int ac, char **av) {
+  CUTEST_DATA test = {0};
+
+  CUTEST_PASS(mphf, nomem);
+  CUTEST_PASS(mphf, invalid);
+  CUTEST_PASS(mphf, general);
+  CUTEST_PASS(mphf, stress);
+  return EXIT_SUCCESS;
+}
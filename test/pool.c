@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include "cute.h"
+#include "unic.h"
+
+CUTEST_DATA {
+  int dummy;
+};
+
+CUTEST_SETUP { u_libsys_init(); }
+
+CUTEST_TEARDOWN { u_libsys_shutdown(); }
+
+#define PPOOL_THREADS 4
+#define PPOOL_BATCH 100
+#define PPOOL_ROUNDS 2000
+#define PPOOL_SLOTS 64
+
+typedef struct pool_object {
+  int owner;
+  int seq;
+  double payload[3];
+} pool_object_t;
+
+static pool_t *test_pool = NULL;
+static ptr_t volatile test_slots[PPOOL_SLOTS];
+static volatile int test_pool_stage = 0;
+
+ptr_t
+pmem_alloc(size_t nbytes) {
+  U_UNUSED(nbytes);
+  return (ptr_t) NULL;
+}
+
+ptr_t
+pmem_realloc(ptr_t block, size_t nbytes) {
+  U_UNUSED(block);
+  U_UNUSED(nbytes);
+  return (ptr_t) NULL;
+}
+
+void
+pmem_free(ptr_t block) {
+  U_UNUSED(block);
+}
+
+static void *
+test_pool_worker_func(void *data) {
+  pool_object_t *objs[PPOOL_BATCH];
+  pool_object_t *obj;
+  int id, i, j;
+
+  id = PPOINTER_TO_INT (data);
+  for (i = 0; i < PPOOL_ROUNDS; ++i) {
+    for (j = 0; j < PPOOL_BATCH; ++j) {
+      if ((objs[j] = u_pool_alloc(test_pool)) == NULL) {
+        u_thread_exit(-1);
+      }
+      objs[j]->owner = id;
+      objs[j]->seq = j;
+    }
+    for (j = 0; j < PPOOL_BATCH; ++j) {
+      if (objs[j]->owner != id || objs[j]->seq != j) {
+        u_thread_exit(-1);
+      }
+    }
+
+    /* Every object is either released here or swapped for an object of
+     * another thread, which gets released instead */
+    for (j = 0; j < PPOOL_BATCH; ++j) {
+      do {
+        obj = u_atomic_pointer_get(&test_slots[(i + j) % PPOOL_SLOTS]);
+      } while (!u_atomic_pointer_compare_and_exchange(
+        &test_slots[(i + j) % PPOOL_SLOTS], obj, objs[j]
+      ));
+      if (obj != NULL) {
+        obj->owner = -1;
+        u_pool_release(test_pool, obj);
+      }
+    }
+  }
+  return NULL;
+}
+
+static void *
+test_pool_orphan_func(void *data) {
+  ptr_t obj;
+
+  U_UNUSED(data);
+  obj = u_pool_alloc(test_pool);
+  u_pool_release(test_pool, obj);
+  u_atomic_int_set(&test_pool_stage, 1);
+
+  /* Exits holding a cache of the pool freed meanwhile */
+  while (u_atomic_int_get(&test_pool_stage) != 2) {
+    u_thread_yield();
+  }
+  return obj != NULL ? NULL : (void *) -1;
+}
+
+CUTEST(pool, nomem) {
+  mem_vtable_t vtable;
+  pool_t *pool;
+
+  pool = u_pool_new(32);
+  ASSERT(pool != NULL);
+  vtable.free = pmem_free;
+  vtable.malloc = pmem_alloc;
+  vtable.realloc = pmem_realloc;
+  ASSERT(u_mem_set_vtable(&vtable) == true);
+  ASSERT(u_pool_new(32) == NULL);
+  ASSERT(u_pool_alloc(pool) == NULL);
+  ASSERT(u_pool_alloc0(pool) == NULL);
+  u_mem_restore_vtable();
+  u_pool_free(pool);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(pool, invalid) {
+  ASSERT(u_pool_new(0) == NULL);
+  ASSERT(u_pool_alloc(NULL) == NULL);
+  ASSERT(u_pool_alloc0(NULL) == NULL);
+  u_pool_release(NULL, NULL);
+  u_pool_free(NULL);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(pool, general) {
+  pool_t *pool, *small_pool;
+  byte_t **objs;
+  byte_t *obj;
+  int i, j;
+
+  pool = u_pool_new(20);
+  ASSERT(pool != NULL);
+  small_pool = u_pool_new(1);
+  ASSERT(small_pool != NULL);
+  objs = u_malloc0(10000 * sizeof(byte_t *));
+  ASSERT(objs != NULL);
+  for (j = 0; j < 3; ++j) {
+    for (i = 0; i < 10000; ++i) {
+      objs[i] = (byte_t *) (j == 0 ? u_pool_alloc0(pool) : u_pool_alloc(pool));
+      ASSERT(objs[i] != NULL);
+      ASSERT(((size_t) objs[i] & 7) == 0);
+      if (j == 0) {
+        ASSERT(objs[i][0] == 0 && objs[i][19] == 0);
+      }
+      memset(objs[i], i % 127, 20);
+    }
+    for (i = 0; i < 10000; ++i) {
+      ASSERT(objs[i][0] == i % 127 && objs[i][19] == i % 127);
+    }
+    for (i = 0; i < 10000; ++i) {
+      u_pool_release(pool, objs[i]);
+    }
+  }
+
+  /* Released objects are reused first */
+  obj = u_pool_alloc(pool);
+  ASSERT(obj == objs[9999]);
+  u_pool_release(pool, obj);
+
+  /* Alternating pools switch the thread caches */
+  for (i = 0; i < 1000; ++i) {
+    obj = u_pool_alloc(i % 2 == 0 ? pool : small_pool);
+    ASSERT(obj != NULL);
+    u_pool_release(i % 2 == 0 ? pool : small_pool, obj);
+  }
+  u_pool_release(pool, NULL);
+  u_pool_free(small_pool);
+  u_pool_free(pool);
+  u_free(objs);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(pool, threads) {
+  thread_t *threads[PPOOL_THREADS];
+  thread_t *orphan;
+  ptr_t obj;
+  int i;
+
+  test_pool = u_pool_new(sizeof(pool_object_t));
+  ASSERT(test_pool != NULL);
+  for (i = 0; i < PPOOL_SLOTS; ++i) {
+    test_slots[i] = NULL;
+  }
+  for (i = 0; i < PPOOL_THREADS; ++i) {
+    threads[i] = u_thread_create(test_pool_worker_func, PINT_TO_POINTER (i),
+      true);
+    ASSERT(threads[i] != NULL);
+  }
+  for (i = 0; i < PPOOL_THREADS; ++i) {
+    ASSERT(u_thread_join(threads[i]) == 0);
+    u_thread_unref(threads[i]);
+  }
+  for (i = 0; i < PPOOL_SLOTS; ++i) {
+    u_pool_release(test_pool, test_slots[i]);
+  }
+
+  /* Magazines of the exited threads are back in the depot */
+  for (i = 0; i < PPOOL_THREADS * PPOOL_BATCH; ++i) {
+    obj = u_pool_alloc(test_pool);
+    ASSERT(obj != NULL);
+  }
+  u_pool_free(test_pool);
+
+  /* A thread may outlive the pool it has used */
+  test_pool = u_pool_new(64);
+  ASSERT(test_pool != NULL);
+  u_atomic_int_set(&test_pool_stage, 0);
+  orphan = u_thread_create(test_pool_orphan_func, NULL, true);
+  ASSERT(orphan != NULL);
+  while (u_atomic_int_get(&test_pool_stage) != 1) {
+    u_thread_yield();
+  }
+  u_pool_free(test_pool);
+  test_pool = u_pool_new(64);
+  ASSERT(test_pool != NULL);
+  u_atomic_int_set(&test_pool_stage, 2);
+  ASSERT(u_thread_join(orphan) == 0);
+  u_thread_unref(orphan);
+  obj = u_pool_alloc(test_pool);
+  ASSERT(obj != NULL);
+  u_pool_release(test_pool, obj);
+  u_pool_free(test_pool);
+  test_pool = NULL;
+  return CUTE_SUCCESS;
+}
+
+int
+main(int ac, char **av) {
+  CUTEST_DATA test = {0};
+
+  CUTEST_PASS(pool, nomem);
+  CUTEST_PASS(pool, invalid);
+  CUTEST_PASS(pool, general);
+  CUTEST_PASS(pool, threads);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,389 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cute.h"
+#include "unic.h"
+
+CUTEST_DATA {
+  int dummy;
+};
+
+CUTEST_SETUP { u_libsys_init(); }
+
+CUTEST_TEARDOWN { u_libsys_shutdown(); }
+
+#define PSKIPLIST_THREADS 4
+#define PSKIPLIST_THREAD_KEYS 20000
+#define PSKIPLIST_SHARED_KEYS 512
+#define PSKIPLIST_SHARED_ROUNDS 20000
+
+typedef struct skiplist_scan {
+  int count;
+  int last;
+  int order_errors;
+} skiplist_scan_t;
+
+static skiplist_t *test_list = NULL;
+static volatile int pp_skiplist_destroy_count = 0;
+static volatile int pp_skiplist_removed_count = 0;
+static volatile int pp_skiplist_writers_done = 0;
+
+ptr_t
+pmem_alloc(size_t nbytes) {
+  U_UNUSED(nbytes);
+  return (ptr_t) NULL;
+}
+
+ptr_t
+pmem_realloc(ptr_t block, size_t nbytes) {
+  U_UNUSED(block);
+  U_UNUSED(nbytes);
+  return (ptr_t) NULL;
+}
+
+void
+pmem_free(ptr_t block) {
+  U_UNUSED(block);
+}
+
+static int
+test_skiplist_compare(const_ptr_t a, const_ptr_t b) {
+  int p1;
+  int p2;
+
+  p1 = PPOINTER_TO_INT (a);
+  p2 = PPOINTER_TO_INT (b);
+  return p1 < p2 ? -1 : (p1 > p2 ? 1 : 0);
+}
+
+static void
+test_skiplist_destroy(ptr_t data) {
+  U_UNUSED(data);
+  u_atomic_int_inc(&pp_skiplist_destroy_count);
+}
+
+static bool
+test_skiplist_scan(ptr_t key, ptr_t value, ptr_t user_data) {
+  skiplist_scan_t *scan;
+
+  U_UNUSED(value);
+  scan = (skiplist_scan_t *) user_data;
+  if (scan->count > 0 && PPOINTER_TO_INT (key) <= scan->last) {
+    ++scan->order_errors;
+  }
+  scan->last = PPOINTER_TO_INT (key);
+  return ++scan->count == 10 && scan->last >= 1000000;
+}
+
+static void *
+test_skiplist_private_func(void *data) {
+  int id;
+  int key;
+  int i;
+
+  /* Keys of all the threads are interleaved to collide on the neighbours */
+  id = PPOINTER_TO_INT (data);
+  for (i = 0; i < PSKIPLIST_THREAD_KEYS; ++i) {
+    key = i * PSKIPLIST_THREADS + id + 1;
+    if (!u_skiplist_insert(test_list, PINT_TO_POINTER (key),
+      PINT_TO_POINTER (key * 10))) {
+      u_thread_exit(-1);
+    }
+  }
+  for (i = 0; i < PSKIPLIST_THREAD_KEYS; ++i) {
+    key = i * PSKIPLIST_THREADS + id + 1;
+    if (u_skiplist_lookup(test_list, PINT_TO_POINTER (key))
+      != PINT_TO_POINTER (key * 10)) {
+      u_thread_exit(-1);
+    }
+  }
+  for (i = 0; i < PSKIPLIST_THREAD_KEYS; i += 2) {
+    key = i * PSKIPLIST_THREADS + id + 1;
+    if (!u_skiplist_remove(test_list, PINT_TO_POINTER (key))) {
+      u_thread_exit(-1);
+    }
+  }
+  for (i = 0; i < PSKIPLIST_THREAD_KEYS; ++i) {
+    key = i * PSKIPLIST_THREADS + id + 1;
+    if ((u_skiplist_lookup(test_list, PINT_TO_POINTER (key))
+      == (ptr_t) -1) != (i % 2 == 0)) {
+      u_thread_exit(-1);
+    }
+  }
+  u_thread_exit(0);
+  return NULL;
+}
+
+static void *
+test_skiplist_shared_func(void *data) {
+  u32_t state;
+  ptr_t key, value;
+  int i;
+
+  state = 2463534242U + (u32_t) PPOINTER_TO_INT (data);
+  for (i = 0; i < PSKIPLIST_SHARED_ROUNDS; ++i) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    key = PUINT_TO_POINTER (state % PSKIPLIST_SHARED_KEYS + 1);
+    switch (state >> 30) {
+      case 0:
+        u_skiplist_insert(test_list, key, key);
+        break;
+      case 1:
+        if (u_skiplist_remove(test_list, key)) {
+          u_atomic_int_inc(&pp_skiplist_removed_count);
+        }
+        break;
+      default:
+        value = u_skiplist_lookup(test_list, key);
+        if (value != (ptr_t) -1 && value != key) {
+          u_thread_exit(-1);
+        }
+    }
+  }
+  u_atomic_int_inc(&pp_skiplist_writers_done);
+  u_thread_exit(0);
+  return NULL;
+}
+
+static void *
+test_skiplist_reader_func(void *data) {
+  skiplist_scan_t scan;
+  ptr_t key;
+
+  U_UNUSED(data);
+  while (u_atomic_int_get(&pp_skiplist_writers_done) < PSKIPLIST_THREADS) {
+    memset(&scan, 0, sizeof(scan));
+    u_skiplist_foreach(test_list, test_skiplist_scan, &scan);
+    if (scan.order_errors != 0 || scan.count > PSKIPLIST_SHARED_KEYS) {
+      u_thread_exit(-1);
+    }
+    memset(&scan, 0, sizeof(scan));
+    u_skiplist_foreach_from(test_list, PINT_TO_POINTER (100),
+      test_skiplist_scan, &scan);
+    if (scan.order_errors != 0 || (scan.count > 0 && scan.last < 100)) {
+      u_thread_exit(-1);
+    }
+    if (u_skiplist_lower_bound(test_list, PINT_TO_POINTER (200), &key, NULL)
+      && PPOINTER_TO_INT (key) < 200) {
+      u_thread_exit(-1);
+    }
+  }
+  u_thread_exit(0);
+  return NULL;
+}
+
+CUTEST(skiplist, nomem) {
+  skiplist_t *list;
+  mem_vtable_t vtable;
+
+  list = u_skiplist_new(test_skiplist_compare);
+  ASSERT(list != NULL);
+  vtable.free = pmem_free;
+  vtable.malloc = pmem_alloc;
+  vtable.realloc = pmem_realloc;
+  ASSERT(u_mem_set_vtable(&vtable) == true);
+  ASSERT(u_skiplist_new(test_skiplist_compare) == NULL);
+  ASSERT(u_skiplist_insert(list, PINT_TO_POINTER (1), NULL) == false);
+  u_mem_restore_vtable();
+  ASSERT(u_skiplist_size(list) == 0);
+  ASSERT(u_skiplist_min(list, NULL, NULL) == false);
+  u_skiplist_free(list);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(skiplist, invalid) {
+  ASSERT(u_skiplist_new(NULL) == NULL);
+  ASSERT(u_skiplist_new_full(NULL, NULL, NULL, NULL) == NULL);
+  ASSERT(u_skiplist_lookup(NULL, NULL) == NULL);
+  ASSERT(u_skiplist_insert(NULL, NULL, NULL) == false);
+  ASSERT(u_skiplist_remove(NULL, NULL) == false);
+  ASSERT(u_skiplist_lower_bound(NULL, NULL, NULL, NULL) == false);
+  ASSERT(u_skiplist_min(NULL, NULL, NULL) == false);
+  ASSERT(u_skiplist_max(NULL, NULL, NULL) == false);
+  ASSERT(u_skiplist_size(NULL) == 0);
+  u_skiplist_foreach(NULL, NULL, NULL);
+  u_skiplist_foreach_from(NULL, NULL, NULL, NULL);
+  u_skiplist_free(NULL);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(skiplist, general) {
+  skiplist_scan_t scan;
+  skiplist_t *list;
+  ptr_t key, value;
+  int i;
+
+  pp_skiplist_destroy_count = 0;
+  list = u_skiplist_new_full((cmp_data_fn_t) test_skiplist_compare, NULL,
+    NULL, test_skiplist_destroy);
+  ASSERT(list != NULL);
+  ASSERT(u_skiplist_lookup(list, PINT_TO_POINTER (1)) == (ptr_t) -1);
+  ASSERT(u_skiplist_remove(list, PINT_TO_POINTER (1)) == false);
+  ASSERT(u_skiplist_min(list, &key, &value) == false);
+  ASSERT(u_skiplist_max(list, &key, &value) == false);
+  ASSERT(u_skiplist_lower_bound(list, NULL, &key, &value) == false);
+
+  /* Descending insertion order */
+  for (i = 10000; i >= 1; --i) {
+    ASSERT(u_skiplist_insert(
+      list, PINT_TO_POINTER (i * 2), PINT_TO_POINTER (i * 10)
+    ) == true);
+  }
+  ASSERT(u_skiplist_size(list) == 10000);
+  ASSERT(u_skiplist_insert(list, PINT_TO_POINTER (10), NULL) == false);
+  ASSERT(u_skiplist_lookup(list, PINT_TO_POINTER (10)) == PINT_TO_POINTER (50));
+  for (i = 1; i <= 10000; ++i) {
+    ASSERT(u_skiplist_lookup(list, PINT_TO_POINTER (i * 2))
+      == PINT_TO_POINTER (i * 10));
+    ASSERT(u_skiplist_lookup(list, PINT_TO_POINTER (i * 2 + 1)) == (ptr_t) -1);
+  }
+  ASSERT(u_skiplist_min(list, &key, &value) == true);
+  ASSERT(key == PINT_TO_POINTER (2) && value == PINT_TO_POINTER (10));
+  ASSERT(u_skiplist_max(list, &key, NULL) == true);
+  ASSERT(key == PINT_TO_POINTER (20000));
+  ASSERT(u_skiplist_lower_bound(list, PINT_TO_POINTER (15), &key, &value));
+  ASSERT(key == PINT_TO_POINTER (16) && value == PINT_TO_POINTER (80));
+  ASSERT(u_skiplist_lower_bound(list, PINT_TO_POINTER (16), &key, NULL));
+  ASSERT(key == PINT_TO_POINTER (16));
+  ASSERT(!u_skiplist_lower_bound(list, PINT_TO_POINTER (20001), &key, NULL));
+
+  memset(&scan, 0, sizeof(scan));
+  u_skiplist_foreach(list, test_skiplist_scan, &scan);
+  ASSERT(scan.count == 10000 && scan.order_errors == 0);
+  ASSERT(scan.last == 20000);
+
+  /* The scan callback stops after 10 keys once the range is passed */
+  memset(&scan, 0, sizeof(scan));
+  u_skiplist_foreach_from(list, PINT_TO_POINTER (1000001), test_skiplist_scan,
+    &scan);
+  ASSERT(scan.count == 0);
+  memset(&scan, 0, sizeof(scan));
+  u_skiplist_foreach_from(list, PINT_TO_POINTER (19981), test_skiplist_scan,
+    &scan);
+  ASSERT(scan.count == 10 && scan.last == 20000 && scan.order_errors == 0);
+
+  for (i = 1; i <= 10000; i += 2) {
+    ASSERT(u_skiplist_remove(list, PINT_TO_POINTER (i * 2)) == true);
+  }
+  ASSERT(u_skiplist_remove(list, PINT_TO_POINTER (2)) == false);
+  ASSERT(u_skiplist_size(list) == 5000);
+  for (i = 1; i <= 10000; ++i) {
+    ASSERT((u_skiplist_lookup(list, PINT_TO_POINTER (i * 2)) == (ptr_t) -1)
+      == (i % 2 == 1));
+  }
+  ASSERT(u_skiplist_min(list, &key, NULL) == true);
+  ASSERT(key == PINT_TO_POINTER (4));
+  memset(&scan, 0, sizeof(scan));
+  u_skiplist_foreach(list, test_skiplist_scan, &scan);
+  ASSERT(scan.count == 5000 && scan.order_errors == 0);
+  ASSERT(u_skiplist_insert(list, PINT_TO_POINTER (2), NULL) == true);
+  ASSERT(u_skiplist_lookup(list, PINT_TO_POINTER (2)) == NULL);
+  u_skiplist_free(list);
+
+  /* Flush the deferred reclamation */
+  u_libsys_shutdown();
+  u_libsys_init();
+  ASSERT(pp_skiplist_destroy_count == 10001);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(skiplist, threads) {
+  thread_t *threads[PSKIPLIST_THREADS];
+  skiplist_scan_t scan;
+  int i;
+
+  test_list = u_skiplist_new(test_skiplist_compare);
+  ASSERT(test_list != NULL);
+  for (i = 0; i < PSKIPLIST_THREADS; ++i) {
+    threads[i] = u_thread_create(
+      (thread_fn_t) test_skiplist_private_func, PINT_TO_POINTER (i), true
+    );
+    ASSERT(threads[i] != NULL);
+  }
+  for (i = 0; i < PSKIPLIST_THREADS; ++i) {
+    ASSERT(u_thread_join(threads[i]) == 0);
+    u_thread_unref(threads[i]);
+  }
+  ASSERT(u_skiplist_size(test_list)
+    == PSKIPLIST_THREADS * PSKIPLIST_THREAD_KEYS / 2);
+  memset(&scan, 0, sizeof(scan));
+  u_skiplist_foreach(test_list, test_skiplist_scan, &scan);
+  ASSERT(scan.count == PSKIPLIST_THREADS * PSKIPLIST_THREAD_KEYS / 2);
+  ASSERT(scan.order_errors == 0);
+  u_skiplist_free(test_list);
+  test_list = NULL;
+  return CUTE_SUCCESS;
+}
+
+CUTEST(skiplist, contention) {
+  thread_t *threads[PSKIPLIST_THREADS + 1];
+  skiplist_scan_t scan;
+  size_t count;
+  int i;
+
+  pp_skiplist_destroy_count = 0;
+  pp_skiplist_removed_count = 0;
+  pp_skiplist_writers_done = 0;
+  test_list = u_skiplist_new_full((cmp_data_fn_t) test_skiplist_compare,
+    NULL, NULL, test_skiplist_destroy);
+  ASSERT(test_list != NULL);
+  for (i = 0; i < PSKIPLIST_THREADS; ++i) {
+    threads[i] = u_thread_create(
+      (thread_fn_t) test_skiplist_shared_func, PINT_TO_POINTER (i), true
+    );
+    ASSERT(threads[i] != NULL);
+  }
+  threads[i] = u_thread_create(
+    (thread_fn_t) test_skiplist_reader_func, NULL, true
+  );
+  ASSERT(threads[i] != NULL);
+  for (i = 0; i <= PSKIPLIST_THREADS; ++i) {
+    ASSERT(u_thread_join(threads[i]) == 0);
+    u_thread_unref(threads[i]);
+  }
+  count = 0;
+  for (i = 1; i <= PSKIPLIST_SHARED_KEYS; ++i) {
+    if (u_skiplist_lookup(test_list, PINT_TO_POINTER (i)) != (ptr_t) -1) {
+      ++count;
+    }
+  }
+  ASSERT(u_skiplist_size(test_list) == count);
+  memset(&scan, 0, sizeof(scan));
+  u_skiplist_foreach(test_list, test_skiplist_scan, &scan);
+  ASSERT(scan.count == (int) count && scan.order_errors == 0);
+  u_skiplist_free(test_list);
+  test_list = NULL;
+  u_libsys_shutdown();
+  u_libsys_init();
+  ASSERT(pp_skiplist_destroy_count
+    == pp_skiplist_removed_count + (int) count);
+  return CUTE_SUCCESS;
+}
+
+int
+main(int ac, char **av) {
+  CUTEST_DATA test = {0};
+
+  CUTEST_PASS(skiplist, nomem);
+  CUTEST_PASS(skiplist, invalid);
+  CUTEST_PASS(skiplist, general);
+  CUTEST_PASS(skiplist, threads);
+  CUTEST_PASS(skiplist, contention);
+  return EXIT_SUCCESS;
+}
@@ -32,6 +32,7 @@ CUTEST_TEARDOWN { u_libsys_shutdown(); }
 #define PTREE_STRESS_NODES  10000
 #define PTREE_STRESS_ROOT_MIN  10000
 #define PTREE_STRESS_TRAVS  30
+#define PTREE_DESTROY_NODES  512
 typedef struct tree_data {
   int cmp_counter;
   int key_destroy_counter;
@@ -80,6 +81,10 @@ tree_complexity(tree_t *tree) {
         log(sqrt(5.0) * (u_tree_get_nnodes(tree) + 2)) / log(phi) - 2
       );
     }
+    case U_TREE_TYPE_BTREE:
+      /* Binary search in up to 15 keys plus one compare after a split */
+      return 5 * (1 + (int) (
+        log((u_tree_get_nnodes(tree) + 1) / 2.0) / log(8.0)));
     default:
       return u_tree_get_nnodes(tree);
   }
@@ -132,6 +137,19 @@ value_destroy_notify(ptr_t data) {
   tree_data.value_sum += PPOINTER_TO_INT (data);
 }
 
+static int key_destroyed[PTREE_DESTROY_NODES + 1];
+static int value_destroyed[PTREE_DESTROY_NODES + 1];
+
+static void
+key_destroy_count(ptr_t data) {
+  key_destroyed[PPOINTER_TO_INT (data)]++;
+}
+
+static void
+value_destroy_count(ptr_t data) {
+  value_destroyed[PPOINTER_TO_INT (data) - PTREE_DESTROY_NODES]++;
+}
+
 static bool
 tree_traverse(ptr_t key, ptr_t value, ptr_t data) {
   tree_data_t *tdata;
@@ -401,11 +419,12 @@ stress_tree_test(tree_t *tree, int node_count) {
 }
 
 CUTEST(tree, nomem) {
+  ptr_t keys[1];
   int i;
   mem_vtable_t vtable;
   tree_t *tree;
 
-  for (i = (int) U_TREE_TYPE_BINARY; i <= (int) U_TREE_TYPE_AVL; ++i) {
+  for (i = (int) U_TREE_TYPE_BINARY; i <= (int) U_TREE_TYPE_BTREE; ++i) {
     tree = u_tree_new((tree_kind_t) i, (cmp_fn_t) compare_keys);
     ASSERT(tree != NULL);
     vtable.free = pmem_free;
@@ -416,6 +435,13 @@ CUTEST(tree, nomem) {
     u_tree_insert(tree, PINT_TO_POINTER (1), PINT_TO_POINTER (10));
     ASSERT(u_tree_get_nnodes(tree) == 0);
     u_mem_restore_vtable();
+    u_tree_insert(tree, PINT_TO_POINTER (1), PINT_TO_POINTER (10));
+    ASSERT(u_mem_set_vtable(&vtable) == true);
+    keys[0] = PINT_TO_POINTER (2);
+    ASSERT(u_tree_build_sorted(tree, keys, NULL, 1) == false);
+    ASSERT(u_tree_get_nnodes(tree) == 1);
+    ASSERT(u_tree_lookup(tree, PINT_TO_POINTER (1)) == PINT_TO_POINTER (10));
+    u_mem_restore_vtable();
     u_tree_free(tree);
   }
   return CUTE_SUCCESS;
@@ -424,7 +450,7 @@ CUTEST(tree, nomem) {
 CUTEST(tree, invalid) {
   int i;
 
-  for (i = (int) U_TREE_TYPE_BINARY; i <= (int) U_TREE_TYPE_AVL; ++i) {
+  for (i = (int) U_TREE_TYPE_BINARY; i <= (int) U_TREE_TYPE_BTREE; ++i) {
     /* Invalid usage */
     ASSERT(u_tree_new((tree_kind_t) i, NULL) == NULL);
     ASSERT(u_tree_new((tree_kind_t) -1, (cmp_fn_t) compare_keys) == NULL);
@@ -461,6 +487,19 @@ CUTEST(tree, invalid) {
     u_tree_foreach(NULL, NULL, NULL);
     u_tree_clear(NULL);
     u_tree_free(NULL);
+    ASSERT(u_tree_lower_bound(NULL, NULL, NULL, NULL) == false);
+    ASSERT(u_tree_upper_bound(NULL, NULL, NULL, NULL) == false);
+    ASSERT(u_tree_min(NULL, NULL, NULL) == false);
+    ASSERT(u_tree_max(NULL, NULL, NULL) == false);
+    u_tree_iter_init(NULL, NULL);
+    u_tree_iter_seek(NULL, NULL);
+    u_tree_iter_seek_end(NULL);
+    ASSERT(u_tree_iter_next(NULL, NULL, NULL) == false);
+    ASSERT(u_tree_iter_prev(NULL, NULL, NULL) == false);
+    ASSERT(u_tree_build_sorted(NULL, NULL, NULL, 0) == false);
+    ASSERT(u_tree_enable_ranks(NULL) == false);
+    ASSERT(u_tree_select(NULL, 0, NULL, NULL) == false);
+    ASSERT(u_tree_rank(NULL, NULL) == -1);
   }
   return CUTE_SUCCESS;
 }
@@ -469,7 +508,7 @@ CUTEST(tree, general) {
   tree_t *tree;
   int i;
 
-  for (i = (int) U_TREE_TYPE_BINARY; i <= (int) U_TREE_TYPE_AVL; ++i) {
+  for (i = (int) U_TREE_TYPE_BINARY; i <= (int) U_TREE_TYPE_BTREE; ++i) {
     /* Test 1 */
     tree = u_tree_new((tree_kind_t) i, (cmp_fn_t) compare_keys);
     ASSERT(general_tree_test(tree, (tree_kind_t) i, false, false) == true);
@@ -507,7 +546,7 @@ CUTEST(tree, stress) {
   int i;
   int j;
 
-  for (i = (int) U_TREE_TYPE_BINARY; i <= (int) U_TREE_TYPE_AVL; ++i) {
+  for (i = (int) U_TREE_TYPE_BINARY; i <= (int) U_TREE_TYPE_BTREE; ++i) {
     tree = u_tree_new_full((tree_kind_t) i,
       (cmp_data_fn_t) compare_keys_data,
       &tree_data,
@@ -521,6 +560,458 @@ CUTEST(tree, stress) {
   return CUTE_SUCCESS;
 }
 
+/* Walks over the even keys from 0 to 2 * (nkeys - 1) in both directions,
+ * returns the failed assertion or NULL */
+static const char *
+iter_tree_test(tree_t *tree, int nkeys) {
+  tree_iter_t iter;
+  ptr_t key, value;
+  int i, j;
+
+  ASSERT(u_tree_min(tree, &key, &value) == true);
+  ASSERT(PPOINTER_TO_INT (key) == 0 && PPOINTER_TO_INT (value) == 1);
+  ASSERT(u_tree_max(tree, &key, NULL) == true);
+  ASSERT(PPOINTER_TO_INT (key) == 2 * (nkeys - 1));
+  for (i = -1; i <= 2 * nkeys; ++i) {
+    if (i < 2 * (nkeys - 1)) {
+      ASSERT(u_tree_upper_bound(tree, PINT_TO_POINTER (i), &key, &value));
+      ASSERT(PPOINTER_TO_INT (key) == (i < 0 ? 0 : (i / 2 + 1) * 2));
+      ASSERT(PPOINTER_TO_INT (value) == PPOINTER_TO_INT (key) + 1);
+    } else {
+      ASSERT(!u_tree_upper_bound(tree, PINT_TO_POINTER (i), &key, &value));
+    }
+    if (i <= 2 * (nkeys - 1)) {
+      ASSERT(u_tree_lower_bound(tree, PINT_TO_POINTER (i), &key, NULL));
+      ASSERT(PPOINTER_TO_INT (key) == (i < 0 ? 0 : (i + 1) / 2 * 2));
+    } else {
+      ASSERT(!u_tree_lower_bound(tree, PINT_TO_POINTER (i), &key, NULL));
+    }
+  }
+
+  /* Full scans */
+  u_tree_iter_init(&iter, tree);
+  ASSERT(u_tree_iter_prev(&iter, &key, NULL) == false);
+  for (i = 0; u_tree_iter_next(&iter, &key, &value); ++i) {
+    ASSERT(PPOINTER_TO_INT (key) == i * 2);
+    ASSERT(PPOINTER_TO_INT (value) == i * 2 + 1);
+  }
+  ASSERT(i == nkeys);
+  ASSERT(u_tree_iter_next(&iter, &key, NULL) == false);
+  for (i = nkeys - 1; u_tree_iter_prev(&iter, &key, NULL); --i) {
+    ASSERT(PPOINTER_TO_INT (key) == i * 2);
+  }
+  ASSERT(i == -1);
+  u_tree_iter_seek_end(&iter);
+  ASSERT(u_tree_iter_next(&iter, &key, NULL) == false);
+  ASSERT(u_tree_iter_prev(&iter, &key, NULL) == true);
+  ASSERT(PPOINTER_TO_INT (key) == 2 * (nkeys - 1));
+
+  /* Ranges starting from every key and from the gaps */
+  for (i = 0; i < 2 * nkeys; i += nkeys / 50 + 1) {
+    u_tree_iter_seek(&iter, PINT_TO_POINTER (i));
+    for (j = 0; j < 10 && u_tree_iter_next(&iter, &key, NULL); ++j) {
+      ASSERT(PPOINTER_TO_INT (key) == (i + 1) / 2 * 2 + j * 2);
+    }
+    ASSERT(j == 10 || (i + 1) / 2 + j == nkeys);
+
+    /* Going back returns the same keys in the reverse order */
+    for (; j > 0; --j) {
+      ASSERT(u_tree_iter_prev(&iter, &key, NULL) == true);
+      ASSERT(PPOINTER_TO_INT (key) == (i + 1) / 2 * 2 + (j - 1) * 2);
+    }
+    if (i > 0) {
+      ASSERT(u_tree_iter_prev(&iter, &key, NULL) == true);
+      ASSERT(PPOINTER_TO_INT (key) == ((i + 1) / 2 - 1) * 2);
+    } else {
+      ASSERT(u_tree_iter_prev(&iter, &key, NULL) == false);
+    }
+  }
+  u_tree_iter_seek(&iter, PINT_TO_POINTER (2 * nkeys));
+  ASSERT(u_tree_iter_next(&iter, &key, NULL) == false);
+  return NULL;
+}
+
+CUTEST(tree, iter) {
+  tree_iter_t iter;
+  tree_t *tree;
+  int *keys;
+  int i, j, tmp;
+
+  keys = u_malloc0(5000 * sizeof(int));
+  ASSERT(keys != NULL);
+  for (i = 0; i < 5000; ++i) {
+    keys[i] = i;
+  }
+  srand((unsigned int) time(NULL));
+  for (i = 4999; i > 0; --i) {
+    j = rand() % (i + 1);
+    tmp = keys[i];
+    keys[i] = keys[j];
+    keys[j] = tmp;
+  }
+  for (i = (int) U_TREE_TYPE_BINARY; i <= (int) U_TREE_TYPE_BTREE; ++i) {
+    tree = u_tree_new((tree_kind_t) i, (cmp_fn_t) compare_keys);
+    ASSERT(tree != NULL);
+    ASSERT(u_tree_min(tree, NULL, NULL) == false);
+    ASSERT(u_tree_max(tree, NULL, NULL) == false);
+    ASSERT(u_tree_lower_bound(tree, NULL, NULL, NULL) == false);
+    u_tree_iter_init(&iter, tree);
+    ASSERT(u_tree_iter_next(&iter, NULL, NULL) == false);
+    ASSERT(u_tree_iter_prev(&iter, NULL, NULL) == false);
+    for (j = 0; j < 5000; ++j) {
+      u_tree_insert(tree, PINT_TO_POINTER (keys[j] * 2),
+        PINT_TO_POINTER (keys[j] * 2 + 1));
+    }
+    ASSERT(iter_tree_test(tree, 5000) == NULL);
+    u_tree_free(tree);
+
+    /* Sorted input degenerates the plain binary tree beyond the cursor
+     * path limit */
+    tree = u_tree_new((tree_kind_t) i, (cmp_fn_t) compare_keys);
+    for (j = 0; j < 300; ++j) {
+      u_tree_insert(tree, PINT_TO_POINTER (j * 2), PINT_TO_POINTER (j * 2 + 1));
+    }
+    ASSERT(iter_tree_test(tree, 300) == NULL);
+    u_tree_free(tree);
+  }
+  u_free(keys);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(tree, btree) {
+  tree_t *tree;
+  bool *present;
+  int i, key, nkeys, nremoved;
+
+  /* Random operations checked against a presence map, destroy counters
+   * catch keys which are lost or released twice on rebalancing */
+  tree = u_tree_new_full(U_TREE_TYPE_BTREE,
+    (cmp_data_fn_t) compare_keys_data,
+    NULL,
+    (destroy_fn_t) key_destroy_notify,
+    (destroy_fn_t) value_destroy_notify
+  );
+  ASSERT(tree != NULL);
+  present = u_malloc0(4096 * sizeof(bool));
+  ASSERT(present != NULL);
+  memset(&tree_data, 0, sizeof(tree_data));
+  srand((unsigned int) time(NULL));
+  nkeys = 0;
+  nremoved = 0;
+  for (i = 0; i < 200000; ++i) {
+    key = rand() % 4096 + 1;
+    if (rand() % 3 != 0) {
+      u_tree_insert(tree, PINT_TO_POINTER (key), PINT_TO_POINTER (key));
+      if (!present[key - 1]) {
+        present[key - 1] = true;
+        ++nkeys;
+      } else {
+        ++nremoved;
+      }
+    } else {
+      ASSERT(u_tree_remove(tree, PINT_TO_POINTER (key)) == present[key - 1]);
+      if (present[key - 1]) {
+        present[key - 1] = false;
+        --nkeys;
+        ++nremoved;
+      }
+    }
+    ASSERT(u_tree_get_nnodes(tree) == nkeys);
+    ASSERT(tree_data.key_destroy_counter == nremoved);
+    ASSERT(tree_data.value_destroy_counter == nremoved);
+  }
+  for (key = 1; key <= 4096; ++key) {
+    ASSERT(u_tree_lookup(tree, PINT_TO_POINTER (key)) ==
+      (present[key - 1] ? PINT_TO_POINTER (key) : NULL));
+  }
+  memset(&tree_data, 0, sizeof(tree_data));
+  u_tree_foreach(tree, (traverse_fn_t) tree_traverse, &tree_data);
+  ASSERT(tree_data.traverse_counter == nkeys);
+  ASSERT(tree_data.key_order_errors == 0);
+  memset(&tree_data, 0, sizeof(tree_data));
+  u_tree_free(tree);
+  ASSERT(tree_data.key_destroy_counter == nkeys);
+  ASSERT(tree_data.value_destroy_counter == nkeys);
+  u_free(present);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(tree, remove_destroy) {
+  tree_t *tree;
+  int i, j, key;
+
+  /* Every removal must destroy exactly the removed pair, whichever node of
+   * the tree holds it after the rebalancing */
+  for (i = (int) U_TREE_TYPE_BINARY; i <= (int) U_TREE_TYPE_BTREE; ++i) {
+    tree = u_tree_new_full((tree_kind_t) i,
+      (cmp_data_fn_t) compare_keys_data,
+      NULL,
+      (destroy_fn_t) key_destroy_count,
+      (destroy_fn_t) value_destroy_count
+    );
+    ASSERT(tree != NULL);
+    memset(key_destroyed, 0, sizeof(key_destroyed));
+    memset(value_destroyed, 0, sizeof(value_destroyed));
+    for (j = 0; j < PTREE_DESTROY_NODES; ++j) {
+      key = (j * 7919) % PTREE_DESTROY_NODES + 1;
+      u_tree_insert(tree, PINT_TO_POINTER (key),
+        PINT_TO_POINTER (key + PTREE_DESTROY_NODES));
+    }
+    for (j = 0; j < PTREE_DESTROY_NODES; ++j) {
+      key = (j * 263) % PTREE_DESTROY_NODES + 1;
+      ASSERT(u_tree_remove(tree, PINT_TO_POINTER (key)) == true);
+      ASSERT(key_destroyed[key] == 1);
+      ASSERT(value_destroyed[key] == 1);
+    }
+    ASSERT(u_tree_get_nnodes(tree) == 0);
+    for (key = 1; key <= PTREE_DESTROY_NODES; ++key) {
+      ASSERT(key_destroyed[key] == 1);
+      ASSERT(value_destroyed[key] == 1);
+    }
+    u_tree_free(tree);
+  }
+  return CUTE_SUCCESS;
+}
+
+CUTEST(tree, build) {
+  static const int sizes[] = {0, 1, 2, 3, 7, 15, 16, 17, 100, 255, 256, 5000};
+  tree_t *tree;
+  ptr_t *keys, *values;
+  int i, j, k, n, max_cmp;
+
+  keys = u_malloc0(5000 * sizeof(ptr_t));
+  values = u_malloc0(5000 * sizeof(ptr_t));
+  ASSERT(keys != NULL && values != NULL);
+  for (i = 0; i < 5000; ++i) {
+    keys[i] = PINT_TO_POINTER (i * 2);
+    values[i] = PINT_TO_POINTER (i * 2 + 1);
+  }
+  for (i = (int) U_TREE_TYPE_BINARY; i <= (int) U_TREE_TYPE_BTREE; ++i) {
+    tree = u_tree_new_with_data((tree_kind_t) i,
+      (cmp_data_fn_t) compare_keys_data,
+      &tree_data
+    );
+    ASSERT(tree != NULL);
+    ASSERT(u_tree_build_sorted(tree, NULL, NULL, 1) == false);
+    ASSERT(u_tree_build_sorted(tree, keys, NULL, -1) == false);
+
+    /* Unsorted input and duplicates leave the tree untouched */
+    u_tree_insert(tree, PINT_TO_POINTER (1), PINT_TO_POINTER (1));
+    keys[1] = PINT_TO_POINTER (-1);
+    ASSERT(u_tree_build_sorted(tree, keys, values, 3) == false);
+    keys[1] = PINT_TO_POINTER (0);
+    ASSERT(u_tree_build_sorted(tree, keys, values, 3) == false);
+    keys[1] = PINT_TO_POINTER (2);
+    ASSERT(u_tree_get_nnodes(tree) == 1);
+    ASSERT(u_tree_lookup(tree, PINT_TO_POINTER (1)) == PINT_TO_POINTER (1));
+
+    for (j = 0; j < (int) (sizeof(sizes) / sizeof(sizes[0])); ++j) {
+      n = sizes[j];
+      ASSERT(u_tree_build_sorted(tree, keys, values, n) == true);
+      ASSERT(u_tree_get_nnodes(tree) == n);
+      ASSERT(u_tree_lookup(tree, PINT_TO_POINTER (1)) == NULL);
+      if (n == 0) {
+        continue;
+      }
+      ASSERT(iter_tree_test(tree, n) == NULL);
+
+      /* Every key is reachable within the balanced height, even for the
+       * plain binary tree */
+      for (max_cmp = 1; (n >> max_cmp) > 0; ++max_cmp)
+        ;
+      if (i == (int) U_TREE_TYPE_BTREE) {
+        max_cmp = tree_complexity(tree);
+      }
+      for (k = 0; k < n; ++k) {
+        tree_data.cmp_counter = 0;
+        ASSERT(u_tree_lookup(tree, keys[k]) == values[k]);
+        ASSERT(tree_data.cmp_counter <= max_cmp);
+      }
+
+      /* The balance data must be valid for the following updates */
+      for (k = 0; k < n; k += 2) {
+        ASSERT(u_tree_remove(tree, keys[k]) == true);
+      }
+      for (k = 0; k < n; k += 2) {
+        u_tree_insert(tree, PINT_TO_POINTER (k * 2 + 1), NULL);
+      }
+      ASSERT(u_tree_get_nnodes(tree) == n);
+      for (k = 0; k < n; ++k) {
+        ASSERT(u_tree_lookup(tree, keys[k]) == (k % 2 ? values[k] : NULL));
+        ASSERT(u_tree_remove(tree, keys[k]) == (k % 2 == 1));
+        if (k % 2 == 0) {
+          ASSERT(u_tree_remove(tree, PINT_TO_POINTER (k * 2 + 1)) == true);
+        }
+      }
+      ASSERT(u_tree_get_nnodes(tree) == 0);
+    }
+
+    /* Values are optional */
+    ASSERT(u_tree_build_sorted(tree, keys, NULL, 100) == true);
+    ASSERT(u_tree_get_nnodes(tree) == 100);
+    ASSERT(u_tree_lookup(tree, keys[99]) == NULL);
+    u_tree_free(tree);
+  }
+  u_free(keys);
+  u_free(values);
+  return CUTE_SUCCESS;
+}
+
+/* Checks every index and every key from 0 to 2 * nkeys against a presence
+ * map, returns the failed assertion or NULL */
+static const char *
+rank_tree_test(tree_t *tree, const bool *present, int nkeys) {
+  ptr_t key, value;
+  int i, index;
+
+  index = 0;
+  for (i = 0; i < nkeys; ++i) {
+    ASSERT(u_tree_rank(tree, PINT_TO_POINTER (i)) == index);
+    if (present[i]) {
+      ASSERT(u_tree_select(tree, index, &key, &value) == true);
+      ASSERT(PPOINTER_TO_INT (key) == i && PPOINTER_TO_INT (value) == i + 1);
+      ++index;
+    }
+  }
+  ASSERT(index == u_tree_get_nnodes(tree));
+  ASSERT(u_tree_select(tree, index, &key, NULL) == false);
+  ASSERT(u_tree_select(tree, -1, &key, NULL) == false);
+  ASSERT(u_tree_rank(tree, PINT_TO_POINTER (2 * nkeys)) == index);
+  return NULL;
+}
+
+CUTEST(tree, rank) {
+  tree_t *tree;
+  bool *present;
+  ptr_t keys[1000];
+  int i, j, key;
+
+  present = u_malloc0(1000 * sizeof(bool));
+  ASSERT(present != NULL);
+  for (i = (int) U_TREE_TYPE_BINARY; i <= (int) U_TREE_TYPE_BTREE; ++i) {
+    tree = u_tree_new((tree_kind_t) i, (cmp_fn_t) compare_keys);
+    ASSERT(tree != NULL);
+    if (i != (int) U_TREE_TYPE_RB && i != (int) U_TREE_TYPE_AVL) {
+      ASSERT(u_tree_enable_ranks(tree) == false);
+      ASSERT(u_tree_select(tree, 0, NULL, NULL) == false);
+      ASSERT(u_tree_rank(tree, NULL) == -1);
+      u_tree_free(tree);
+      continue;
+    }
+
+    /* Enabled on a filled tree */
+    memset(present, 0, 1000 * sizeof(bool));
+    for (j = 0; j < 1000; j += 3) {
+      u_tree_insert(tree, PINT_TO_POINTER (j), PINT_TO_POINTER (j + 1));
+      present[j] = true;
+    }
+    ASSERT(u_tree_rank(tree, NULL) == -1);
+    ASSERT(u_tree_enable_ranks(tree) == true);
+    ASSERT(u_tree_enable_ranks(tree) == true);
+    ASSERT(rank_tree_test(tree, present, 1000) == NULL);
+
+    /* Random updates exercise all the rotations */
+    srand((unsigned int) time(NULL));
+    for (j = 0; j < 20000; ++j) {
+      key = rand() % 1000;
+      if (rand() % 2 == 0) {
+        u_tree_insert(tree, PINT_TO_POINTER (key), PINT_TO_POINTER (key + 1));
+        present[key] = true;
+      } else {
+        ASSERT(u_tree_remove(tree, PINT_TO_POINTER (key)) == present[key]);
+        present[key] = false;
+      }
+      if (j % 1000 == 0) {
+        ASSERT(rank_tree_test(tree, present, 1000) == NULL);
+      }
+    }
+    ASSERT(rank_tree_test(tree, present, 1000) == NULL);
+
+    /* Bulk loading keeps the sizes */
+    for (j = 0; j < 1000; ++j) {
+      keys[j] = PINT_TO_POINTER (j);
+      present[j] = j < 500;
+    }
+    ASSERT(u_tree_build_sorted(tree, keys, &keys[1], 500) == true);
+    ASSERT(rank_tree_test(tree, present, 1000) == NULL);
+    u_tree_clear(tree);
+    ASSERT(u_tree_select(tree, 0, NULL, NULL) == false);
+    ASSERT(u_tree_rank(tree, PINT_TO_POINTER (1)) == 0);
+    u_tree_free(tree);
+  }
+  u_free(present);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(tree, typed) {
+  tree_iter_t iter;
+  tree_t *tree;
+  ptr_t key, value;
+  char buf[16];
+  int i, j, prev;
+
+  for (i = (int) U_TREE_TYPE_BINARY; i <= (int) U_TREE_TYPE_BTREE; ++i) {
+    ASSERT(u_tree_new_int((tree_kind_t) -1) == NULL);
+    ASSERT(u_tree_new_str((tree_kind_t) -1, NULL, NULL) == NULL);
+
+    /* Integer keys are ordered as signed values */
+    tree = u_tree_new_int((tree_kind_t) i);
+    ASSERT(tree != NULL);
+    for (j = 0; j < 2000; ++j) {
+      u_tree_insert(tree, PINT_TO_POINTER ((j * 7919) % 2000 - 1000),
+        PINT_TO_POINTER (j));
+    }
+    ASSERT(u_tree_get_nnodes(tree) == 2000);
+    for (j = 0; j < 2000; ++j) {
+      ASSERT(u_tree_lookup(tree, PINT_TO_POINTER ((j * 7919) % 2000 - 1000))
+        == PINT_TO_POINTER (j));
+    }
+    ASSERT(u_tree_lookup(tree, PINT_TO_POINTER (1000)) == NULL);
+    ASSERT(u_tree_min(tree, &key, NULL) == true);
+    ASSERT(PPOINTER_TO_INT (key) == -1000);
+    u_tree_iter_init(&iter, tree);
+    u_tree_iter_seek(&iter, PINT_TO_POINTER (-10));
+    for (j = -10; u_tree_iter_next(&iter, &key, NULL); ++j) {
+      ASSERT(PPOINTER_TO_INT (key) == j);
+    }
+    ASSERT(j == 1000);
+    for (j = -1000; j < 1000; j += 2) {
+      ASSERT(u_tree_remove(tree, PINT_TO_POINTER (j)) == true);
+    }
+    ASSERT(u_tree_remove(tree, PINT_TO_POINTER (-1000)) == false);
+    ASSERT(u_tree_get_nnodes(tree) == 1000);
+    u_tree_free(tree);
+
+    /* String keys are ordered with strcmp() and owned by the tree */
+    tree = u_tree_new_str((tree_kind_t) i, (destroy_fn_t) u_free, NULL);
+    ASSERT(tree != NULL);
+    for (j = 0; j < 1000; ++j) {
+      snprintf(buf, sizeof(buf), "key%d", j);
+      u_tree_insert(tree, u_strdup(buf), PINT_TO_POINTER (j));
+    }
+    ASSERT(u_tree_get_nnodes(tree) == 1000);
+    for (j = 0; j < 1000; ++j) {
+      snprintf(buf, sizeof(buf), "key%d", j);
+      ASSERT(u_tree_lookup(tree, buf) == PINT_TO_POINTER (j));
+    }
+    ASSERT(u_tree_lookup(tree, "key") == NULL);
+    ASSERT(u_tree_remove(tree, "key500") == true);
+    ASSERT(u_tree_lookup(tree, "key500") == NULL);
+    u_tree_iter_init(&iter, tree);
+    prev = -1;
+    buf[0] = '\0';
+    for (j = 0; u_tree_iter_next(&iter, &key, &value); ++j) {
+      ASSERT(strcmp(buf, (const char *) key) < 0);
+      snprintf(buf, sizeof(buf), "%s", (const char *) key);
+      prev = PPOINTER_TO_INT (value);
+    }
+    ASSERT(j == 999);
+    ASSERT(prev == 999);
+    u_tree_free(tree);
+  }
+  return CUTE_SUCCESS;
+}
+
 int
 main(int ac, char **av) {
   CUTEST_DATA test = {0};
@@ -529,5 +1020,11 @@ main(int ac, char **av) {
   CUTEST_PASS(tree, invalid);
   CUTEST_PASS(tree, general);
   CUTEST_PASS(tree, stress);
+  CUTEST_PASS(tree, iter);
+  CUTEST_PASS(tree, btree);
+  CUTEST_PASS(tree, remove_destroy);
+  CUTEST_PASS(tree, build);
+  CUTEST_PASS(tree, rank);
+  CUTEST_PASS(tree, typed);
   return EXIT_SUCCESS;
 }
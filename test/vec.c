@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2017 Alexander Saprykin <xelfium@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include "cute.h"
+#include "unic.h"
+
+CUTEST_DATA {
+  int dummy;
+};
+
+CUTEST_SETUP { u_libsys_init(); }
+
+CUTEST_TEARDOWN { u_libsys_shutdown(); }
+
+ptr_t
+pmem_alloc(size_t nbytes) {
+  U_UNUSED(nbytes);
+  return (ptr_t) NULL;
+}
+
+ptr_t
+pmem_realloc(ptr_t block, size_t nbytes) {
+  U_UNUSED(block);
+  U_UNUSED(nbytes);
+  return (ptr_t) NULL;
+}
+
+void
+pmem_free(ptr_t block) {
+  U_UNUSED(block);
+}
+
+static int
+test_vec_cmp_int(const_ptr_t a, const_ptr_t b) {
+  int va = *((const int *) a), vb = *((const int *) b);
+
+  return va < vb ? -1 : (va > vb ? 1 : 0);
+}
+
+CUTEST(vec, nomem) {
+  mem_vtable_t vtable;
+  vec_t *vec;
+  int val;
+
+  vec = u_vec_new(sizeof(int));
+  ASSERT(vec != NULL);
+  vtable.free = pmem_free;
+  vtable.malloc = pmem_alloc;
+  vtable.realloc = pmem_realloc;
+  ASSERT(u_mem_set_vtable(&vtable) == true);
+  ASSERT(u_vec_new(sizeof(int)) == NULL);
+  val = 10;
+  ASSERT(u_vec_push(vec, &val) == false);
+  ASSERT(u_vec_append(vec, &val, 1) == false);
+  ASSERT(u_vec_reserve(vec, 100) == false);
+  ASSERT(u_vec_get_size(vec) == 0);
+  u_mem_restore_vtable();
+  u_vec_free(vec);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(vec, invalid) {
+  vec_t *vec;
+  int val;
+
+  ASSERT(u_vec_new(0) == NULL);
+  ASSERT(u_vec_get_size(NULL) == 0);
+  ASSERT(u_vec_get_capacity(NULL) == 0);
+  ASSERT(u_vec_data(NULL) == NULL);
+  ASSERT(u_vec_at(NULL, 0) == NULL);
+  ASSERT(u_vec_push(NULL, NULL) == false);
+  ASSERT(u_vec_pop(NULL, NULL) == false);
+  ASSERT(u_vec_append(NULL, NULL, 0) == false);
+  ASSERT(u_vec_insert(NULL, 0, NULL) == false);
+  ASSERT(u_vec_remove(NULL, 0, NULL) == false);
+  ASSERT(u_vec_reserve(NULL, 0) == false);
+  ASSERT(u_vec_shrink(NULL) == false);
+  ASSERT(u_vec_bsearch(NULL, NULL, NULL, NULL) == false);
+  u_vec_clear(NULL);
+  u_vec_sort(NULL, NULL);
+  u_vec_free(NULL);
+  vec = u_vec_new(sizeof(int));
+  ASSERT(vec != NULL);
+  val = 1;
+  ASSERT(u_vec_at(vec, 0) == NULL);
+  ASSERT(u_vec_pop(vec, &val) == false);
+  ASSERT(u_vec_insert(vec, 1, &val) == false);
+  ASSERT(u_vec_remove(vec, 0, NULL) == false);
+  ASSERT(u_vec_append(vec, NULL, 1) == false);
+  ASSERT(u_vec_append(vec, NULL, 0) == true);
+  ASSERT(u_vec_bsearch(vec, &val, test_vec_cmp_int, NULL) == false);
+  u_vec_free(vec);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(vec, general) {
+  vec_t *vec;
+  int i, val, *data;
+  int arr[] = {5, 6, 7};
+
+  vec = u_vec_new(sizeof(int));
+  ASSERT(vec != NULL);
+  ASSERT(u_vec_get_size(vec) == 0);
+  for (i = 0; i < 1000; ++i) {
+    ASSERT(u_vec_push(vec, &i));
+  }
+  ASSERT(u_vec_get_size(vec) == 1000);
+  ASSERT(u_vec_get_capacity(vec) >= 1000);
+  data = u_vec_data(vec);
+  for (i = 0; i < 1000; ++i) {
+    ASSERT(data[i] == i);
+    ASSERT(*((int *) u_vec_at(vec, (size_t) i)) == i);
+  }
+  ASSERT(u_vec_at(vec, 1000) == NULL);
+  ASSERT(u_vec_pop(vec, &val) && val == 999);
+  ASSERT(u_vec_get_size(vec) == 999);
+
+  /* Insert and remove in the middle */
+  val = -1;
+  ASSERT(u_vec_insert(vec, 0, &val));
+  ASSERT(u_vec_insert(vec, 500, NULL));
+  ASSERT(u_vec_insert(vec, u_vec_get_size(vec), &val));
+  data = u_vec_data(vec);
+  ASSERT(u_vec_get_size(vec) == 1002);
+  ASSERT(data[0] == -1 && data[1] == 0);
+  ASSERT(data[500] == 0 && data[499] == 498 && data[501] == 499);
+  ASSERT(data[1001] == -1);
+  ASSERT(u_vec_remove(vec, 500, &val) && val == 0);
+  ASSERT(u_vec_remove(vec, 0, &val) && val == -1);
+  ASSERT(u_vec_remove(vec, u_vec_get_size(vec) - 1, NULL));
+  data = u_vec_data(vec);
+  for (i = 0; i < 999; ++i) {
+    ASSERT(data[i] == i);
+  }
+
+  /* Bulk append, clear and shrink */
+  ASSERT(u_vec_append(vec, arr, 3));
+  ASSERT(u_vec_get_size(vec) == 1002);
+  ASSERT(*((int *) u_vec_at(vec, 1001)) == 7);
+  u_vec_clear(vec);
+  ASSERT(u_vec_get_size(vec) == 0);
+  ASSERT(u_vec_get_capacity(vec) >= 1002);
+  ASSERT(u_vec_shrink(vec));
+  ASSERT(u_vec_get_capacity(vec) == 0);
+  ASSERT(u_vec_data(vec) == NULL);
+  ASSERT(u_vec_reserve(vec, 10));
+  ASSERT(u_vec_get_capacity(vec) == 10);
+  ASSERT(u_vec_append(vec, arr, 3));
+  ASSERT(u_vec_shrink(vec));
+  ASSERT(u_vec_get_capacity(vec) == 3);
+  u_vec_free(vec);
+  return CUTE_SUCCESS;
+}
+
+CUTEST(vec, sort) {
+  vec_t *vec;
+  size_t index;
+  int i, val, *data;
+
+  vec = u_vec_new(sizeof(int));
+  ASSERT(vec != NULL);
+  for (i = 0; i < 1000; ++i) {
+    val = (i * 7919) % 1000 * 2;
+    ASSERT(u_vec_push(vec, &val));
+  }
+  u_vec_sort(vec, test_vec_cmp_int);
+  data = u_vec_data(vec);
+  for (i = 0; i < 1000; ++i) {
+    ASSERT(data[i] == i * 2);
+  }
+  for (i = 0; i < 2000; ++i) {
+    val = i;
+    if (i % 2 == 0) {
+      ASSERT(u_vec_bsearch(vec, &val, test_vec_cmp_int, &index));
+      ASSERT(index == (size_t) i / 2);
+    } else {
+      ASSERT(!u_vec_bsearch(vec, &val, test_vec_cmp_int, &index));
+      ASSERT(index == (size_t) i / 2 + 1);
+    }
+  }
+  val = -1;
+  ASSERT(!u_vec_bsearch(vec, &val, test_vec_cmp_int, &index) && index == 0);
+
+  /* The first of equal elements is found */
+  val = 10;
+  ASSERT(u_vec_insert(vec, 5, &val));
+  ASSERT(u_vec_bsearch(vec, &val, test_vec_cmp_int, &index) && index == 5);
+  u_vec_free(vec);
+  return CUTE_SUCCESS;
+}
+
+int
+main(int ac, char **av) {
+  CUTEST_DATA test = {0};
+
+  CUTEST_PASS(vec, nomem);
+  CUTEST_PASS(vec, invalid);
+  CUTEST_PASS(vec, general);
+  CUTEST_PASS(vec, sort);
+  return EXIT_SUCCESS;
+}